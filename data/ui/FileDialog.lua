@@ -12,6 +12,7 @@ ui.templates.FileDialog = function (args)
 	local cancelLabel = args.cancelLabel or t("Cancel")
 	local onSelect    = args.onSelect    or function (name) end
 	local onCancel    = args.onCancel    or function () end
+	local filter      = args.filter      or function (name) return true end
 
 	local ok, files, _ = pcall(FileSystem.ReadDirectory, root, path)
 	if not ok then
@@ -20,7 +21,9 @@ ui.templates.FileDialog = function (args)
 	end
 
 	local list = ui:List()
-	for i = 1,#files do list:AddOption(files[i]) end
+	for i = 1,#files do
+		if filter(files[i]) then list:AddOption(files[i]) end
+	end
 
 	local selectButton = ui:Button(ui:Label(selectLabel):SetFont("HEADING_NORMAL"))
 	local cancelButton = ui:Button(ui:Label(cancelLabel):SetFont("HEADING_NORMAL"))
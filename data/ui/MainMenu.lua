@@ -29,6 +29,8 @@ local doLoadDialog = function ()
 		ui.templates.FileDialog({
 			title       = t("Select game to load..."),
 			path        = "savefiles",
+			-- skip the temporary files saves are written to
+			filter      = function (filename) return not filename:find("%.tmp$") end,
 			selectLabel = t("Load game"),
 			onSelect    = function (filename) Game.LoadGame(filename) end,
 			onCancel    = function () ui:SetInnerWidget(ui.templates.MainMenu()) end
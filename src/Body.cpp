@@ -56,9 +56,9 @@ void Body::Load(Serializer::Reader &rd, Space *space)
 	m_clipRadius = rd.Double();
 }
 
-void Body::Serialize(Serializer::Writer &_wr, Space *space)
+void Body::Serialize(Serializer::Writer &wr, Space *space)
 {
-	Serializer::Writer wr;
+	wr.BeginSection("Body");
 	wr.Int32(int(GetType()));
 	switch (GetType()) {
 		case Object::STAR:
@@ -75,7 +75,7 @@ void Body::Serialize(Serializer::Writer &_wr, Space *space)
 		default:
 			assert(0);
 	}
-	_wr.WrSection("Body", wr.GetData());
+	wr.EndSection();
 }
 
 Body *Body::Unserialize(Serializer::Reader &_rd, Space *space)
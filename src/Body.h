@@ -10,12 +10,37 @@
 #include "Frame.h"
 #include "Serializer.h"
 #include <string>
+#include <vector>
+#include <algorithm>
 
 class ObjMesh;
 class Space;
 class Camera;
+class Body;
 namespace Graphics { class Renderer; }
 
+// A set of bodies removed from space at the same time. Sort() before asking
+// Contains(), which is a binary search
+class BodyBatch {
+public:
+	typedef std::vector<const Body*>::const_iterator const_iterator;
+
+	void Add(const Body *b) { m_bodies.push_back(b); }
+	void Sort() {
+		std::sort(m_bodies.begin(), m_bodies.end());
+		m_bodies.erase(std::unique(m_bodies.begin(), m_bodies.end()), m_bodies.end());
+	}
+	bool Contains(const Body *b) const {
+		return b && std::binary_search(m_bodies.begin(), m_bodies.end(), b);
+	}
+	bool IsEmpty() const { return m_bodies.empty(); }
+	const_iterator begin() const { return m_bodies.begin(); }
+	const_iterator end() const { return m_bodies.end(); }
+
+private:
+	std::vector<const Body*> m_bodies;
+};
+
 class Body: public Object {
 public:
 	OBJDEF(Body, Object, BODY);
@@ -44,8 +69,9 @@ public:
 	virtual bool OnDamage(Object *attacker, float kgDamage) { return false; }
 	virtual void OnHaveKilled(Body *guyWeKilled) {}
 	// Note: Does not mean killed, just deleted.
-	// Override to clear any pointers you hold to the body
-	virtual void NotifyRemoved(const Body* const removedBody) {}
+	// Called once with every body removed in the same step.
+	// Override to clear any pointers you hold to those bodies
+	virtual void NotifyRemoved(const BodyBatch &removed) {}
 
 	// before all bodies have had TimeStepUpdate (their moving step),
 	// StaticUpdate() is called. Good for special collision testing (Projectiles)
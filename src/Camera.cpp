@@ -29,6 +29,7 @@ Camera::Camera(const Body *body, float width, float height, float fovY, float zn
 	m_orient(matrix3x3d::Identity()),
 	m_camFrame(0),
 	m_showCameraBody(true),
+	m_useRenderQueue(Pi::config->Int("RenderQueue") != 0),
 	m_renderer(0)
 {
 	m_onBodyDeletedConnection = m_body->onDelete.connect(sigc::mem_fun(this, &Camera::OnBodyDeleted));
@@ -177,6 +178,9 @@ void Camera::Draw(Renderer *renderer)
 		renderer->SetLights(rendererLights.size(), &rendererLights[0]);
 	}
 
+	if (m_useRenderQueue)
+		renderer->SetRenderQueue(&m_renderQueue);
+
 	for (std::list<BodyAttrs>::iterator i = m_sortedBodies.begin(); i != m_sortedBodies.end(); ++i) {
 		BodyAttrs *attrs = &(*i);
 
@@ -198,6 +202,9 @@ void Camera::Draw(Renderer *renderer)
 			attrs->body->Render(renderer, this, attrs->viewCoords, attrs->viewTransform);
 	}
 
+	// draws what's left in the queue
+	renderer->SetRenderQueue(0);
+
 	Sfx::RenderAll(renderer, Pi::game->GetSpace()->GetRootFrame(), m_camFrame);
 	UnbindAllBuffers();
 
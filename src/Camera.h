@@ -6,6 +6,7 @@
 
 #include "graphics/Frustum.h"
 #include "graphics/Light.h"
+#include "graphics/RenderQueue.h"
 #include "vector3.h"
 #include "matrix4x4.h"
 #include "Background.h"
@@ -117,6 +118,11 @@ private:
 	std::list<BodyAttrs> m_sortedBodies;
 	std::vector<LightSource> m_lightSources;
 
+	// bodies' scene graph draws, sorted to bind each material and mesh as
+	// few times as possible
+	Graphics::RenderQueue m_renderQueue;
+	bool m_useRenderQueue;
+
 	Graphics::Renderer *m_renderer;
 };
 
@@ -175,6 +175,9 @@ static void lookupBuildingListModels(citybuildinglist_t *list)
 	{
 		std::vector<std::string> filenames;
 		enumerateNewBuildings(filenames);
+		// load them all at once in the background, while this waits for
+		// each in turn
+		Pi::modelCache->Preload(filenames);
 		for (std::vector<std::string>::const_iterator it = filenames.begin();
 			it != filenames.end(); ++it)
 		{
@@ -8,6 +8,16 @@
 #include "Serializer.h"
 #include "Planet.h"
 #include "Pi.h"
+#include "Kepler.h"
+#include <algorithm>
+
+// two doubles at a time wherever the compiler is allowed to emit SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DYNAMICBODY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+DynamicBody::ForceMode DynamicBody::s_forceMode = DynamicBody::FORCES_PER_BODY;
 
 DynamicBody::DynamicBody(): ModelBody()
 {
@@ -27,6 +37,8 @@ DynamicBody::DynamicBody(): ModelBody()
 	m_externalForce = vector3d(0.0);		// do external forces calc instead?
 	m_lastForce = vector3d(0.0);
 	m_lastTorque = vector3d(0.0);
+	m_externalForcePending = false;
+	m_pendingMass = 0;
 }
 
 void DynamicBody::SetForce(const vector3d &f)
@@ -124,24 +136,7 @@ void DynamicBody::CalcExternalForce()
 	// atmospheric drag
 	if (GetFrame()->IsRotFrame() && body->IsType(Object::PLANET))
 	{
-		Planet *planet = static_cast<Planet*>(body);
-		double dist = GetPosition().Length();
-		double speed = m_vel.Length();
-		double pressure, density;
-		planet->GetAtmosphericState(dist, &pressure, &density);
-		const double radius = GetClipRadius();		// bogus, preserving behaviour
-		const double AREA = radius;
-		// ^^^ yes that is as stupid as it looks
-		const double DRAG_COEFF = 0.1; // 'smooth sphere'
-		vector3d dragDir = -m_vel.NormalizedSafe();
-		vector3d fDrag = 0.5*density*speed*speed*AREA*DRAG_COEFF*dragDir;
-
-		// make this a bit less daft at high time accel
-		// only allow atmosForce to increase by .1g per frame
-		vector3d f1g = m_atmosForce + dragDir * GetMass();
-		if (fDrag.LengthSqr() > f1g.LengthSqr()) m_atmosForce = f1g;
-		else m_atmosForce = fDrag;
-
+		UpdateAtmosForce(static_cast<Planet*>(body), GetMass());
 		m_externalForce += m_atmosForce;
 	}
 	else m_atmosForce = vector3d(0.0);
@@ -154,6 +149,223 @@ void DynamicBody::CalcExternalForce()
 	}
 }
 
+void DynamicBody::UpdateAtmosForce(const Planet *planet, double mass)
+{
+	double dist = GetPosition().Length();
+	double speed = m_vel.Length();
+	double pressure, density;
+	planet->GetAtmosphericState(dist, &pressure, &density);
+	const double radius = GetClipRadius();		// bogus, preserving behaviour
+	const double AREA = radius;
+	// ^^^ yes that is as stupid as it looks
+	const double DRAG_COEFF = 0.1; // 'smooth sphere'
+	vector3d dragDir = -m_vel.NormalizedSafe();
+	vector3d fDrag = 0.5*density*speed*speed*AREA*DRAG_COEFF*dragDir;
+
+	// make this a bit less daft at high time accel
+	// only allow atmosForce to increase by .1g per frame
+	vector3d f1g = m_atmosForce + dragDir * mass;
+	if (fDrag.LengthSqr() > f1g.LengthSqr()) m_atmosForce = f1g;
+	else m_atmosForce = fDrag;
+}
+
+// one frame's bodies, an array per component. padded to an even length so
+// the SSE2 loops don't need a tail
+struct ForceBatch {
+	void Resize(size_t n) {
+		const size_t padded = (n + 1) & ~size_t(1);
+		px.resize(padded); py.resize(padded); pz.resize(padded);
+		vx.resize(padded); vy.resize(padded); vz.resize(padded);
+		mass.resize(padded);
+		fx.resize(padded); fy.resize(padded); fz.resize(padded);
+		if (padded > n) {
+			// somewhere harmless, so the padding doesn't divide by zero
+			px[n] = 1.0; py[n] = pz[n] = 0.0;
+			vx[n] = vy[n] = vz[n] = 0.0;
+			mass[n] = 0.0;
+		}
+	}
+	size_t Size() const { return px.size(); }
+
+	std::vector<double> px, py, pz;
+	std::vector<double> vx, vy, vz;
+	std::vector<double> mass;
+	std::vector<double> fx, fy, fz;
+};
+
+static ForceBatch s_batch;
+
+// these do the same sums in the same order as CalcExternalForce(), so the
+// results match it exactly
+
+static void CalcGravity(ForceBatch &b, double bodyMass)
+{
+	size_t i = 0;
+#ifdef DYNAMICBODY_SSE2
+	const __m128d bm = _mm_set1_pd(bodyMass);
+	const __m128d g = _mm_set1_pd(G);
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d zero = _mm_setzero_pd();
+	for (; i < b.Size(); i += 2) {
+		const __m128d x = _mm_loadu_pd(&b.px[i]);
+		const __m128d y = _mm_loadu_pd(&b.py[i]);
+		const __m128d z = _mm_loadu_pd(&b.pz[i]);
+		const __m128d m1m2 = _mm_mul_pd(_mm_loadu_pd(&b.mass[i]), bm);
+		const __m128d lenSqr = _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), _mm_mul_pd(z, z));
+		const __m128d invrsqr = _mm_div_pd(one, lenSqr);
+		const __m128d force = _mm_mul_pd(_mm_mul_pd(g, m1m2), invrsqr);
+		const __m128d invr = _mm_sqrt_pd(invrsqr);
+		_mm_storeu_pd(&b.fx[i], _mm_mul_pd(_mm_mul_pd(_mm_sub_pd(zero, x), invr), force));
+		_mm_storeu_pd(&b.fy[i], _mm_mul_pd(_mm_mul_pd(_mm_sub_pd(zero, y), invr), force));
+		_mm_storeu_pd(&b.fz[i], _mm_mul_pd(_mm_mul_pd(_mm_sub_pd(zero, z), invr), force));
+	}
+#endif
+	for (; i < b.Size(); i++) {
+		const double m1m2 = b.mass[i] * bodyMass;
+		const double invrsqr = 1.0 / (b.px[i]*b.px[i] + b.py[i]*b.py[i] + b.pz[i]*b.pz[i]);
+		const double force = G*m1m2 * invrsqr;
+		const double invr = sqrt(invrsqr);
+		b.fx[i] = -b.px[i] * invr * force;
+		b.fy[i] = -b.py[i] * invr * force;
+		b.fz[i] = -b.pz[i] * invr * force;
+	}
+}
+
+// centrifugal and coriolis forces for a frame spinning at angSpeed about its
+// y axis. neither has a y component
+static void CalcRotationForces(ForceBatch &b, double angSpeed)
+{
+	size_t i = 0;
+#ifdef DYNAMICBODY_SSE2
+	const __m128d w = _mm_set1_pd(angSpeed);
+	const __m128d two = _mm_set1_pd(2.0);
+	const __m128d zero = _mm_setzero_pd();
+	for (; i < b.Size(); i += 2) {
+		const __m128d m = _mm_loadu_pd(&b.mass[i]);
+		const __m128d m2 = _mm_mul_pd(two, m);
+		__m128d fx = _mm_loadu_pd(&b.fx[i]);
+		__m128d fz = _mm_loadu_pd(&b.fz[i]);
+		// w x (w x p) = (-w*(w*px), 0, -w*(w*pz)), w x v = (w*vz, 0, -w*vx)
+		fx = _mm_sub_pd(fx, _mm_mul_pd(m, _mm_mul_pd(w, _mm_sub_pd(zero, _mm_mul_pd(w, _mm_loadu_pd(&b.px[i]))))));
+		fz = _mm_sub_pd(fz, _mm_mul_pd(m, _mm_sub_pd(zero, _mm_mul_pd(w, _mm_mul_pd(w, _mm_loadu_pd(&b.pz[i]))))));
+		fx = _mm_sub_pd(fx, _mm_mul_pd(m2, _mm_mul_pd(w, _mm_loadu_pd(&b.vz[i]))));
+		fz = _mm_sub_pd(fz, _mm_mul_pd(m2, _mm_sub_pd(zero, _mm_mul_pd(w, _mm_loadu_pd(&b.vx[i])))));
+		_mm_storeu_pd(&b.fx[i], fx);
+		_mm_storeu_pd(&b.fz[i], fz);
+	}
+#endif
+	for (; i < b.Size(); i++) {
+		const double m = b.mass[i];
+		b.fx[i] -= m * (angSpeed * -(angSpeed * b.px[i]));
+		b.fz[i] -= m * -(angSpeed * (angSpeed * b.pz[i]));
+		b.fx[i] -= 2 * m * (angSpeed * b.vz[i]);
+		b.fz[i] -= 2 * m * -(angSpeed * b.vx[i]);
+	}
+}
+
+void DynamicBody::CalcFrameExternalForces(Frame *f, DynamicBody *const *bodies, size_t numBodies)
+{
+	ForceBatch &b = s_batch;
+	b.Resize(numBodies);
+	for (size_t i = 0; i < numBodies; i++) {
+		const DynamicBody *db = bodies[i];
+		const vector3d &pos = db->GetPosition();
+		b.px[i] = pos.x; b.py[i] = pos.y; b.pz[i] = pos.z;
+		b.vx[i] = db->m_vel.x; b.vy[i] = db->m_vel.y; b.vz[i] = db->m_vel.z;
+		b.mass[i] = db->m_pendingMass;
+	}
+
+	Body *body = f->GetBody();
+	if (body && !body->IsType(Object::SPACESTATION))
+		CalcGravity(b, body->GetMass());
+	else {
+		std::fill(b.fx.begin(), b.fx.end(), 0.0);
+		std::fill(b.fy.begin(), b.fy.end(), 0.0);
+		std::fill(b.fz.begin(), b.fz.end(), 0.0);
+	}
+
+	// drag needs the atmosphere at each body, which doesn't batch
+	const bool drag = f->IsRotFrame() && body->IsType(Object::PLANET);
+	for (size_t i = 0; i < numBodies; i++) {
+		DynamicBody *db = bodies[i];
+		db->m_gravityForce = vector3d(b.fx[i], b.fy[i], b.fz[i]);
+		if (drag) {
+			db->UpdateAtmosForce(static_cast<Planet*>(body), db->m_pendingMass);
+			b.fx[i] += db->m_atmosForce.x;
+			b.fy[i] += db->m_atmosForce.y;
+			b.fz[i] += db->m_atmosForce.z;
+		}
+		else db->m_atmosForce = vector3d(0.0);
+	}
+
+	if (f->IsRotFrame())
+		CalcRotationForces(b, f->GetAngSpeed());
+
+	for (size_t i = 0; i < numBodies; i++) {
+		bodies[i]->m_externalForce = vector3d(b.fx[i], b.fy[i], b.fz[i]);
+		bodies[i]->m_externalForcePending = false;
+	}
+}
+
+static bool CompareFrame(const DynamicBody *a, const DynamicBody *b)
+{
+	return a->GetFrame() < b->GetFrame();
+}
+
+void DynamicBody::CalcExternalForces(std::vector<DynamicBody*> &bodies)
+{
+	std::sort(bodies.begin(), bodies.end(), CompareFrame);
+
+	// drag carries on from the last force, so the check needs it from before
+	std::vector<vector3d> oldAtmosForces;
+	if (s_forceMode == FORCES_CHECKED) {
+		oldAtmosForces.reserve(bodies.size());
+		for (size_t i = 0; i < bodies.size(); i++)
+			oldAtmosForces.push_back(bodies[i]->m_atmosForce);
+	}
+
+	for (size_t start = 0, end; start < bodies.size(); start = end) {
+		Frame *f = bodies[start]->GetFrame();
+		for (end = start + 1; end < bodies.size() && bodies[end]->GetFrame() == f; end++) {}
+		if (f)
+			CalcFrameExternalForces(f, &bodies[start], end - start);
+		else {
+			// no external force if not in a frame
+			for (size_t i = start; i < end; i++)
+				bodies[i]->m_externalForcePending = false;
+		}
+	}
+
+	if (s_forceMode != FORCES_CHECKED) return;
+
+	int numDiffering = 0;
+	double worstError = 0.0;
+	for (size_t i = 0; i < bodies.size(); i++) {
+		DynamicBody *db = bodies[i];
+		if (!db->GetFrame()) continue;
+		const vector3d external = db->m_externalForce;
+		const vector3d gravity = db->m_gravityForce;
+		const vector3d atmos = db->m_atmosForce;
+
+		const double mass = db->m_mass;
+		db->m_mass = db->m_pendingMass;
+		db->m_atmosForce = oldAtmosForces[i];
+		db->CalcExternalForce();
+		db->m_mass = mass;
+
+		const double error = (external - db->m_externalForce).Length() / std::max(db->m_externalForce.Length(), 1e-30);
+		if (error > 1e-9) numDiffering++;
+		worstError = std::max(worstError, error);
+
+		db->m_externalForce = external;
+		db->m_gravityForce = gravity;
+		db->m_atmosForce = atmos;
+	}
+	if (numDiffering)
+		printf("batched external forces: " SIZET_FMT " bodies, %d differ, worst relative error %g\n",
+			bodies.size(), numDiffering, worstError);
+}
+
 void DynamicBody::TimeStepUpdate(const float timeStep)
 {
 	m_oldPos = GetPosition();
@@ -182,12 +394,38 @@ void DynamicBody::TimeStepUpdate(const float timeStep)
 		m_lastTorque = m_torque;
 		m_force = vector3d(0.0);
 		m_torque = vector3d(0.0);
-		CalcExternalForce();			// regenerate for new pos/vel
+		if (s_forceMode == FORCES_PER_BODY)
+			CalcExternalForce();			// regenerate for new pos/vel
+		else {
+			// left for CalcExternalForces(), which regenerates it with the
+			// mass as it is now
+			m_externalForcePending = true;
+			m_pendingMass = m_mass;
+		}
 	} else {
 		m_oldAngDisplacement = vector3d(0.0);
 	}
 }
 
+bool DynamicBody::MoveOnRails(const float timeStep)
+{
+	// same gravity as CalcExternalForce()
+	double mu = 0.0;
+	Body *body = GetFrame()->GetBody();
+	if (body && !body->IsType(Object::SPACESTATION))
+		mu = G * body->GetMass();
+
+	vector3d pos, vel;
+	if (!Kepler::Propagate(mu, GetPosition(), m_vel, timeStep, pos, vel))
+		return false;
+
+	m_oldPos = GetPosition();
+	m_oldAngDisplacement = vector3d(0.0);
+	SetPosition(pos);
+	m_vel = vel;
+	return true;
+}
+
 void DynamicBody::UpdateInterpTransform(double alpha)
 {
 	m_interpPos = alpha*GetPosition() + (1.0-alpha)*m_oldPos;
@@ -9,6 +9,8 @@
 #include "vector3.h"
 #include "matrix4x4.h"
 
+class Planet;
+
 class DynamicBody: public ModelBody {
 public:
 	OBJDEF(DynamicBody, ModelBody, DYNAMICBODY);
@@ -29,7 +31,26 @@ public:
 	virtual double GetMass() const { return m_mass; }	// XXX don't override this
 	virtual void TimeStepUpdate(const float timeStep);
 	void CalcExternalForce();
+
+	// where the external force (gravity, drag and the rotation of the frame)
+	// is worked out after a body moves
+	enum ForceMode {
+		FORCES_PER_BODY, // by each body at the end of its TimeStepUpdate
+		FORCES_BATCHED,  // left for CalcExternalForces()
+		FORCES_CHECKED   // batched, then worked out again per body and compared
+	};
+	static void SetForceMode(ForceMode mode) { s_forceMode = mode; }
+	static ForceMode GetForceMode() { return s_forceMode; }
+	bool IsExternalForcePending() const { return m_externalForcePending; }
+	// works out the external force on bodies left pending by TimeStepUpdate.
+	// the bodies of each frame are gathered into arrays and done together.
+	// sorts the list
+	static void CalcExternalForces(std::vector<DynamicBody*> &bodies);
 	void UndoTimestep();
+	// moves the body exactly as if it were falling freely in its frame, for
+	// bodies with nothing else acting on them. returns false if the orbit
+	// couldn't be worked out
+	bool MoveOnRails(float timeStep);
 
 	void SetMass(double);
 	void AddForce(const vector3d &);
@@ -51,6 +72,11 @@ protected:
 	virtual void Save(Serializer::Writer &wr, Space *space);
 	virtual void Load(Serializer::Reader &rd, Space *space);
 private:
+	static void CalcFrameExternalForces(Frame *f, DynamicBody *const *bodies, size_t numBodies);
+	void UpdateAtmosForce(const Planet *planet, double mass);
+
+	static ForceMode s_forceMode;
+
 	vector3d m_oldPos;
 	vector3d m_oldAngDisplacement;
 
@@ -69,6 +95,9 @@ private:
 	// for time accel reduction fudge
 	vector3d m_lastForce;
 	vector3d m_lastTorque;
+
+	bool m_externalForcePending;
+	double m_pendingMass; // the mass when the force was left pending
 };
 
 #endif /* _DYNAMICBODY_H */
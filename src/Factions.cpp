@@ -336,6 +336,7 @@ void Faction::Init()
 
 	printf("Number of factions added: " SIZET_FMT "\n", s_factions.size());
 	StarSystem::ShrinkCache();    // clear the star system cache of anything we used for faction generation
+	Sector::ShrinkCache();        // and the sectors, whose names and factions depend on the homeworlds
 }
 
 void Faction::Uninit()
@@ -375,7 +376,7 @@ const Uint32 Faction::GetNumFactions()
 	if it is, then the passed distance will also be updated to be the distance
 	from the factions homeworld to the sysPath.
 */
-const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector sec, Uint32 sysIndex)
+const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector &sec, Uint32 sysIndex)
 {
 	/*	Treat factions without homeworlds as if they are of effectively infinite radius,
 		so every world is potentially within their borders, but also treat them as if
@@ -394,7 +395,9 @@ const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector
 		/* ...otherwise we need to calculate whether the world is inside the
 		   the faction border, and how far away it is. */
 		else {
-			if (!m_homesector) m_homesector = new Sector(homeworld.sectorX, homeworld.sectorY, homeworld.sectorZ);
+			// m_homesector was made along with the homeworld, before the faction
+			// was registered, and never changes after, so no lock is needed here
+			assert(m_homesector);
 			distance = Sector::DistanceBetween(m_homesector, homeworld.systemIndex, &sec, sysIndex);
 			inside   = distance < Radius();
 		}
@@ -412,7 +415,7 @@ const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector
 	}
 }
 
-Faction* Faction::GetNearestFaction(const Sector sec, Uint32 sysIndex)
+Faction* Faction::GetNearestFaction(const Sector &sec, Uint32 sysIndex)
 {
 	/* firstly if this a custom StarSystem it may already have a faction assigned
 	*/
@@ -500,6 +503,13 @@ void Faction::SetBestFitHomeworld(Sint32 x, Sint32 y, Sint32 z, Sint32 si, Uint3
 		i++;
 	}
 	homeworld = SystemPath(x, y, z, si);
+
+	// sectors are generated on several threads at once, and all of them read
+	// this, so make it now while only the faction loader can see the faction.
+	// not from the sector cache: cached sectors have their factions assigned,
+	// which would come back here
+	delete m_homesector;
+	m_homesector = (si >= 0) ? new Sector(x, y, z) : 0;
 }
 
 Faction::Faction() :
@@ -538,7 +548,7 @@ void FactionOctsapling::Add(Faction* faction)
 		This part happens at faction generation time so shouldn't be too performance
 		critical
 	*/
-	Sector sec = Sector(faction->homeworld.sectorX, faction->homeworld.sectorY, faction->homeworld.sectorZ);
+	Sector sec(faction->homeworld.sectorX, faction->homeworld.sectorY, faction->homeworld.sectorZ);
 
 	/* only factions with homeworlds that are available at faction generation time can
 	   be added to specific cells...
@@ -22,7 +22,7 @@ public:
 	// XXX this is not as const-safe as it should be
 	static Faction *GetFaction       (const Uint32 index);
 	static Faction *GetFaction       (const std::string factionName);
-	static Faction *GetNearestFaction(const Sector sec, Uint32 sysIndex);
+	static Faction *GetNearestFaction(const Sector &sec, Uint32 sysIndex);
 	static bool     IsHomeSystem     (const SystemPath& sysPath);
 
 	static const Uint32 GetNumFactions();
@@ -77,7 +77,7 @@ private:
 	static const double FACTION_CURRENT_YEAR;	// used to calculate faction radius
 
 	Sector* m_homesector;						// cache of home sector to use in distance calculations
-	const bool IsCloserAndContains(double& closestFactionDist, const Sector sec, Uint32 sysIndex);
+	const bool IsCloserAndContains(double& closestFactionDist, const Sector &sec, Uint32 sysIndex);
 };
 
 /* One day it might grow up to become a full tree, on the  other hand it might be
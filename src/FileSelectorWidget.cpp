@@ -6,6 +6,7 @@
 #include "utils.h"
 #include "Pi.h"
 #include "FileSystem.h"
+#include "Game.h"
 
 class SimpleLabelButton: public Gui::LabelButton
 {
@@ -56,6 +57,7 @@ void FileSelectorWidget::ShowAll()
 	for (FileSystem::FileEnumerator files(FileSystem::userFiles, Pi::SAVE_DIR_NAME); !files.Finished(); files.Next())
 	{
 		const std::string name = files.Current().GetName();
+		if (Game::IsTempSaveFile(name)) continue;
 		b = new SimpleLabelButton(new Gui::Label(name));
 		b->onClick.connect(sigc::bind(sigc::mem_fun(this, &FileSelectorWidget::OnClickFile), name));
 		vbox->PackEnd(b);
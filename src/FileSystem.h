@@ -175,6 +175,9 @@ namespace FileSystem {
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
 
 		bool MakeDirectory(const std::string &path);
+		bool RemoveFile(const std::string &path);
+		// replaces newPath if it exists, in one step where the OS allows
+		bool RenameFile(const std::string &oldPath, const std::string &newPath);
 
 		enum WriteFlags {
 			WRITE_TEXT = 1
@@ -184,6 +187,9 @@ namespace FileSystem {
 		FILE* OpenReadStream(const std::string &path);
 		// similar to fopen(path, "wb")
 		FILE* OpenWriteStream(const std::string &path, int flags = 0);
+		// flushes everything written to the stream so far out to the disk,
+		// so it survives a crash. do this before renaming over another file
+		static bool SyncWriteStream(FILE *f);
 	};
 
 	class FileSourceUnion : public FileSource {
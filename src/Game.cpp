@@ -22,7 +22,11 @@
 #include "LuaEvent.h"
 #include "ObjectViewerView.h"
 #include "FileSystem.h"
+#include "OS.h"
+#include "Lang.h"
+#include "SaveContainer.h"
 #include "graphics/Renderer.h"
+#include <deque>
 
 static const int  s_saveVersion   = 60;
 static const char s_saveStart[]   = "PIONEER";
@@ -174,58 +178,57 @@ void Game::Serialize(Serializer::Writer &wr)
 	// version
 	wr.Int32(s_saveVersion);
 
-	Serializer::Writer section;
-
 	// space, all the bodies and things
-	m_space->Serialize(section);
-	wr.WrSection("Space", section.GetData());
+	wr.BeginSection("Space");
+	m_space->Serialize(wr);
+	wr.EndSection();
 
 
 	// game state and space transition state
-	section = Serializer::Writer();
+	wr.BeginSection("Game");
 
-	section.Int32(m_space->GetIndexForBody(m_player.Get()));
+	wr.Int32(m_space->GetIndexForBody(m_player.Get()));
 
 	// hyperspace clouds being brought over from the previous system
-	section.Int32(m_hyperspaceClouds.size());
+	wr.Int32(m_hyperspaceClouds.size());
 	for (std::list<HyperspaceCloud*>::const_iterator i = m_hyperspaceClouds.begin(); i != m_hyperspaceClouds.end(); ++i)
-		(*i)->Serialize(section, m_space.Get());
+		(*i)->Serialize(wr, m_space.Get());
 
-	section.Double(m_time);
-	section.Int32(Uint32(m_state));
+	wr.Double(m_time);
+	wr.Int32(Uint32(m_state));
 
-	section.Bool(m_wantHyperspace);
-	section.Double(m_hyperspaceProgress);
-	section.Double(m_hyperspaceDuration);
-	section.Double(m_hyperspaceEndTime);
+	wr.Bool(m_wantHyperspace);
+	wr.Double(m_hyperspaceProgress);
+	wr.Double(m_hyperspaceDuration);
+	wr.Double(m_hyperspaceEndTime);
 
-	wr.WrSection("Game", section.GetData());
+	wr.EndSection();
 
 
 	// system political data (crime etc)
-	section = Serializer::Writer();
-	Polit::Serialize(section);
-	wr.WrSection("Polit", section.GetData());
+	wr.BeginSection("Polit");
+	Polit::Serialize(wr);
+	wr.EndSection();
 
 
 	// views. must be saved in init order
-	section = Serializer::Writer();
-	Pi::cpan->Save(section);
-	wr.WrSection("ShipCpanel", section.GetData());
+	wr.BeginSection("ShipCpanel");
+	Pi::cpan->Save(wr);
+	wr.EndSection();
 
-	section = Serializer::Writer();
-	Pi::sectorView->Save(section);
-	wr.WrSection("SectorView", section.GetData());
+	wr.BeginSection("SectorView");
+	Pi::sectorView->Save(wr);
+	wr.EndSection();
 
-	section = Serializer::Writer();
-	Pi::worldView->Save(section);
-	wr.WrSection("WorldView", section.GetData());
+	wr.BeginSection("WorldView");
+	Pi::worldView->Save(wr);
+	wr.EndSection();
 
 
 	// lua
-	section = Serializer::Writer();
-	Pi::luaSerializer->Serialize(section);
-	wr.WrSection("LuaModules", section.GetData());
+	wr.BeginSection("LuaModules");
+	Pi::luaSerializer->Serialize(wr);
+	wr.EndSection();
 
 
 	// trailing signature
@@ -383,7 +386,9 @@ void Game::SwitchToHyperspace()
 		// want the player to have any memory of what they were (we're just
 		// reusing them for convenience). tell the player it was deleted so it
 		// can clean up
-		m_player->NotifyRemoved(cloud);
+		BodyBatch removed;
+		removed.Add(cloud);
+		m_player->NotifyRemoved(removed);
 
 		// turn the cloud arround
 		cloud->GetShip()->SetHyperspaceDest(m_hyperspaceSource);
@@ -687,33 +692,297 @@ void Game::DestroyViews()
 	Pi::cpan = 0;
 }
 
+static double Msec(Uint64 from, Uint64 to)
+{
+	return 1000.0 * double(to - from) / double(OS::HFTimerFreq());
+}
+
+static RefCountedPtr<FileSystem::FileData> UnpackSave(const RefCountedPtr<FileSystem::FileData> &packed, int &numBlocks)
+{
+	size_t size;
+	char *data = SaveContainer::Unpack(packed->GetData(), packed->GetSize(), OS::GetNumCPUs(), size, numBlocks);
+	return RefCountedPtr<FileSystem::FileData>(new FileSystem::FileDataMalloc(packed->GetInfo(), size, data));
+}
+
 Game *Game::LoadGame(const std::string &filename)
 {
 	printf("Game::LoadGame('%s')\n", filename.c_str());
-	FILE *f = FileSystem::userFiles.OpenReadStream(FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename));
-	if (!f) throw CouldNotOpenFileException();
-	Serializer::Reader rd(f);
-	fclose(f);
-	return new Game(rd);
+	// it might be in the middle of being saved
+	FinishBackgroundSaves();
+
+	const Uint64 start = OS::HFTimer();
+	RefCountedPtr<FileSystem::FileData> data = FileSystem::userFiles.ReadFile(FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename));
+	if (!data) throw CouldNotOpenFileException();
+	const size_t fileSize = data->GetSize();
+	const Uint64 read = OS::HFTimer();
+
+	// plain saves from before packing, or with CompressSaves off, are read
+	// as they are
+	int numBlocks = 0;
+	if (SaveContainer::IsContainer(data->GetData(), data->GetSize()))
+		data = UnpackSave(data, numBlocks);
+	const Uint64 unpacked = OS::HFTimer();
+
+	Serializer::Reader rd(data);
+	Game *game = new Game(rd);
+	const Uint64 end = OS::HFTimer();
+
+	printf("Game::LoadGame: read " SIZET_FMT " bytes in %.1f ms, unpacked %d blocks to " SIZET_FMT " bytes in %.1f ms, loaded in %.1f ms\n",
+		fileSize, Msec(start, read), numBlocks, data->GetSize(), Msec(read, unpacked), Msec(unpacked, end));
+	return game;
+}
+
+// saves are written next to the real file, which is only replaced once the
+// whole save is safely on disk. only one save may write a file at a time
+static const char TEMP_SAVE_SUFFIX[] = ".tmp";
+
+static std::string TempSavePath(const std::string &path)
+{
+	return path + TEMP_SAVE_SUFFIX;
+}
+
+bool Game::IsTempSaveFile(const std::string &filename)
+{
+	const size_t len = sizeof(TEMP_SAVE_SUFFIX) - 1;
+	return filename.size() > len && filename.compare(filename.size() - len, len, TEMP_SAVE_SUFFIX) == 0;
+}
+
+// writes a save taken in memory, packing it first if asked to
+static bool WriteSaveFile(const std::string &filename, const std::string &data, bool pack)
+{
+	std::string packed;
+	if (pack)
+		SaveContainer::Pack(data.data(), data.size(), packed);
+	const std::string &out = pack ? packed : data;
+
+	const std::string path = FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename);
+	const std::string tmpPath = TempSavePath(path);
+	FILE *f = FileSystem::userFiles.OpenWriteStream(tmpPath);
+	if (!f) return false;
+
+	// synced first, or a crash just after the rename can leave an empty save
+	const bool written = fwrite(out.data(), out.size(), 1, f) == 1 &&
+		FileSystem::FileSourceFS::SyncWriteStream(f);
+	if (fclose(f) != 0 || !written || !FileSystem::userFiles.RenameFile(tmpPath, path)) {
+		FileSystem::userFiles.RemoveFile(tmpPath);
+		return false;
+	}
+	return true;
 }
 
 void Game::SaveGame(const std::string &filename, Game *game)
 {
 	assert(game);
+
+	// a background save may be writing the same temporary file
+	FinishBackgroundSaves();
+
 	if (!FileSystem::userFiles.MakeDirectory(Pi::SAVE_DIR_NAME)) {
 		throw CouldNotOpenFileException();
 	}
 
+	const std::string path = FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename);
+	const std::string tmpPath = TempSavePath(path);
+	FILE *f = FileSystem::userFiles.OpenWriteStream(tmpPath);
+	if (!f) throw CouldNotOpenFileException();
+
+	try {
+		Serializer::Writer wr(f, Pi::config->Int("CompressSaves"));
+		game->Serialize(wr);
+		wr.Flush();
+		if (!FileSystem::FileSourceFS::SyncWriteStream(f))
+			throw CouldNotWriteToFileException();
+	} catch (...) {
+		fclose(f);
+		FileSystem::userFiles.RemoveFile(tmpPath);
+		throw;
+	}
+
+	if (fclose(f) != 0 || !FileSystem::userFiles.RenameFile(tmpPath, path)) {
+		FileSystem::userFiles.RemoveFile(tmpPath);
+		throw CouldNotWriteToFileException();
+	}
+}
+
+void Game::ConvertSaveGame(const std::string &filename, bool pack)
+{
+	const Uint64 start = OS::HFTimer();
+	RefCountedPtr<FileSystem::FileData> data = FileSystem::userFiles.ReadFile(FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename));
+	if (!data) throw CouldNotOpenFileException();
+	const size_t fileSize = data->GetSize();
+
+	if (SaveContainer::IsContainer(data->GetData(), data->GetSize()) == pack) {
+		printf("'%s' is already %s\n", filename.c_str(), pack ? "packed" : "plain");
+		return;
+	}
+
+	std::string out;
+	if (pack)
+		SaveContainer::Pack(data->GetData(), data->GetSize(), out);
+	else {
+		int numBlocks;
+		data = UnpackSave(data, numBlocks);
+		out.assign(data->GetData(), data->GetSize());
+	}
+	if (!WriteSaveFile(filename, out, false))
+		throw CouldNotWriteToFileException();
+
+	printf("'%s': " SIZET_FMT " bytes %s to " SIZET_FMT " bytes in %.1f ms\n", filename.c_str(),
+		fileSize, pack ? "packed" : "unpacked", out.size(),
+		Msec(start, OS::HFTimer()));
+}
+
+// a save that's been taken but not yet written
+struct BackgroundSave {
+	std::string filename;
+	std::string data;
+	bool pack;
+	double snapshotMsec;
+};
+
+static SDL_Thread *s_saveThread = 0;
+static SDL_mutex *s_saveLock = 0;     // protects everything below
+static SDL_cond *s_saveQueued = 0;    // signalled when a save is queued
+static SDL_cond *s_saveFinished = 0;  // signalled when a save has been written
+static std::deque<BackgroundSave*> s_pendingSaves;
+static bool s_saveThreadBusy = false;
+static bool s_saveThreadQuit = false;
+static std::vector<std::pair<std::string,bool> > s_finishedSaves; // filename, success
+static Game::SaveStats s_lastSaveStats;
+
+static int SaveThread(void *)
+{
+	SDL_mutexP(s_saveLock);
+	for (;;) {
+		while (s_pendingSaves.empty() && !s_saveThreadQuit)
+			SDL_CondWait(s_saveQueued, s_saveLock);
+		if (s_pendingSaves.empty()) break;
+		BackgroundSave *save = s_pendingSaves.front();
+		s_pendingSaves.pop_front();
+		s_saveThreadBusy = true;
+		SDL_mutexV(s_saveLock);
+
+		const Uint64 start = OS::HFTimer();
+		const bool ok = WriteSaveFile(save->filename, save->data, save->pack);
+		const double writeMsec = 1000.0 * double(OS::HFTimer() - start) / double(OS::HFTimerFreq());
+		printf("background save of '%s': written in %.1f ms\n", save->filename.c_str(), writeMsec);
+
+		SDL_mutexP(s_saveLock);
+		s_saveThreadBusy = false;
+		s_finishedSaves.push_back(std::make_pair(save->filename, ok));
+		s_lastSaveStats.snapshotMsec = save->snapshotMsec;
+		s_lastSaveStats.writeMsec = writeMsec;
+		s_lastSaveStats.bytes = save->data.size();
+		SDL_CondBroadcast(s_saveFinished);
+		delete save;
+	}
+	SDL_mutexV(s_saveLock);
+	return 0;
+}
+
+void Game::SaveGameInBackground(const std::string &filename, Game *game)
+{
+	assert(game);
+	if (!FileSystem::userFiles.MakeDirectory(Pi::SAVE_DIR_NAME)) {
+		throw CouldNotOpenFileException();
+	}
+
+	// everything up to the hand over is time the game is stopped for
+	const Uint64 start = OS::HFTimer();
+
 	Serializer::Writer wr;
 	game->Serialize(wr);
 
-	const std::string data = wr.GetData();
+	BackgroundSave *save = new BackgroundSave;
+	save->filename = filename;
+	save->data = wr.GetData();
+	save->pack = Pi::config->Int("CompressSaves");
+	save->snapshotMsec = 1000.0 * double(OS::HFTimer() - start) / double(OS::HFTimerFreq());
+	printf("background save of '%s': %.1f ms on the main thread, " SIZET_FMT " bytes\n",
+		filename.c_str(), save->snapshotMsec, save->data.size());
+
+	if (!s_saveThread) {
+		s_saveLock = SDL_CreateMutex();
+		s_saveQueued = SDL_CreateCond();
+		s_saveFinished = SDL_CreateCond();
+		s_saveThread = SDL_CreateThread(SaveThread, 0);
+	}
 
-	FILE *f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPathBelow(Pi::SAVE_DIR_NAME, filename));
-	if (!f) throw CouldNotOpenFileException();
+	SDL_mutexP(s_saveLock);
+	// a newer snapshot of a file replaces one that's still waiting
+	bool replaced = false;
+	for (std::deque<BackgroundSave*>::iterator i = s_pendingSaves.begin(); i != s_pendingSaves.end(); ++i) {
+		if ((*i)->filename == filename) {
+			delete *i;
+			*i = save;
+			replaced = true;
+			break;
+		}
+	}
+	if (!replaced)
+		s_pendingSaves.push_back(save);
+	SDL_CondSignal(s_saveQueued);
+	SDL_mutexV(s_saveLock);
+}
+
+void Game::UpdateBackgroundSaves()
+{
+	if (!s_saveThread) return;
+
+	std::vector<std::pair<std::string,bool> > finished;
+	SDL_mutexP(s_saveLock);
+	finished.swap(s_finishedSaves);
+	SDL_mutexV(s_saveLock);
+
+	for (std::vector<std::pair<std::string,bool> >::const_iterator i = finished.begin(); i != finished.end(); ++i) {
+		if (!Pi::cpan) continue;
+		if (i->second)
+			Pi::cpan->MsgLog()->Message("", Lang::GAME_SAVED_TO + FileSystem::JoinPath(Pi::GetSaveDir(), i->first));
+		else
+			Pi::cpan->MsgLog()->Message("", Lang::GAME_SAVE_CANNOT_WRITE);
+	}
+}
 
-	size_t nwritten = fwrite(data.data(), data.length(), 1, f);
-	fclose(f);
+void Game::FinishBackgroundSaves()
+{
+	if (!s_saveThread) return;
+
+	SDL_mutexP(s_saveLock);
+	while (!s_pendingSaves.empty() || s_saveThreadBusy)
+		SDL_CondWait(s_saveFinished, s_saveLock);
+	SDL_mutexV(s_saveLock);
+}
+
+void Game::StopBackgroundSaves()
+{
+	if (!s_saveThread) return;
+
+	// the thread writes everything still queued before it stops
+	SDL_mutexP(s_saveLock);
+	s_saveThreadQuit = true;
+	SDL_CondSignal(s_saveQueued);
+	SDL_mutexV(s_saveLock);
+	SDL_WaitThread(s_saveThread, 0);
+
+	SDL_DestroyCond(s_saveFinished);
+	SDL_DestroyCond(s_saveQueued);
+	SDL_DestroyMutex(s_saveLock);
+	s_saveThread = 0;
+	s_saveLock = 0;
+	s_saveQueued = s_saveFinished = 0;
+	s_saveThreadQuit = false;
+	s_finishedSaves.clear();
+}
+
+Game::SaveStats Game::GetLastSaveStats()
+{
+	if (!s_saveThread) {
+		SaveStats stats = { 0.0, 0.0, 0 };
+		return stats;
+	}
 
-	if (nwritten != 1) throw CouldNotWriteToFileException();
+	SDL_mutexP(s_saveLock);
+	const SaveStats stats = s_lastSaveStats;
+	SDL_mutexV(s_saveLock);
+	return stats;
 }
@@ -21,6 +21,32 @@ public:
 	// XXX game arg should be const, and this should probably be a member function
 	// (or LoadGame/SaveGame should be somewhere else entirely)
 	static void SaveGame(const std::string &filename, Game *game);
+	// packs a plain save, or unpacks a packed one, where it is. either sort
+	// loads; this is for saves from before packing, or for looking inside one
+	static void ConvertSaveGame(const std::string &filename, bool pack);
+
+	// snapshots the game in memory, then writes it out on a background
+	// thread. throws if the snapshot can't be taken; write failures show up
+	// in the message log once UpdateBackgroundSaves() sees them
+	static void SaveGameInBackground(const std::string &filename, Game *game);
+	// report finished background saves. main thread only
+	static void UpdateBackgroundSaves();
+	// block until every background save has been written
+	static void FinishBackgroundSaves();
+	// write anything still queued and stop the background save thread
+	static void StopBackgroundSaves();
+
+	// true for the temporary file a save is written to before it replaces
+	// the real one. these should never be offered for loading
+	static bool IsTempSaveFile(const std::string &filename);
+
+	struct SaveStats {
+		double snapshotMsec; // main thread
+		double writeMsec;    // background thread
+		size_t bytes;
+	};
+	// timings for the most recent background save
+	static SaveStats GetLastSaveStats();
 
 	// start docked in station referenced by path
 	Game(const SystemPath &path);
@@ -31,6 +31,18 @@ GameConfig::GameConfig()
 	map["SectorViewZRotation"] = "0";
 	map["SectorViewZoom"] = "2.0";
 	map["MaxPhysicsCyclesPerRender"] = "4";
+	map["PipelinedFrames"] = "0"; // 1 = step physics while the GPU draws, a frame behind
+	map["CollisionThreads"] = "0"; // 0 = one per CPU
+	map["ShipRailsDistance"] = "1000"; // in km, 0 = always simulate ships. only above 1x time accel
+	map["BatchedForces"] = "1"; // 0 = per body, 2 = batched and checked
+	map["TerrainThreads"] = "0"; // 0 = one per CPU
+	map["TerrainCacheSize"] = "0"; // in MB, 0 = no terrain cache (and empties it). -terrainbenchmark times it
+	map["SystemThreads"] = "2"; // 0 = no background system generation
+	map["ModelThreads"] = "2"; // 0 = load models only when they're needed
+	map["RenderQueue"] = "1"; // 0 = draw each model as it comes, unsorted
+	map["SystemCacheSize"] = "32"; // in MB, for systems not in use
+	map["AutosaveInterval"] = "0"; // in minutes, 0 = no autosave
+	map["CompressSaves"] = "1"; // 0 = plain saves, bigger but with nothing to unpack
 	map["AntiAliasingMode"] = "2";
 	map["JoystickDeadzone"] = "0.1";
 	map["DefaultLowThrustPower"] = "0.25";
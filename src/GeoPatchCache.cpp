@@ -0,0 +1,347 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GeoPatchCache.h"
+#include "FileSystem.h"
+#include "Pi.h"
+#include "galaxy/StarSystem.h"
+#include "terrain/Terrain.h"
+#include <list>
+#include <map>
+
+extern "C" {
+#include "miniz/miniz.h"
+}
+
+// bump this whenever the terrain code changes what it generates, so old
+// entries stop matching
+static const Uint32 CACHE_VERSION = 2;
+
+static const char CACHE_DIR[] = "terraincache";
+static const char INDEX_FILE[] = "terraincache/index.txt";
+static const char FILE_MAGIC[4] = { 'G', 'P', 'C', '2' };
+
+namespace GeoPatchCache {
+
+struct Entry {
+	Uint64 size;
+	std::list<std::string>::iterator lru;
+};
+
+static bool s_enabled = false;
+static Uint64 s_maxBytes;
+static Uint64 s_totalBytes;
+static SDL_mutex *s_lock = 0;
+
+// filename -> entry. s_lru holds the same filenames, most recently used first
+static std::map<std::string,Entry> s_entries;
+static std::list<std::string> s_lru;
+
+static Stats s_stats;
+
+static void AddEntry(const std::string &filename, Uint64 size, bool recent)
+{
+	Entry &e = s_entries[filename];
+	e.size = size;
+	e.lru = recent ? s_lru.insert(s_lru.begin(), filename) : s_lru.insert(s_lru.end(), filename);
+	s_totalBytes += size;
+}
+
+// call with s_lock held
+static void Evict()
+{
+	while (s_totalBytes > s_maxBytes && !s_lru.empty()) {
+		const std::string filename = s_lru.back();
+		s_lru.pop_back();
+		std::map<std::string,Entry>::iterator i = s_entries.find(filename);
+		s_totalBytes -= i->second.size;
+		s_entries.erase(i);
+		FileSystem::userFiles.RemoveFile(FileSystem::JoinPath(CACHE_DIR, filename));
+		s_stats.evictions++;
+	}
+}
+
+static Uint64 GetFileSize(const std::string &path)
+{
+	FILE *f = FileSystem::userFiles.OpenReadStream(path);
+	if (!f) return 0;
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fclose(f);
+	return size > 0 ? Uint64(size) : 0;
+}
+
+void Init(Uint64 maxBytes)
+{
+	s_maxBytes = maxBytes;
+	s_totalBytes = 0;
+	memset(&s_stats, 0, sizeof(s_stats));
+	if (maxBytes == 0) {
+		// turned off, so give back the disk space from when it was on
+		if (FileSystem::userFiles.Lookup(CACHE_DIR).IsDir()) {
+			std::vector<std::string> files;
+			for (FileSystem::FileEnumerator i(FileSystem::userFiles, CACHE_DIR); !i.Finished(); i.Next())
+				files.push_back(i.Current().GetPath());
+			for (std::vector<std::string>::const_iterator i = files.begin(); i != files.end(); ++i)
+				FileSystem::userFiles.RemoveFile(*i);
+		}
+		s_enabled = false;
+		return;
+	}
+	s_enabled = FileSystem::userFiles.MakeDirectory(CACHE_DIR);
+	if (!s_enabled) return;
+
+	s_lock = SDL_CreateMutex();
+
+	// the index remembers the use order from last time. it lists most
+	// recent first, with the size of each entry
+	RefCountedPtr<FileSystem::FileData> index = FileSystem::userFiles.ReadFile(INDEX_FILE);
+	if (index) {
+		StringRange data = index->AsStringRange();
+		while (!data.Empty()) {
+			const std::string line = data.ReadLine().StripSpace().ToString();
+			char filename[64];
+			unsigned long long size;
+			if (sscanf(line.c_str(), "%63s %llu", filename, &size) != 2) continue;
+			if (!FileSystem::userFiles.Lookup(FileSystem::JoinPath(CACHE_DIR, filename)).IsFile()) continue;
+			if (s_entries.count(filename)) continue;
+			AddEntry(filename, size, false);
+		}
+	}
+
+	// anything the index doesn't know about (eg after a crash) is treated
+	// as the oldest
+	for (FileSystem::FileEnumerator files(FileSystem::userFiles, CACHE_DIR); !files.Finished(); files.Next()) {
+		const FileSystem::FileInfo &info = files.Current();
+		const std::string filename = info.GetName();
+		if (info.GetPath() == INDEX_FILE || s_entries.count(filename)) continue;
+		AddEntry(filename, GetFileSize(info.GetPath()), false);
+	}
+
+	// the budget may have shrunk since last time
+	Evict();
+}
+
+void Uninit()
+{
+	if (!s_enabled) return;
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(INDEX_FILE, FileSystem::FileSourceFS::WRITE_TEXT);
+	if (f) {
+		for (std::list<std::string>::const_iterator i = s_lru.begin(); i != s_lru.end(); ++i)
+			fprintf(f, "%s %llu\n", i->c_str(), static_cast<unsigned long long>(s_entries[*i].size));
+		fclose(f);
+	}
+
+	s_entries.clear();
+	s_lru.clear();
+	SDL_DestroyMutex(s_lock);
+	s_lock = 0;
+	s_enabled = false;
+}
+
+bool IsEnabled()
+{
+	return s_enabled;
+}
+
+template <typename T>
+static void AppendValue(std::string &out, const T &value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void AppendString(std::string &out, const char *s)
+{
+	out.append(s ? s : "");
+	out.push_back('\0');
+}
+
+Key::Key(const SystemBody *body, const Terrain *terrain, int edgeLen, const vector3d corners[4])
+{
+	AppendValue(m_data, CACHE_VERSION);
+
+	AppendValue(m_data, body->path.sectorX);
+	AppendValue(m_data, body->path.sectorY);
+	AppendValue(m_data, body->path.sectorZ);
+	AppendValue(m_data, body->path.systemIndex);
+	AppendValue(m_data, body->path.bodyIndex);
+
+	// everything the terrain reads from the body, in case a custom system
+	// changes under us
+	AppendValue(m_data, body->seed);
+	AppendValue(m_data, Sint32(body->type));
+	AppendValue(m_data, body->radius.v);
+	AppendValue(m_data, body->mass.v);
+	AppendValue(m_data, body->averageTemp);
+	AppendValue(m_data, body->m_volatileGas.v);
+	AppendValue(m_data, body->m_volatileLiquid.v);
+	AppendValue(m_data, body->m_volatileIces.v);
+	AppendValue(m_data, body->m_volcanicity.v);
+	AppendValue(m_data, body->m_life.v);
+	AppendString(m_data, body->heightMapFilename);
+	AppendValue(m_data, body->heightMapFractal);
+
+	AppendString(m_data, terrain->GetHeightFractalName());
+	AppendString(m_data, terrain->GetColorFractalName());
+	AppendValue(m_data, Pi::detail.textures);
+	AppendValue(m_data, Pi::detail.fracmult);
+	AppendValue(m_data, edgeLen);
+
+	for (int i = 0; i < 4; i++) {
+		AppendValue(m_data, corners[i].x);
+		AppendValue(m_data, corners[i].y);
+		AppendValue(m_data, corners[i].z);
+	}
+
+	// 64-bit FNV-1a. the full key is kept in the file too, so a collision
+	// only costs a miss
+	Uint64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < m_data.size(); i++) {
+		hash ^= Uint8(m_data[i]);
+		hash *= 1099511628211ULL;
+	}
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%08x%08x.gpc", Uint32(hash >> 32), Uint32(hash));
+	m_filename = filename;
+}
+
+// file layout: magic, key size, key, height count, colour count, packed
+// size, then heights and colours (3 each) deflated together, all as
+// doubles so a hit gives exactly what generating would have. native byte
+// order, since the cache never leaves the machine
+
+bool Load(const Key &key, std::vector<double> &heights, std::vector<vector3d> &colors)
+{
+	if (!s_enabled) return false;
+
+	SDL_mutexP(s_lock);
+	std::map<std::string,Entry>::iterator i = s_entries.find(key.GetFilename());
+	const bool known = (i != s_entries.end());
+	if (known) {
+		// most recently used now
+		s_lru.erase(i->second.lru);
+		i->second.lru = s_lru.insert(s_lru.begin(), key.GetFilename());
+	}
+	SDL_mutexV(s_lock);
+
+	bool ok = false;
+	if (known) {
+		RefCountedPtr<FileSystem::FileData> fd = FileSystem::userFiles.ReadFile(FileSystem::JoinPath(CACHE_DIR, key.GetFilename()));
+		ByteRange data = fd ? fd->AsByteRange() : ByteRange();
+
+		char magic[4];
+		Uint32 keySize = 0, numHeights = 0, numColors = 0, packedSize = 0;
+		if (data.read(magic, 4, 1) == 1 && memcmp(magic, FILE_MAGIC, 4) == 0 &&
+				data.read(reinterpret_cast<char*>(&keySize), 4, 1) == 1 &&
+				keySize == key.GetData().size() && data.Size() >= keySize &&
+				memcmp(data.begin, key.GetData().data(), keySize) == 0) {
+			data.begin += keySize;
+			if (data.read(reinterpret_cast<char*>(&numHeights), 4, 1) == 1 &&
+					data.read(reinterpret_cast<char*>(&numColors), 4, 1) == 1 &&
+					data.read(reinterpret_cast<char*>(&packedSize), 4, 1) == 1 &&
+					data.Size() == packedSize) {
+				const size_t rawSize = (numHeights + numColors*3) * sizeof(double);
+				std::vector<unsigned char> raw(std::max(rawSize, size_t(1)));
+				mz_ulong unpackedSize = rawSize;
+				if (mz_uncompress(&raw[0], &unpackedSize, reinterpret_cast<const unsigned char*>(data.begin), packedSize) == MZ_OK &&
+						unpackedSize == rawSize) {
+					heights.resize(numHeights);
+					if (numHeights) memcpy(&heights[0], &raw[0], numHeights*sizeof(double));
+					const double *c = reinterpret_cast<const double*>(&raw[numHeights*sizeof(double)]);
+					colors.resize(numColors);
+					for (Uint32 j = 0; j < numColors; j++, c += 3)
+						colors[j] = vector3d(c[0], c[1], c[2]);
+					ok = true;
+				}
+			}
+		}
+	}
+
+	SDL_mutexP(s_lock);
+	if (ok) s_stats.hits++;
+	else s_stats.misses++;
+	SDL_mutexV(s_lock);
+
+	return ok;
+}
+
+void Save(const Key &key, const std::vector<double> &heights, const std::vector<vector3d> &colors)
+{
+	if (!s_enabled) return;
+
+	// claim the entry first so two threads don't write the same file. a
+	// load that gets in before the write is done just fails to verify
+	SDL_mutexP(s_lock);
+	const bool known = s_entries.count(key.GetFilename()) > 0;
+	if (!known) AddEntry(key.GetFilename(), 0, true);
+	SDL_mutexV(s_lock);
+	if (known) return;
+
+	const size_t rawSize = (heights.size() + colors.size()*3) * sizeof(double);
+	std::vector<unsigned char> raw(std::max(rawSize, size_t(1)));
+	if (!heights.empty()) memcpy(&raw[0], &heights[0], heights.size()*sizeof(double));
+	double *c = reinterpret_cast<double*>(&raw[heights.size()*sizeof(double)]);
+	for (size_t i = 0; i < colors.size(); i++, c += 3) {
+		c[0] = colors[i].x;
+		c[1] = colors[i].y;
+		c[2] = colors[i].z;
+	}
+
+	mz_ulong packedSize = mz_compressBound(rawSize);
+	std::vector<unsigned char> packed(packedSize);
+	Uint64 size = 0;
+	if (mz_compress(&packed[0], &packedSize, &raw[0], rawSize) == MZ_OK) {
+		FILE *f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPath(CACHE_DIR, key.GetFilename()));
+		if (f) {
+			const Uint32 header[] = { Uint32(key.GetData().size()) };
+			const Uint32 counts[] = { Uint32(heights.size()), Uint32(colors.size()), Uint32(packedSize) };
+			bool written =
+				fwrite(FILE_MAGIC, 4, 1, f) == 1 &&
+				fwrite(header, sizeof(header), 1, f) == 1 &&
+				fwrite(key.GetData().data(), key.GetData().size(), 1, f) == 1 &&
+				fwrite(counts, sizeof(counts), 1, f) == 1 &&
+				fwrite(&packed[0], packedSize, 1, f) == 1;
+			if (fclose(f) != 0) written = false;
+			if (written)
+				size = 4 + sizeof(header) + key.GetData().size() + sizeof(counts) + packedSize;
+		}
+	}
+
+	SDL_mutexP(s_lock);
+	std::map<std::string,Entry>::iterator i = s_entries.find(key.GetFilename());
+	// may have been evicted while we were writing
+	if (i != s_entries.end()) {
+		if (size) {
+			i->second.size = size;
+			s_totalBytes += size;
+		} else {
+			// couldn't write it; forget about it
+			s_lru.erase(i->second.lru);
+			s_entries.erase(i);
+			FileSystem::userFiles.RemoveFile(FileSystem::JoinPath(CACHE_DIR, key.GetFilename()));
+		}
+	}
+	Evict();
+	SDL_mutexV(s_lock);
+}
+
+Stats GetStats()
+{
+	if (!s_enabled) return s_stats;
+	SDL_mutexP(s_lock);
+	Stats stats = s_stats;
+	stats.totalBytes = s_totalBytes;
+	SDL_mutexV(s_lock);
+	return stats;
+}
+
+void ClearStats()
+{
+	if (!s_enabled) return;
+	SDL_mutexP(s_lock);
+	s_stats.hits = s_stats.misses = s_stats.evictions = 0;
+	SDL_mutexV(s_lock);
+}
+
+}
@@ -0,0 +1,56 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GEOPATCHCACHE_H
+#define _GEOPATCHCACHE_H
+
+#include "libs.h"
+
+class SystemBody;
+class Terrain;
+
+/*
+ * Disk cache of generated terrain patches. The terrain is fully determined
+ * by the body and the patch corners, so heights and colours computed once
+ * can be reused the next time the patch is needed, even in a later session.
+ * Entries are compressed, and the cache is kept under a size budget by
+ * throwing away the least recently used.
+ *
+ * Load and Save may be called from any thread.
+ */
+namespace GeoPatchCache {
+
+	// maxBytes of 0 disables the cache and deletes anything left in it
+	void Init(Uint64 maxBytes);
+	void Uninit();
+	bool IsEnabled();
+
+	// identifies one patch mesh: the body, the fractals, the detail settings
+	// and the patch corners
+	class Key {
+	public:
+		Key(const SystemBody *body, const Terrain *terrain, int edgeLen, const vector3d corners[4]);
+		const std::string &GetFilename() const { return m_filename; }
+		const std::string &GetData() const { return m_data; }
+	private:
+		std::string m_data;
+		std::string m_filename;
+	};
+
+	// returns false if the patch isn't in the cache. the vectors are
+	// resized to whatever was saved
+	bool Load(const Key &key, std::vector<double> &heights, std::vector<vector3d> &colors);
+	void Save(const Key &key, const std::vector<double> &heights, const std::vector<vector3d> &colors);
+
+	struct Stats {
+		int hits;
+		int misses;
+		int evictions;
+		Uint64 totalBytes;
+	};
+	Stats GetStats();
+	// reset the counters (not the size)
+	void ClearStats();
+}
+
+#endif
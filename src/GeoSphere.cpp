@@ -13,6 +13,9 @@
 #include "graphics/VertexArray.h"
 #include "graphics/gl2/GeoSphereMaterial.h"
 #include "vcacheopt/vcacheopt.h"
+#include "JobQueue.h"
+#include "GeoPatchCache.h"
+#include "OS.h"
 #include <deque>
 #include <algorithm>
 
@@ -22,7 +25,7 @@
 #define GEOSPHERE_USE_THREADING
 
 static const int GEOPATCH_MAX_EDGELEN = 55;
-int GeoSphere::s_vtxGenCount = 0;
+volatile long GeoSphere::s_vtxGenCount = 0;
 RefCountedPtr<GeoPatchContext> GeoSphere::s_patchContext;
 
 // must be odd numbers
@@ -70,7 +73,6 @@ public:
 	GLuint indices_list[NUM_INDEX_LISTS];
 	GLuint indices_tri_count;
 	GLuint indices_tri_counts[NUM_INDEX_LISTS];
-	VBOVertex *vbotemp;
 
 	GeoPatchContext(int _edgeLen) : edgeLen(_edgeLen) {
 		Init();
@@ -99,7 +101,6 @@ public:
 				glDeleteBuffersARB(1, &indices_list[i]);
 			}
 		}
-		delete [] vbotemp;
 	}
 
 	void updateIndexBufferId(const GLuint edge_hi_flags) {
@@ -146,8 +147,6 @@ public:
 	void Init() {
 		frac = 1.0 / double(edgeLen-1);
 
-		vbotemp = new VBOVertex[NUMVERTICES()];
-
 		unsigned short *idx;
 		midIndices.Reset(new unsigned short[VBO_COUNT_MID_IDX()]);
 		for (int i=0; i<4; i++) {
@@ -375,8 +374,8 @@ public:
 	vector3d clipCentroid, centroid;
 	double clipRadius;
 	int m_depth;
-	SDL_mutex *m_kidsLock;
 	bool m_needUpdateVBOs;
+	bool m_detached;
 	double m_distMult;
 
 	GeoPatch(const RefCountedPtr<GeoPatchContext> &_ctx, GeoSphere *gs, vector3d v0, vector3d v1, vector3d v2, vector3d v3, int depth) {
@@ -386,7 +385,6 @@ public:
 
 		geosphere = gs;
 
-		m_kidsLock = SDL_CreateMutex();
 		v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
 		//depth -= Pi::detail.fracmult;
 		m_depth = depth;
@@ -402,13 +400,14 @@ public:
  		}
 		m_roughLength = GEOPATCH_SUBDIVIDE_AT_CAMDIST / pow(2.0, depth) * m_distMult;
 		m_needUpdateVBOs = false;
+		m_detached = false;
 		normals = new vector3d[ctx->NUMVERTICES()];
 		vertices = new vector3d[ctx->NUMVERTICES()];
 		colors = new vector3d[ctx->NUMVERTICES()];
 	}
 
+	// only on the render thread, unless the patch never got a vbo
 	~GeoPatch() {
-		SDL_DestroyMutex(m_kidsLock);
 		for (int i=0; i<4; i++) {
 			if (edgeFriend[i]) edgeFriend[i]->NotifyEdgeFriendDeleted(this);
 		}
@@ -416,37 +415,48 @@ public:
 		delete[] vertices;
 		delete[] normals;
 		delete[] colors;
-		geosphere->AddVBOToDestroy(m_vbo);
+		if (m_vbo) glDeleteBuffersARB(1, &m_vbo);
 	}
 
+	// mark the vbo as out of date. the new data is sent to the render
+	// thread by GeoSphere::FlushPatchUploads
 	void UpdateVBOs() {
-		m_needUpdateVBOs = true;
+		if (!m_needUpdateVBOs) {
+			m_needUpdateVBOs = true;
+			geosphere->m_dirtyPatches.push_back(this);
+		}
 	}
 
-	void _UpdateVBOs() {
-		if (m_needUpdateVBOs) {
-			if (!m_vbo) glGenBuffersARB(1, &m_vbo);
-			m_needUpdateVBOs = false;
-			glBindBufferARB(GL_ARRAY_BUFFER, m_vbo);
-			glBufferDataARB(GL_ARRAY_BUFFER, sizeof(VBOVertex)*ctx->NUMVERTICES(), 0, GL_DYNAMIC_DRAW);
-			for (int i=0; i<ctx->NUMVERTICES(); i++)
-			{
-				clipRadius = std::max(clipRadius, (vertices[i]-clipCentroid).Length());
-				VBOVertex *pData = ctx->vbotemp + i;
-				pData->x = float(vertices[i].x - clipCentroid.x);
-				pData->y = float(vertices[i].y - clipCentroid.y);
-				pData->z = float(vertices[i].z - clipCentroid.z);
-				pData->nx = float(normals[i].x);
-				pData->ny = float(normals[i].y);
-				pData->nz = float(normals[i].z);
-				pData->col[0] = static_cast<unsigned char>(Clamp(colors[i].x*255.0, 0.0, 255.0));
-				pData->col[1] = static_cast<unsigned char>(Clamp(colors[i].y*255.0, 0.0, 255.0));
-				pData->col[2] = static_cast<unsigned char>(Clamp(colors[i].z*255.0, 0.0, 255.0));
-				pData->col[3] = 255;
-			}
-			glBufferDataARB(GL_ARRAY_BUFFER, sizeof(VBOVertex)*ctx->NUMVERTICES(), ctx->vbotemp, GL_DYNAMIC_DRAW);
-			glBindBufferARB(GL_ARRAY_BUFFER, 0);
+	// convert the mesh to vbo format, for the render thread to upload.
+	// also returns the clip radius the vertices need
+	VBOVertex *PackVBOVertices(double &radius) const {
+		VBOVertex *data = new VBOVertex[ctx->NUMVERTICES()];
+		radius = 0;
+		for (int i=0; i<ctx->NUMVERTICES(); i++)
+		{
+			radius = std::max(radius, (vertices[i]-clipCentroid).Length());
+			VBOVertex *pData = data + i;
+			pData->x = float(vertices[i].x - clipCentroid.x);
+			pData->y = float(vertices[i].y - clipCentroid.y);
+			pData->z = float(vertices[i].z - clipCentroid.z);
+			pData->nx = float(normals[i].x);
+			pData->ny = float(normals[i].y);
+			pData->nz = float(normals[i].z);
+			pData->col[0] = static_cast<unsigned char>(Clamp(colors[i].x*255.0, 0.0, 255.0));
+			pData->col[1] = static_cast<unsigned char>(Clamp(colors[i].y*255.0, 0.0, 255.0));
+			pData->col[2] = static_cast<unsigned char>(Clamp(colors[i].z*255.0, 0.0, 255.0));
+			pData->col[3] = 255;
 		}
+		return data;
+	}
+
+	// render thread only
+	void UploadVBO(const VBOVertex *data, double radius) {
+		if (!m_vbo) glGenBuffersARB(1, &m_vbo);
+		clipRadius = std::max(clipRadius, radius);
+		glBindBufferARB(GL_ARRAY_BUFFER, m_vbo);
+		glBufferDataARB(GL_ARRAY_BUFFER, sizeof(VBOVertex)*ctx->NUMVERTICES(), data, GL_DYNAMIC_DRAW);
+		glBindBufferARB(GL_ARRAY_BUFFER, 0);
 	}
 	/* not quite edge, since we share edge vertices so that would be
 	 * fucking pointless. one position inwards. used to make edge normals
@@ -754,43 +764,65 @@ public:
 	void GenerateMesh() {
 		centroid = clipCentroid.Normalized();
 		centroid = (1.0 + geosphere->GetHeight(centroid)) * centroid;
-		vector3d *vts = vertices;
-		vector3d *col = colors;
-		double xfrac;
-		double yfrac = 0;
-		for (int y=0; y<ctx->edgeLen; y++) {
-			xfrac = 0;
-			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(xfrac, yfrac);
-				double height = geosphere->GetHeight(p);
-				*(vts++) = p * (height + 1.0);
-				// remember this -- we will need it later
-				(col++)->x = height;
-				xfrac += ctx->frac;
+
+		const int edgeLen = ctx->edgeLen;
+		const int numVerts = ctx->NUMVERTICES();
+		const int numInner = (edgeLen-2)*(edgeLen-2);
+		// the sphere points are needed again for the colours, so keep them
+		std::vector<vector3d> points(numVerts);
+		for (int y=0; y<edgeLen; y++) {
+			for (int x=0; x<edgeLen; x++) {
+				points[x + y*edgeLen] = GetSpherePoint(x*ctx->frac, y*ctx->frac);
 			}
-			yfrac += ctx->frac;
 		}
-		assert(vts == &vertices[ctx->NUMVERTICES()]);
+
+		// heights for every vertex and colours for the non-edge ones are
+		// all that's expensive, so that's what the disk cache keeps
+		std::vector<double> heights;
+		std::vector<vector3d> innerColors;
+		ScopedPtr<GeoPatchCache::Key> cacheKey;
+		bool cached = false;
+		if (GeoPatchCache::IsEnabled()) {
+			cacheKey.Reset(new GeoPatchCache::Key(geosphere->m_sbody, geosphere->m_terrain, edgeLen, v));
+			cached = GeoPatchCache::Load(*cacheKey, heights, innerColors) &&
+				(int(heights.size()) == numVerts) && (int(innerColors.size()) == numInner);
+		}
+		if (!cached) {
+			heights.resize(numVerts);
+			geosphere->GetHeights(&points[0], &heights[0], numVerts);
+		}
+
+		for (int i=0; i<numVerts; i++) {
+			vertices[i] = points[i] * (heights[i] + 1.0);
+			// remember this -- we will need it later
+			colors[i].x = heights[i];
+		}
 		// Generate normals & colors for non-edge vertices since they never change
-		for (int y=1; y<ctx->edgeLen-1; y++) {
-			for (int x=1; x<ctx->edgeLen-1; x++) {
+		for (int y=1; y<edgeLen-1; y++) {
+			for (int x=1; x<edgeLen-1; x++) {
 				// normal
-				vector3d x1 = vertices[x-1 + y*ctx->edgeLen];
-				vector3d x2 = vertices[x+1 + y*ctx->edgeLen];
-				vector3d y1 = vertices[x + (y-1)*ctx->edgeLen];
-				vector3d y2 = vertices[x + (y+1)*ctx->edgeLen];
+				vector3d x1 = vertices[x-1 + y*edgeLen];
+				vector3d x2 = vertices[x+1 + y*edgeLen];
+				vector3d y1 = vertices[x + (y-1)*edgeLen];
+				vector3d y2 = vertices[x + (y+1)*edgeLen];
 
 				vector3d n = (x2-x1).Cross(y2-y1);
-				normals[x + y*ctx->edgeLen] = n.Normalized();
-				// color
-				vector3d p = GetSpherePoint(x*ctx->frac, y*ctx->frac);
-				vector3d &col_r = colors[x + y*ctx->edgeLen];
-				const double height = col_r.x;
-				const vector3d &norm = normals[x + y*ctx->edgeLen];
-				col_r = geosphere->GetColor(p, height, norm);
+				normals[x + y*edgeLen] = n.Normalized();
 			}
+			// color
+			const int row = 1 + y*edgeLen;
+			if (cached)
+				std::copy(&innerColors[(y-1)*(edgeLen-2)], &innerColors[(y-1)*(edgeLen-2)] + edgeLen-2, &colors[row]);
+			else
+				geosphere->GetColors(&points[row], &heights[row], &normals[row], &colors[row], edgeLen-2);
 		}
 
+		if (cacheKey.Valid() && !cached) {
+			innerColors.resize(numInner);
+			for (int y=1; y<edgeLen-1; y++)
+				std::copy(&colors[1 + y*edgeLen], &colors[1 + y*edgeLen] + edgeLen-2, &innerColors[(y-1)*(edgeLen-2)]);
+			GeoPatchCache::Save(*cacheKey, heights, innerColors);
+		}
 	}
 	void OnEdgeFriendChanged(int edge, GeoPatch *e) {
 		edgeFriend[edge] = e;
@@ -798,47 +830,33 @@ public:
 		int we_are = e->GetEdgeIdxOf(this);
 		e->GetEdgeMinusOneVerticesFlipped(we_are, ev);
 		/* now we have a valid edge, fix the edge vertices */
-		if (edge == 0) {
-			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(x * ctx->frac, 0);
-				double height = geosphere->GetHeight(p);
-				vertices[x] = p * (height + 1.0);
-				// XXX These bounds checks in each edge case are
-				// only necessary while the "All these 'if's"
-				// comment in FixCOrnerNormalsByEdge stands
-				if ((x>0) && (x<ctx->edgeLen-1)) {
-					colors[x].x = height;
-				}
-			}
-		} else if (edge == 1) {
-			for (int y=0; y<ctx->edgeLen; y++) {
-				vector3d p = GetSpherePoint(1.0, y * ctx->frac);
-				double height = geosphere->GetHeight(p);
-				int pos = (ctx->edgeLen-1) + y*ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((y>0) && (y<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
-			}
-		} else if (edge == 2) {
-			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(x * ctx->frac, 1.0);
-				double height = geosphere->GetHeight(p);
-				int pos = x + (ctx->edgeLen-1)*ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((x>0) && (x<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
+		vector3d points[GEOPATCH_MAX_EDGELEN];
+		double heights[GEOPATCH_MAX_EDGELEN];
+		int pos[GEOPATCH_MAX_EDGELEN];
+		for (int i=0; i<ctx->edgeLen; i++) {
+			const double t = i * ctx->frac;
+			if (edge == 0) {
+				points[i] = GetSpherePoint(t, 0);
+				pos[i] = i;
+			} else if (edge == 1) {
+				points[i] = GetSpherePoint(1.0, t);
+				pos[i] = (ctx->edgeLen-1) + i*ctx->edgeLen;
+			} else if (edge == 2) {
+				points[i] = GetSpherePoint(t, 1.0);
+				pos[i] = i + (ctx->edgeLen-1)*ctx->edgeLen;
+			} else {
+				points[i] = GetSpherePoint(0, t);
+				pos[i] = i * ctx->edgeLen;
 			}
-		} else {
-			for (int y=0; y<ctx->edgeLen; y++) {
-				vector3d p = GetSpherePoint(0, y * ctx->frac);
-				double height = geosphere->GetHeight(p);
-				int pos = y * ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((y>0) && (y<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
+		}
+		geosphere->GetHeights(points, heights, ctx->edgeLen);
+		for (int i=0; i<ctx->edgeLen; i++) {
+			vertices[pos[i]] = points[i] * (heights[i] + 1.0);
+			// XXX These bounds checks are
+			// only necessary while the "All these 'if's"
+			// comment in FixCOrnerNormalsByEdge stands
+			if ((i>0) && (i<ctx->edgeLen-1)) {
+				colors[pos[i]].x = heights[i];
 			}
 		}
 
@@ -911,14 +929,27 @@ public:
 			(edgeFriend[3] ? 8u : 0u);
 	}
 
+	// kids are only ever deleted by the render thread, so it can look at
+	// them while the update thread is adding or removing them. until all
+	// four have been uploaded we keep drawing this patch instead.
+	// the update thread can clear a kid pointer at any time though, so
+	// they're read once into kidsCopy (through volatile, so the compiler
+	// can't read them again) and only the copy is used after that
+	bool KidsReady(GeoPatch *kidsCopy[4]) const {
+		GeoPatch * const volatile *shared = kids;
+		for (int i=0; i<4; i++) kidsCopy[i] = shared[i];
+		for (int i=0; i<4; i++) {
+			if (!kidsCopy[i] || !kidsCopy[i]->m_vbo) return false;
+		}
+		return true;
+	}
+
 	void Render(vector3d &campos, const Graphics::Frustum &frustum) {
-		PiVerify(SDL_mutexP(m_kidsLock)==0);
-		if (kids[0]) {
-			for (int i=0; i<4; i++) kids[i]->Render(campos, frustum);
-			SDL_mutexV(m_kidsLock);
+		GeoPatch *kidsCopy[4];
+		if (KidsReady(kidsCopy)) {
+			for (int i=0; i<4; i++) kidsCopy[i]->Render(campos, frustum);
 		} else {
-			SDL_mutexV(m_kidsLock);
-			_UpdateVBOs();
+			if (!m_vbo) return;
 
 			if (!frustum.TestPoint(clipCentroid, clipRadius))
 				return;
@@ -951,84 +982,124 @@ public:
 		}
 	}
 
-	void LODUpdate(vector3d &campos) {
+	// decide whether to split or merge. patches that want to split are
+	// added to splits rather than split straight away, so that all the new
+	// meshes can be generated at once on the job pool
+	void LODUpdate(const vector3d &campos, std::vector<GeoPatch*> &splits) {
 		// if we've been asked to abort then get out as quickly as possible
 		// this function is recursive so we might be very deep. this is about
 		// as fast as we can go
-		SDL_mutexP(geosphere->m_abortLock);
-		bool abort = geosphere->m_abort;
-		SDL_mutexV(geosphere->m_abortLock);
-		if (abort)
+		if (geosphere->m_abort)
 			return;
 
-		bool canSplit = true;
-		for (int i=0; i<4; i++) {
-			if (!edgeFriend[i]) { canSplit = false; break; }
-			if (edgeFriend[i] && (edgeFriend[i]->m_depth < m_depth)) {
-				canSplit = false;
-				break;
+		if (CanSplit(campos)) {
+			if (kids[0]) {
+				for (int i=0; i<4; i++) kids[i]->LODUpdate(campos, splits);
+			} else {
+				splits.push_back(this);
 			}
+		} else if (kids[0]) {
+			Merge();
 		}
-		if (!(canSplit && (m_depth < GEOPATCH_MAX_DEPTH) &&
-		    ((campos - centroid).Length() < m_roughLength)))
-			canSplit = false;
+	}
+
+	bool CanSplit(const vector3d &campos) const {
 		// always split at first level
-		if (!parent) canSplit = true;
-		//printf(campos.Length());
-
-		bool canMerge = true;
-
-		if (canSplit) {
-			if (!kids[0]) {
-				vector3d v01, v12, v23, v30, cn;
-				cn = centroid.Normalized();
-				v01 = (v[0]+v[1]).Normalized();
-				v12 = (v[1]+v[2]).Normalized();
-				v23 = (v[2]+v[3]).Normalized();
-				v30 = (v[3]+v[0]).Normalized();
-				GeoPatch *_kids[4];
-				_kids[0] = new GeoPatch(ctx, geosphere, v[0], v01, cn, v30, m_depth+1);
-				_kids[1] = new GeoPatch(ctx, geosphere, v01, v[1], v12, cn, m_depth+1);
-				_kids[2] = new GeoPatch(ctx, geosphere, cn, v12, v[2], v23, m_depth+1);
-				_kids[3] = new GeoPatch(ctx, geosphere, v30, cn, v23, v[3], m_depth+1);
-				// hm.. edges. Not right to pass this
-				// edgeFriend...
-				_kids[0]->edgeFriend[0] = GetEdgeFriendForKid(0, 0);
-				_kids[0]->edgeFriend[1] = _kids[1];
-				_kids[0]->edgeFriend[2] = _kids[3];
-				_kids[0]->edgeFriend[3] = GetEdgeFriendForKid(0, 3);
-				_kids[1]->edgeFriend[0] = GetEdgeFriendForKid(1, 0);
-				_kids[1]->edgeFriend[1] = GetEdgeFriendForKid(1, 1);
-				_kids[1]->edgeFriend[2] = _kids[2];
-				_kids[1]->edgeFriend[3] = _kids[0];
-				_kids[2]->edgeFriend[0] = _kids[1];
-				_kids[2]->edgeFriend[1] = GetEdgeFriendForKid(2, 1);
-				_kids[2]->edgeFriend[2] = GetEdgeFriendForKid(2, 2);
-				_kids[2]->edgeFriend[3] = _kids[3];
-				_kids[3]->edgeFriend[0] = _kids[0];
-				_kids[3]->edgeFriend[1] = _kids[2];
-				_kids[3]->edgeFriend[2] = GetEdgeFriendForKid(3, 2);
-				_kids[3]->edgeFriend[3] = GetEdgeFriendForKid(3, 3);
-				_kids[0]->parent = _kids[1]->parent = _kids[2]->parent = _kids[3]->parent = this;
-				for (int i=0; i<4; i++) _kids[i]->GenerateMesh();
-				PiVerify(SDL_mutexP(m_kidsLock)==0);
-				for (int i=0; i<4; i++) kids[i] = _kids[i];
-				for (int i=0; i<4; i++) edgeFriend[i]->NotifyEdgeFriendSplit(this);
-				for (int i=0; i<4; i++) {
-					kids[i]->GenerateEdgeNormalsAndColors();
-					kids[i]->UpdateVBOs();
-				}
-				PiVerify(SDL_mutexV(m_kidsLock)!=-1);
-			}
-			for (int i=0; i<4; i++) kids[i]->LODUpdate(campos);
-		} else {
-			if (canMerge && kids[0]) {
-				PiVerify(SDL_mutexP(m_kidsLock)==0);
-				for (int i=0; i<4; i++) { delete kids[i]; kids[i] = 0; }
-				PiVerify(SDL_mutexV(m_kidsLock)!=-1);
+		if (!parent) return true;
+		for (int i=0; i<4; i++) {
+			if (!edgeFriend[i]) return false;
+			if (edgeFriend[i]->m_depth < m_depth) return false;
+		}
+		return (m_depth < GEOPATCH_MAX_DEPTH) &&
+			((campos - centroid).Length() < m_roughLength);
+	}
+
+	// make (but don't attach) the four kids. their meshes still need
+	// generating, which is safe to do on any thread
+	void CreateKids(GeoPatch *_kids[4]) {
+		vector3d v01, v12, v23, v30, cn;
+		cn = centroid.Normalized();
+		v01 = (v[0]+v[1]).Normalized();
+		v12 = (v[1]+v[2]).Normalized();
+		v23 = (v[2]+v[3]).Normalized();
+		v30 = (v[3]+v[0]).Normalized();
+		_kids[0] = new GeoPatch(ctx, geosphere, v[0], v01, cn, v30, m_depth+1);
+		_kids[1] = new GeoPatch(ctx, geosphere, v01, v[1], v12, cn, m_depth+1);
+		_kids[2] = new GeoPatch(ctx, geosphere, cn, v12, v[2], v23, m_depth+1);
+		_kids[3] = new GeoPatch(ctx, geosphere, v30, cn, v23, v[3], m_depth+1);
+		_kids[0]->parent = _kids[1]->parent = _kids[2]->parent = _kids[3]->parent = this;
+	}
+
+	// hook kids with generated meshes into the tree. update thread only
+	void AttachKids(GeoPatch *_kids[4]) {
+		// hm.. edges. Not right to pass this
+		// edgeFriend...
+		_kids[0]->edgeFriend[0] = GetEdgeFriendForKid(0, 0);
+		_kids[0]->edgeFriend[1] = _kids[1];
+		_kids[0]->edgeFriend[2] = _kids[3];
+		_kids[0]->edgeFriend[3] = GetEdgeFriendForKid(0, 3);
+		_kids[1]->edgeFriend[0] = GetEdgeFriendForKid(1, 0);
+		_kids[1]->edgeFriend[1] = GetEdgeFriendForKid(1, 1);
+		_kids[1]->edgeFriend[2] = _kids[2];
+		_kids[1]->edgeFriend[3] = _kids[0];
+		_kids[2]->edgeFriend[0] = _kids[1];
+		_kids[2]->edgeFriend[1] = GetEdgeFriendForKid(2, 1);
+		_kids[2]->edgeFriend[2] = GetEdgeFriendForKid(2, 2);
+		_kids[2]->edgeFriend[3] = _kids[3];
+		_kids[3]->edgeFriend[0] = _kids[0];
+		_kids[3]->edgeFriend[1] = _kids[2];
+		_kids[3]->edgeFriend[2] = GetEdgeFriendForKid(3, 2);
+		_kids[3]->edgeFriend[3] = GetEdgeFriendForKid(3, 3);
+		for (int i=0; i<4; i++) kids[i] = _kids[i];
+		for (int i=0; i<4; i++) edgeFriend[i]->NotifyEdgeFriendSplit(this);
+		for (int i=0; i<4; i++) {
+			kids[i]->GenerateEdgeNormalsAndColors();
+			kids[i]->UpdateVBOs();
+		}
+	}
+
+	void Merge() {
+		for (int i=0; i<4; i++) {
+			GeoPatch *kid = kids[i];
+			kids[i] = 0;
+			kid->Detach();
+			geosphere->m_deadPatches.push_back(kid);
+		}
+	}
+
+	// unhook from the tree, leaving the actual delete (and the vbo) to the
+	// render thread, which may still be drawing us
+	void Detach() {
+		m_detached = true;
+		for (int i=0; i<4; i++) {
+			if (edgeFriend[i]) {
+				edgeFriend[i]->NotifyEdgeFriendDeleted(this);
+				edgeFriend[i] = 0;
 			}
 		}
+		for (int i=0; i<4; i++) if (kids[i]) kids[i]->Detach();
+	}
+};
+
+// a new vbo for a patch, or if data is null, a patch to delete
+struct GeoPatchUpload {
+	GeoPatchUpload() : patch(0), data(0), radius(0) {}
+	GeoPatchUpload(GeoPatch *p, VBOVertex *d, double r) : patch(p), data(d), radius(r) {}
+	GeoPatch *patch;
+	VBOVertex *data;
+	double radius;
+};
+
+class GeoPatchMeshJob : public Job {
+public:
+	GeoPatchMeshJob(GeoPatch *patch) : m_patch(patch) {}
+	virtual void Run(int threadNum) {
+		// an aborted update throws its new patches away
+		if (!m_patch->geosphere->m_abort)
+			m_patch->GenerateMesh();
 	}
+private:
+	GeoPatch *m_patch;
 };
 
 static const int geo_sphere_edge_friends[6][4] = {
@@ -1046,6 +1117,7 @@ static GeoSphere* s_currentlyUpdatingGeoSphere = 0;
 static SDL_mutex *s_geosphereUpdateQueueLock = 0;
 static SDL_cond *s_geosphereUpdateQueueCondition = 0;		///< Condition variable for s_geosphereUpdateQueue and s_exitFlag. Allows waking up the thread when useful.
 static SDL_Thread *s_updateThread = 0;
+static JobQueue *s_patchJobs = 0;
 
 static bool s_exitFlag = false;
 
@@ -1075,8 +1147,7 @@ int GeoSphere::UpdateLODThread(void *data)
 			SDL_mutexV(s_geosphereUpdateQueueLock);
 
 			// update the patches
-			for (int n=0; n<6; n++)
-				gs->m_patches[n]->LODUpdate(gs->m_tempCampos);
+			gs->UpdateLODs();
 
 			// overlap locks again
 			SDL_mutexP(s_geosphereUpdateQueueLock);
@@ -1103,11 +1174,116 @@ void GeoSphere::Init()
 	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
 	assert(s_patchContext->edgeLen <= GEOPATCH_MAX_EDGELEN);
 
+	int numThreads = Pi::config->Int("TerrainThreads");
+	if (numThreads <= 0)
+		numThreads = OS::GetNumCPUs();
+	s_patchJobs = new JobQueue(numThreads);
+
+	GeoPatchCache::Init(Uint64(std::max(Pi::config->Int("TerrainCacheSize"), 0)) * 1024 * 1024);
+
 #ifdef GEOSPHERE_USE_THREADING
 	s_updateThread = SDL_CreateThread(&GeoSphere::UpdateLODThread, 0);
 #endif /* GEOSPHERE_USE_THREADING */
 }
 
+static vector3d BilerpSpherePoint(const vector3d v[4], double x, double y)
+{
+	return (v[0] + x*(1.0-y)*(v[1]-v[0]) +
+		    x*y*(v[2]-v[0]) +
+		    (1.0-x)*y*(v[3]-v[0])).Normalized();
+}
+
+// only the heights and colours are timed: the rest of GenerateMesh is done
+// on a hit too
+GeoSphere::CacheBenchmark GeoSphere::BenchmarkCache(const SystemBody *sbody, int numSplits)
+{
+	assert(GeoPatchCache::IsEnabled());
+
+	CacheBenchmark result;
+	memset(&result, 0, sizeof(result));
+
+	Terrain *terrain = Terrain::InstanceTerrain(sbody);
+	const int edgeLen = s_patchContext->edgeLen;
+	const double frac = s_patchContext->frac;
+	const int numVerts = edgeLen*edgeLen;
+	const int numInner = (edgeLen-2)*(edgeLen-2);
+
+	// the first of the patches from BuildFirstPatches
+	const vector3d face[4] = {
+		vector3d(1,1,1).Normalized(), vector3d(-1,1,1).Normalized(),
+		vector3d(-1,-1,1).Normalized(), vector3d(1,-1,1).Normalized()
+	};
+
+	std::vector<GeoPatchCache::Key> keys;
+	std::vector< std::vector<double> > allHeights;
+	std::vector< std::vector<vector3d> > allColors;
+	std::vector<vector3d> points(numVerts), normals(numVerts), colors(numVerts);
+	Uint64 generateTicks = 0;
+
+	for (int py = 0; py < numSplits; py++) {
+		for (int px = 0; px < numSplits; px++) {
+			const double x0 = double(px)/numSplits, x1 = double(px+1)/numSplits;
+			const double y0 = double(py)/numSplits, y1 = double(py+1)/numSplits;
+			const vector3d v[4] = {
+				BilerpSpherePoint(face, x0, y0), BilerpSpherePoint(face, x1, y0),
+				BilerpSpherePoint(face, x1, y1), BilerpSpherePoint(face, x0, y1)
+			};
+			for (int y=0; y<edgeLen; y++)
+				for (int x=0; x<edgeLen; x++)
+					points[x + y*edgeLen] = BilerpSpherePoint(v, x*frac, y*frac);
+
+			std::vector<double> heights(numVerts);
+			Uint64 start = OS::HFTimer();
+			terrain->GetHeights(&points[0], &heights[0], numVerts);
+			generateTicks += OS::HFTimer() - start;
+
+			std::vector<vector3d> innerColors(numInner);
+			for (int y=1; y<edgeLen-1; y++) {
+				for (int x=1; x<edgeLen-1; x++) {
+					const vector3d x1 = points[x-1 + y*edgeLen] * (heights[x-1 + y*edgeLen] + 1.0);
+					const vector3d x2 = points[x+1 + y*edgeLen] * (heights[x+1 + y*edgeLen] + 1.0);
+					const vector3d y1 = points[x + (y-1)*edgeLen] * (heights[x + (y-1)*edgeLen] + 1.0);
+					const vector3d y2 = points[x + (y+1)*edgeLen] * (heights[x + (y+1)*edgeLen] + 1.0);
+					normals[x + y*edgeLen] = (x2-x1).Cross(y2-y1).Normalized();
+				}
+				const int row = 1 + y*edgeLen;
+				start = OS::HFTimer();
+				terrain->GetColors(&points[row], &heights[row], &normals[row], &colors[row], edgeLen-2);
+				generateTicks += OS::HFTimer() - start;
+				std::copy(&colors[row], &colors[row] + edgeLen-2, &innerColors[(y-1)*(edgeLen-2)]);
+			}
+
+			keys.push_back(GeoPatchCache::Key(sbody, terrain, edgeLen, v));
+			GeoPatchCache::Save(keys.back(), heights, innerColors);
+			allHeights.push_back(heights);
+			allColors.push_back(innerColors);
+		}
+	}
+
+	Uint64 loadTicks = 0;
+	std::vector<double> heights;
+	std::vector<vector3d> innerColors;
+	for (size_t i = 0; i < keys.size(); i++) {
+		const Uint64 start = OS::HFTimer();
+		const bool loaded = GeoPatchCache::Load(keys[i], heights, innerColors);
+		loadTicks += OS::HFTimer() - start;
+		if (!loaded) continue;
+		result.loaded++;
+		// bit for bit, so a hit draws exactly what generating would have
+		if (heights.size() != allHeights[i].size() || innerColors.size() != allColors[i].size() ||
+				memcmp(&heights[0], &allHeights[i][0], heights.size()*sizeof(double)) ||
+				memcmp(&innerColors[0], &allColors[i][0], innerColors.size()*sizeof(vector3d)))
+			result.different++;
+	}
+
+	delete terrain;
+
+	result.patches = int(keys.size());
+	result.generateMs = 1000.0 * double(generateTicks) / double(OS::HFTimerFreq());
+	result.loadMs = 1000.0 * double(loadTicks) / double(OS::HFTimerFreq());
+	return result;
+}
+
 void GeoSphere::Uninit()
 {
 #ifdef GEOSPHERE_USE_THREADING
@@ -1121,6 +1297,11 @@ void GeoSphere::Uninit()
 	SDL_WaitThread(s_updateThread, 0);
 #endif /* GEOSPHERE_USE_THREADING */
 
+	delete s_patchJobs;
+	s_patchJobs = 0;
+
+	GeoPatchCache::Uninit();
+
 	assert (s_patchContext.Unique());
 	s_patchContext.Reset();
 
@@ -1150,11 +1331,8 @@ void GeoSphere::OnChangeDetailLevel()
 	SDL_mutexV(s_geosphereUpdateQueueLock);
 
 	// if a terrain is currently being updated, then abort the update
-	if (gs) {
-		SDL_mutexP(gs->m_abortLock);
+	if (gs)
 		gs->m_abort = true;
-		SDL_mutexV(gs->m_abortLock);
-	}
 
 	// reinit the geosphere terrain data
 	for(std::vector<GeoSphere*>::iterator i = s_allGeospheres.begin();
@@ -1165,13 +1343,7 @@ void GeoSphere::OnChangeDetailLevel()
 		// abort quickly
 		SDL_mutexP((*i)->m_updateLock);
 
-		for (int p=0; p<6; p++) {
-			// delete patches
-			if ((*i)->m_patches[p]) {
-				delete (*i)->m_patches[p];
-				(*i)->m_patches[p] = 0;
-			}
-		}
+		(*i)->DeletePatches();
 
 		// reinit the terrain with the new settings
 		delete (*i)->m_terrain;
@@ -1193,12 +1365,10 @@ GeoSphere::GeoSphere(const SystemBody *body)
 	m_terrain = Terrain::InstanceTerrain(body);
 	print_info(body, m_terrain);
 
-	m_vbosToDestroyLock = SDL_CreateMutex();
 	m_sbody = body;
 	memset(m_patches, 0, 6*sizeof(GeoPatch*));
 
 	m_updateLock = SDL_CreateMutex();
-	m_abortLock = SDL_CreateMutex();
 	m_abort = false;
 
 	s_allGeospheres.push_back(this);
@@ -1209,9 +1379,7 @@ GeoSphere::GeoSphere(const SystemBody *body)
 GeoSphere::~GeoSphere()
 {
 	// tell the thread to finish up with this geosphere
-	SDL_mutexP(m_abortLock);
 	m_abort = true;
-	SDL_mutexV(m_abortLock);
 
 	SDL_mutexP(s_geosphereUpdateQueueLock);
 	assert(std::count(s_allGeospheres.begin(), s_allGeospheres.end(), this) <= 1);
@@ -1228,32 +1396,116 @@ GeoSphere::~GeoSphere()
 	assert(std::count(s_allGeospheres.begin(), s_allGeospheres.end(), this) == 1);
 	s_allGeospheres.erase(std::find(s_allGeospheres.begin(), s_allGeospheres.end(), this));
 
-	SDL_DestroyMutex(m_abortLock);
+	DeletePatches();
 	SDL_DestroyMutex(m_updateLock);
 
-	for (int i=0; i<6; i++) if (m_patches[i]) delete m_patches[i];
-	DestroyVBOs();
-	SDL_DestroyMutex(m_vbosToDestroyLock);
-
 	delete m_terrain;
 }
 
-void GeoSphere::AddVBOToDestroy(GLuint vbo)
+void GeoSphere::UpdateLODs()
+{
+	// patches were thrown away (detail change) after we were queued
+	if (!m_patches[0]) return;
+
+	// each pass splits the patches that want it by one level, so keep
+	// going until nothing does
+	std::vector<GeoPatch*> splits;
+	for (;;) {
+		splits.clear();
+		for (int n=0; n<6; n++)
+			m_patches[n]->LODUpdate(m_tempCampos, splits);
+		if (!splits.empty() && !m_abort)
+			SplitPatches(splits);
+
+		// let the render thread have this level while we do the next
+		FlushPatchUploads();
+
+		if (splits.empty() || m_abort)
+			break;
+	}
+}
+
+void GeoSphere::SplitPatches(const std::vector<GeoPatch*> &parents)
+{
+	std::vector<GeoPatch*> kids(parents.size()*4);
+	for (size_t i = 0; i < parents.size(); i++)
+		parents[i]->CreateKids(&kids[i*4]);
+
+	// mesh generation only looks at the patch itself and the terrain, so
+	// every new patch can be done at once
+	std::vector<GeoPatchMeshJob> jobs;
+	jobs.reserve(kids.size());
+	for (size_t i = 0; i < kids.size(); i++)
+		jobs.push_back(GeoPatchMeshJob(kids[i]));
+	for (size_t i = 0; i < jobs.size(); i++)
+		s_patchJobs->Queue(&jobs[i]);
+	s_patchJobs->Finish();
+
+	// stitching them in touches the neighbours, so that's done in order
+	for (size_t i = 0; i < parents.size(); i++) {
+		GeoPatch *parent = parents[i];
+		// a merge later in the same pass may have taken away a neighbour
+		// since the patch decided to split
+		bool canAttach = !m_abort;
+		for (int j=0; j<4 && canAttach; j++)
+			if (!parent->edgeFriend[j]) canAttach = false;
+
+		if (canAttach) {
+			parent->AttachKids(&kids[i*4]);
+		} else {
+			// never seen by anyone else, so no need to go via the render thread
+			for (int j=0; j<4; j++) delete kids[i*4+j];
+		}
+	}
+}
+
+void GeoSphere::FlushPatchUploads()
 {
-	SDL_mutexP(m_vbosToDestroyLock);
-	m_vbosToDestroy.push_back(vbo);
-	SDL_mutexV(m_vbosToDestroyLock);
+	for (std::vector<GeoPatch*>::iterator i = m_dirtyPatches.begin(); i != m_dirtyPatches.end(); ++i) {
+		GeoPatch *patch = *i;
+		patch->m_needUpdateVBOs = false;
+		if (patch->m_detached) continue;
+		double radius;
+		VBOVertex *data = patch->PackVBOVertices(radius);
+		m_patchUploads.Push(GeoPatchUpload(patch, data, radius));
+	}
+	m_dirtyPatches.clear();
+
+	// deletes go last so they come after any upload for the same patch
+	for (std::vector<GeoPatch*>::iterator i = m_deadPatches.begin(); i != m_deadPatches.end(); ++i)
+		m_patchUploads.Push(GeoPatchUpload(*i, 0, 0));
+	m_deadPatches.clear();
 }
 
-void GeoSphere::DestroyVBOs()
+void GeoSphere::ProcessPatchUploads()
 {
-	SDL_mutexP(m_vbosToDestroyLock);
-	for (std::list<GLuint>::iterator i = m_vbosToDestroy.begin();
-			i != m_vbosToDestroy.end(); ++i) {
-		glDeleteBuffersARB(1, &(*i));
+	GeoPatchUpload u;
+	while (m_patchUploads.Pop(u)) {
+		if (u.data) {
+			u.patch->UploadVBO(u.data, u.radius);
+			delete [] u.data;
+		} else {
+			delete u.patch;
+		}
+	}
+}
+
+void GeoSphere::DeletePatches()
+{
+	// patches still waiting for the render thread go first, since the
+	// uploads may refer to them
+	ProcessPatchUploads();
+	m_dirtyPatches.clear();
+	for (std::vector<GeoPatch*>::iterator i = m_deadPatches.begin(); i != m_deadPatches.end(); ++i)
+		delete *i;
+	m_deadPatches.clear();
+
+	for (int p=0; p<6; p++) {
+		if (m_patches[p]) {
+			delete m_patches[p];
+			m_patches[p] = 0;
+		}
 	}
-	m_vbosToDestroy.clear();
-	SDL_mutexV(m_vbosToDestroyLock);
 }
 
 void GeoSphere::BuildFirstPatches()
@@ -1290,6 +1542,7 @@ void GeoSphere::BuildFirstPatches()
 	for (int i=0; i<6; i++) m_patches[i]->GenerateMesh();
 	for (int i=0; i<6; i++) m_patches[i]->GenerateEdgeNormalsAndColors();
 	for (int i=0; i<6; i++) m_patches[i]->UpdateVBOs();
+	FlushPatchUploads();
 }
 
 static const float g_ambient[4] = { 0, 0, 0, 1.0 };
@@ -1393,6 +1646,9 @@ void GeoSphere::Render(Graphics::Renderer *renderer, vector3d campos, const floa
 
 	if (!m_patches[0]) BuildFirstPatches();
 
+	// pick up whatever the update thread has finished since last frame
+	ProcessPatchUploads();
+
 	Color ambient;
 	Color &emission = m_surfaceMaterial->emissive;
 
@@ -1433,9 +1689,6 @@ void GeoSphere::Render(Graphics::Renderer *renderer, vector3d campos, const floa
 
 	renderer->SetAmbientColor(oldAmbient);
 
-	// if the update thread has deleted any geopatches, destroy the vbos
-	// associated with them
-	DestroyVBOs();
 		/*this->m_tempCampos = campos;
 		UpdateLODThread(this);
 		return;*/
@@ -1456,7 +1709,7 @@ void GeoSphere::Render(Graphics::Renderer *renderer, vector3d campos, const floa
 
 #ifndef GEOSPHERE_USE_THREADING
 	m_tempCampos = campos;
-	_UpdateLODs();
+	UpdateLODs();
 #endif /* !GEOSPHERE_USE_THREADING */
 }
 
@@ -11,11 +11,13 @@
 #include "galaxy/StarSystem.h"
 #include "graphics/Material.h"
 #include "terrain/Terrain.h"
+#include "LockFreeQueue.h"
 
 namespace Graphics { class Renderer; }
 class SystemBody;
 class GeoPatch;
 class GeoPatchContext;
+struct GeoPatchUpload;
 class GeoSphere {
 public:
 	GeoSphere(const SystemBody *body);
@@ -23,7 +25,7 @@ public:
 	void Render(Graphics::Renderer *r, vector3d campos, const float radius, const float scale);
 	inline double GetHeight(vector3d p) {
 		const double h = m_terrain->GetHeight(p);
-		s_vtxGenCount++;
+		AddVtxGenCount(1);
 #ifdef DEBUG
 		// XXX don't remove this. Fix your fractals instead
 		// Fractals absolutely MUST return heights >= 0.0 (one planet radius)
@@ -32,15 +34,35 @@ public:
 #endif /* DEBUG */
 		return h;
 	}
+	void GetHeights(const vector3d *p, double *heights, int count) {
+		m_terrain->GetHeights(p, heights, count);
+		AddVtxGenCount(count);
+#ifdef DEBUG
+		for (int i = 0; i < count; i++) assert(heights[i] >= 0.0);
+#endif /* DEBUG */
+	}
 	friend class GeoPatch;
+	friend class GeoPatchMeshJob;
 	static void Init();
 	static void Uninit();
 	static void OnChangeDetailLevel();
 	// in sbody radii
 	double GetMaxFeatureHeight() const { return m_terrain->GetMaxHeight(); }
-	static int GetVtxGenCount() { return s_vtxGenCount; }
+	static int GetVtxGenCount() { return int(s_vtxGenCount); }
 	static void ClearVtxGenCount() { s_vtxGenCount = 0; }
 
+	struct CacheBenchmark {
+		int patches;
+		int loaded;        // found in the disk cache again
+		int different;     // loaded, but not what was generated
+		double generateMs; // heights and colours
+		double loadMs;
+	};
+	// generates numSplits*numSplits patches over one face of the body,
+	// saving each to the disk cache, then loads them all back. the cache
+	// must be on
+	static CacheBenchmark BenchmarkCache(const SystemBody *sbody, int numSplits);
+
 private:
 	void BuildFirstPatches();
 	GeoPatch *m_patches[6];
@@ -51,25 +73,49 @@ private:
 
 	///////////////////////////
 	// threading rubbbbbish
-	// update thread can't do it since only 1 thread can molest opengl
+	// the update thread walks the patch tree and hands new patch meshes to
+	// the job pool. only the render thread can touch opengl, so vbo uploads
+	// and patch deletions go back to it through m_patchUploads
 	static int UpdateLODThread(void *data);
-	std::list<GLuint> m_vbosToDestroy;
-	SDL_mutex *m_vbosToDestroyLock;
-	void AddVBOToDestroy(GLuint vbo);
-	void DestroyVBOs();
+	void UpdateLODs();
+	void SplitPatches(const std::vector<GeoPatch*> &parents);
+
+	// called with m_updateLock held (or from the render thread when no
+	// update can be running): queue uploads for changed patches and
+	// deletion for merged ones
+	void FlushPatchUploads();
+	// render thread: do the queued uploads and deletions
+	void ProcessPatchUploads();
+	// render thread, m_updateLock held: delete every patch right now
+	void DeletePatches();
+
+	std::vector<GeoPatch*> m_dirtyPatches;
+	std::vector<GeoPatch*> m_deadPatches;
+	LockFreeQueue<GeoPatchUpload> m_patchUploads;
 
 	vector3d m_tempCampos;
 
 	SDL_mutex *m_updateLock;
-	SDL_mutex *m_abortLock;
-	bool m_abort;
+	// polled by the update thread and patch jobs so they can give up
+	// early. a stale read just means a little wasted work, so no lock;
+	// it's only cleared with m_updateLock held
+	volatile bool m_abort;
 	//////////////////////////////
 
 	inline vector3d GetColor(const vector3d &p, double height, const vector3d &norm) {
 		return m_terrain->GetColor(p, height, norm);
 	}
+	void GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, int count) {
+		m_terrain->GetColors(p, heights, norms, colors, count);
+	}
 
-	static int s_vtxGenCount;
+	// added to by the mesh generation workers, so it's changed atomically
+	static volatile long s_vtxGenCount;
+#if defined(_MSC_VER)
+	static void AddVtxGenCount(long n) { _InterlockedExchangeAdd(&s_vtxGenCount, n); }
+#else
+	static void AddVtxGenCount(long n) { __sync_add_and_fetch(&s_vtxGenCount, n); }
+#endif
 
 	static RefCountedPtr<GeoPatchContext> s_patchContext;
 
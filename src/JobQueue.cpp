@@ -0,0 +1,132 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "JobQueue.h"
+
+JobQueue::JobQueue(int numThreads)
+	: m_nextWorker(0)
+	, m_numUnfinished(0)
+	, m_shutdown(false)
+{
+	assert(numThreads > 0);
+
+	m_lock = SDL_CreateMutex();
+	m_jobQueued = SDL_CreateCond();
+	m_jobFinished = SDL_CreateCond();
+
+	// threads get a pointer into m_workers, so it can't move after this
+	m_workers.resize(numThreads);
+	for (int i = 0; i < numThreads; i++) {
+		Worker &w = m_workers[i];
+		w.queue = this;
+		w.threadNum = i;
+		w.lock = SDL_CreateMutex();
+	}
+	for (int i = 0; i < numThreads; i++)
+		m_workers[i].thread = SDL_CreateThread(&JobQueue::WorkerThread, &m_workers[i]);
+}
+
+JobQueue::~JobQueue()
+{
+	Finish();
+
+	SDL_mutexP(m_lock);
+	m_shutdown = true;
+	SDL_mutexV(m_lock);
+	SDL_CondBroadcast(m_jobQueued);
+
+	for (std::vector<Worker>::iterator i = m_workers.begin(); i != m_workers.end(); ++i) {
+		SDL_WaitThread(i->thread, 0);
+		SDL_DestroyMutex(i->lock);
+	}
+
+	SDL_DestroyCond(m_jobFinished);
+	SDL_DestroyCond(m_jobQueued);
+	SDL_DestroyMutex(m_lock);
+}
+
+void JobQueue::Queue(Job *job)
+{
+	SDL_mutexP(m_lock);
+	Worker &w = m_workers[m_nextWorker];
+	m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+
+	SDL_mutexP(w.lock);
+	w.jobs.push_back(job);
+	SDL_mutexV(w.lock);
+
+	m_numUnfinished++;
+	SDL_mutexV(m_lock);
+
+	// whoever wakes up will find the job, even if it's not in their own list
+	SDL_CondSignal(m_jobQueued);
+}
+
+void JobQueue::Finish()
+{
+	SDL_mutexP(m_lock);
+	while (m_numUnfinished > 0)
+		SDL_CondWait(m_jobFinished, m_lock);
+	SDL_mutexV(m_lock);
+}
+
+Job *JobQueue::TakeJob(int threadNum)
+{
+	Job *job = 0;
+
+	// own jobs first, newest first since it's likely to still be in cache
+	Worker &self = m_workers[threadNum];
+	SDL_mutexP(self.lock);
+	if (!self.jobs.empty()) {
+		job = self.jobs.back();
+		self.jobs.pop_back();
+	}
+	SDL_mutexV(self.lock);
+	if (job) return job;
+
+	// steal the oldest job from someone else, starting with our neighbour
+	// so the thieves spread out
+	const int numWorkers = m_workers.size();
+	for (int i = 1; i < numWorkers && !job; i++) {
+		Worker &victim = m_workers[(threadNum + i) % numWorkers];
+		SDL_mutexP(victim.lock);
+		if (!victim.jobs.empty()) {
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+		SDL_mutexV(victim.lock);
+	}
+
+	return job;
+}
+
+int JobQueue::WorkerThread(void *data)
+{
+	Worker *w = reinterpret_cast<Worker*>(data);
+	JobQueue *q = w->queue;
+
+	for (;;) {
+		Job *job = q->TakeJob(w->threadNum);
+
+		if (!job) {
+			// nothing anywhere. look again under the lock, since jobs are
+			// only added with it held, then sleep until one turns up
+			SDL_mutexP(q->m_lock);
+			while (!q->m_shutdown && !(job = q->TakeJob(w->threadNum)))
+				SDL_CondWait(q->m_jobQueued, q->m_lock);
+			SDL_mutexV(q->m_lock);
+
+			if (!job) break;
+		}
+
+		// the job may be deleted as soon as Run() returns, see JobQueue.h
+		job->Run(w->threadNum);
+
+		SDL_mutexP(q->m_lock);
+		if (--q->m_numUnfinished == 0)
+			SDL_CondBroadcast(q->m_jobFinished);
+		SDL_mutexV(q->m_lock);
+	}
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _JOBQUEUE_H
+#define _JOBQUEUE_H
+
+#include "libs.h"
+#include <deque>
+
+// A unit of work to be run by a JobQueue
+class Job {
+public:
+	virtual ~Job() {}
+	// called from a worker thread. threadNum identifies the worker running
+	// the job, from 0 to JobQueue::GetNumThreads()-1
+	virtual void Run(int threadNum) = 0;
+};
+
+// A fixed pool of worker threads. Each worker has its own list of jobs;
+// queued jobs are dealt out to the workers in turn, and a worker that runs
+// out takes jobs from the others, so uneven jobs still keep every thread
+// busy. Jobs may start and finish in any order. The queue does not own its
+// jobs, and never touches a job again once its Run() has returned. So a job
+// must stay alive until either Finish() returns, or it has handed itself
+// over as the very last thing its Run() does (for example by adding itself
+// to a list under a lock its owner takes before deleting it), whichever
+// comes first.
+class JobQueue {
+public:
+	explicit JobQueue(int numThreads);
+	~JobQueue();
+
+	int GetNumThreads() const { return m_workers.size(); }
+
+	void Queue(Job *job);
+
+	// block until every job queued so far has run
+	void Finish();
+
+private:
+	struct Worker {
+		JobQueue *queue;
+		int threadNum;
+		SDL_Thread *thread;
+		SDL_mutex *lock;          // protects jobs
+		std::deque<Job*> jobs;
+	};
+	static int WorkerThread(void *data);
+
+	// next job for the given worker: its own newest, or another's oldest
+	Job *TakeJob(int threadNum);
+
+	std::vector<Worker> m_workers;
+	int m_nextWorker;             // who gets the next queued job
+
+	SDL_mutex *m_lock;
+	SDL_cond *m_jobQueued;        // signalled when a job is added or we're shutting down
+	SDL_cond *m_jobFinished;      // signalled when m_numUnfinished drops to zero
+	int m_numUnfinished;          // queued plus currently running
+	bool m_shutdown;
+};
+
+#endif
@@ -0,0 +1,99 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "libs.h"
+#include "Kepler.h"
+
+// universal variable formulation, see eg Curtis, "Orbital Mechanics for
+// Engineering Students", section 3.7. it handles ellipses, parabolas and
+// hyperbolas the same way, so ships can change from one to another
+
+// the Stumpff functions, with series near zero where the closed forms lose
+// all their precision
+static double StumpffC(double z)
+{
+	if (z > 1e-6) return (1.0 - cos(sqrt(z))) / z;
+	if (z < -1e-6) return (cosh(sqrt(-z)) - 1.0) / -z;
+	return 1.0/2.0 - z/24.0 + z*z/720.0;
+}
+
+static double StumpffS(double z)
+{
+	if (z > 1e-6) {
+		const double s = sqrt(z);
+		return (s - sin(s)) / (s*s*s);
+	}
+	if (z < -1e-6) {
+		const double s = sqrt(-z);
+		return (sinh(s) - s) / (s*s*s);
+	}
+	return 1.0/6.0 - z/120.0 + z*z/5040.0;
+}
+
+static const int MAX_ITERATIONS = 50;
+static const double TOLERANCE = 1e-10; // any less and rounding in F can stop it ever settling
+
+bool Kepler::Propagate(double mu, const vector3d &pos, const vector3d &vel, double dt, vector3d &outPos, vector3d &outVel)
+{
+	if (mu <= 0.0) {
+		outPos = pos + vel * dt;
+		outVel = vel;
+		return true;
+	}
+
+	const double r0 = pos.Length();
+	if (r0 <= 0.0) return false;
+	const double sqrtMu = sqrt(mu);
+	const double vr0 = pos.Dot(vel) / r0;
+	const double alpha = 2.0 / r0 - vel.LengthSqr() / mu; // 1 / semi-major axis
+
+	// solve Kepler's equation for the universal anomaly chi. the first
+	// guesses are from Vallado, "Fundamentals of Astrodynamics and
+	// Applications", algorithm 8
+	double chi;
+	if (alpha > 1e-12)
+		chi = sqrtMu * alpha * dt;
+	else if (alpha < -1e-12) {
+		const double a = 1.0 / alpha;
+		const double sign = dt < 0.0 ? -1.0 : 1.0;
+		const double denom = pos.Dot(vel) + sign * sqrt(-mu * a) * (1.0 - r0 * alpha);
+		const double ratio = -2.0 * mu * alpha * dt / denom;
+		chi = ratio > 0.0 ? sign * sqrt(-a) * log(ratio) : sqrtMu * dt / r0;
+	}
+	else
+		chi = sqrtMu * dt / r0; // near parabolic
+	double z = 0.0, C = 0.5, S = 1.0/6.0;
+	int i;
+	for (i = 0; i < MAX_ITERATIONS; i++) {
+		z = alpha * chi * chi;
+		C = StumpffC(z);
+		S = StumpffS(z);
+		const double F = r0*vr0/sqrtMu * chi*chi * C + (1.0 - alpha*r0) * chi*chi*chi * S + r0*chi - sqrtMu*dt;
+		const double dF = r0*vr0/sqrtMu * chi * (1.0 - z*S) + (1.0 - alpha*r0) * chi*chi * C + r0;
+		const double ddF = r0*vr0/sqrtMu * (1.0 - z*C) + (1.0 - alpha*r0) * chi * (1.0 - z*S);
+		// Laguerre's method (Conway's n = 5) rather than Newton's, which can
+		// overshoot on hyperbolas and never come back
+		const double root = sqrt(fabs(16.0*dF*dF - 20.0*F*ddF));
+		const double step = 5.0*F / (dF + (dF < 0.0 ? -root : root));
+		chi -= step;
+		if (fabs(step) <= TOLERANCE * std::max(fabs(chi), 1.0)) break;
+	}
+	if (i == MAX_ITERATIONS || !(fabs(chi) <= DBL_MAX)) return false; // or NaN
+
+	z = alpha * chi * chi;
+	C = StumpffC(z);
+	S = StumpffS(z);
+
+	// Lagrange coefficients
+	const double f = 1.0 - chi*chi / r0 * C;
+	const double g = dt - chi*chi*chi / sqrtMu * S;
+	const vector3d newPos = f * pos + g * vel;
+	const double r = newPos.Length();
+	if (!(r > 0.0)) return false;
+	const double fdot = sqrtMu / (r * r0) * (z * S - 1.0) * chi;
+	const double gdot = 1.0 - chi*chi / r * C;
+
+	outPos = newPos;
+	outVel = fdot * pos + gdot * vel;
+	return true;
+}
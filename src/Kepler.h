@@ -0,0 +1,20 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _KEPLER_H
+#define _KEPLER_H
+
+#include "vector3.h"
+
+namespace Kepler {
+
+	// moves something falling freely around a mass (mu = G * mass) from
+	// pos, vel to where it is dt seconds later. works for any orbit, closed
+	// or not, and for mu = 0 (a straight line). returns false if the
+	// solution doesn't converge, in which case outPos and outVel are
+	// untouched
+	bool Propagate(double mu, const vector3d &pos, const vector3d &vel, double dt, vector3d &outPos, vector3d &outVel);
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include "graphics/Graphics.h"
 #include "graphics/Material.h"
 #include "graphics/Renderer.h"
+#include "graphics/RenderQueue.h"
 #include "graphics/VertexArray.h"
 #include "graphics/TextureBuilder.h"
 #include "graphics/TextureGL.h" // XXX temporary until LMR uses renderer drawing properly
@@ -343,6 +344,7 @@ static RefCountedPtr<Text::VectorFont> s_font;
 static float NEWMODEL_ZBIAS = 0.0002f;
 static LmrGeomBuffer *s_curBuf;
 static const LmrObjParams *s_curParams;
+static Uint32 s_curParamsRead; // PARAM_* flags for what the current build has looked at
 static std::map<std::string, LmrModel*> s_models;
 static lua_State *sLua;
 static int s_numTrisRendered;
@@ -362,6 +364,70 @@ lua_State *LmrGetLuaState() { return sLua; }
 int LmrModelGetStatsTris() { return s_numTrisRendered; }
 void LmrModelClearStatsTris() { s_numTrisRendered = 0; }
 
+static int s_numDynamicBuilds;
+static int s_numDynamicReuses;
+int LmrModelGetStatsDynamicBuilds() { return s_numDynamicBuilds; }
+int LmrModelGetStatsDynamicReuses() { return s_numDynamicReuses; }
+void LmrModelClearStatsDynamic() { s_numDynamicBuilds = s_numDynamicReuses = 0; }
+
+// the parts of LmrObjParams a dynamic function can read. a build notes the
+// ones it used, and its geometry is good until one of those changes
+enum {
+	PARAM_TIME        = (1<<0),
+	PARAM_ANIMATION   = (1<<1),
+	PARAM_EQUIPMENT   = (1<<2),
+	PARAM_FLIGHTSTATE = (1<<3),
+	PARAM_LABEL       = (1<<4),
+	PARAM_MATERIAL    = (1<<5)
+};
+
+static void HashValue(CRC32 &crc, const void *data, size_t size)
+{
+	crc.AddData(static_cast<const char*>(data), int(size));
+}
+
+static void HashString(CRC32 &crc, const char *str)
+{
+	if (!str) str = "";
+	crc.AddData(str, int(strlen(str))+1);
+}
+
+static Uint32 HashParams(const LmrObjParams *params, Uint32 read)
+{
+	CRC32 crc;
+	if (read & PARAM_TIME)
+		HashValue(crc, &params->time, sizeof(params->time));
+	if (read & PARAM_ANIMATION) {
+		HashString(crc, params->animationNamespace);
+		HashValue(crc, params->animStages, sizeof(params->animStages));
+		HashValue(crc, params->animValues, sizeof(params->animValues));
+	}
+	if (read & PARAM_EQUIPMENT) {
+		const int hasEquipment = params->equipment ? 1 : 0;
+		HashValue(crc, &hasEquipment, sizeof(hasEquipment));
+		if (params->equipment) {
+			for (int slot = 0; slot < Equip::SLOT_MAX; slot++) {
+				const int size = params->equipment->GetSlotSize(Equip::Slot(slot));
+				for (int i = 0; i < size; i++) {
+					const int equip = params->equipment->Get(Equip::Slot(slot), i);
+					HashValue(crc, &equip, sizeof(equip));
+				}
+			}
+		}
+	}
+	if (read & PARAM_FLIGHTSTATE) {
+		// only ships (those with equipment) have one
+		const int isShip = params->equipment ? 1 : 0;
+		HashValue(crc, &isShip, sizeof(isShip));
+		HashValue(crc, &params->flightState, sizeof(params->flightState));
+	}
+	if (read & PARAM_LABEL)
+		HashString(crc, params->label);
+	if (read & PARAM_MATERIAL)
+		HashValue(crc, params->pMat, sizeof(params->pMat));
+	return crc.GetChecksum();
+}
+
 #define BUFFER_OFFSET(i) (reinterpret_cast<const GLvoid *>(i))
 
 static void _fwrite_string(const std::string &str, FILE *f)
@@ -1226,7 +1292,7 @@ public:
 	}
 };
 
-LmrModel::LmrModel(const char *model_name) : m_dumped(false)
+LmrModel::LmrModel(const char *model_name) : m_lastDynamicExpiry(0), m_dumped(false)
 {
 	m_name = model_name;
 	m_drawClipRadius = 1.0f;
@@ -1382,6 +1448,10 @@ LmrModel::~LmrModel()
 		delete m_staticGeometry[i];
 		delete m_dynamicGeometry[i];
 	}
+	for (DynamicGeometryMap::iterator it = m_dynamicCache.begin(); it != m_dynamicCache.end(); ++it) {
+		for (int i=0; i<m_numLods; i++)
+			delete it->second.geometry[i];
+	}
 }
 
 //static std::map<std::string, LmrModel*> s_models;
@@ -1494,10 +1564,24 @@ bool LmrModel::HasTag(const char *tag) const
 
 void LmrModel::Render(Graphics::Renderer *r, const matrix4x4f &trans, LmrObjParams *params)
 {
+	// LMR binds buffers and sets client arrays with GL directly, and sets
+	// blend modes part way through. a render queue flushed by one of those
+	// would undo its bindings under it, so the queue is flushed before LMR
+	// starts and kept off until it's done. the queue's draws don't go through
+	// the buffer binding cache either, so that's reset first
+	Graphics::RenderQueue *queue = r->GetRenderQueue();
+	if (queue) {
+		r->SetRenderQueue(0);
+		Graphics::UnbindAllBuffers();
+	}
+
 	RenderState rstate;
 	rstate.subTransform = matrix4x4f::Identity();
 	rstate.combinedScale = m_scale;
 	Render(&rstate, vector3f(-trans[12], -trans[13], -trans[14]), trans, params);
+
+	if (queue)
+		r->SetRenderQueue(queue);
 }
 
 void LmrModel::Render(const RenderState *rstate, const vector3f &cameraPos, const matrix4x4f &trans, LmrObjParams *params)
@@ -1515,7 +1599,7 @@ void LmrModel::Render(const RenderState *rstate, const vector3f &cameraPos, cons
 	}
 	//printf("%s: lod %d\n", m_name.c_str(), lod);
 
-	Build(lod, params);
+	LmrGeomBuffer *dynamicGeometry = m_hasDynamicFunc ? GetDynamicGeometry(lod, params) : 0;
 
 	const vector3f modelRelativeCamPos = trans.InverseOf() * cameraPos;
 
@@ -1524,8 +1608,8 @@ void LmrModel::Render(const RenderState *rstate, const vector3f &cameraPos, cons
 	glEnable(GL_LIGHTING);
 
 	m_staticGeometry[lod]->Render(rstate, modelRelativeCamPos, params);
-	if (m_hasDynamicFunc) {
-		m_dynamicGeometry[lod]->Render(rstate, modelRelativeCamPos, params);
+	if (dynamicGeometry) {
+		dynamicGeometry->Render(rstate, modelRelativeCamPos, params);
 	}
 	s_curBuf = 0;
 
@@ -1542,24 +1626,66 @@ void LmrModel::Render(const RenderState *rstate, const vector3f &cameraPos, cons
 	glPopMatrix();
 }
 
-void LmrModel::Build(int lod, const LmrObjParams *params)
+// dynamic geometry that hasn't been drawn for this long is thrown away. it
+// belongs to a body that's gone, or one that's out of sight
+static const Uint32 DYNAMIC_GEOMETRY_EXPIRY_MSEC = 5000;
+
+Uint32 LmrModel::Build(LmrGeomBuffer *buf, int lod, const LmrObjParams *params)
 {
-	if (m_hasDynamicFunc) {
-		LUA_DEBUG_START(sLua);
-		m_dynamicGeometry[lod]->PreBuild();
-		s_curBuf = m_dynamicGeometry[lod];
-		s_curParams = params;
-		lua_pushcfunction(sLua, pi_lua_panic);
-		// call model dynamic bits
-		lua_getglobal(sLua, (m_name+"_dynamic").c_str());
-		// lod as first argument
-		lua_pushnumber(sLua, lod+1);
-		lua_pcall(sLua, 1, 0, -3);
-		lua_pop(sLua, 1);  // remove panic func
-		s_curBuf = 0;
-		s_curParams = 0;
-		m_dynamicGeometry[lod]->PostBuild();
-		LUA_DEBUG_END(sLua, 0);
+	s_numDynamicBuilds++;
+	s_curParamsRead = 0;
+	LUA_DEBUG_START(sLua);
+	buf->PreBuild();
+	s_curBuf = buf;
+	s_curParams = params;
+	lua_pushcfunction(sLua, pi_lua_panic);
+	// call model dynamic bits
+	lua_getglobal(sLua, (m_name+"_dynamic").c_str());
+	// lod as first argument
+	lua_pushnumber(sLua, lod+1);
+	lua_pcall(sLua, 1, 0, -3);
+	lua_pop(sLua, 1);  // remove panic func
+	s_curBuf = 0;
+	s_curParams = 0;
+	buf->PostBuild();
+	LUA_DEBUG_END(sLua, 0);
+	return s_curParamsRead;
+}
+
+LmrGeomBuffer *LmrModel::GetDynamicGeometry(int lod, const LmrObjParams *params)
+{
+	const Uint32 now = SDL_GetTicks();
+	if (now - m_lastDynamicExpiry > DYNAMIC_GEOMETRY_EXPIRY_MSEC)
+		ExpireDynamicGeometry(now);
+
+	DynamicGeometry &dyn = m_dynamicCache[params];
+	dyn.lastUsed = now;
+	if (dyn.geometry[lod] && HashParams(params, dyn.paramsRead[lod]) == dyn.paramsHash[lod]) {
+		s_numDynamicReuses++;
+		return dyn.geometry[lod];
+	}
+
+	// the function takes the same path through itself as long as what it
+	// reads doesn't change, so what it reads this time is all that matters
+	if (!dyn.geometry[lod])
+		dyn.geometry[lod] = new LmrGeomBuffer(this, false);
+	dyn.paramsRead[lod] = Build(dyn.geometry[lod], lod, params);
+	dyn.paramsHash[lod] = HashParams(params, dyn.paramsRead[lod]);
+	return dyn.geometry[lod];
+}
+
+void LmrModel::ExpireDynamicGeometry(Uint32 now)
+{
+	m_lastDynamicExpiry = now;
+	DynamicGeometryMap::iterator it = m_dynamicCache.begin();
+	while (it != m_dynamicCache.end()) {
+		if (now - it->second.lastUsed > DYNAMIC_GEOMETRY_EXPIRY_MSEC) {
+			for (int i=0; i<m_numLods; i++)
+				delete it->second.geometry[i];
+			m_dynamicCache.erase(it++);
+		}
+		else
+			++it;
 	}
 }
 
@@ -1573,7 +1699,7 @@ RefCountedPtr<CollMesh> LmrModel::CreateCollisionMesh(const LmrObjParams *params
 void LmrModel::GetCollMeshGeometry(LmrCollMesh *mesh, const matrix4x4f &transform, const LmrObjParams *params)
 {
 	// use lowest LOD
-	Build(0, params);
+	if (m_hasDynamicFunc) Build(m_dynamicGeometry[0], 0, params);
 	matrix4x4f m = transform * matrix4x4f::ScaleMatrix(m_scale);
 	m_staticGeometry[0]->GetCollMeshGeometry(mesh, m, params);
 	if (m_hasDynamicFunc) m_dynamicGeometry[0]->GetCollMeshGeometry(mesh, m, params);
@@ -1604,7 +1730,7 @@ void LmrModel::Dump(const LmrObjParams *params, const char* pMainFolderName)
 	if (m_hasDynamicFunc)
 	{
 		for (int lod = 0; lod < m_numLods; lod++) {
-			Build( lod, params );
+			Build(m_dynamicGeometry[lod], lod, params);
 			m_dynamicGeometry[lod]->Dump(params, rootFolderName, m_name, lod);
 		}
 	}
@@ -3874,6 +4000,7 @@ namespace ModelFuncs {
 	static int get_time(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_TIME;
 		double t = s_curParams->time;
 		int nparams = lua_gettop(L);
 		if (nparams == 0) {
@@ -3941,6 +4068,7 @@ namespace ModelFuncs {
 	static int get_equipment(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_EQUIPMENT;
 		if (s_curParams->equipment) {
 			const char *slotName = luaL_checkstring(L, 1);
 			int index = luaL_optinteger(L, 2, 0);
@@ -4001,6 +4129,7 @@ namespace ModelFuncs {
 	static int get_animation_stage(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_ANIMATION;
 		if (s_curParams->animationNamespace) {
 			const char *animName = luaL_checkstring(L, 1);
 			int anim = LuaConstants::GetConstant(L, s_curParams->animationNamespace, animName);
@@ -4044,6 +4173,7 @@ namespace ModelFuncs {
 	static int get_animation_position(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_ANIMATION;
 		if (s_curParams->animationNamespace) {
 			const char *animName = luaL_checkstring(L, 1);
 			int anim = LuaConstants::GetConstant(L, s_curParams->animationNamespace, animName);
@@ -4084,6 +4214,7 @@ namespace ModelFuncs {
 	static int get_flight_state(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_FLIGHTSTATE;
 		// if there is equipment then there should also be a flightState
 		if (s_curParams->equipment) {
 			lua_pushstring(L, LuaConstants::GetConstantString(L, "ShipFlightState", s_curParams->flightState));
@@ -4122,6 +4253,7 @@ namespace ModelFuncs {
 	static int get_label(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_LABEL;
 		lua_pushstring(L, s_curParams->label ? s_curParams->label : "");
 		return 1;
 	}
@@ -4158,6 +4290,7 @@ namespace ModelFuncs {
 	static int get_arg_material(lua_State *L)
 	{
 		assert(s_curParams != 0);
+		s_curParamsRead |= PARAM_MATERIAL;
 		int n = luaL_checkinteger(L, 1);
 		if (n < 0 || n > int(COUNTOF(s_curParams->pMat)))
 			return luaL_error(L, "argument #1 of get_arg_material is out of range");
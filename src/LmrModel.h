@@ -6,6 +6,7 @@
 
 #include <map>
 #include <vector>
+#include <algorithm>
 #include <sigc++/sigc++.h>
 #include "CollMesh.h"
 #include "ModelBase.h"
@@ -44,7 +45,28 @@ public:
 	std::string GetDumpPath(const char *pMainFolderName=0);
 	void Dump(const LmrObjParams *params, const char* pMainFolderName=0);
 private:
-	void Build(int lod, const LmrObjParams *params);
+	// runs the dynamic function into buf. returns the PARAM_* flags for the
+	// parts of params it read
+	Uint32 Build(LmrGeomBuffer *buf, int lod, const LmrObjParams *params);
+	// the dynamic geometry for an instance, built again only if something
+	// the dynamic function read from its params has changed
+	LmrGeomBuffer *GetDynamicGeometry(int lod, const LmrObjParams *params);
+	void ExpireDynamicGeometry(Uint32 now);
+
+	struct DynamicGeometry {
+		DynamicGeometry() : lastUsed(0) {
+			std::fill(geometry, geometry+LMR_MAX_LOD, static_cast<LmrGeomBuffer*>(0));
+			std::fill(paramsRead, paramsRead+LMR_MAX_LOD, 0);
+			std::fill(paramsHash, paramsHash+LMR_MAX_LOD, 0);
+		}
+		LmrGeomBuffer *geometry[LMR_MAX_LOD]; // 0 until that lod is drawn
+		Uint32 paramsRead[LMR_MAX_LOD];
+		Uint32 paramsHash[LMR_MAX_LOD];
+		Uint32 lastUsed; // SDL_GetTicks()
+	};
+	// by the params an instance is drawn with. bodies keep theirs for their
+	// lifetime; instances sharing one share the geometry too
+	typedef std::map<const LmrObjParams*, DynamicGeometry> DynamicGeometryMap;
 
 	// index into m_materials
 	std::map<std::string, int> m_materialLookup;
@@ -53,7 +75,9 @@ private:
 	float m_lodPixelSize[LMR_MAX_LOD];
 	int m_numLods;
 	LmrGeomBuffer *m_staticGeometry[LMR_MAX_LOD];
-	LmrGeomBuffer *m_dynamicGeometry[LMR_MAX_LOD];
+	LmrGeomBuffer *m_dynamicGeometry[LMR_MAX_LOD]; // for collision meshes and dumps
+	DynamicGeometryMap m_dynamicCache;
+	Uint32 m_lastDynamicExpiry;
 	std::string m_name;
 	bool m_hasDynamicFunc;
 	// only used for lod pixel size at the moment
@@ -71,6 +95,10 @@ LmrModel *LmrLookupModelByName(const char *name);
 void LmrModelRender(LmrModel *m, const matrix4x4f &transform);
 int LmrModelGetStatsTris();
 void LmrModelClearStatsTris();
+// dynamic functions run, and dynamic geometry reused from an earlier frame
+int LmrModelGetStatsDynamicBuilds();
+int LmrModelGetStatsDynamicReuses();
+void LmrModelClearStatsDynamic();
 void LmrGetModelsWithTag(const char *tag, std::vector<LmrModel*> &outModels);
 void LmrGetAllModelNames(std::vector<std::string> &modelNames);
 lua_State *LmrGetLuaState();
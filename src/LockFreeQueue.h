@@ -0,0 +1,72 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LOCKFREEQUEUE_H
+#define _LOCKFREEQUEUE_H
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+// x86 doesn't reorder stores with stores or loads with loads, so only the
+// compiler needs to be stopped
+#define LOCKFREEQUEUE_BARRIER() _ReadWriteBarrier()
+#else
+#define LOCKFREEQUEUE_BARRIER() __sync_synchronize()
+#endif
+
+/*
+ * Unbounded FIFO for handing values from one thread to another without
+ * locking. Exactly one thread may Push() and exactly one may Pop() at any
+ * time; they can be different threads. If the producer changes hands, the
+ * handover needs some other synchronisation (eg a mutex held while pushing).
+ */
+template <typename T>
+class LockFreeQueue {
+public:
+	LockFreeQueue() { m_head = m_tail = new Node(); }
+
+	~LockFreeQueue() {
+		while (m_head) {
+			Node *next = m_head->next;
+			delete m_head;
+			m_head = next;
+		}
+	}
+
+	// producer only
+	void Push(const T &value) {
+		Node *n = new Node(value);
+		// the node has to be filled in before the consumer can see it
+		LOCKFREEQUEUE_BARRIER();
+		m_tail->next = n;
+		m_tail = n;
+	}
+
+	// consumer only. returns false if there's nothing to take
+	bool Pop(T &value) {
+		Node *next = m_head->next;
+		if (!next) return false;
+		LOCKFREEQUEUE_BARRIER();
+		value = next->value;
+		// next becomes the empty head. the producer never looks at the old
+		// head once it has a successor, so it's safe to free
+		delete m_head;
+		m_head = next;
+		return true;
+	}
+
+private:
+	LockFreeQueue(const LockFreeQueue &);
+	LockFreeQueue &operator=(const LockFreeQueue &);
+
+	struct Node {
+		Node() : next(0) {}
+		Node(const T &v) : value(v), next(0) {}
+		T value;
+		Node * volatile next;
+	};
+
+	Node *m_head; // consumer's end; always an already-consumed node
+	Node *m_tail; // producer's end
+};
+
+#endif
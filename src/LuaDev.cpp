@@ -5,6 +5,15 @@
 #include "LuaObject.h"
 #include "Pi.h"
 #include "WorldView.h"
+#include "Game.h"
+#include "Space.h"
+#include "Ship.h"
+#include "Player.h"
+#include "Serializer.h"
+#include "OS.h"
+#include "terrain/Terrain.h"
+#include "galaxy/StarSystem.h"
+#include "mtrand.h"
 
 /*
  * Lua commands used in development & debugging
@@ -31,6 +40,133 @@ static int l_dev_set_camera_offset(lua_State *l)
 	return 0;
 }
 
+/*
+ * Fill the current system with ships that all target each other, then time
+ * saving and reloading its Space. The ships are removed again afterwards.
+ * Returns save time and load time in milliseconds and the size of the save
+ * data in bytes
+ *
+ * save_ms, load_ms, bytes = Dev.BenchmarkSaveLoad(num_ships)
+ */
+static int l_dev_benchmark_save_load(lua_State *l)
+{
+	if (!Pi::game)
+		return luaL_error(l, "Dev.BenchmarkSaveLoad only works when there is a game running");
+	if (Pi::game->IsHyperspace())
+		return luaL_error(l, "Dev.BenchmarkSaveLoad can't be used in hyperspace");
+	const int numShips = luaL_checkinteger(l, 1);
+
+	Space *space = Pi::game->GetSpace();
+
+	std::vector<Ship*> ships;
+	for (int i = 0; i < numShips; i++) {
+		Ship *ship = new Ship(ShipType::LADYBIRD);
+		ship->SetFrame(Pi::player->GetFrame());
+		ship->SetPosition(Pi::player->GetPosition() + 100000.0 *
+			vector3d(Pi::rng.Double(-1.0, 1.0), Pi::rng.Double(-1.0, 1.0), Pi::rng.Double(-1.0, 1.0)));
+		ship->SetVelocity(Pi::player->GetVelocity());
+		// cross-references are what make saving expensive
+		if (!ships.empty())
+			ship->AIKill(ships[Pi::rng.Int32(ships.size())]);
+		space->AddBody(ship);
+		ships.push_back(ship);
+	}
+
+	const int numBodies = std::distance(space->BodiesBegin(), space->BodiesEnd());
+
+	Serializer::Writer wr;
+	Uint64 start = OS::HFTimer();
+	space->Serialize(wr);
+	const Uint64 saveTicks = OS::HFTimer() - start;
+
+	const std::string data = wr.GetData();
+	Serializer::Reader rd(data);
+	Player *player = Pi::player;
+	start = OS::HFTimer();
+	Space *loaded = new Space(Pi::game, rd);
+	const Uint64 loadTicks = OS::HFTimer() - start;
+	// loading a player makes it the current player
+	Pi::player = player;
+	delete loaded;
+
+	for (std::vector<Ship*>::iterator i = ships.begin(); i != ships.end(); ++i)
+		space->KillBody(*i);
+
+	const double saveMs = 1000.0 * double(saveTicks) / double(OS::HFTimerFreq());
+	const double loadMs = 1000.0 * double(loadTicks) / double(OS::HFTimerFreq());
+	printf("save/load benchmark: %d bodies, %d bytes, save %.1f ms, load %.1f ms\n",
+		numBodies, int(data.size()), saveMs, loadMs);
+
+	lua_pushnumber(l, saveMs);
+	lua_pushnumber(l, loadMs);
+	lua_pushinteger(l, data.size());
+	return 3;
+}
+
+/*
+ * Compare the batch terrain functions (Terrain::GetHeights and GetColors)
+ * with the single point ones for every body in the current system, on a
+ * fixed set of points. Timings are printed. Returns the number of points
+ * where the results differ at all, which should be 0
+ *
+ * mismatches = Dev.CheckTerrainBatch()
+ */
+static int l_dev_check_terrain_batch(lua_State *l)
+{
+	if (!Pi::game)
+		return luaL_error(l, "Dev.CheckTerrainBatch only works when there is a game running");
+
+	const int NUM_POINTS = 20000;
+	MTRand rand(1234);
+	std::vector<vector3d> points(NUM_POINTS), norms(NUM_POINTS);
+	for (int i = 0; i < NUM_POINTS; i++) {
+		points[i] = vector3d(rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0)).Normalized();
+		const vector3d tilt(rand.Double(-0.3, 0.3), rand.Double(-0.3, 0.3), rand.Double(-0.3, 0.3));
+		norms[i] = (points[i] + tilt).Normalized();
+	}
+
+	std::vector<double> heights(NUM_POINTS), batchHeights(NUM_POINTS);
+	std::vector<vector3d> colors(NUM_POINTS), batchColors(NUM_POINTS);
+	int mismatches = 0;
+
+	const std::vector<SystemBody*> &bodies = Pi::game->GetSpace()->GetStarSystem()->m_bodies;
+	for (std::vector<SystemBody*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		const SystemBody *sbody = *i;
+		if (sbody->type == SystemBody::TYPE_GRAVPOINT) continue;
+		Terrain *terrain = Terrain::InstanceTerrain(sbody);
+
+		const Uint64 start = OS::HFTimer();
+		for (int j = 0; j < NUM_POINTS; j++)
+			heights[j] = terrain->GetHeight(points[j]);
+		for (int j = 0; j < NUM_POINTS; j++)
+			colors[j] = terrain->GetColor(points[j], heights[j], norms[j]);
+		const Uint64 single = OS::HFTimer() - start;
+
+		const Uint64 batchStart = OS::HFTimer();
+		terrain->GetHeights(&points[0], &batchHeights[0], NUM_POINTS);
+		terrain->GetColors(&points[0], &batchHeights[0], &norms[0], &batchColors[0], NUM_POINTS);
+		const Uint64 batch = OS::HFTimer() - batchStart;
+
+		// bit for bit, so no tolerance
+		int bad = 0;
+		for (int j = 0; j < NUM_POINTS; j++) {
+			if (memcmp(&heights[j], &batchHeights[j], sizeof(double)) ||
+					memcmp(&colors[j], &batchColors[j], sizeof(vector3d)))
+				bad++;
+		}
+		mismatches += bad;
+
+		printf("%s (%s, %s): single %.2f ms, batch %.2f ms, %d mismatches\n",
+			sbody->name.c_str(), terrain->GetHeightFractalName(), terrain->GetColorFractalName(),
+			1000.0 * double(single) / double(OS::HFTimerFreq()), 1000.0 * double(batch) / double(OS::HFTimerFreq()), bad);
+
+		delete terrain;
+	}
+
+	lua_pushinteger(l, mismatches);
+	return 1;
+}
+
 void LuaDev::Register()
 {
 	lua_State *l = Lua::manager->GetLuaState();
@@ -39,6 +175,8 @@ void LuaDev::Register()
 
 	static const luaL_Reg methods[]= {
 		{ "SetCameraOffset", l_dev_set_camera_offset },
+		{ "BenchmarkSaveLoad", l_dev_benchmark_save_load },
+		{ "CheckTerrainBatch", l_dev_check_terrain_batch },
 		{ 0, 0 }
 	};
 
@@ -418,6 +418,27 @@ static int l_space_get_body(lua_State *l)
 	return 1;
 }
 
+// call the filter function at the given stack index with the body. true if
+// it wants the body
+static bool _filter_body(lua_State *l, int filterIdx, Body *b)
+{
+	lua_pushvalue(l, filterIdx);
+	LuaBody::PushToLua(b);
+	if (int ret = lua_pcall(l, 1, 1, 0)) {
+		const char *errmsg( "Unknown error" );
+		if (ret == LUA_ERRRUN)
+			errmsg = lua_tostring(l, -1);
+		else if (ret == LUA_ERRMEM)
+			errmsg = "memory allocation failure";
+		else if (ret == LUA_ERRERR)
+			errmsg = "error in error handler function";
+		luaL_error(l, "Error in filter function: %s", errmsg);
+	}
+	const bool wanted = lua_toboolean(l, -1);
+	lua_pop(l, 1);
+	return wanted;
+}
+
 /*
  * Function: GetBodies
  *
@@ -472,25 +493,8 @@ static int l_space_get_bodies(lua_State *l)
 	for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i) {
 		Body *b = *i;
 
-		if (filter) {
-			lua_pushvalue(l, 1);
-			LuaBody::PushToLua(b);
-			if (int ret = lua_pcall(l, 1, 1, 0)) {
-				const char *errmsg( "Unknown error" );
-				if (ret == LUA_ERRRUN)
-					errmsg = lua_tostring(l, -1);
-				else if (ret == LUA_ERRMEM)
-					errmsg = "memory allocation failure";
-				else if (ret == LUA_ERRERR)
-					errmsg = "error in error handler function";
-				luaL_error(l, "Error in filter function: %s", errmsg);
-			}
-			if (!lua_toboolean(l, -1)) {
-				lua_pop(l, 1);
-				continue;
-			}
-			lua_pop(l, 1);
-		}
+		if (filter && !_filter_body(l, 1, b))
+			continue;
 
 		lua_pushinteger(l, lua_rawlen(l, -1)+1);
 		LuaBody::PushToLua(b);
@@ -502,6 +506,155 @@ static int l_space_get_bodies(lua_State *l)
 	return 1;
 }
 
+/*
+ * Function: GetNearestBodies
+ *
+ * Get the <Body> objects nearest to a body, closest first
+ *
+ * > bodies = Space.GetNearestBodies(body, count, filter)
+ *
+ * Parameters:
+ *
+ *   body - the <Body> to search around. It is not included in the results
+ *
+ *   count - the maximum number of bodies to return
+ *
+ *   filter - an optional function, as for <GetBodies>. Only bodies it
+ *            returns true for are counted
+ *
+ * Return:
+ *
+ *   bodies - an array of up to count <Body> objects, nearest first
+ *
+ * Example:
+ *
+ * > -- the three ships closest to the player
+ * > local ships = Space.GetNearestBodies(Game.player, 3, function (body)
+ * >     return body:isa("Ship")
+ * > end)
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_space_get_nearest_bodies(lua_State *l)
+{
+	if (!Pi::game)
+		luaL_error(l, "Game is not started");
+
+	LUA_DEBUG_START(l);
+
+	Body *b = LuaBody::CheckFromLua(1);
+	const int count = luaL_checkinteger(l, 2);
+	bool filter = false;
+	if (lua_gettop(l) >= 3) {
+		luaL_checktype(l, 3, LUA_TFUNCTION); // any type of function
+		filter = true;
+	}
+
+	lua_newtable(l);
+
+	if (count > 0) {
+		// the filter can't be run in the middle of the search, so ask for
+		// more candidates until enough pass or there are no more
+		const SpatialIndex::TypeFilter anyBody(Object::BODY);
+		std::vector<Body*> candidates;
+		size_t numWanted = count;
+		size_t numSeen = 0;
+		int numFound = 0;
+		for (;;) {
+			candidates.clear();
+			Pi::game->GetSpace()->FindBodiesNear(b, numWanted, FLT_MAX, anyBody, candidates);
+			for (; numSeen < candidates.size() && numFound < count; numSeen++) {
+				Body *candidate = candidates[numSeen];
+				if (filter && !_filter_body(l, 3, candidate))
+					continue;
+				numFound++;
+				lua_pushinteger(l, numFound);
+				LuaBody::PushToLua(candidate);
+				lua_rawset(l, -3);
+			}
+			if (numFound == count || candidates.size() < numWanted)
+				break;
+			numWanted *= 2;
+		}
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
+/*
+ * Function: GetBodiesNear
+ *
+ * Get the <Body> objects within some distance of a body, closest first
+ *
+ * > bodies = Space.GetBodiesNear(body, distance, filter)
+ *
+ * Parameters:
+ *
+ *   body - the <Body> to search around. It is not included in the results
+ *
+ *   distance - the distance to search within, in metres
+ *
+ *   filter - an optional function, as for <GetBodies>
+ *
+ * Return:
+ *
+ *   bodies - an array containing zero or more <Body> objects, nearest first
+ *
+ * Example:
+ *
+ * > -- every body within 100km of the player
+ * > local nearby = Space.GetBodiesNear(Game.player, 100000)
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_space_get_bodies_near(lua_State *l)
+{
+	if (!Pi::game)
+		luaL_error(l, "Game is not started");
+
+	LUA_DEBUG_START(l);
+
+	Body *b = LuaBody::CheckFromLua(1);
+	const double dist = luaL_checknumber(l, 2);
+	bool filter = false;
+	if (lua_gettop(l) >= 3) {
+		luaL_checktype(l, 3, LUA_TFUNCTION); // any type of function
+		filter = true;
+	}
+
+	std::vector<Body*> bodies;
+	Pi::game->GetSpace()->FindBodiesNear(b, 0, dist, SpatialIndex::TypeFilter(Object::BODY), bodies);
+
+	lua_newtable(l);
+
+	for (std::vector<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		if (filter && !_filter_body(l, 3, *i))
+			continue;
+
+		lua_pushinteger(l, lua_rawlen(l, -1)+1);
+		LuaBody::PushToLua(*i);
+		lua_rawset(l, -3);
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
 void LuaSpace::Register()
 {
 	lua_State *l = Lua::manager->GetLuaState();
@@ -516,6 +669,9 @@ void LuaSpace::Register()
 
 		{ "GetBody",   l_space_get_body   },
 		{ "GetBodies", l_space_get_bodies },
+
+		{ "GetNearestBodies", l_space_get_nearest_bodies },
+		{ "GetBodiesNear",    l_space_get_bodies_near    },
 		{ 0, 0 }
 	};
 
@@ -7,6 +7,7 @@
 #include "LuaFaction.h"
 #include "LuaSpaceStation.h"
 #include "LuaStarSystem.h"
+#include "LuaSystemSummary.h"
 #include "LuaSystemPath.h"
 #include "LuaConstants.h"
 #include "LuaUtils.h"
@@ -191,7 +192,7 @@ static int l_starsystem_is_commodity_legal(lua_State *l)
 /*
  * Method: GetNearbySystems
  *
- * Get a list of nearby <StarSystems> that match some criteria
+ * Get a list of nearby systems that match some criteria
  *
  * > systems = system:GetNearbySystems(range, filter)
  *
@@ -200,7 +201,7 @@ static int l_starsystem_is_commodity_legal(lua_State *l)
  *   range - distance from this system to search, in light years
  *
  *   filter - an optional function. If specified the function will be called
- *            once for each candidate system with the <StarSystem> object
+ *            once for each candidate system with its <SystemSummary> object
  *            passed as the only parameter. If the filter function returns
  *            true then the system will be included in the array returned by
  *            <GetNearbySystems>, otherwise it will be omitted. If no filter
@@ -208,7 +209,9 @@ static int l_starsystem_is_commodity_legal(lua_State *l)
  *
  * Return:
  *
- *  systems - an array of systems in range that matched the filter
+ *  systems - an array of <SystemSummary> objects for the systems in range
+ *            that matched the filter. Use their <SystemSummary.system>
+ *            attribute to get the full <StarSystem>
  *
  * Availability:
  *
@@ -233,46 +236,26 @@ static int l_starsystem_get_nearby_systems(lua_State *l)
 
 	lua_newtable(l);
 
-	SystemPath here = s->GetPath();
-
-	int here_x = here.sectorX;
-	int here_y = here.sectorY;
-	int here_z = here.sectorZ;
-	Uint32 here_idx = here.systemIndex;
-	Sector here_sec(here_x, here_y, here_z);
-
-	int diff_sec = int(ceil(dist_ly/Sector::SIZE));
-
-	for (int x = here_x-diff_sec; x <= here_x+diff_sec; x++) {
-		for (int y = here_y-diff_sec; y <= here_y+diff_sec; y++) {
-			for (int z = here_z-diff_sec; z <= here_z+diff_sec; z++) {
-				Sector sec(x, y, z);
-
-				for (unsigned int idx = 0; idx < sec.m_systems.size(); idx++) {
-					if (x == here_x && y == here_y && z == here_z && idx == here_idx)
-						continue;
-
-					if (Sector::DistanceBetween(&here_sec, here_idx, &sec, idx) > dist_ly)
-						continue;
-
-					RefCountedPtr<StarSystem> sys = StarSystem::GetCached(SystemPath(x, y, z, idx));
-					if (filter) {
-						lua_pushvalue(l, 3);
-						LuaStarSystem::PushToLua(sys.Get());
-						lua_call(l, 1, 1);
-						if (!lua_toboolean(l, -1)) {
-							lua_pop(l, 1);
-							continue;
-						}
-						lua_pop(l, 1);
-					}
-
-					lua_pushinteger(l, lua_rawlen(l, -1)+1);
-					LuaStarSystem::PushToLua(sys.Get());
-					lua_rawset(l, -3);
-				}
+	// all of them first, so what the filter is likely to ask for can be
+	// worked out in the background while it goes through them
+	std::vector< RefCountedPtr<SystemSummary> > nearby;
+	SystemSummary::GetNearby(s->GetPath(), dist_ly, nearby);
+
+	for (std::vector< RefCountedPtr<SystemSummary> >::const_iterator i = nearby.begin(); i != nearby.end(); ++i) {
+		if (filter) {
+			lua_pushvalue(l, 3);
+			LuaSystemSummary::PushToLua(i->Get());
+			lua_call(l, 1, 1);
+			if (!lua_toboolean(l, -1)) {
+				lua_pop(l, 1);
+				continue;
 			}
+			lua_pop(l, 1);
 		}
+
+		lua_pushinteger(l, lua_rawlen(l, -1)+1);
+		LuaSystemSummary::PushToLua(i->Get());
+		lua_rawset(l, -3);
 	}
 
 	LUA_DEBUG_END(l, 1);
@@ -289,7 +272,8 @@ static int l_starsystem_get_nearby_systems(lua_State *l)
  *
  * Parameters:
  *
- *   system - a <SystemPath> or <StarSystem> to calculate the distance to
+ *   system - a <SystemPath>, <StarSystem> or <SystemSummary> to calculate
+ *            the distance to
  *
  * Return:
  *
@@ -312,14 +296,14 @@ static int l_starsystem_distance_to(lua_State *l)
 
 	const SystemPath *loc2 = LuaSystemPath::GetFromLua(2);
 	if (!loc2) {
-		StarSystem *s2 = LuaStarSystem::CheckFromLua(2);
-		loc2 = &(s2->GetPath());
+		SystemSummary *s2 = LuaSystemSummary::GetFromLua(2);
+		loc2 = s2 ? &(s2->GetPath()) : &(LuaStarSystem::CheckFromLua(2)->GetPath());
 	}
 
-	Sector sec1(loc1->sectorX, loc1->sectorY, loc1->sectorZ);
-	Sector sec2(loc2->sectorX, loc2->sectorY, loc2->sectorZ);
+	RefCountedPtr<Sector> sec1 = Sector::GetCached(*loc1);
+	RefCountedPtr<Sector> sec2 = Sector::GetCached(*loc2);
 
-	double dist = Sector::DistanceBetween(&sec1, loc1->systemIndex, &sec2, loc2->systemIndex);
+	double dist = Sector::DistanceBetween(sec1.Get(), loc1->systemIndex, sec2.Get(), loc2->systemIndex);
 
 	lua_pushnumber(l, dist);
 
@@ -73,8 +73,8 @@ static int l_sbodypath_new(lua_State *l)
 		path.systemIndex = luaL_checkinteger(l, 4);
 
 		// if this is a system path, then check that the system exists
-		Sector s(sector_x, sector_y, sector_z);
-		if (size_t(path.systemIndex) >= s.m_systems.size())
+		RefCountedPtr<Sector> s = Sector::GetCached(sector_x, sector_y, sector_z);
+		if (size_t(path.systemIndex) >= s->m_systems.size())
 			luaL_error(l, "System %d in sector <%d,%d,%d> does not exist", path.systemIndex, sector_x, sector_y, sector_z);
 
 		if (lua_gettop(l) > 4) {
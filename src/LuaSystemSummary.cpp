@@ -0,0 +1,378 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "LuaObject.h"
+#include "LuaSystemSummary.h"
+#include "LuaStarSystem.h"
+#include "LuaSystemPath.h"
+#include "LuaFaction.h"
+#include "LuaConstants.h"
+#include "LuaUtils.h"
+#include "galaxy/SystemSummary.h"
+#include "galaxy/Sector.h"
+#include "Factions.h"
+
+/*
+ * Class: SystemSummary
+ *
+ * A short description of a star system: its stars, population, politics and
+ * trade, without its bodies.
+ *
+ * <SystemSummary> objects are returned by <StarSystem.GetNearbySystems>. They
+ * are much cheaper to keep and look through than full <StarSystem> objects.
+ * The full system is generated only when <system> is used.
+ */
+
+/*
+ * Method: GetStationPaths
+ *
+ * Get the <SystemPaths> to stations in this system
+ *
+ * > paths = summary:GetStationPaths()
+ *
+ * Return:
+ *
+ *   paths - an array of <SystemPath> objects, one for each space station
+ *
+ * Which stations a system has depends on its bodies, so the first time this
+ * is called for a system its bodies are generated and thrown away again.
+ * <StarSystem.GetNearbySystems> starts on that for every system it finds in
+ * the background, before calling its filter. Calls after the first, from any
+ * summary of the same system, are cheap.
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_get_station_paths(lua_State *l)
+{
+	LUA_DEBUG_START(l);
+
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+
+	lua_newtable(l);
+
+	const std::vector<SystemPath> &paths = s->GetStationPaths();
+	for (std::vector<SystemPath>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+	{
+		lua_pushinteger(l, lua_rawlen(l, -1)+1);
+		SystemPath path(*i);
+		LuaSystemPath::PushToLua(&path);
+		lua_rawset(l, -3);
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
+/*
+ * Method: GetCommodityBasePriceAlterations
+ *
+ * Get the price alterations for cargo items bought and sold in this system.
+ * See <StarSystem.GetCommodityBasePriceAlterations>.
+ *
+ * > alterations = summary:GetCommodityBasePriceAlterations()
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_get_commodity_base_price_alterations(lua_State *l)
+{
+	LUA_DEBUG_START(l);
+
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+
+	lua_newtable(l);
+
+	for (int e = Equip::FIRST_COMMODITY; e <= Equip::LAST_COMMODITY; e++) {
+		lua_pushstring(l, LuaConstants::GetConstantString(l, "EquipType", e));
+		lua_pushnumber(l, s->GetCommodityBasePriceModPercent(e));
+		lua_rawset(l, -3);
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
+/*
+ * Method: IsCommodityLegal
+ *
+ * Determine if a given cargo item is legal for trade in this system. See
+ * <StarSystem.IsCommodityLegal>.
+ *
+ * > is_legal = summary:IsCommodityLegal(cargo)
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_is_commodity_legal(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	Equip::Type e = static_cast<Equip::Type>(LuaConstants::GetConstant(l, "EquipType", luaL_checkstring(l, 2)));
+	lua_pushboolean(l, s->IsCommodityLegal(e));
+	return 1;
+}
+
+/*
+ * Method: DistanceTo
+ *
+ * Calculate the distance between this and another system
+ *
+ * > dist = summary:DistanceTo(system)
+ *
+ * Parameters:
+ *
+ *   system - a <SystemPath>, <StarSystem> or <SystemSummary> to calculate
+ *            the distance to
+ *
+ * Return:
+ *
+ *   dist - the distance, in light years
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_distance_to(lua_State *l)
+{
+	LUA_DEBUG_START(l);
+
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	const SystemPath *loc1 = &(s->GetPath());
+
+	const SystemPath *loc2 = LuaSystemPath::GetFromLua(2);
+	if (!loc2) {
+		SystemSummary *s2 = LuaSystemSummary::GetFromLua(2);
+		loc2 = s2 ? &(s2->GetPath()) : &(LuaStarSystem::CheckFromLua(2)->GetPath());
+	}
+
+	RefCountedPtr<Sector> sec1 = Sector::GetCached(*loc1);
+	RefCountedPtr<Sector> sec2 = Sector::GetCached(*loc2);
+
+	double dist = Sector::DistanceBetween(sec1.Get(), loc1->systemIndex, sec2.Get(), loc2->systemIndex);
+
+	lua_pushnumber(l, dist);
+
+	LUA_DEBUG_END(l, 1);
+	return 1;
+}
+
+/*
+ * Attribute: name
+ *
+ * The name of the system
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_name(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	lua_pushstring(l, s->GetName().c_str());
+	return 1;
+}
+
+/*
+ * Attribute: path
+ *
+ * The <SystemPath> to the system
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_path(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	SystemPath path = s->GetPath();
+	LuaSystemPath::PushToLua(&path);
+	return 1;
+}
+
+/*
+ * Attribute: numStars
+ *
+ * The number of stars in the system
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_num_stars(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	lua_pushinteger(l, s->GetNumStars());
+	return 1;
+}
+
+/*
+ * Attribute: lawlessness
+ *
+ * The lawlessness value for the system
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_lawlessness(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	lua_pushnumber(l, s->GetSysPolit().lawlessness.ToDouble());
+	return 1;
+}
+
+/*
+ * Attribute: population
+ *
+ * The population of this system, in billions of people
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_population(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	lua_pushnumber(l, s->GetTotalPop().ToDouble());
+	return 1;
+}
+
+/*
+ * Attribute: faction
+ *
+ * The faction that controls this system
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_faction(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	if (s->GetFaction()->IsValid()) {
+		LuaFaction::PushToLua(s->GetFaction());
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+/*
+ * Attribute: explored
+ *
+ *   If this system has been explored then returns true
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_explored(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	lua_pushboolean(l, !s->GetUnexplored());
+	return 1;
+}
+
+/*
+ * Attribute: system
+ *
+ * The full <StarSystem>, with its bodies. The system is generated if it
+ * isn't already cached, which is slow.
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_systemsummary_attr_system(lua_State *l)
+{
+	SystemSummary *s = LuaSystemSummary::CheckFromLua(1);
+	RefCountedPtr<StarSystem> sys = s->GetStarSystem();
+	LuaStarSystem::PushToLua(sys.Get());
+	return 1;
+}
+
+template <> const char *LuaObject<SystemSummary>::s_type = "SystemSummary";
+
+template <> void LuaObject<SystemSummary>::RegisterClass()
+{
+	static const luaL_Reg l_methods[] = {
+		{ "GetStationPaths", l_systemsummary_get_station_paths },
+
+		{ "GetCommodityBasePriceAlterations", l_systemsummary_get_commodity_base_price_alterations },
+		{ "IsCommodityLegal",                 l_systemsummary_is_commodity_legal                   },
+
+		{ "DistanceTo", l_systemsummary_distance_to },
+
+		{ 0, 0 }
+	};
+
+	static const luaL_Reg l_attrs[] = {
+		{ "name",     l_systemsummary_attr_name      },
+		{ "path",     l_systemsummary_attr_path      },
+		{ "numStars", l_systemsummary_attr_num_stars },
+
+		{ "lawlessness", l_systemsummary_attr_lawlessness },
+		{ "population",  l_systemsummary_attr_population  },
+		{ "faction",     l_systemsummary_attr_faction     },
+		{ "explored",    l_systemsummary_attr_explored    },
+
+		{ "system", l_systemsummary_attr_system },
+
+		{ 0, 0 }
+	};
+
+	LuaObjectBase::CreateClass(s_type, NULL, l_methods, l_attrs, NULL);
+}
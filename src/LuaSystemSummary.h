@@ -0,0 +1,13 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _LUASYSTEMSUMMARY_H
+#define _LUASYSTEMSUMMARY_H
+
+#include "LuaObject.h"
+#include "galaxy/SystemSummary.h"
+
+template <> class LuaAcquirer<SystemSummary> : public LuaAcquirerRefCounted {};
+typedef LuaObject<SystemSummary> LuaSystemSummary;
+
+#endif
@@ -110,12 +110,12 @@ void Missile::Explode()
 	Sfx::Add(this, Sfx::TYPE_EXPLOSION);
 }
 
-void Missile::NotifyRemoved(const Body* const removedBody)
+void Missile::NotifyRemoved(const BodyBatch &removed)
 {
-	if (m_owner == removedBody) {
+	if (removed.Contains(m_owner)) {
 		m_owner = 0;
 	}
-	else if (m_target == removedBody) {
+	if (removed.Contains(m_target)) {
 		m_target = 0;
 	}
 }
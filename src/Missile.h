@@ -17,7 +17,7 @@ public:
 	void TimeStepUpdate(const float timeStep);
 	virtual bool OnCollision(Object *o, Uint32 flags, double relVel);
 	virtual bool OnDamage(Object *attacker, float kgDamage);
-	virtual void NotifyRemoved(const Body* const removedBody);
+	virtual void NotifyRemoved(const BodyBatch &removed);
 	virtual void PostLoadFixup(Space *space);
 	void ECMAttack(int power_val);
 	Body *GetOwner() const { return m_owner; }
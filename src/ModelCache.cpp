@@ -2,40 +2,297 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "ModelCache.h"
+#include "CRC32.h"
+#include "JobQueue.h"
+#include "OS.h"
 #include "scenegraph/SceneGraph.h"
 
-ModelCache::ModelCache(Graphics::Renderer *r)
+// how long Update() may spend building models and uploading textures each
+// frame. it always does at least one of each that's waiting
+static const double UPDATE_BUDGET_MSEC = 2.0;
+
+static ModelCache::Stats s_stats;
+
+// a model being loaded in the background. the job is owned by the main
+// thread, which deletes it once it's been collected
+class ModelLoadJob : public Job {
+public:
+	enum State {
+		QUEUED,
+		RUNNING,
+		DONE,
+		CANCELLED
+	};
+
+	ModelLoadJob(const std::string &name, Graphics::Renderer *r, SDL_mutex *lock, SDL_cond *done, std::vector<ModelLoadJob*> &finished) :
+		m_name(name), m_loader(r), m_ok(false), m_state(QUEUED),
+		m_lock(lock), m_done(done), m_finished(finished) {}
+	virtual void Run(int threadNum);
+
+	const std::string &GetName() const { return m_name; }
+	SceneGraph::Loader &GetLoader() { return m_loader; }
+	bool IsOk() const { return m_ok; }
+	// these need the cache's lock held
+	State GetState() const { return m_state; }
+	void Cancel() { assert(m_state == QUEUED); m_state = CANCELLED; }
+
+private:
+	std::string m_name;
+	SceneGraph::Loader m_loader;
+	bool m_ok;
+	State m_state;
+
+	SDL_mutex *m_lock;
+	SDL_cond *m_done;
+	std::vector<ModelLoadJob*> &m_finished;
+};
+
+void ModelLoadJob::Run(int threadNum)
+{
+	SDL_mutexP(m_lock);
+	if (m_state == CANCELLED) {
+		m_finished.push_back(this);
+		SDL_mutexV(m_lock);
+		return;
+	}
+	m_state = RUNNING;
+	SDL_mutexV(m_lock);
+
+	// PrepareModel doesn't touch the renderer, so nothing here is shared
+	// with the main thread
+	try {
+		m_loader.PrepareModel(m_name);
+		m_ok = true;
+	} catch (SceneGraph::LoadingError &) {
+		// it's loaded again when it's asked for, which reports the error
+	}
+
+	SDL_mutexP(m_lock);
+	m_state = DONE;
+	m_finished.push_back(this);
+	SDL_CondBroadcast(m_done);
+	SDL_mutexV(m_lock);
+}
+
+ModelCache::ModelCache(Graphics::Renderer *r, int numThreads)
 : m_renderer(r)
+, m_jobs(0)
+, m_lock(0)
+, m_jobDone(0)
 {
+	ClearStats();
+	if (numThreads <= 0) return;
 
+	// the CRC table is built the first time it's used. make sure that isn't
+	// on two workers at once
+	CRC32 crc;
+
+	m_lock = SDL_CreateMutex();
+	m_jobDone = SDL_CreateCond();
+	m_jobs = new JobQueue(std::min(numThreads, OS::GetNumCPUs()));
 }
 
 ModelCache::~ModelCache()
 {
+	if (m_jobs) {
+		CancelPreload();
+		m_jobs->Finish();
+		delete m_jobs;
+		m_jobs = 0;
+
+		for (std::vector<ModelLoadJob*>::iterator i = m_finishedJobs.begin(); i != m_finishedJobs.end(); ++i)
+			delete *i;
+		for (std::vector<ModelLoadJob*>::iterator i = m_readyJobs.begin(); i != m_readyJobs.end(); ++i)
+			delete *i;
+		m_finishedJobs.clear();
+		m_readyJobs.clear();
+		m_pendingJobs.clear();
+
+		SDL_DestroyCond(m_jobDone);
+		SDL_DestroyMutex(m_lock);
+	}
+
 	Flush();
 }
 
 SceneGraph::Model *ModelCache::FindModel(const std::string &name)
 {
 	ModelMap::iterator it = m_models.find(name);
+	if (it != m_models.end())
+		return it->second;
+
+	if (m_jobs) {
+		// if it's already being loaded, wait for it. if it hasn't been
+		// started yet it's quicker to do it here
+		bool waited = false;
+		SDL_mutexP(m_lock);
+		JobMap::iterator job = m_pendingJobs.find(name);
+		if (job != m_pendingJobs.end()) {
+			if (job->second->GetState() == ModelLoadJob::QUEUED) {
+				job->second->Cancel();
+				m_pendingJobs.erase(job);
+			} else {
+				while (job->second->GetState() == ModelLoadJob::RUNNING)
+					SDL_CondWait(m_jobDone, m_lock);
+				waited = true;
+			}
+		}
+		SDL_mutexV(m_lock);
+
+		if (waited) {
+			s_stats.waited++;
+			CollectJobs();
+		}
+
+		// finished, but Update() hasn't got to it yet
+		for (std::vector<ModelLoadJob*>::iterator i = m_readyJobs.begin(); i != m_readyJobs.end(); ++i) {
+			if ((*i)->GetName() == name) {
+				ModelLoadJob *ready = *i;
+				m_readyJobs.erase(i);
+				FinishJob(ready);
+				break;
+			}
+		}
+		it = m_models.find(name);
+		if (it != m_models.end())
+			return it->second;
+	}
+
+	try {
+		SceneGraph::Loader loader(m_renderer);
+		SceneGraph::Model *m = loader.LoadModel(name);
+		m_models[name] = m;
+		s_stats.loadedNow++;
+		return m;
+	} catch (SceneGraph::LoadingError &) {
+		throw ModelNotFoundException();
+	}
+}
+
+void ModelCache::CollectJobs()
+{
+	std::vector<ModelLoadJob*> finished;
+	SDL_mutexP(m_lock);
+	finished.swap(m_finishedJobs);
+	for (std::vector<ModelLoadJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		// cancelled jobs were taken off the list when they were cancelled
+		if ((*i)->GetState() == ModelLoadJob::DONE)
+			m_pendingJobs.erase((*i)->GetName());
+	}
+	SDL_mutexV(m_lock);
 
-	if (it == m_models.end()) {
+	for (std::vector<ModelLoadJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		if ((*i)->GetState() == ModelLoadJob::DONE)
+			m_readyJobs.push_back(*i);
+		else
+			delete *i;
+	}
+}
+
+void ModelCache::FinishJob(ModelLoadJob *job)
+{
+	if (job->IsOk() && m_models.find(job->GetName()) == m_models.end()) {
 		try {
-			SceneGraph::Loader loader(m_renderer);
-			SceneGraph::Model *m = loader.LoadModel(name);
-			m_models[name] = m;
-			return m;
+			std::vector<SceneGraph::PendingTexture> textures;
+			SceneGraph::Model *m = job->GetLoader().CreatePreparedModel(&textures);
+			m_models[job->GetName()] = m;
+			m_pendingTextures.insert(m_pendingTextures.end(), textures.begin(), textures.end());
+			s_stats.preloaded++;
 		} catch (SceneGraph::LoadingError &) {
-			throw ModelNotFoundException();
+			// as above, FindModel() will try again and report it
 		}
 	}
-	return it->second;
+	delete job;
+}
+
+void ModelCache::Preload(const std::vector<std::string> &names)
+{
+	if (!m_jobs) return;
+
+	CollectJobs();
+
+	// the workers take their newest job first, so queue the list backwards
+	std::vector<ModelLoadJob*> jobs;
+	SDL_mutexP(m_lock);
+	for (std::vector<std::string>::const_reverse_iterator i = names.rbegin(); i != names.rend(); ++i) {
+		if (m_models.find(*i) != m_models.end() || m_pendingJobs.find(*i) != m_pendingJobs.end())
+			continue;
+		bool ready = false;
+		for (std::vector<ModelLoadJob*>::const_iterator j = m_readyJobs.begin(); j != m_readyJobs.end(); ++j)
+			if ((*j)->GetName() == *i) ready = true;
+		if (ready) continue;
+		ModelLoadJob *job = new ModelLoadJob(*i, m_renderer, m_lock, m_jobDone, m_finishedJobs);
+		m_pendingJobs.insert(JobMap::value_type(*i, job));
+		jobs.push_back(job);
+	}
+	SDL_mutexV(m_lock);
+
+	for (std::vector<ModelLoadJob*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+		m_jobs->Queue(*i);
+}
+
+void ModelCache::Update()
+{
+	const Uint64 budget = Uint64(UPDATE_BUDGET_MSEC * 0.001 * double(OS::HFTimerFreq()));
+	const Uint64 start = OS::HFTimer();
+
+	if (m_jobs) {
+		CollectJobs();
+		// oldest first. the rest wait for the next frame
+		size_t numDone = 0;
+		while (numDone < m_readyJobs.size()) {
+			if (numDone > 0 && OS::HFTimer() - start > budget) break;
+			FinishJob(m_readyJobs[numDone++]);
+		}
+		m_readyJobs.erase(m_readyJobs.begin(), m_readyJobs.begin() + numDone);
+	}
+
+	bool first = true;
+	while (!m_pendingTextures.empty()) {
+		if (!first && OS::HFTimer() - start > budget) break;
+		first = false;
+		m_pendingTextures.front().Upload(m_renderer);
+		m_pendingTextures.pop_front();
+		s_stats.texturesUploaded++;
+	}
+	s_stats.texturesPending = m_pendingTextures.size();
+}
+
+void ModelCache::CancelPreload()
+{
+	SDL_mutexP(m_lock);
+	JobMap::iterator i = m_pendingJobs.begin();
+	while (i != m_pendingJobs.end()) {
+		if (i->second->GetState() == ModelLoadJob::QUEUED) {
+			i->second->Cancel();
+			m_pendingJobs.erase(i++);
+		}
+		else
+			i++;
+	}
+	SDL_mutexV(m_lock);
 }
 
 void ModelCache::Flush()
 {
+	// the models are going, so their materials don't need anything more
+	m_pendingTextures.clear();
+	s_stats.texturesPending = 0;
+
 	for(ModelMap::iterator it = m_models.begin(); it != m_models.end(); ++it) {
 		delete it->second;
 	}
 	m_models.clear();
 }
+
+ModelCache::Stats ModelCache::GetStats()
+{
+	return s_stats;
+}
+
+void ModelCache::ClearStats()
+{
+	const int pending = s_stats.texturesPending;
+	memset(&s_stats, 0, sizeof(s_stats));
+	s_stats.texturesPending = pending;
+}
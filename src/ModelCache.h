@@ -6,9 +6,16 @@
 /*
  * This class is a quick thoughtless hack
  * Also it only deals in New Models
+ *
+ * Models can be loaded in the background ahead of time with Preload(). The
+ * workers do everything up to talking to the renderer; Update() builds the
+ * finished models on the main thread and uploads their textures a few at a
+ * time, with a placeholder in each material until its texture is ready.
  */
 #include "libs.h"
+#include "scenegraph/Loader.h"
 #include <stdexcept>
+#include <deque>
 
 namespace Graphics {
 	class Renderer;
@@ -16,21 +23,61 @@ namespace Graphics {
 namespace SceneGraph {
 	class Model;
 }
+class JobQueue;
+class ModelLoadJob;
 
 class ModelCache {
 public:
 	struct ModelNotFoundException : public std::runtime_error {
 		ModelNotFoundException() : std::runtime_error("Could not find model") { }
 	};
-	ModelCache(Graphics::Renderer*);
+	// numThreads: background loaders, 0 for none (Preload() does nothing)
+	ModelCache(Graphics::Renderer*, int numThreads = 0);
 	~ModelCache();
+	// the model, loaded now if it isn't already. one that's being loaded
+	// in the background is waited for. main thread only
 	SceneGraph::Model *FindModel(const std::string&);
 	void Flush();
 
+	// start loading the named models in the background, skipping any that
+	// are loaded or on their way already
+	void Preload(const std::vector<std::string> &names);
+	// build models finished in the background and upload waiting textures,
+	// for as long as the time budget allows. call it every frame
+	void Update();
+
+	struct Stats {
+		int preloaded;        // built from the background
+		int waited;           // asked for while still loading in the background
+		int loadedNow;        // loaded on the main thread when asked for
+		int texturesUploaded;
+		int texturesPending;
+	};
+	static Stats GetStats();
+	// reset the counters (not the number pending)
+	static void ClearStats();
+
 private:
 	typedef std::map<std::string, SceneGraph::Model*> ModelMap;
+	typedef std::map<std::string, ModelLoadJob*> JobMap;
+
+	// moves finished jobs to m_readyJobs, and deletes cancelled ones
+	void CollectJobs();
+	// builds the model from a finished job and deletes the job
+	void FinishJob(ModelLoadJob *job);
+	void CancelPreload();
+
 	ModelMap m_models;
 	Graphics::Renderer *m_renderer;
+
+	JobQueue *m_jobs;
+	SDL_mutex *m_lock;                      // protects these and the job states
+	SDL_cond *m_jobDone;                    // signalled when a job finishes
+	JobMap m_pendingJobs;                   // queued or running, by name
+	std::vector<ModelLoadJob*> m_finishedJobs; // done or cancelled, waiting to be collected
+	std::vector<ModelLoadJob*> m_readyJobs;    // collected, waiting to be built. main thread only
+
+	std::deque<SceneGraph::PendingTexture> m_pendingTextures;
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include "FileSystem.h"
 #include "graphics/Graphics.h"
 #include "graphics/Light.h"
+#include "graphics/RendererNull.h"
 #include "graphics/TextureBuilder.h"
 #include "scenegraph/DumpVisitor.h"
 #include "scenegraph/FindNodeVisitor.h"
@@ -116,7 +117,7 @@ ModelViewer::~ModelViewer()
 	ClearModel();
 }
 
-void ModelViewer::Run(const std::string &modelName)
+void ModelViewer::Run(const std::string &modelName, int benchmarkFrames)
 {
 	ScopedPtr<GameConfig> config(new GameConfig);
 
@@ -142,6 +143,7 @@ void ModelViewer::Run(const std::string &modelName)
 	videoSettings.requestedSamples = config->Int("AntiAliasingMode");
 	videoSettings.vsync = (config->Int("VSync") != 0);
 	videoSettings.useTextureCompression = (config->Int("UseTextureCompression") != 0);
+	videoSettings.nullRenderer = (benchmarkFrames > 0);
 	renderer = Graphics::Init(videoSettings);
 
 	OS::LoadWindowIcon();
@@ -150,7 +152,10 @@ void ModelViewer::Run(const std::string &modelName)
 	//run main loop until quit
 	viewer = new ModelViewer(renderer, Lua::manager);
 	viewer->SetModel(modelName);
-	viewer->MainLoop();
+	if (benchmarkFrames > 0)
+		viewer->RunBenchmark(benchmarkFrames);
+	else
+		viewer->MainLoop();
 
 	//uninit components
 	Lua::Uninit();
@@ -493,6 +498,40 @@ void ModelViewer::MainLoop()
 	}
 }
 
+void ModelViewer::RunBenchmark(int numFrames)
+{
+	if (!m_model) {
+		fprintf(stderr, "modelviewer: couldn't load model %s\n", m_modelName.c_str());
+		return;
+	}
+	Graphics::RendererNull *nullRenderer = static_cast<Graphics::RendererNull*>(m_renderer);
+
+	Graphics::RendererNull::PrintStatsHeader(stdout);
+	Uint64 totalTime = 0;
+	for (int frame = 0; frame < numFrames; frame++) {
+		// once round the model, tipping up and down twice on the way
+		const float t = float(frame) / float(numFrames);
+		m_modelRot = matrix4x4f::RotateYMatrix(2.f * float(M_PI) * t) *
+			matrix4x4f::RotateXMatrix(0.5f * sin(4.f * float(M_PI) * t));
+
+		const Uint64 start = OS::HFTimer();
+		m_renderer->ClearScreen();
+		DrawBackground();
+		DrawModel();
+		m_ui->Update();
+		if (m_options.showUI)
+			m_ui->Draw();
+		m_renderer->SwapBuffers();
+		const Uint64 frameTime = OS::HFTimer() - start;
+		totalTime += frameTime;
+
+		Graphics::RendererNull::PrintStats(stdout, frame, nullRenderer->GetFrameStats(), 1000.0 * double(frameTime) / double(OS::HFTimerFreq()));
+	}
+
+	const double totalMs = 1000.0 * double(totalTime) / double(OS::HFTimerFreq());
+	printf("benchmark: %s, %d frames in %.1f ms, %.3f ms/frame\n", m_modelName.c_str(), numFrames, totalMs, totalMs / numFrames);
+}
+
 void ModelViewer::OnAnimChanged(unsigned int, const std::string &name)
 {
 	m_currentAnimation = 0;
@@ -19,7 +19,9 @@ public:
 	ModelViewer(Graphics::Renderer *r, LuaManager *l);
 	~ModelViewer();
 
-	static void Run(const std::string &modelName);
+	// with benchmarkFrames, draw that many frames of the model along a fixed
+	// camera path with the null renderer, print what each drew and quit
+	static void Run(const std::string &modelName, int benchmarkFrames = 0);
 
 private:
 	bool OnAnimPlay(UI::Widget*, bool reverse);
@@ -39,6 +41,7 @@ private:
 	void DrawLog();
 	void DrawModel();
 	void MainLoop();
+	void RunBenchmark(int numFrames);
 	void OnAnimChanged(unsigned int, const std::string&);
 	void OnAnimSliderChanged(float);
 	void OnDecalChanged(unsigned int, const std::string&);
@@ -29,6 +29,9 @@ namespace OS {
 	// should not be considered reliable
 	Uint64 HFTimerFreq();
 	Uint64 HFTimer();
+
+	// Number of processors available to run threads on. At least 1.
+	int GetNumCPUs();
 }
 
 #endif
@@ -14,6 +14,8 @@
 #include "Game.h"
 #include "GameMenuView.h"
 #include "GeoSphere.h"
+#include "GeoPatchCache.h"
+#include "collider/CollisionSpace.h"
 #include "Intro.h"
 #include "Lang.h"
 #include "LmrModel.h"
@@ -45,6 +47,7 @@
 #include "LuaSpaceStation.h"
 #include "LuaStar.h"
 #include "LuaStarSystem.h"
+#include "LuaSystemSummary.h"
 #include "LuaSystemBody.h"
 #include "LuaSystemPath.h"
 #include "LuaTimer.h"
@@ -76,12 +79,17 @@
 #include "WorldView.h"
 #include "galaxy/CustomSystem.h"
 #include "galaxy/Galaxy.h"
+#include "galaxy/Sector.h"
 #include "galaxy/StarSystem.h"
+#include "galaxy/SystemSummary.h"
 #include "gameui/Lua.h"
 #include "graphics/Graphics.h"
 #include "graphics/Light.h"
 #include "graphics/Renderer.h"
+#include "graphics/RendererNull.h"
+#include "graphics/RenderQueue.h"
 #include "gui/Gui.h"
+#include "scenegraph/Loader.h"
 #include "scenegraph/Model.h"
 #include "ui/Context.h"
 #include "ui/Lua.h"
@@ -134,6 +142,7 @@ bool Pi::joystickEnabled;
 bool Pi::mouseYInvert;
 std::vector<Pi::JoystickState> Pi::joysticks;
 bool Pi::navTunnelDisplayed;
+bool Pi::soundEnabled;
 Gui::Fixed *Pi::menu;
 const char * const Pi::combatRating[] = {
 	Lang::HARMLESS,
@@ -193,6 +202,7 @@ static void LuaInit()
 	LuaPlayer::RegisterClass();
 	LuaCargoBody::RegisterClass();
 	LuaStarSystem::RegisterClass();
+	LuaSystemSummary::RegisterClass();
 	LuaSystemPath::RegisterClass();
 	LuaSystemBody::RegisterClass();
 	LuaShipType::RegisterClass();
@@ -270,7 +280,23 @@ std::string Pi::GetSaveDir()
 	return FileSystem::JoinPath(FileSystem::GetUserDir(), Pi::SAVE_DIR_NAME);
 }
 
-void Pi::Init()
+// ships can turn up at any time, so get all their models loading in the
+// background now rather than when the first of each type appears
+static void PreloadShipModels()
+{
+	std::vector<std::string> names;
+	for (std::map<ShipType::Id, ShipType>::const_iterator it = ShipType::types.begin(); it != ShipType::types.end(); ++it) {
+		const std::string &name = it->second.lmrModelName;
+		try {
+			LmrLookupModelByName(name.c_str());
+		} catch (LmrModelNotFoundException) {
+			names.push_back(name);
+		}
+	}
+	Pi::modelCache->Preload(names);
+}
+
+void Pi::Init(bool benchmark, bool nullRenderer)
 {
 
 	OS::NotifyLoadBegin();
@@ -281,6 +307,10 @@ void Pi::Init()
 	Pi::config = new GameConfig();
 	KeyBindings::InitBindings();
 
+	// a benchmark turns sound off for this run only. it's kept out of the
+	// config, which is saved at the end of Init() and by the options menu
+	soundEnabled = !benchmark && !config->Int("DisableSound");
+
 	if (config->Int("RedirectStdio"))
 		OS::RedirectStdio();
 
@@ -333,6 +363,7 @@ void Pi::Init()
 	videoSettings.requestedSamples = config->Int("AntiAliasingMode");
 	videoSettings.vsync = (config->Int("VSync") != 0);
 	videoSettings.useTextureCompression = (config->Int("UseTextureCompression") != 0);
+	videoSettings.nullRenderer = nullRenderer;
 
 	Pi::renderer = Graphics::Init(videoSettings);
 	{
@@ -354,8 +385,10 @@ void Pi::Init()
 
 	Pi::rng.seed(time(0));
 
-	InitJoysticks();
-	joystickEnabled = (config->Int("EnableJoystick")) ? true : false;
+	// nobody is playing a benchmark
+	if (!benchmark)
+		InitJoysticks();
+	joystickEnabled = !benchmark && config->Int("EnableJoystick");
 	mouseYInvert = (config->Int("InvertMouseY")) ? true : false;
 
 	navTunnelDisplayed = (config->Int("DisplayNavTunnel")) ? true : false;
@@ -384,7 +417,10 @@ void Pi::Init()
 	draw_progress(0.4f);
 
 	LmrModelCompilerInit(Pi::renderer);
-	modelCache = new ModelCache(Pi::renderer);
+	// benchmarks load models on the main thread only, so background loads
+	// don't compete with what's being timed (or, in -modelbenchmark, write
+	// the same cache files as it)
+	modelCache = new ModelCache(Pi::renderer, benchmark ? 0 : config->Int("ModelThreads"));
 	draw_progress(0.5f);
 
 //unsigned int control_word;
@@ -393,6 +429,7 @@ void Pi::Init()
 //double fpexcept = Pi::timeAccelRates[1] / Pi::timeAccelRates[0];
 
 	ShipType::Init();
+	if (!benchmark) PreloadShipModels();
 	draw_progress(0.6f);
 
 	GeoSphere::Init();
@@ -402,12 +439,13 @@ void Pi::Init()
 	draw_progress(0.8f);
 
 	SpaceStation::Init();
+	Space::Init();
 	draw_progress(0.9f);
 
 	Sfx::Init(Pi::renderer);
 	draw_progress(0.95f);
 
-	if (!config->Int("DisableSound")) {
+	if (soundEnabled) {
 		Sound::Init();
 		Sound::SetMasterVolume(config->Float("MasterVolume"));
 		Sound::SetSfxVolume(config->Float("SfxVolume"));
@@ -562,13 +600,15 @@ void Pi::ToggleLuaConsole()
 	}
 }
 
-void Pi::Quit()
+void Pi::Quit(int status)
 {
+	Game::StopBackgroundSaves();
 	Projectile::FreeModel();
 	delete Pi::gameMenuView;
 	delete Pi::luaConsole;
 	Sfx::Uninit();
 	Sound::Uninit();
+	Space::Uninit();
 	SpaceStation::Uninit();
 	CityOnPlanet::Uninit();
 	GeoSphere::Uninit();
@@ -580,10 +620,9 @@ void Pi::Quit()
 	Gui::Uninit();
 	delete Pi::modelCache;
 	delete Pi::renderer;
-	StarSystem::ShrinkCache();
 	SDL_Quit();
 	FileSystem::Uninit();
-	exit(0);
+	exit(status);
 }
 
 void Pi::BoinkNoise()
@@ -742,8 +781,8 @@ void Pi::HandleEvents()
 									const std::string name = "_quicksave";
 									const std::string path = FileSystem::JoinPath(GetSaveDir(), name);
 									try {
-										Game::SaveGame(name, Pi::game);
-										Pi::cpan->MsgLog()->Message("", Lang::GAME_SAVED_TO + path);
+										// reported once it's been written
+										Game::SaveGameInBackground(name, Pi::game);
 									} catch (CouldNotOpenFileException) {
 										Pi::cpan->MsgLog()->Message("", stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", path)));
 									}
@@ -845,7 +884,7 @@ void Pi::InitGame()
 		std::fill(stick->axes.begin(), stick->axes.end(), 0.f);
 	}
 
-	if (!config->Int("DisableSound")) AmbientSounds::Init();
+	if (soundEnabled) AmbientSounds::Init();
 
 	LuaInitGame();
 }
@@ -916,6 +955,7 @@ void Pi::Start()
 		ui->Draw();
 
 		Pi::renderer->SwapBuffers();
+		Pi::modelCache->Update();
 
 		Pi::frameTime = 0.001f*(SDL_GetTicks() - last_time);
 		_time += Pi::frameTime;
@@ -941,7 +981,7 @@ void Pi::EndGame()
 
 	Lua::manager->CollectGarbage();
 
-	if (!config->Int("DisableSound")) AmbientSounds::Uninit();
+	if (soundEnabled) AmbientSounds::Uninit();
 	Sound::DestroyAllEvents();
 
 
@@ -951,7 +991,92 @@ void Pi::EndGame()
 	game = 0;
 	player = 0;
 
+	StarSystem::CancelPrefetch();
 	StarSystem::ShrinkCache();
+	SystemSummary::ShrinkCache();
+}
+
+// keep the systems the player is likely to want next generated in the
+// background: those in jump range now, and those in jump range of the
+// hyperspace target
+static void PrefetchNearbySystems()
+{
+	static SystemPath lastHere, lastTarget;
+	static float lastRange = -1.0f;
+
+	const SystemPath here = Pi::game->IsHyperspace() ?
+		Pi::player->GetHyperspaceDest() : Pi::game->GetSpace()->GetStarSystem()->GetPath();
+	const SystemPath target = Pi::sectorView->GetHyperspaceTarget();
+	const float range = Pi::player->GetStats().hyperspace_range;
+
+	if (here.IsSameSystem(lastHere) && target.IsSameSystem(lastTarget) && range == lastRange) {
+		StarSystem::UpdatePrefetch();
+		return;
+	}
+	lastHere = here;
+	lastTarget = target;
+	lastRange = range;
+
+	StarSystem::CancelPrefetch();
+	if (!target.IsSameSystem(here))
+		StarSystem::PrefetchNear(target, range, 128);
+	// queued last so it's started first
+	StarSystem::PrefetchNear(here, range, 256);
+}
+
+static void Autosave()
+{
+	const std::string name = "_autosave";
+	try {
+		Game::SaveGameInBackground(name, Pi::game);
+	} catch (CouldNotOpenFileException) {
+		const std::string path = FileSystem::JoinPath(Pi::GetSaveDir(), name);
+		Pi::cpan->MsgLog()->Message("", stringf(Lang::COULD_NOT_OPEN_FILENAME, formatarg("path", path)));
+	}
+}
+
+int Pi::StepPhysics(double &accumulator, int maxTicks)
+{
+	const float step = Pi::game->GetTimeStep();
+	if (step <= 0.0f) return 0; // paused
+
+	int phys_ticks = 0;
+	while (accumulator >= step) {
+		if (++phys_ticks >= maxTicks) {
+			accumulator = 0.0;
+			break;
+		}
+		game->TimeStep(step);
+
+		accumulator -= step;
+	}
+	// rendering interpolation between frames: don't use when docked
+	int pstate = Pi::game->GetPlayer()->GetFlightState();
+	if (pstate == Ship::DOCKED || pstate == Ship::DOCKING) Pi::gameTickAlpha = 1.0;
+	else Pi::gameTickAlpha = accumulator / step;
+
+	return phys_ticks;
+}
+
+bool Pi::CheckPlayerDeath(double &timePlayerDied)
+{
+	// fuckadoodledoo, did the player die?
+	if (!Pi::player->IsDead()) return false;
+
+	if (timePlayerDied > 0.0) {
+		if (Pi::game->GetTime() - timePlayerDied > 8.0) {
+			Pi::SetView(0);
+			Pi::TombStoneLoop();
+			Pi::EndGame();
+			return true;
+		}
+	} else {
+		Pi::game->SetTimeAccel(Game::TIMEACCEL_1X);
+		Pi::deathView->Init();
+		Pi::SetView(Pi::deathView);
+		timePlayerDied = Pi::game->GetTime();
+	}
+	return false;
 }
 
 void Pi::MainLoop()
@@ -966,7 +1091,10 @@ void Pi::MainLoop()
 	Uint32 last_stats = SDL_GetTicks();
 	int frame_stat = 0;
 	int phys_stat = 0;
-	char fps_readout[256];
+	Uint64 sim_time_stat = 0;
+	Uint64 render_time_stat = 0;
+	Uint64 swap_time_stat = 0;
+	char fps_readout[2048];
 	memset(fps_readout, 0, sizeof(fps_readout));
 #endif
 
@@ -974,10 +1102,21 @@ void Pi::MainLoop()
 	if (MAX_PHYSICS_TICKS <= 0)
 		MAX_PHYSICS_TICKS = 4;
 
+	const Uint32 autosave_interval = Uint32(std::max(Pi::config->Int("AutosaveInterval"), 0)) * 60 * 1000;
+	Uint32 last_autosave = SDL_GetTicks();
+
 	double currentTime = 0.001 * double(SDL_GetTicks());
 	double accumulator = Pi::game->GetTimeStep();
 	Pi::gameTickAlpha = 0;
 
+	// with pipelining the physics for the next frame runs after this
+	// frame's drawing has been handed to the GPU, and before waiting for it
+	// in SwapBuffers(), so the GPU's work overlaps the physics instead of
+	// following it. everything still runs on this thread, so it only helps
+	// when the GPU is the slower of the two, and what's shown is a frame
+	// behind the input. off unless asked for
+	const bool pipelined = Pi::config->Int("PipelinedFrames");
+
 	while (Pi::game) {
 		double newTime = 0.001 * double(SDL_GetTicks());
 		Pi::frameTime = newTime - currentTime;
@@ -985,47 +1124,17 @@ void Pi::MainLoop()
 		currentTime = newTime;
 		accumulator += Pi::frameTime * Pi::game->GetTimeAccelRate();
 
-		const float step = Pi::game->GetTimeStep();
-		if (step > 0.0f) {
-			int phys_ticks = 0;
-			while (accumulator >= step) {
-				if (++phys_ticks >= MAX_PHYSICS_TICKS) {
-					accumulator = 0.0;
-					break;
-				}
-				game->TimeStep(step);
-
-				accumulator -= step;
-			}
-			// rendering interpolation between frames: don't use when docked
-			int pstate = Pi::game->GetPlayer()->GetFlightState();
-			if (pstate == Ship::DOCKED || pstate == Ship::DOCKING) Pi::gameTickAlpha = 1.0;
-			else Pi::gameTickAlpha = accumulator / step;
-			
-#if WITH_DEVKEYS
-			phys_stat += phys_ticks;
-#endif
-		} else {
-			// paused
+		int phys_ticks = 0;
+		Uint64 simTime = 0;
+		if (!pipelined) {
+			const Uint64 simStart = OS::HFTimer();
+			phys_ticks = StepPhysics(accumulator, MAX_PHYSICS_TICKS);
+			simTime = OS::HFTimer() - simStart;
+			if (CheckPlayerDeath(time_player_died)) break;
 		}
 		frame_stat++;
 
-		// fuckadoodledoo, did the player die?
-		if (Pi::player->IsDead()) {
-			if (time_player_died > 0.0) {
-				if (Pi::game->GetTime() - time_player_died > 8.0) {
-					Pi::SetView(0);
-					Pi::TombStoneLoop();
-					Pi::EndGame();
-					break;
-				}
-			} else {
-				Pi::game->SetTimeAccel(Game::TIMEACCEL_1X);
-				Pi::deathView->Init();
-				Pi::SetView(Pi::deathView);
-				time_player_died = Pi::game->GetTime();
-			}
-		}
+		const Uint64 renderStart = OS::HFTimer();
 
 		Pi::renderer->BeginFrame();
 		Pi::renderer->SetTransform(matrix4x4f::Identity());
@@ -1060,22 +1169,53 @@ void Pi::MainLoop()
 		}
 #endif
 
+		const Uint64 renderTime = OS::HFTimer() - renderStart;
+
+		// the game can be ended from the menus while handling events, and
+		// there's nothing left to step
+		if (pipelined && Pi::game) {
+			Pi::renderer->FlushCommands();
+			const Uint64 simStart = OS::HFTimer();
+			phys_ticks = StepPhysics(accumulator, MAX_PHYSICS_TICKS);
+			simTime = OS::HFTimer() - simStart;
+		}
+
+		const Uint64 swapStart = OS::HFTimer();
 		Pi::renderer->SwapBuffers();
+		const Uint64 swapTime = OS::HFTimer() - swapStart;
+
+#if WITH_DEVKEYS
+		phys_stat += phys_ticks;
+		sim_time_stat += simTime;
+		render_time_stat += renderTime;
+		swap_time_stat += swapTime;
+#else
+		(void)phys_ticks; (void)simTime; (void)renderTime; (void)swapTime;
+#endif
 
 		// game exit or failed load from GameMenuView will have cleared
 		// Pi::game. we can't continue.
 		if (!Pi::game)
 			return;
 
+		if (pipelined && CheckPlayerDeath(time_player_died)) break;
+
 		if (Pi::game->UpdateTimeAccel())
 			accumulator = 0; // fix for huge pauses 10000x -> 1x
 
 		if (!Pi::player->IsDead()) {
 			// XXX should this really be limited to while the player is alive?
 			// this is something we need not do every turn...
-			if (!config->Int("DisableSound")) AmbientSounds::Update();
-			StarSystem::ShrinkCache();
+			if (soundEnabled) AmbientSounds::Update();
+			PrefetchNearbySystems();
+
+			if (autosave_interval && SDL_GetTicks() - last_autosave > autosave_interval && !Pi::game->IsHyperspace()) {
+				Autosave();
+				last_autosave = SDL_GetTicks();
+			}
 		}
+		Game::UpdateBackgroundSaves();
+		modelCache->Update();
 		cpan->Update();
 		musicPlayer.Update();
 
@@ -1088,18 +1228,60 @@ void Pi::MainLoop()
 
 			Pi::statSceneTris += LmrModelGetStatsTris();
 
+			const CollisionSpace::TreeStats &treeStats = CollisionSpace::GetTreeStats();
+			const double treeUpdateUsec = phys_stat ? 1e6 * double(treeStats.updateTime) / double(OS::HFTimerFreq()) / phys_stat : 0.0;
+			const GeoPatchCache::Stats cacheStats = GeoPatchCache::GetStats();
+			const Sector::CacheStats sectorStats = Sector::GetCacheStats();
+			const StarSystem::CacheStats systemStats = StarSystem::GetCacheStats();
+			const Game::SaveStats saveStats = Game::GetLastSaveStats();
+			const ModelCache::Stats modelStats = ModelCache::GetStats();
+			const Graphics::RenderQueue::Stats queueStats = Graphics::RenderQueue::GetStats();
+			const double msPerFrame = frame_stat ? 1000.0 / double(OS::HFTimerFreq()) / frame_stat : 0.0;
+
 			snprintf(
 				fps_readout, sizeof(fps_readout),
 				"%d fps (%.1f ms/f), %d phys updates, %d triangles, %.3f M tris/sec, %d terrain vtx/sec, %d glyphs/sec\n"
-				"Lua mem usage: %d MB + %d KB + %d bytes",
+				"Lua mem usage: %d MB + %d KB + %d bytes\n"
+				"Collision trees: %.1f us/update, %d rebuilds, %d re-splits\n"
+				"Terrain cache: %d hits, %d misses, %d evictions, %.1f MB\n"
+				"Sector cache: %d hits, %d misses, %d evictions, %d sectors\n"
+				"System cache: %d hits, %d misses, %d pre-generated, %d evictions, %d systems, %.1f MB\n"
+				"Last background save: %.1f ms snapshot, %.1f ms write, %.1f MB\n"
+				"Main thread per frame (%s): %.1f ms physics, %.1f ms drawing, %.1f ms in swap\n"
+				"Models: %d preloaded, %d waited for, %d loaded on demand, %d textures uploaded, %d pending\n"
+				"LMR dynamic geometry: %.1f built/frame, %.1f reused/frame\n"
+				"Render queue: %.1f flushes/frame, %.1f items/frame, %.1f material binds/frame, %.1f mesh binds/frame",
 				frame_stat, (1000.0/frame_stat), phys_stat, Pi::statSceneTris, Pi::statSceneTris*frame_stat*1e-6,
 				GeoSphere::GetVtxGenCount(), Text::TextureFont::GetGlyphCount(),
-				lua_memMB, lua_memKB, lua_memB
+				lua_memMB, lua_memKB, lua_memB,
+				treeUpdateUsec, treeStats.rebuilds, treeStats.resplits,
+				cacheStats.hits, cacheStats.misses, cacheStats.evictions, double(cacheStats.totalBytes) / (1024.0*1024.0),
+				sectorStats.hits, sectorStats.misses, sectorStats.evictions, sectorStats.size,
+				systemStats.hits, systemStats.misses, systemStats.prefetched, systemStats.evictions, systemStats.size,
+				double(systemStats.totalBytes) / (1024.0*1024.0),
+				saveStats.snapshotMsec, saveStats.writeMsec, double(saveStats.bytes) / (1024.0*1024.0),
+				pipelined ? "GPU overlaps physics" : "serial", msPerFrame * double(sim_time_stat),
+				msPerFrame * double(render_time_stat), msPerFrame * double(swap_time_stat),
+				modelStats.preloaded, modelStats.waited, modelStats.loadedNow, modelStats.texturesUploaded, modelStats.texturesPending,
+				frame_stat ? double(LmrModelGetStatsDynamicBuilds()) / frame_stat : 0.0,
+				frame_stat ? double(LmrModelGetStatsDynamicReuses()) / frame_stat : 0.0,
+				frame_stat ? double(queueStats.flushes) / frame_stat : 0.0,
+				frame_stat ? double(queueStats.solids + queueStats.transparents) / frame_stat : 0.0,
+				frame_stat ? double(queueStats.materialBinds) / frame_stat : 0.0,
+				frame_stat ? double(queueStats.meshBinds) / frame_stat : 0.0
 			);
 			frame_stat = 0;
 			phys_stat = 0;
+			sim_time_stat = render_time_stat = swap_time_stat = 0;
 			Text::TextureFont::ClearGlyphCount();
 			GeoSphere::ClearVtxGenCount();
+			CollisionSpace::ClearTreeStats();
+			GeoPatchCache::ClearStats();
+			Sector::ClearCacheStats();
+			StarSystem::ClearCacheStats();
+			ModelCache::ClearStats();
+			LmrModelClearStatsDynamic();
+			Graphics::RenderQueue::ClearStats();
 			if (SDL_GetTicks() - last_stats > 1200) last_stats = SDL_GetTicks();
 			else last_stats += 1000;
 		}
@@ -1117,6 +1299,338 @@ void Pi::MainLoop()
 	}
 }
 
+static void PrintBenchmarkPhase(const char *name, Uint64 ticks, Uint64 total, int numTicks)
+{
+	const double ms = 1000.0 * double(ticks) / double(OS::HFTimerFreq());
+	printf("  %-16s %10.1f ms %8.1f us/tick %6.1f%%\n", name, ms, 1000.0 * ms / numTicks, total ? 100.0 * double(ticks) / double(total) : 0.0);
+}
+
+// sets up the game for a benchmark. false if the save couldn't be loaded
+static bool StartBenchmarkGame(const std::string &saveName)
+{
+	// same universe and same choices every run, so runs can be compared
+	Pi::rng.seed(0);
+
+	Pi::InitGame();
+
+	try {
+		if (saveName.empty())
+			Pi::game = new Game(SystemPath(0,0,0,0,9)); // docked at Earth
+		else
+			Pi::game = Game::LoadGame(saveName);
+	}
+	catch (SavedGameCorruptException) {
+		fprintf(stderr, "benchmark: %s\n", Lang::GAME_LOAD_CORRUPT);
+		return false;
+	}
+	catch (CouldNotOpenFileException) {
+		fprintf(stderr, "benchmark: %s\n", Lang::GAME_LOAD_CANNOT_OPEN);
+		return false;
+	}
+
+	Pi::StartGame();
+	return true;
+}
+
+// runs numTicks steps of the game, or until the player dies. false if the
+// save couldn't be loaded
+static bool RunBenchmarkTicks(const std::string &saveName, int numTicks, Game::TimeAccel timeAccel, int &ticks, Uint64 &totalTime)
+{
+	if (!StartBenchmarkGame(saveName)) return false;
+
+	// saves load paused. the step must not change during the run
+	Pi::game->SetTimeAccel(timeAccel);
+	const float step = Pi::game->GetTimeStep();
+
+	Space::ClearTimeStepStats();
+	const Uint64 startTime = OS::HFTimer();
+
+	ticks = 0;
+	while (ticks < numTicks) {
+		Pi::game->TimeStep(step);
+		ticks++;
+		if (Pi::player->IsDead()) break;
+	}
+
+	totalTime = OS::HFTimer() - startTime;
+	return true;
+}
+
+void Pi::RunBenchmark(const std::string &saveName, int numTicks, Game::TimeAccel timeAccel)
+{
+	int ticks;
+	Uint64 totalTime;
+	if (!RunBenchmarkTicks(saveName, numTicks, timeAccel, ticks, totalTime)) return;
+
+	const float step = game->GetTimeStep();
+	const double totalMs = 1000.0 * double(totalTime) / double(OS::HFTimerFreq());
+
+	int numBodies = 0;
+	for (Space::BodyIterator i = game->GetSpace()->BodiesBegin(); i != game->GetSpace()->BodiesEnd(); ++i)
+		numBodies++;
+
+	const Space::TimeStepStats &stats = Space::GetTimeStepStats();
+	const Uint64 spaceTime = stats.collision + stats.updateFrame + stats.staticUpdate + stats.orbitRails +
+		stats.timeStepUpdate + stats.externalForces + stats.luaEvents + stats.updateBodies;
+
+	printf("benchmark: %d ticks of %.1f ms in %.1f ms, %.1f ticks/sec, %d bodies at end\n",
+		ticks, 1000.0 * step, totalMs, totalMs > 0.0 ? 1000.0 * ticks / totalMs : 0.0, numBodies);
+	if (ticks > 0) {
+		PrintBenchmarkPhase("collision",      stats.collision,      totalTime, ticks);
+		PrintBenchmarkPhase("UpdateFrame",    stats.updateFrame,    totalTime, ticks);
+		PrintBenchmarkPhase("StaticUpdate",   stats.staticUpdate,   totalTime, ticks);
+		PrintBenchmarkPhase("orbit rails",    stats.orbitRails,     totalTime, ticks);
+		PrintBenchmarkPhase("TimeStepUpdate", stats.timeStepUpdate, totalTime, ticks);
+		PrintBenchmarkPhase("ext. forces",    stats.externalForces, totalTime, ticks);
+		PrintBenchmarkPhase("Lua events",     stats.luaEvents,      totalTime, ticks);
+		PrintBenchmarkPhase("body removal",   stats.updateBodies,   totalTime, ticks);
+		PrintBenchmarkPhase("outside Space",  totalTime > spaceTime ? totalTime - spaceTime : 0, totalTime, ticks);
+		if (stats.shipSteps > 0)
+			printf("benchmark: %.1f ships a tick, %.1f%% of them on rails\n",
+				double(stats.shipSteps) / ticks, 100.0 * stats.railsShipSteps / stats.shipSteps);
+	}
+	if (ticks < numTicks)
+		printf("benchmark: stopped early, the player died\n");
+
+	EndGame();
+
+	// ships only go on rails with time accelerated. the same run with them
+	// all simulated shows what the rails saved
+	const double railsDistance = Space::GetRailsDistance();
+	if (timeAccel <= Game::TIMEACCEL_1X || railsDistance <= 0.0) return;
+
+	Space::SetRailsDistance(0.0);
+	int noRailsTicks;
+	Uint64 noRailsTime;
+	const bool ran = RunBenchmarkTicks(saveName, numTicks, timeAccel, noRailsTicks, noRailsTime);
+	Space::SetRailsDistance(railsDistance);
+	if (!ran) return;
+
+	const Space::TimeStepStats &noRailsStats = Space::GetTimeStepStats();
+	const double noRailsMs = 1000.0 * double(noRailsTime) / double(OS::HFTimerFreq());
+	printf("benchmark: without rails, %d ticks in %.1f ms, %.1f ticks/sec\n",
+		noRailsTicks, noRailsMs, noRailsMs > 0.0 ? 1000.0 * noRailsTicks / noRailsMs : 0.0);
+	if (noRailsTicks > 0) {
+		PrintBenchmarkPhase("StaticUpdate",   noRailsStats.staticUpdate,   noRailsTime, noRailsTicks);
+		PrintBenchmarkPhase("TimeStepUpdate", noRailsStats.timeStepUpdate, noRailsTime, noRailsTicks);
+	}
+	if (noRailsTicks == ticks && totalMs > 0.0)
+		printf("benchmark: rails made it %.2fx faster\n", noRailsMs / totalMs);
+
+	EndGame();
+}
+
+// returns the time taken in ms. if treeMs is given, the collision mesh and
+// its GeomTree are built again for each model, untimed by the rest, and the
+// time that took goes in it. models build them again for every body made
+// from them, so that's what the cache doesn't save
+static double LoadAllModels(const std::vector<std::string> &names, bool rebuildCache, bool writeCache, int &numFailed, double *treeMs = 0)
+{
+	numFailed = 0;
+	Uint64 loadTime = 0, treeTime = 0;
+	for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+		try {
+			SceneGraph::Loader loader(Pi::renderer, rebuildCache, writeCache);
+			const Uint64 loadStart = OS::HFTimer();
+			SceneGraph::Model *model = loader.LoadModel(*it);
+			loadTime += OS::HFTimer() - loadStart;
+			if (treeMs) {
+				const Uint64 treeStart = OS::HFTimer();
+				model->CreateCollisionMesh(0);
+				treeTime += OS::HFTimer() - treeStart;
+			}
+			delete model;
+		} catch (SceneGraph::LoadingError &) {
+			numFailed++;
+		}
+	}
+	if (treeMs) *treeMs = 1000.0 * double(treeTime) / double(OS::HFTimerFreq());
+	return 1000.0 * double(loadTime) / double(OS::HFTimerFreq());
+}
+
+void Pi::RunModelBenchmark()
+{
+	std::vector<std::string> names;
+	for (FileSystem::FileEnumerator files(FileSystem::gameDataFiles, "models", FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next()) {
+		const FileSystem::FileInfo &info = files.Current();
+		if (info.IsFile() && ends_with(info.GetName(), ".model"))
+			names.push_back(info.GetName().substr(0, info.GetName().size() - 6));
+	}
+	if (names.empty()) {
+		fprintf(stderr, "benchmark: no models found\n");
+		return;
+	}
+
+	// the first pass fills the cache and loads the textures, so the timed
+	// passes only differ in where the meshes come from. the import pass
+	// doesn't write the cache, so that isn't in its time
+	int numFailed;
+	LoadAllModels(names, true, true, numFailed);
+	const double importMs = LoadAllModels(names, true, false, numFailed);
+	double treeMs;
+	const double cacheMs = LoadAllModels(names, false, false, numFailed, &treeMs);
+
+	printf("benchmark: %d models, %d failed to load\n", int(names.size()), numFailed);
+	printf("  %-16s %10.1f ms %8.1f ms/model\n", "imported", importMs, importMs / names.size());
+	printf("  %-16s %10.1f ms %8.1f ms/model\n", "from cache", cacheMs, cacheMs / names.size());
+	printf("  %-16s %10.1f ms %8.1f ms/model\n", "collision trees", treeMs, treeMs / names.size());
+	if (cacheMs > 0.0) {
+		printf("benchmark: cache is %.1fx faster\n", importMs / cacheMs);
+		printf("benchmark: building collision trees is %.1f%% of loading from the cache\n", 100.0 * treeMs / cacheMs);
+	}
+}
+
+void Pi::RunTerrainCacheBenchmark()
+{
+	// the cache is off unless the config says otherwise, so give it room
+	// for the run and clear up afterwards
+	const bool wasEnabled = GeoPatchCache::IsEnabled();
+	if (!wasEnabled)
+		GeoPatchCache::Init(Uint64(256) * 1024 * 1024);
+	if (!GeoPatchCache::IsEnabled()) {
+		fprintf(stderr, "benchmark: couldn't open the terrain cache\n");
+		return;
+	}
+
+	RefCountedPtr<StarSystem> sys = StarSystem::GetCached(SystemPath(0,0,0,0));
+	int numPatches = 0, numLoaded = 0, numDifferent = 0;
+	double generateMs = 0.0, loadMs = 0.0;
+	for (std::vector<SystemBody*>::const_iterator i = sys->m_bodies.begin(); i != sys->m_bodies.end(); ++i) {
+		if ((*i)->type == SystemBody::TYPE_GRAVPOINT) continue;
+		const GeoSphere::CacheBenchmark result = GeoSphere::BenchmarkCache(*i, 8);
+		printf("  %-16s %10.1f ms generated %8.1f ms from cache\n", (*i)->name.c_str(), result.generateMs, result.loadMs);
+		numPatches += result.patches;
+		numLoaded += result.loaded;
+		numDifferent += result.different;
+		generateMs += result.generateMs;
+		loadMs += result.loadMs;
+	}
+
+	printf("benchmark: %d patches, %d found in the cache, %d different from what was generated\n", numPatches, numLoaded, numDifferent);
+	if (numPatches) {
+		printf("  %-16s %10.1f ms %8.2f ms/patch\n", "generated", generateMs, generateMs / numPatches);
+		printf("  %-16s %10.1f ms %8.2f ms/patch\n", "from cache", loadMs, loadMs / numPatches);
+	}
+	if (loadMs > 0.0)
+		printf("benchmark: cache is %.1fx faster\n", generateMs / loadMs);
+
+	if (!wasEnabled) {
+		GeoPatchCache::Uninit();
+		GeoPatchCache::Init(0);
+	}
+}
+
+int Pi::RunSystemSummaryTest()
+{
+	const SystemPath sol(0,0,0,0);
+	const double range = 20.0;
+
+	StarSystem::ShrinkCache();
+	SystemSummary::ShrinkCache();
+	StarSystem::ClearCacheStats();
+	const int cachedBefore = StarSystem::GetCacheStats().size;
+
+	// the same as a mission looking for somewhere with stations
+	const Uint64 start = OS::HFTimer();
+	std::vector< RefCountedPtr<SystemSummary> > nearby;
+	SystemSummary::GetNearby(sol, range, nearby);
+	int numWithStations = 0;
+	for (std::vector< RefCountedPtr<SystemSummary> >::const_iterator i = nearby.begin(); i != nearby.end(); ++i)
+		if (!(*i)->GetStationPaths().empty())
+			numWithStations++;
+	const double scanMs = 1000.0 * double(OS::HFTimer() - start) / double(OS::HFTimerFreq());
+
+	int failures = 0;
+	const StarSystem::CacheStats stats = StarSystem::GetCacheStats();
+	printf("summary test: %d systems within %.0f ly of Sol, %d with stations, %.1f ms\n",
+		int(nearby.size()), range, numWithStations, scanMs);
+	if (stats.misses || stats.size != cachedBefore) {
+		printf("summary test: FAIL: the scan generated %d full systems\n", stats.misses);
+		failures++;
+	}
+
+	for (std::vector< RefCountedPtr<SystemSummary> >::const_iterator i = nearby.begin(); i != nearby.end(); ++i) {
+		SystemSummary *summary = i->Get();
+		RefCountedPtr<StarSystem> sys = summary->GetStarSystem();
+		std::vector<SystemPath> stations;
+		for (std::vector<SystemBody*>::const_iterator j = sys->m_spaceStations.begin(); j != sys->m_spaceStations.end(); ++j)
+			stations.push_back((*j)->path);
+		bool same = stations == summary->GetStationPaths() &&
+			sys->GetTotalPop() == summary->GetTotalPop() &&
+			sys->GetEconType() == summary->GetEconType() &&
+			sys->GetUnexplored() == summary->GetUnexplored();
+		for (int t = 0; t < Equip::TYPE_MAX; t++)
+			same = same && sys->GetTradeLevel()[t] == summary->GetCommodityBasePriceModPercent(t);
+		if (!same) {
+			printf("summary test: FAIL: the summary of %s doesn't match the system\n", summary->GetName().c_str());
+			failures++;
+		}
+	}
+
+	printf("summary test: %d failures\n", failures);
+	return failures;
+}
+
+void Pi::RunRenderBenchmark(const std::string &saveName, int numFrames)
+{
+	Graphics::RendererNull *nullRenderer = dynamic_cast<Graphics::RendererNull*>(Pi::renderer);
+	if (!nullRenderer) {
+		fprintf(stderr, "benchmark: needs the null renderer\n");
+		return;
+	}
+
+	if (!StartBenchmarkGame(saveName)) return;
+
+	// nothing moves but the camera, so every run draws the same frames
+	game->SetTimeAccel(Game::TIMEACCEL_PAUSED);
+	worldView->SetCamType(WorldView::CAM_EXTERNAL);
+	ExternalCamera *cam = static_cast<ExternalCamera*>(worldView->GetActiveCamera());
+
+	Graphics::RendererNull::PrintStatsHeader(stdout);
+
+	Graphics::RendererNull::FrameStats total;
+	memset(&total, 0, sizeof(total));
+	Uint64 totalTime = 0;
+
+	for (int frame = 0; frame < numFrames; frame++) {
+		// once round the ship, rising and falling twice on the way. the
+		// camera keeps above the ship, so the path works docked too
+		const double t = double(frame) / double(numFrames);
+		cam->SetRotationAngles(-40.0 - 25.0 * sin(4.0 * M_PI * t), 360.0 * t);
+
+		const Uint64 start = OS::HFTimer();
+
+		Pi::renderer->BeginFrame();
+		Pi::renderer->SetTransform(matrix4x4f::Identity());
+		for (Space::BodyIterator i = game->GetSpace()->BodiesBegin(); i != game->GetSpace()->BodiesEnd(); ++i)
+			(*i)->UpdateInterpTransform(1.0);
+		game->GetSpace()->GetRootFrame()->UpdateInterpTransform(1.0);
+		currentView->Update();
+		currentView->Draw3D();
+		Pi::renderer->EndFrame();
+		Gui::Draw();
+		Pi::renderer->SwapBuffers();
+
+		const Uint64 frameTime = OS::HFTimer() - start;
+		totalTime += frameTime;
+
+		const Graphics::RendererNull::FrameStats &stats = nullRenderer->GetFrameStats();
+		Graphics::RendererNull::PrintStats(stdout, frame, stats, 1000.0 * double(frameTime) / double(OS::HFTimerFreq()));
+		total.drawCalls += stats.drawCalls;
+		total.materialChanges += stats.materialChanges;
+		total.bytesSubmitted += stats.bytesSubmitted;
+	}
+
+	if (numFrames > 0) {
+		const double totalMs = 1000.0 * double(totalTime) / double(OS::HFTimerFreq());
+		printf("benchmark: %d frames in %.1f ms, %.3f ms/frame, %.1f draws/frame, %.1f material changes/frame, %.1f KB/frame\n",
+			numFrames, totalMs, totalMs / numFrames, double(total.drawCalls) / numFrames,
+			double(total.materialChanges) / numFrames, double(total.bytesSubmitted) / 1024.0 / numFrames);
+	}
+
+	EndGame();
+}
+
 float Pi::CalcHyperspaceRangeMax(int hyperclass, int total_mass_in_tonnes)
 {
 	// 400.0f is balancing parameter
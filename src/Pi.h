@@ -13,6 +13,7 @@
 #include "LuaTimer.h"
 #include "CargoBody.h"
 #include "Space.h"
+#include "Game.h"
 #include <map>
 #include <string>
 #include <vector>
@@ -61,17 +62,39 @@ class Game;
 
 class Pi {
 public:
-	static void Init();
+	// a benchmark run has no sound. with nullRenderer nothing is drawn
+	// through the renderer, it only counts what would have been
+	static void Init(bool benchmark = false, bool nullRenderer = false);
 	static void InitGame();
 	static void StarportStart(Uint32 starport);
 	static void StartGame();
 	static void EndGame();
 	static void Start();
 	static void MainLoop();
+	// run numTicks physics steps as fast as possible without drawing
+	// anything, starting from the named save (or a fixed start if empty),
+	// and print how long each part of the step took. with time accelerated
+	// it's run again without ship rails, to compare
+	static void RunBenchmark(const std::string &saveName, int numTicks, Game::TimeAccel timeAccel = Game::TIMEACCEL_1X);
+	// load every model in data/models, importing the meshes and then from
+	// the model cache, and print how long each took
+	static void RunModelBenchmark();
+	// draw numFrames frames with the external camera circling the player,
+	// starting from the named save (or a fixed start if empty), with the
+	// game paused. prints what each frame drew, as counted by the null
+	// renderer, so needs Init(true, true)
+	static void RunRenderBenchmark(const std::string &saveName, int numFrames);
+	// generate terrain patches for every body in Sol and load them back
+	// from the terrain cache, and print how long each took
+	static void RunTerrainCacheBenchmark();
+	// look over the systems around Sol through their summaries, and check
+	// that doesn't generate (and cache) any full systems, and that the
+	// summaries agree with the systems. returns the number of failures
+	static int RunSystemSummaryTest();
 	static void TombStoneLoop();
 	static void OnChangeDetailLevel();
 	static void ToggleLuaConsole();
-	static void Quit() __attribute((noreturn));
+	static void Quit(int status = 0) __attribute((noreturn));
 	static float GetFrameTime() { return frameTime; }
 	static float GetGameTickAlpha() { return gameTickAlpha; }
 	static float GetScrAspect() { return scrAspect; }
@@ -86,6 +109,7 @@ public:
     static void SetMouseYInvert(bool state) { mouseYInvert = state; }
     static bool IsMouseYInvert() { return mouseYInvert; }
 	static bool IsNavTunnelDisplayed() { return navTunnelDisplayed; }
+	static bool IsSoundEnabled() { return soundEnabled; }
 	static void SetNavTunnelDisplayed(bool state) { navTunnelDisplayed = state; }
 	static int MouseButtonState(int button) { return mouseButton[button]; }
 	/// Get the default speed modifier to apply to movement (scrolling, zooming...), depending on the "shift" keys.
@@ -161,6 +185,10 @@ public:
 private:
 	static void HandleEvents();
 	static void InitJoysticks();
+	// runs the physics ticks the accumulated time calls for, returns how many
+	static int StepPhysics(double &accumulator, int maxTicks);
+	// returns true once the game is over
+	static bool CheckPlayerDeath(double &timePlayerDied);
 
 	static bool menuDone;
 
@@ -197,6 +225,8 @@ private:
 	static Sound::MusicPlayer musicPlayer;
 
 	static bool navTunnelDisplayed;
+	// DisableSound, or off for a benchmark. not saved to the config
+	static bool soundEnabled;
 
 	static Gui::Fixed *menu;
 };
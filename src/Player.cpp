@@ -127,19 +127,23 @@ void Player::SetAlertState(Ship::AlertState as)
 	Ship::SetAlertState(as);
 }
 
-void Player::NotifyRemoved(const Body* const removedBody)
+void Player::NotifyRemoved(const BodyBatch &removed)
 {
-	if (GetNavTarget() == removedBody)
+	if (removed.Contains(GetNavTarget()))
 		SetNavTarget(0);
 
-	else if (GetCombatTarget() == removedBody) {
+	const Body *combatTarget = GetCombatTarget();
+	if (removed.Contains(combatTarget)) {
 		SetCombatTarget(0);
 
-		if (!GetNavTarget() && removedBody->IsType(Object::SHIP))
-			SetNavTarget(static_cast<const Ship*>(removedBody)->GetHyperspaceCloud());
+		if (!GetNavTarget() && combatTarget->IsType(Object::SHIP)) {
+			Body *cloud = static_cast<const Ship*>(combatTarget)->GetHyperspaceCloud();
+			if (!removed.Contains(cloud))
+				SetNavTarget(cloud);
+		}
 	}
 
-	Ship::NotifyRemoved(removedBody);
+	Ship::NotifyRemoved(removed);
 }
 
 /* MarketAgent shite */
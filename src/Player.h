@@ -27,7 +27,7 @@ public:
 	virtual bool SetWheelState(bool down); // returns success of state change, NOT state itself
 	virtual bool FireMissile(int idx, Ship *target);
 	virtual void SetAlertState(Ship::AlertState as);
-	virtual void NotifyRemoved(const Body* const removedBody);
+	virtual void NotifyRemoved(const BodyBatch &removed);
 
 	/* MarketAgent stuff */
 	int GetStock(Equip::Type t) const { assert(0); return 0; }
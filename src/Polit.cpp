@@ -190,13 +190,13 @@ void GetSysPolitStarSystem(const StarSystem *s, const fixed human_infestedness,
 	const unsigned long _init[5] = { Uint32(path.sectorX), Uint32(path.sectorY), Uint32(path.sectorZ), path.systemIndex, POLIT_SEED };
 	MTRand rand(_init, 5);
 
-	Sector sec(path.sectorX, path.sectorY, path.sectorZ);
+	RefCountedPtr<Sector> sec = Sector::GetCached(path);
 
 	GovType a = GOV_INVALID;
 
 	/* from custom system definition */
-	if (sec.m_systems[path.systemIndex].customSys) {
-		Polit::GovType t = sec.m_systems[path.systemIndex].customSys->govType;
+	if (sec->m_systems[path.systemIndex].customSys) {
+		Polit::GovType t = sec->m_systems[path.systemIndex].customSys->govType;
 		a = t;
 	}
 	if (a == GOV_INVALID) {
@@ -223,16 +223,20 @@ void GetSysPolitStarSystem(const StarSystem *s, const fixed human_infestedness,
 
 bool IsCommodityLegal(const StarSystem *s, const Equip::Type t)
 {
-	SystemPath path = s->GetPath();
+	return IsCommodityLegal(s->GetPath(), s->GetSysPolit(), s->GetFaction(), t);
+}
+
+bool IsCommodityLegal(const SystemPath &path, const SysPolit &polit, const Faction *faction, const Equip::Type t)
+{
 	const unsigned long _init[5] = { Uint32(path.sectorX), Uint32(path.sectorY), Uint32(path.sectorZ), path.systemIndex, POLIT_SALT };
 	MTRand rand(_init, 5);
 
-	Polit::GovType a = s->GetSysPolit().govType;
+	Polit::GovType a = polit.govType;
 	if (a == GOV_NONE) return true;
 
-	if(s->GetFaction()->idx != Faction::BAD_FACTION_IDX ) {
-		Faction::EquipProbMap::const_iterator iter = s->GetFaction()->equip_legality.find(t);
-		if( iter != s->GetFaction()->equip_legality.end() ) {
+	if(faction->idx != Faction::BAD_FACTION_IDX ) {
+		Faction::EquipProbMap::const_iterator iter = faction->equip_legality.find(t);
+		if( iter != faction->equip_legality.end() ) {
 			const uint32_t per = (*iter).second;
 			return (rand.Int32(100) >= per);
 		}
@@ -10,6 +10,8 @@
 class StarSystem;
 class SysPolit;
 class Ship;
+class Faction;
+class SystemPath;
 
 namespace Polit {
 	enum Crime { // <enum scope='Polit' name=PolitCrime prefix=CRIME_>
@@ -54,6 +56,7 @@ namespace Polit {
 	void NotifyOfCrime(Ship *s, enum Crime c);
 	void GetSysPolitStarSystem(const StarSystem *s, const fixed human_infestedness, SysPolit &outSysPolit);
 	bool IsCommodityLegal(const StarSystem *s, const Equip::Type t);
+	bool IsCommodityLegal(const SystemPath &path, const SysPolit &polit, const Faction *faction, const Equip::Type t);
 	void Init();
 	void Serialize(Serializer::Writer &wr);
 	void Unserialize(Serializer::Reader &rd);
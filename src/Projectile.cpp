@@ -147,9 +147,9 @@ void Projectile::UpdateInterpTransform(double alpha)
 	m_interpPos = alpha*GetPosition() + (1.0-alpha)*oldPos;
 }
 
-void Projectile::NotifyRemoved(const Body* const removedBody)
+void Projectile::NotifyRemoved(const BodyBatch &removed)
 {
-	if (m_parent == removedBody) m_parent = 0;
+	if (removed.Contains(m_parent)) m_parent = 0;
 }
 
 void Projectile::TimeStepUpdate(const float timeStep)
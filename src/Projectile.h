@@ -26,7 +26,7 @@ public:
 	virtual void Render(Graphics::Renderer *r, const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform);
 	void TimeStepUpdate(const float timeStep);
 	void StaticUpdate(const float timeStep);
-	virtual void NotifyRemoved(const Body* const removedBody);
+	virtual void NotifyRemoved(const BodyBatch &removed);
 	virtual void UpdateInterpTransform(double alpha);
 	virtual void PostLoadFixup(Space *space);
 
@@ -6,6 +6,10 @@
 
 #include "SmartPtr.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 class RefCounted {
 public:
 	RefCounted() : m_refCount(0) {}
@@ -19,6 +23,29 @@ private:
 	int m_refCount;
 };
 
+// for objects shared between threads. only the count is safe to change
+// from several threads at once; the object needs its own locking if it
+// changes after it's shared. a copy starts with no references
+class AtomicRefCounted {
+public:
+	AtomicRefCounted() : m_refCount(0) {}
+	AtomicRefCounted(const AtomicRefCounted &) : m_refCount(0) {}
+	AtomicRefCounted &operator=(const AtomicRefCounted &) { return *this; }
+	virtual ~AtomicRefCounted() {}
+
+#if defined(_MSC_VER)
+	inline void IncRefCount() { _InterlockedIncrement(&m_refCount); }
+	inline void DecRefCount() { const long n = _InterlockedDecrement(&m_refCount); assert(n >= 0); if (!n) delete this; }
+#else
+	inline void IncRefCount() { __sync_add_and_fetch(&m_refCount, 1); }
+	inline void DecRefCount() { const long n = __sync_sub_and_fetch(&m_refCount, 1); assert(n >= 0); if (!n) delete this; }
+#endif
+	inline int GetRefCount() { return m_refCount; }
+
+private:
+	volatile long m_refCount;
+};
+
 template <typename T>
 class RefCountedPtr : public SmartPtrBase<RefCountedPtr<T>, T> {
 	typedef RefCountedPtr<T> this_type;
@@ -0,0 +1,299 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SaveContainer.h"
+#include "Serializer.h"
+#include "JobQueue.h"
+
+extern "C" {
+#include "miniz/miniz.h"
+}
+
+// a plain save starts with "PIONEER" and a null, so this can't be mistaken
+// for one
+static const char s_magic[] = "PIONEERZ";
+static const size_t MAGIC_SIZE = sizeof(s_magic) - 1;
+
+// bump this if the container itself changes. it says nothing about the save
+// inside, which has its own version. version 1 had every block's header up
+// front, so it couldn't be written as the save was made. it's still read
+static const Uint32 CONTAINER_VERSION = 2;
+
+// big sections (Space, mostly) are cut into blocks no bigger than this, so
+// there's something to share out between the threads
+static const size_t MAX_BLOCK_SIZE = 1024*1024;
+
+// no save comes anywhere near this. it stops damaged block sizes from asking
+// for more memory than there is
+static const size_t MAX_UNPACKED_SIZE = 1024*1024*1024;
+
+// saves are mostly repeated numbers and names, which even the fastest level
+// squeezes well
+static const int COMPRESSION_LEVEL = MZ_BEST_SPEED;
+
+static void PutInt32(std::string &out, Uint32 x)
+{
+	x = SDL_SwapLE32(x);
+	out.append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+static Uint32 GetInt32(const char *data)
+{
+	Uint32 x;
+	memcpy(&x, data, sizeof(x));
+	return SDL_SwapLE32(x);
+}
+
+// reads the header, throwing if it runs off the end of the data
+class HeaderReader {
+public:
+	HeaderReader(const char *data, size_t size): m_data(data), m_size(size), m_pos(0) {}
+	const char *Bytes(size_t len) {
+		if (len > m_size - m_pos) throw SavedGameCorruptException();
+		const char *p = m_data + m_pos;
+		m_pos += len;
+		return p;
+	}
+	Uint32 Int32() { return GetInt32(Bytes(4)); }
+private:
+	const char *m_data;
+	size_t m_size;
+	size_t m_pos;
+};
+
+struct Block {
+	Block(const std::string &l, size_t s, size_t n): label(l), start(s), size(n) {}
+	std::string label;
+	size_t start;
+	size_t size;
+};
+
+static void AddBlocks(std::vector<Block> &blocks, const std::string &label, size_t start, size_t size)
+{
+	while (size > 0) {
+		const size_t n = std::min(size, MAX_BLOCK_SIZE);
+		blocks.push_back(Block(label, start, n));
+		start += n;
+		size -= n;
+	}
+}
+
+// if there's a section (a label string then a data string, see
+// Serializer::Writer::BeginSection) at pos, gets its label and returns where
+// it ends. otherwise returns 0
+static size_t SectionEnd(const char *data, size_t size, size_t pos, std::string &label)
+{
+	if (size - pos < 4) return 0;
+	const size_t labelLen = GetInt32(data + pos);
+	pos += 4;
+	if (labelLen == 0 || labelLen > size - pos || data[pos + labelLen - 1] != '\0') return 0;
+	label.assign(data + pos, labelLen - 1);
+	pos += labelLen;
+
+	if (size - pos < 4) return 0;
+	const size_t dataLen = GetInt32(data + pos);
+	pos += 4;
+	if (dataLen > size - pos) return 0;
+	return pos + dataLen;
+}
+
+// cuts a plain save up along its top level: the signature and version, each
+// section, and whatever is left (the end marker). this only decides where
+// the cuts go; the blocks are put back together byte for byte, so data that
+// doesn't look like a save still packs and unpacks correctly
+static void FindBlocks(const char *data, size_t size, std::vector<Block> &blocks)
+{
+	size_t pos = 0;
+	while (pos < size && data[pos] != '\0') pos++;
+	pos = std::min(pos + 1 + 4, size);
+	AddBlocks(blocks, "header", 0, pos);
+
+	std::string label;
+	for (;;) {
+		const size_t end = SectionEnd(data, size, pos, label);
+		if (!end) break;
+		AddBlocks(blocks, label, pos, end - pos);
+		pos = end;
+	}
+
+	AddBlocks(blocks, "end", pos, size - pos);
+}
+
+bool SaveContainer::IsContainer(const char *data, size_t size)
+{
+	return size >= MAGIC_SIZE && memcmp(data, s_magic, MAGIC_SIZE) == 0;
+}
+
+/* Layout, all numbers little endian Int32:
+ *   magic, container version
+ *   for each block: unpacked size (never 0), packed size, crc32, packed data
+ *   0, to end the blocks
+ *   number of patches, then for each: position, value
+ *   crc32 of the patches, from their number on */
+void SaveContainer::BeginPack(std::string &out)
+{
+	out.append(s_magic, MAGIC_SIZE);
+	PutInt32(out, CONTAINER_VERSION);
+}
+
+void SaveContainer::PackBlock(const char *data, size_t size, std::string &out)
+{
+	if (size == 0) return;
+
+	const size_t headerPos = out.size();
+	PutInt32(out, size);
+	PutInt32(out, 0); // packed size, filled in below
+	PutInt32(out, mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(data), size));
+
+	const size_t dataPos = out.size();
+	mz_ulong packedSize = mz_compressBound(size);
+	out.resize(dataPos + packedSize);
+	int status = mz_compress2(reinterpret_cast<unsigned char*>(&out[dataPos]), &packedSize,
+		reinterpret_cast<const unsigned char*>(data), size, COMPRESSION_LEVEL);
+	assert(status == MZ_OK);
+	out.resize(dataPos + packedSize);
+
+	const Uint32 le = SDL_SwapLE32(Uint32(packedSize));
+	memcpy(&out[headerPos + 4], &le, sizeof(le));
+}
+
+void SaveContainer::EndPack(const std::vector<Patch> &patches, std::string &out)
+{
+	PutInt32(out, 0);
+
+	const size_t patchPos = out.size();
+	PutInt32(out, patches.size());
+	for (std::vector<Patch>::const_iterator i = patches.begin(); i != patches.end(); ++i) {
+		PutInt32(out, i->pos);
+		PutInt32(out, i->value);
+	}
+	PutInt32(out, mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(&out[patchPos]), out.size() - patchPos));
+}
+
+void SaveContainer::Pack(const char *data, size_t size, std::string &out)
+{
+	std::vector<Block> blocks;
+	FindBlocks(data, size, blocks);
+
+	BeginPack(out);
+	for (size_t i = 0; i < blocks.size(); i++)
+		PackBlock(data + blocks[i].start, blocks[i].size, out);
+	EndPack(std::vector<Patch>(), out);
+}
+
+class UnpackJob : public Job {
+public:
+	UnpackJob(): packed(0), packedSize(0), out(0), size(0), crc(0), ok(false) {}
+
+	virtual void Run(int threadNum) {
+		mz_ulong len = size;
+		ok = mz_uncompress(reinterpret_cast<unsigned char*>(out), &len,
+				reinterpret_cast<const unsigned char*>(packed), packedSize) == MZ_OK &&
+			len == size &&
+			mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(out), size) == crc;
+	}
+
+	const char *packed;
+	size_t packedSize;
+	char *out;
+	size_t size;
+	Uint32 crc;
+	bool ok;
+};
+
+char *SaveContainer::Unpack(const char *data, size_t size, int numThreads, size_t &unpackedSize, int &numBlocks)
+{
+	if (!IsContainer(data, size)) throw SavedGameCorruptException();
+
+	HeaderReader rd(data, size);
+	rd.Bytes(MAGIC_SIZE);
+	const Uint32 version = rd.Int32();
+	if (version == 0 || version > CONTAINER_VERSION) throw SavedGameCorruptException();
+
+	std::vector<UnpackJob> jobs;
+	std::vector<Patch> patches;
+	size_t totalSize = 0;
+	if (version == 1) {
+		const Uint32 blockCount = rd.Int32();
+		totalSize = rd.Int32();
+
+		// every block takes at least 16 bytes of header, so this stops a
+		// damaged count from asking for a silly amount of memory
+		if (blockCount > size / 16) throw SavedGameCorruptException();
+
+		jobs.resize(blockCount);
+		size_t outPos = 0;
+		for (Uint32 i = 0; i < blockCount; i++) {
+			rd.Bytes(rd.Int32()); // label, for anyone looking at the file
+			jobs[i].size = rd.Int32();
+			jobs[i].packedSize = rd.Int32();
+			jobs[i].crc = rd.Int32();
+			if (jobs[i].size > totalSize - outPos) throw SavedGameCorruptException();
+			outPos += jobs[i].size;
+		}
+		if (outPos != totalSize) throw SavedGameCorruptException();
+		for (Uint32 i = 0; i < blockCount; i++)
+			jobs[i].packed = rd.Bytes(jobs[i].packedSize);
+	} else {
+		for (;;) {
+			UnpackJob job;
+			job.size = rd.Int32();
+			if (!job.size) break;
+			job.packedSize = rd.Int32();
+			job.crc = rd.Int32();
+			job.packed = rd.Bytes(job.packedSize);
+			// a damaged size could add up to more memory than there is
+			if (job.size > MAX_UNPACKED_SIZE - totalSize) throw SavedGameCorruptException();
+			totalSize += job.size;
+			jobs.push_back(job);
+		}
+
+		const char *patchData = rd.Bytes(0);
+		const Uint32 patchCount = rd.Int32();
+		if (patchCount > size / 8) throw SavedGameCorruptException();
+		for (Uint32 i = 0; i < patchCount; i++) {
+			const Uint32 pos = rd.Int32();
+			const Uint32 value = rd.Int32();
+			if (pos > totalSize || totalSize - pos < 4) throw SavedGameCorruptException();
+			patches.push_back(Patch(pos, value));
+		}
+		const size_t patchSize = rd.Bytes(0) - patchData;
+		if (rd.Int32() != mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(patchData), patchSize))
+			throw SavedGameCorruptException();
+	}
+	const Uint32 blockCount = jobs.size();
+
+	char *out = static_cast<char*>(malloc(std::max(totalSize, size_t(1))));
+	size_t outPos = 0;
+	for (Uint32 i = 0; i < blockCount; i++) {
+		jobs[i].out = out + outPos;
+		outPos += jobs[i].size;
+	}
+
+	numThreads = std::min(numThreads, int(blockCount));
+	if (numThreads > 1) {
+		JobQueue queue(numThreads);
+		for (Uint32 i = 0; i < blockCount; i++)
+			queue.Queue(&jobs[i]);
+		queue.Finish();
+	} else {
+		for (Uint32 i = 0; i < blockCount; i++)
+			jobs[i].Run(0);
+	}
+
+	for (Uint32 i = 0; i < blockCount; i++) {
+		if (!jobs[i].ok) {
+			free(out);
+			throw SavedGameCorruptException();
+		}
+	}
+
+	for (std::vector<Patch>::const_iterator i = patches.begin(); i != patches.end(); ++i) {
+		const Uint32 le = SDL_SwapLE32(i->value);
+		memcpy(out + i->pos, &le, sizeof(le));
+	}
+
+	unpackedSize = totalSize;
+	numBlocks = blockCount;
+	return out;
+}
@@ -0,0 +1,48 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SAVECONTAINER_H
+#define _SAVECONTAINER_H
+
+#include "libs.h"
+
+// The compressed form of a save file. The plain save (as written by
+// Game::Serialize) is cut into blocks, and each block is compressed and
+// checksummed on its own, so they can be unpacked in parallel and damage is
+// caught before the game tries to read it. Unpacking gives back exactly the
+// bytes that were packed, so the game reads a packed save the same way as a
+// plain one, and plain saves still load as they are.
+//
+// A packed save can be written a block at a time as the save is made (see
+// Serializer::Writer). Section lengths that are only known after their block
+// has gone are stored as patches at the end, applied after unpacking.
+namespace SaveContainer {
+
+	// true if the data is a packed save rather than a plain one
+	bool IsContainer(const char *data, size_t size);
+
+	// appends the packed form of a plain save to out, cut into blocks along
+	// its top level sections
+	void Pack(const char *data, size_t size, std::string &out);
+
+	// four bytes of the plain save to overwrite once it's unpacked
+	struct Patch {
+		Patch(Uint32 p, Uint32 v): pos(p), value(v) {}
+		Uint32 pos;
+		Uint32 value;
+	};
+
+	// the same, a block at a time. BeginPack first, then a PackBlock for each
+	// part of the save in order, then EndPack. each appends to out
+	void BeginPack(std::string &out);
+	void PackBlock(const char *data, size_t size, std::string &out);
+	void EndPack(const std::vector<Patch> &patches, std::string &out);
+
+	// the plain save, in a buffer from malloc() for the caller to free().
+	// blocks are unpacked on up to numThreads threads. throws
+	// SavedGameCorruptException if the container is damaged
+	char *Unpack(const char *data, size_t size, int numThreads, size_t &unpackedSize, int &numBlocks);
+
+}
+
+#endif
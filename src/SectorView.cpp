@@ -278,7 +278,7 @@ void SectorView::OnSearchBoxKeyPress(const SDL_keysym *keysym)
 	SystemPath bestMatch;
 	const std::string *bestMatchName = 0;
 
-	for (std::map<SystemPath,Sector*>::iterator i = m_sectorCache.begin(); i != m_sectorCache.end(); ++i)
+	for (std::map<SystemPath,RefCountedPtr<Sector> >::iterator i = m_sectorCache.begin(); i != m_sectorCache.end(); ++i)
 
 		for (unsigned int systemIndex = 0; systemIndex < (*i).second->m_systems.size(); systemIndex++) {
 			const Sector::System *ss = &((*i).second->m_systems[systemIndex]);
@@ -1118,17 +1118,14 @@ void SectorView::MouseButtonDown(int button, int x, int y)
 
 Sector* SectorView::GetCached(const SystemPath& loc)
 {
-	Sector *s = 0;
-
-	std::map<SystemPath,Sector*>::iterator i = m_sectorCache.find(loc);
+	std::map<SystemPath,RefCountedPtr<Sector> >::iterator i = m_sectorCache.find(loc);
 	if (i != m_sectorCache.end())
-		return (*i).second;
+		return (*i).second.Get();
 
-	s = new Sector(loc.sectorX, loc.sectorY, loc.sectorZ);
-	m_sectorCache.insert( std::pair<SystemPath,Sector*>(loc, s) );
-	s->AssignFactions();
+	RefCountedPtr<Sector> s = Sector::GetCached(loc);
+	m_sectorCache.insert( std::pair<SystemPath,RefCountedPtr<Sector> >(loc, s) );
 
-	return s;
+	return s.Get();
 }
 
 Sector* SectorView::GetCached(const int sectorX, const int sectorY, const int sectorZ)
@@ -1155,12 +1152,11 @@ void SectorView::ShrinkCache()
 	if  (xmin != m_cacheXMin || xmax != m_cacheXMax
 	  || ymin != m_cacheYMin || ymax != m_cacheYMax
 	  || zmin != m_cacheZMin || zmax != m_cacheZMax) {
-		std::map<SystemPath,Sector*>::iterator iter = m_sectorCache.begin();
+		std::map<SystemPath,RefCountedPtr<Sector> >::iterator iter = m_sectorCache.begin();
 		while (iter != m_sectorCache.end())	{
-			Sector *s = (*iter).second;
+			const Sector *s = (*iter).second.Get();
 			//check_point_in_box
-			if (s && !s->WithinBox( xmin, xmax, ymin, ymax, zmin, zmax )) {
-				delete s;
+			if (!s->WithinBox( xmin, xmax, ymin, ymax, zmin, zmax )) {
 				m_sectorCache.erase( iter++ );
 			} else {
 				iter++;
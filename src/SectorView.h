@@ -132,7 +132,8 @@ private:
 	sigc::connection m_onMouseButtonDown;
 	sigc::connection m_onKeyPressConnection;
 
-	std::map<SystemPath,Sector*> m_sectorCache;
+	// sectors in view. holding them keeps them in the shared cache
+	std::map<SystemPath,RefCountedPtr<Sector> > m_sectorCache;
 	std::string m_previousSearch;
 
 	float m_playerHyperspaceRange;
@@ -1,68 +1,102 @@
 // Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
-#include "galaxy/StarSystem.h"
 #include "Serializer.h"
-#include "Pi.h"
-#include "Frame.h"
-#include "Space.h"
-#include "Ship.h"
-#include "HyperspaceCloud.h"
+#include "FileSystem.h"
 
 namespace Serializer {
 
-const std::string &Writer::GetData() { return m_str; }
+// file writers hand this much at a time to the file
+static const size_t CHUNK_SIZE = 256*1024;
+
+Writer::Writer(): m_file(0), m_fileSize(0), m_pack(false) {
+}
+Writer::Writer(FILE *fptr, bool pack): m_file(fptr), m_fileSize(0), m_pack(pack) {
+	m_buf.reserve(CHUNK_SIZE);
+	if (m_pack) {
+		SaveContainer::BeginPack(m_packed);
+		WritePacked();
+	}
+}
+const std::string &Writer::GetData() {
+	assert(!m_file);
+	return m_buf;
+}
+void Writer::Flush() {
+	assert(m_sections.empty());
+	if (m_file) {
+		WriteChunk();
+		if (m_pack) {
+			SaveContainer::EndPack(m_patches, m_packed);
+			WritePacked();
+		}
+		if (fflush(m_file) != 0) throw CouldNotWriteToFileException();
+	}
+}
+void Writer::WriteChunk() {
+	if (m_buf.empty()) return;
+	if (m_pack) {
+		SaveContainer::PackBlock(m_buf.data(), m_buf.size(), m_packed);
+		WritePacked();
+	} else if (fwrite(m_buf.data(), m_buf.size(), 1, m_file) != 1)
+		throw CouldNotWriteToFileException();
+	m_fileSize += m_buf.size();
+	m_buf.clear();
+}
+void Writer::WritePacked() {
+	if (fwrite(m_packed.data(), m_packed.size(), 1, m_file) != 1)
+		throw CouldNotWriteToFileException();
+	m_packed.clear();
+}
+inline void Writer::Write(const void *data, size_t len) {
+	// never splits a write between the file and the buffer, so Patch() only
+	// has to look in one place
+	if (m_file && m_buf.size() + len > CHUNK_SIZE)
+		WriteChunk();
+	m_buf.append(reinterpret_cast<const char*>(data), len);
+}
+void Writer::Patch(size_t pos, Uint32 x) {
+	x = SDL_SwapLE32(x);
+	if (pos >= m_fileSize) {
+		memcpy(&m_buf[pos - m_fileSize], &x, sizeof(x));
+		return;
+	}
+	// packed chunks can't be changed, so the length is put right after
+	// unpacking instead
+	if (m_pack) {
+		m_patches.push_back(SaveContainer::Patch(pos, SDL_SwapLE32(x)));
+		return;
+	}
+	if (fseek(m_file, long(pos), SEEK_SET) != 0 ||
+		fwrite(&x, sizeof(x), 1, m_file) != 1 ||
+		fseek(m_file, 0, SEEK_END) != 0)
+		throw CouldNotWriteToFileException();
+}
 void Writer::Byte(Uint8 x) {
-	m_str.push_back(char(x));
+	Write(&x, 1);
 }
 void Writer::Bool(bool x) {
 	Byte(Uint8(x));
 }
 void Writer::Int16(Uint16 x) {
-	m_str.push_back(char(x&0xff));
-	m_str.push_back(char((x>>8)&0xff));
+	x = SDL_SwapLE16(x);
+	Write(&x, sizeof(x));
 }
 void Writer::Int32(Uint32 x) {
-	m_str.push_back(char(x&0xff));
-	m_str.push_back(char((x>>8)&0xff));
-	m_str.push_back(char((x>>16)&0xff));
-	m_str.push_back(char((x>>24)&0xff));
+	x = SDL_SwapLE32(x);
+	Write(&x, sizeof(x));
 }
 void Writer::Int64(Uint64 x) {
-	m_str.push_back(char(x&0xff));
-	m_str.push_back(char((x>>8)&0xff));
-	m_str.push_back(char((x>>16)&0xff));
-	m_str.push_back(char((x>>24)&0xff));
-	m_str.push_back(char((x>>32)&0xff));
-	m_str.push_back(char((x>>40)&0xff));
-	m_str.push_back(char((x>>48)&0xff));
-	m_str.push_back(char((x>>56)&0xff));
+	x = SDL_SwapLE64(x);
+	Write(&x, sizeof(x));
 }
 void Writer::Float(float f) {
 	// not portable across architectures?
-	unsigned int i;
-	union {
-		unsigned char c[sizeof (float)];
-		float f;
-	} p;
-	p.f = f;
-
-	for (i=0; i<sizeof (float); i++) {
-		Byte (p.c[i]);
-	}
+	Write(&f, sizeof(f));
 }
 void Writer::Double(double f) {
 	// not portable across architectures
-	unsigned int i;
-	union {
-		unsigned char c[sizeof (double)];
-		double f;
-	} p;
-	p.f = f;
-
-	for (i=0; i<sizeof (double); i++) {
-		Byte (p.c[i]);
-	}
+	Write(&f, sizeof(f));
 }
 /* First byte is string length, including null terminator */
 void Writer::String(const char* s)
@@ -73,23 +107,15 @@ void Writer::String(const char* s)
 		return;
 	}
 
-	Int32(strlen(s)+1);
-
-	while (*s) {
-		Byte(*s);
-		s++;
-	}
-	Byte(*s);
+	const size_t len = strlen(s)+1;
+	Int32(len);
+	Write(s, len);
 }
 
 void Writer::String(const std::string &s)
 {
 	Int32(s.size()+1);
-
-	for(size_t i=0; i<s.size(); i++) {
-		Byte(s[i]);
-	}
-	Byte(0);
+	Write(s.c_str(), s.size()+1);
 }
 
 void Writer::Vector3d(vector3d vec)
@@ -107,100 +133,107 @@ void Writer::WrQuaternionf(const Quaternionf &q)
 	Float(q.z);
 }
 
+/* A section is stored as its label and then its contents as one string, so
+ * the length goes in front and is filled in once the section is finished */
+void Writer::BeginSection(const std::string &section_label)
+{
+	String(section_label);
+	m_sections.push_back(m_fileSize + m_buf.size());
+	Int32(0);
+}
+
+void Writer::EndSection()
+{
+	assert(!m_sections.empty());
+	const size_t start = m_sections.back();
+	m_sections.pop_back();
 
-Reader::Reader(): m_data(""), m_pos(0) {
+	Byte(0); // null terminator, same as String()
+	Patch(start, Uint32(m_fileSize + m_buf.size() - start - 4));
 }
-Reader::Reader(const std::string &data):
-	m_data(data),
-	m_pos(0) {
 
+
+// holds the data for readers made from a string
+class ReaderData : public RefCounted {
+public:
+	ReaderData(const std::string &data): m_data(data) {}
+	const std::string &GetData() const { return m_data; }
+private:
+	std::string m_data;
+};
+
+Reader::Reader(): m_data(0), m_size(0), m_pos(0), m_streamVersion(0) {
+}
+Reader::Reader(const std::string &data): m_pos(0), m_streamVersion(0) {
+	ReaderData *owner = new ReaderData(data);
+	m_owner.Reset(owner);
+	m_data = owner->GetData().data();
+	m_size = owner->GetData().size();
 }
-Reader::Reader(FILE *fptr): m_pos(0) {
-	m_data = "";
-	while (!feof(fptr)) m_data.push_back(fgetc(fptr));
-	printf(SIZET_FMT " characters in savefile\n", m_data.size());
+Reader::Reader(const RefCountedPtr<FileSystem::FileData> &data):
+	m_owner(data.Get()),
+	m_data(data->GetData()),
+	m_size(data->GetSize()),
+	m_pos(0),
+	m_streamVersion(0) {
 }
-bool Reader::AtEnd() { return m_pos >= m_data.size(); }
+bool Reader::AtEnd() { return m_pos >= m_size; }
 void Reader::Seek(int pos) { m_pos = pos; }
+inline void Reader::Read(void *out, size_t len) {
+	if (m_pos > m_size || len > m_size - m_pos)
+		throw SavedGameCorruptException();
+	memcpy(out, m_data + m_pos, len);
+	m_pos += len;
+}
 Uint8 Reader::Byte() {
-#ifdef DEBUG
-	assert(m_pos < m_data.size());
-#endif /* DEBUG */
-	return Uint8(m_data[m_pos++]);
+	Uint8 x;
+	Read(&x, 1);
+	return x;
 }
 bool Reader::Bool() {
 	return Byte() != 0;
 }
 Uint16 Reader::Int16()
 {
-	int t1, t2;
-	t2 = Byte();
-	t1 = Byte();
-	return ((t1 << 8) | t2);
+	Uint16 x;
+	Read(&x, sizeof(x));
+	return SDL_SwapLE16(x);
 }
 Uint32 Reader::Int32(void)
 {
-	int t1, t2, t3, t4;
-	t4 = Byte();
-	t3 = Byte();
-	t2 = Byte();
-	t1 = Byte();
-	return ((t1 << 24) | (t2 << 16) | (t3 << 8) | t4);
+	Uint32 x;
+	Read(&x, sizeof(x));
+	return SDL_SwapLE32(x);
 }
 Uint64 Reader::Int64(void)
 {
-	Uint64 t1, t2, t3, t4, t5, t6, t7, t8;
-	t8 = Byte();
-	t7 = Byte();
-	t6 = Byte();
-	t5 = Byte();
-	t4 = Byte();
-	t3 = Byte();
-	t2 = Byte();
-	t1 = Byte();
-	return ((t1<<56) | (t2<<48) | (t3<<40) | (t4<<32) | (t5 << 24) | (t6 << 16) | (t7 << 8) | t8);
+	Uint64 x;
+	Read(&x, sizeof(x));
+	return SDL_SwapLE64(x);
 }
 
 float Reader::Float ()
 {
-	unsigned int i;
-	union {
-		unsigned char c[sizeof (float)];
-		float f;
-	} p;
-
-	for (i=0; i<sizeof (float); i++) {
-		p.c[i] = Byte ();
-	}
-	return p.f;
+	float f;
+	Read(&f, sizeof(f));
+	return f;
 }
 
 double Reader::Double ()
 {
-	unsigned int i;
-	union {
-		unsigned char c[sizeof (double)];
-		double f;
-	} p;
-
-	for (i=0; i<sizeof (double); i++) {
-		p.c[i] = Byte ();
-	}
-	return p.f;
+	double f;
+	Read(&f, sizeof(f));
+	return f;
 }
 
 std::string Reader::String()
 {
-	int size = Int32();
+	Uint32 size = Int32();
 	if (size == 0) return "";
+	if (size > m_size - m_pos) throw SavedGameCorruptException();
 
-	std::string buf;
-	buf.reserve(size-1);
-
-	for (int i=0; i<size-1; i++) {
-		buf.push_back(char(Byte()));
-	}
-	Byte();// discard null terminator
+	std::string buf(m_data + m_pos, size-1);
+	m_pos += size; // and the null terminator
 	return buf;
 }
 
@@ -223,4 +256,23 @@ Quaternionf Reader::RdQuaternionf()
 	return q;
 }
 
+Reader Reader::RdSection(const std::string &section_label_expected)
+{
+	if (section_label_expected != String()) {
+		throw SavedGameCorruptException();
+	}
+
+	Uint32 size = Int32();
+	if (size == 0 || size > m_size - m_pos) throw SavedGameCorruptException();
+
+	Reader section;
+	section.m_owner = m_owner;
+	section.m_data = m_data + m_pos;
+	section.m_size = size-1;
+	section.SetStreamVersion(StreamVersion());
+
+	m_pos += size;
+	return section;
+}
+
 } /* end namespace Serializer */
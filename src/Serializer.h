@@ -6,6 +6,8 @@
 
 #include "utils.h"
 #include "Quaternion.h"
+#include "RefCounted.h"
+#include "SaveContainer.h"
 #include <vector>
 
 class Frame;
@@ -13,6 +15,8 @@ class Body;
 class StarSystem;
 class SystemBody;
 
+namespace FileSystem { class FileData; }
+
 struct SavedGameCorruptException {};
 struct CouldNotOpenFileException {};
 struct CouldNotWriteToFileException {};
@@ -21,8 +25,20 @@ namespace Serializer {
 
 	class Writer {
 	public:
-		Writer() {}
+		// keeps everything in memory, for GetData()
+		Writer();
+		// writes to the file as it goes, a chunk at a time. the file must be
+		// seekable, so sections can be filled in when they're finished. call
+		// Flush() at the end to write out the last chunk. if pack is set,
+		// each chunk is compressed as it goes, making a packed save (see
+		// SaveContainer)
+		explicit Writer(FILE *fptr, bool pack = false);
+
+		// memory writers only
 		const std::string &GetData();
+		// throws CouldNotWriteToFileException
+		void Flush();
+
 		void Byte(Uint8 x);
 		void Bool(bool x);
 		void Int16(Uint16 x);
@@ -34,24 +50,41 @@ namespace Serializer {
 		void String(const std::string &s);
 		void Vector3d(vector3d vec);
 		void WrQuaternionf(const Quaternionf &q);
-		void WrSection(const std::string &section_label, const std::string &section_data) {
-			String(section_label);
-			String(section_data);
-		}
+		// everything written between these goes in a section, to be read back
+		// with Reader::RdSection(). sections can nest
+		void BeginSection(const std::string &section_label);
+		void EndSection();
 		/** Best not to use these except in templates */
 		void Auto(Sint32 x) { Int32(x); }
 		void Auto(Sint64 x) { Int64(x); }
 		void Auto(float x) { Float(x); }
 		void Auto(double x) { Double(x); }
 	private:
-		std::string m_str;
+		Writer(const Writer &);
+		Writer &operator=(const Writer &);
+
+		void Write(const void *data, size_t len);
+		void WriteChunk();
+		void WritePacked();
+		// overwrite four bytes that have already been written
+		void Patch(size_t pos, Uint32 x);
+
+		std::string m_buf;             // everything not yet in the file
+		FILE *m_file;
+		size_t m_fileSize;             // bytes already in the file, before packing
+		std::vector<size_t> m_sections; // where the length of each open section goes
+		bool m_pack;
+		std::string m_packed;          // a packed chunk on its way to the file
+		std::vector<SaveContainer::Patch> m_patches; // lengths for chunks already packed
 	};
 
 	class Reader {
 	public:
 		Reader();
+		// reads from a copy of the data
 		Reader(const std::string &data);
-		Reader(FILE *fptr);
+		// reads straight out of the file data, without copying it
+		Reader(const RefCountedPtr<FileSystem::FileData> &data);
 		bool AtEnd();
 		void Seek(int pos);
 		Uint8 Byte();
@@ -64,14 +97,8 @@ namespace Serializer {
 		std::string String();
 		vector3d Vector3d();
 		Quaternionf RdQuaternionf();
-		Reader RdSection(const std::string &section_label_expected) {
-			if (section_label_expected != String()) {
-				throw SavedGameCorruptException();
-			}
-			Reader section = Reader(String());
-			section.SetStreamVersion(StreamVersion());
-			return section;
-		}
+		// a reader for just the section, sharing this one's data
+		Reader RdSection(const std::string &section_label_expected);
 		/** Best not to use these except in templates */
 		void Auto(Sint32 *x) { *x = Int32(); }
 		void Auto(Sint64 *x) { *x = Int64(); }
@@ -80,7 +107,12 @@ namespace Serializer {
 		int StreamVersion() const { return m_streamVersion; }
 		void SetStreamVersion(int x) { m_streamVersion = x; }
 	private:
-		std::string m_data;
+		// throws SavedGameCorruptException if there aren't len bytes left
+		void Read(void *out, size_t len);
+
+		RefCountedPtr<RefCounted> m_owner; // keeps m_data alive
+		const char *m_data;
+		size_t m_size;
 		size_t m_pos;
 		int m_streamVersion;
 	};
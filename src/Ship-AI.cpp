@@ -85,6 +85,8 @@ bool Ship::AITimeStep(float timeStep)
 
 void Ship::AIClearInstructions()
 {
+	// it's about to be given something else to do
+	LeaveRails();
 	if (!m_curAICmd) return;
 
 	delete m_curAICmd;		// rely on destructor to kill children
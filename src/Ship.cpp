@@ -219,6 +219,8 @@ Ship::Ship(ShipType::Id shipId): DynamicBody(),
 	m_curAICmd = 0;
 	m_aiMessage = AIERROR_NONE;
 	m_decelerating = false;
+	m_onRails = false;
+	m_railsEnd = 0.0;
 	m_equipment.onChange.connect(sigc::mem_fun(this, &Ship::OnEquipmentChange));
 
 	Init();
@@ -501,10 +503,10 @@ static float distance_to_system(const SystemPath &dest)
 	assert(here.HasValidSystem());
 	assert(dest.HasValidSystem());
 
-	Sector sec1(here.sectorX, here.sectorY, here.sectorZ);
-	Sector sec2(dest.sectorX, dest.sectorY, dest.sectorZ);
+	RefCountedPtr<Sector> sec1 = Sector::GetCached(here);
+	RefCountedPtr<Sector> sec2 = Sector::GetCached(dest);
 
-	return Sector::DistanceBetween(&sec1, here.systemIndex, &sec2, dest.systemIndex);
+	return Sector::DistanceBetween(sec1.Get(), here.systemIndex, sec2.Get(), dest.systemIndex);
 }
 
 Ship::HyperjumpStatus Ship::GetHyperspaceDetails(const SystemPath &dest, int &outFuelRequired, double &outDurationSecs)
@@ -730,6 +732,11 @@ void Ship::TestLanded()
 
 void Ship::TimeStepUpdate(const float timeStep)
 {
+	if (m_onRails) {
+		if (MoveOnRails(timeStep)) return;
+		LeaveRails();
+	}
+
 	// If docked, station is responsible for updating position/orient of ship
 	// but we call this crap anyway and hope it doesn't do anything bad
 
@@ -748,6 +755,59 @@ void Ship::TimeStepUpdate(const float timeStep)
 		static_cast<SceneGraph::Model*>(GetModel())->UpdateAnimations(timeStep);
 }
 
+bool Ship::IsCoasting() const
+{
+	if (m_flightState != FLYING || IsDead() || IsType(Object::MISSILE)) return false;
+	if (m_hyperspace.countdown > 0.0f || m_hyperspace.now) return false;
+	if (m_launchLockTimeout > 0.0f || m_wheelTransition || m_testLanded) return false;
+
+	// any thrust at all, even the AI holding a course against gravity, is
+	// something the orbit doesn't allow for. a little turning to tidy up
+	// its heading doesn't change where it goes
+	if (m_thrusters.LengthSqr() > 0.0 || m_angThrusters.LengthSqr() > 1e-4) return false;
+	if (GetAngVelocity().LengthSqr() > 1e-6) return false;
+
+	// anything still recharging or cooling would be left behind
+	for (int i=0; i<ShipType::GUNMOUNT_MAX; i++)
+		if (m_gunState[i] || m_gunRecharge[i] > 0.0f || m_gunTemperature[i] > 0.0f) return false;
+	if (m_ecmRecharge > 0.0f) return false;
+	if (m_stats.shield_mass_left < m_stats.shield_mass) return false;
+	if (m_equipment.Get(Equip::SLOT_HULLAUTOREPAIR) == Equip::HULL_AUTOREPAIR &&
+		m_stats.hull_mass_left < float(GetShipType().hullMass)) return false;
+
+	// only gravity acts in non-rotating frames, so the orbit is exact. well
+	// away from the body and the edge of the frame, where things happen
+	const Frame *f = GetFrame();
+	if (!f || f->IsRotFrame()) return false;
+	const double dist = GetPosition().Length();
+	if (dist > f->GetRadius()) return false;
+	const Body *body = f->GetBody();
+	if (body && dist < 2.0 * body->GetPhysRadius()) return false;
+
+	if (m_curAICmd) return m_curAICmd->GetCoastTime() > 0.0;
+	return true;
+}
+
+double Ship::GetCoastTime() const
+{
+	return m_curAICmd ? m_curAICmd->GetCoastTime() : DBL_MAX;
+}
+
+void Ship::GoOnRails(double railsEnd)
+{
+	m_onRails = true;
+	m_railsEnd = railsEnd;
+}
+
+void Ship::LeaveRails()
+{
+	if (!m_onRails) return;
+	m_onRails = false;
+	m_railsEnd = 0.0;
+	// the external force is from where it went on rails
+	CalcExternalForce();
+}
+
 void Ship::DoThrusterSounds() const
 {
 	// XXX any ship being the current camera body should emit sounds
@@ -956,6 +1016,14 @@ void Ship::StaticUpdate(const float timeStep)
 
 	if (IsDead()) return;
 
+	// while it's coasting there's nothing here to do, AI included: ships
+	// only go on rails until their AI command wants to act again (see
+	// AICommand::GetCoastTime), and any new command takes them off
+	if (m_onRails) {
+		if (IsCoasting()) return;
+		LeaveRails();
+	}
+
 	if (m_controller) m_controller->StaticUpdate(timeStep);
 
 	if (GetHullTemperature() > 1.0)
@@ -1078,9 +1146,9 @@ void Ship::StaticUpdate(const float timeStep)
 	}
 }
 
-void Ship::NotifyRemoved(const Body* const removedBody)
+void Ship::NotifyRemoved(const BodyBatch &removed)
 {
-	if (m_curAICmd) m_curAICmd->OnDeleted(removedBody);
+	if (m_curAICmd) m_curAICmd->OnDeleted(removed);
 }
 
 bool Ship::Undock()
@@ -99,11 +99,23 @@ public:
 	virtual void TimeStepUpdate(const float timeStep);
 	virtual void StaticUpdate(const float timeStep);
 
+	// distant ships that are only coasting are moved along their orbits
+	// instead of being simulated, see Space::UpdateShipRails()
+	bool IsOnRails() const { return m_onRails; }
+	// true if nothing but falling would happen to the ship over a step
+	bool IsCoasting() const;
+	// how long the ship can coast before its AI needs to act again
+	double GetCoastTime() const;
+	// stays on rails until the game time reaches railsEnd, at most
+	void GoOnRails(double railsEnd);
+	double GetRailsEnd() const { return m_railsEnd; }
+	void LeaveRails();
+
 	void TimeAccelAdjust(const float timeStep);
 	void SetDecelerating(bool decel) { m_decelerating = decel; }
 	bool IsDecelerating() const { return m_decelerating; }
 
-	virtual void NotifyRemoved(const Body* const removedBody);
+	virtual void NotifyRemoved(const BodyBatch &removed);
 	virtual bool OnCollision(Object *o, Uint32 flags, double relVel);
 	virtual bool OnDamage(Object *attacker, float kgDamage);
 
@@ -315,6 +327,9 @@ private:
 	int m_dockedWithIndex; // deserialisation
 
 	SceneGraph::Animation *m_landingGearAnimation;
+
+	bool m_onRails;
+	double m_railsEnd;
 };
 
 
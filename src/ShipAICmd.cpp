@@ -665,6 +665,7 @@ extern double calc_ivel(double dist, double vel, double acc);
 AICmdFlyTo::AICmdFlyTo(Ship *ship, Body *target) : AICommand(ship, CMD_FLYTO)
 {
 	m_frame = 0; m_state = -6; m_lockhead = true; m_endvel = 0; m_tangent = false;
+	m_coastTime = 0.0;
 	if (!target->IsType(Object::TERRAINBODY)) m_dist = VICINITY_MIN;
 	else m_dist = VICINITY_MUL*MaxEffectRad(target, ship);
 
@@ -687,10 +688,12 @@ AICmdFlyTo::AICmdFlyTo(Ship *ship, Frame *targframe, const vector3d &posoff, dou
 	m_endvel = endvel;
 	m_tangent = tangent;
 	m_frame = 0; m_state = -6; m_lockhead = true;
+	m_coastTime = 0.0;
 }
 
 bool AICmdFlyTo::TimeStepUpdate()
 {
+	m_coastTime = 0.0;
 	if (!m_target && !m_targframe) return true;			// deleted object
 
 	// sort out gear, launching
@@ -812,6 +815,14 @@ printf("Autopilot dist = %.1f, speed = %.1f, zthrust = %.2f, state = %i\n",
 		std::max(sdiff, -m_ship->GetAccelFwd()*timestep) :
 		std::min(sdiff, m_ship->GetAccelFwd()*timestep);
 
+	// cruising at the speed the fuel allows towards a fixed point, with
+	// nothing to do until it's time to slow down. half that time is left for
+	// drift before looking again
+	if (!m_target && linaccel == 0.0 && perpspeed < 1.0 && curspeed > 0.0 && maxdecel > 0.0) {
+		const double brakingDist = curspeed*curspeed / (2.0*maxdecel);
+		if (targdist > brakingDist) m_coastTime = 0.5 * (targdist - brakingDist) / curspeed;
+	}
+
 	// linear thrust application, decel check
 	vector3d vdiff = linaccel*reldir + perpspeed*perpdir;
 	bool decel = sdiff <= 0;
@@ -28,6 +28,9 @@ public:
 		if (m_child) m_child->GetStatusText(str);
 		else strcpy(str, "AI state unknown");
 	}
+	// how long the ship can be left to coast before the command needs to
+	// act again. 0 unless the command is just waiting
+	virtual double GetCoastTime() const { return 0.0; }
 
 	// Serialisation functions
 	static AICommand *Load(Serializer::Reader &rd);
@@ -36,7 +39,7 @@ public:
 	virtual void PostLoadFixup(Space *space);
 
 	// Signal functions
-	virtual void OnDeleted(const Body *body) { if (m_child) m_child->OnDeleted(body); }
+	virtual void OnDeleted(const BodyBatch &removed) { if (m_child) m_child->OnDeleted(removed); }
 
 protected:
 	CmdName m_cmdName;
@@ -71,9 +74,9 @@ public:
 		AICommand::PostLoadFixup(space);
 		m_target = static_cast<SpaceStation *>(space->GetBodyByIndex(m_targetIndex));
 	}
-	virtual void OnDeleted(const Body *body) {
-		AICommand::OnDeleted(body);
-		if (static_cast<Body *>(m_target) == body) m_target = 0;
+	virtual void OnDeleted(const BodyBatch &removed) {
+		AICommand::OnDeleted(removed);
+		if (removed.Contains(m_target)) m_target = 0;
 	}
 private:
 	SpaceStation *m_target;
@@ -97,6 +100,7 @@ public:
 		else snprintf(str, 255, "FlyTo: %s, dist %.1fkm, endvel %.1fkm/s, state %i",
 			m_targframe->GetLabel().c_str(), m_posoff.Length()/1000.0, m_endvel/1000.0, m_state);
 	}
+	virtual double GetCoastTime() const { return m_child ? 0.0 : m_coastTime; }
 	virtual void Save(Serializer::Writer &wr) {
 		if(m_child) { delete m_child; m_child = 0; }
 		AICommand::Save(wr);
@@ -116,6 +120,7 @@ public:
 		m_endvel = rd.Double();
 		m_tangent = rd.Bool();
 		m_state = rd.Int32();
+		m_coastTime = 0.0;
 	}
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
@@ -123,9 +128,9 @@ public:
 		m_targframe = space->GetFrameByIndex(m_targframeIndex);
 		m_lockhead = true;
 	}
-	virtual void OnDeleted(const Body *body) {
-		AICommand::OnDeleted(body);
-		if (m_target == body) m_target = 0;
+	virtual void OnDeleted(const BodyBatch &removed) {
+		AICommand::OnDeleted(removed);
+		if (removed.Contains(m_target)) m_target = 0;
 	}
 
 private:
@@ -141,6 +146,7 @@ private:
 	int m_targetIndex, m_targframeIndex;	// used during deserialisation
 	vector3d m_reldir;	// target direction relative to ship at last frame change
 	Frame *m_frame;		// last frame of ship
+	double m_coastTime;	// how long until it needs to act again, 0 if now
 };
 
 
@@ -169,8 +175,8 @@ public:
 		AICommand::PostLoadFixup(space);
 		m_obstructor = space->GetBodyByIndex(m_obstructorIndex);
 	}
-	virtual void OnDeleted(const Body *body) {
-		AICommand::OnDeleted(body);
+	virtual void OnDeleted(const BodyBatch &removed) {
+		AICommand::OnDeleted(removed);
 		// check against obstructor?
 	}
 	void SetTargPos(const vector3d &targpos) { m_targpos = targpos; m_targmode = 0; }
@@ -212,9 +218,9 @@ public:
 		m_lastVel = m_target->GetVelocity();
 	}
 
-	virtual void OnDeleted(const Body *body) {
-		if (static_cast<Body *>(m_target) == body) m_target = 0;
-		AICommand::OnDeleted(body);
+	virtual void OnDeleted(const BodyBatch &removed) {
+		if (removed.Contains(m_target)) m_target = 0;
+		AICommand::OnDeleted(removed);
 	}
 
 private:
@@ -244,9 +250,9 @@ public:
 		m_target = space->GetBodyByIndex(m_targetIndex);
 	}
 
-	virtual void OnDeleted(const Body *body) {
-		if (static_cast<Body *>(m_target) == body) m_target = 0;
-		AICommand::OnDeleted(body);
+	virtual void OnDeleted(const BodyBatch &removed) {
+		if (removed.Contains(m_target)) m_target = 0;
+		AICommand::OnDeleted(removed);
 	}
 
 private:
@@ -285,9 +291,9 @@ public:
 		AICommand::PostLoadFixup(space);
 		m_target = static_cast<Ship*>(space->GetBodyByIndex(m_targetIndex));
 	}
-	virtual void OnDeleted(const Body *body) {
-		if (static_cast<Body *>(m_target) == body) m_target = 0;
-		AICommand::OnDeleted(body);
+	virtual void OnDeleted(const BodyBatch &removed) {
+		if (removed.Contains(m_target)) m_target = 0;
+		AICommand::OnDeleted(removed);
 	}
 
 private:
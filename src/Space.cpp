@@ -24,6 +24,40 @@
 #include "Game.h"
 #include "MathUtil.h"
 #include "LuaEvent.h"
+#include "ModelBody.h"
+#include "JobQueue.h"
+#include "OS.h"
+
+// collision detection is spread over at most this many worker threads. each
+// one needs its own contact recording function, see RecordContact below
+#define MAX_COLLISION_THREADS 8
+
+static JobQueue *s_collisionJobs = 0;
+
+// ships further than this from the player may be put on rails, 0 for never
+static double s_railsDistance = 0.0;
+
+void Space::Init()
+{
+	int numThreads = Pi::config->Int("CollisionThreads");
+	if (numThreads <= 0)
+		numThreads = OS::GetNumCPUs();
+	numThreads = std::min(numThreads, MAX_COLLISION_THREADS);
+
+	// with only one thread it's cheaper to collide directly
+	if (numThreads > 1)
+		s_collisionJobs = new JobQueue(numThreads);
+
+	s_railsDistance = std::max(Pi::config->Float("ShipRailsDistance"), 0.0f) * 1000.0;
+
+	DynamicBody::SetForceMode(DynamicBody::ForceMode(Clamp(Pi::config->Int("BatchedForces"), 0, 2)));
+}
+
+void Space::Uninit()
+{
+	delete s_collisionJobs;
+	s_collisionJobs = 0;
+}
 
 Space::Space(Game *game)
 	: m_game(game)
@@ -86,14 +120,14 @@ Space::Space(Game *game, Serializer::Reader &rd)
 	RebuildBodyIndex();
 
 	Frame::PostUnserializeFixup(m_rootFrame.Get(), this);
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		(*i)->PostLoadFixup(this);
 }
 
 Space::~Space()
 {
 	UpdateBodies(); // make sure anything waiting to be removed gets removed before we go and kill everything else
-	for (std::list<Body*>::iterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		KillBody(*i);
 	UpdateBodies();
 }
@@ -106,12 +140,12 @@ void Space::Serialize(Serializer::Writer &wr)
 
 	StarSystem::Serialize(wr, m_starSystem.Get());
 
-	Serializer::Writer section;
-	Frame::Serialize(section, m_rootFrame.Get(), this);
-	wr.WrSection("Frames", section.GetData());
+	wr.BeginSection("Frames");
+	Frame::Serialize(wr, m_rootFrame.Get(), this);
+	wr.EndSection();
 
 	wr.Int32(m_bodies.size());
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		(*i)->Serialize(wr, this);
 }
 
@@ -139,8 +173,8 @@ SystemBody *Space::GetSystemBodyByIndex(Uint32 idx) const
 Uint32 Space::GetIndexForFrame(const Frame *frame) const
 {
 	assert(m_frameIndexValid);
-	for (Uint32 i = 0; i < m_frameIndex.size(); i++)
-		if (m_frameIndex[i] == frame) return i;
+	std::map<const Frame*,Uint32>::const_iterator i = m_frameIndexLookup.find(frame);
+	if (i != m_frameIndexLookup.end()) return i->second;
 	assert(0);
 	return Uint32(-1);
 }
@@ -148,8 +182,8 @@ Uint32 Space::GetIndexForFrame(const Frame *frame) const
 Uint32 Space::GetIndexForBody(const Body *body) const
 {
 	assert(m_bodyIndexValid);
-	for (Uint32 i = 0; i < m_bodyIndex.size(); i++)
-		if (m_bodyIndex[i] == body) return i;
+	std::map<const Body*,Uint32>::const_iterator i = m_bodyIndexLookup.find(body);
+	if (i != m_bodyIndexLookup.end()) return i->second;
 	assert(0);
 	return Uint32(-1);
 }
@@ -157,8 +191,8 @@ Uint32 Space::GetIndexForBody(const Body *body) const
 Uint32 Space::GetIndexForSystemBody(const SystemBody *sbody) const
 {
 	assert(m_sbodyIndexValid);
-	for (Uint32 i = 0; i < m_sbodyIndex.size(); i++)
-		if (m_sbodyIndex[i] == sbody) return i;
+	std::map<const SystemBody*,Uint32>::const_iterator i = m_sbodyIndexLookup.find(sbody);
+	if (i != m_sbodyIndexLookup.end()) return i->second;
 	assert(0);
 	return Uint32(-1);
 }
@@ -166,6 +200,7 @@ Uint32 Space::GetIndexForSystemBody(const SystemBody *sbody) const
 void Space::AddFrameToIndex(Frame *frame)
 {
 	assert(frame);
+	m_frameIndexLookup[frame] = m_frameIndex.size();
 	m_frameIndex.push_back(frame);
 	for (Frame::ChildIterator it = frame->BeginChildren(); it != frame->EndChildren(); ++it)
 		AddFrameToIndex(*it);
@@ -174,6 +209,7 @@ void Space::AddFrameToIndex(Frame *frame)
 void Space::AddSystemBodyToIndex(SystemBody *sbody)
 {
 	assert(sbody);
+	m_sbodyIndexLookup[sbody] = m_sbodyIndex.size();
 	m_sbodyIndex.push_back(sbody);
 	for (Uint32 i = 0; i < sbody->children.size(); i++)
 		AddSystemBodyToIndex(sbody->children[i]);
@@ -182,6 +218,8 @@ void Space::AddSystemBodyToIndex(SystemBody *sbody)
 void Space::RebuildFrameIndex()
 {
 	m_frameIndex.clear();
+	m_frameIndexLookup.clear();
+	m_frameIndexLookup[0] = 0;
 	m_frameIndex.push_back(0);
 
 	if (m_rootFrame)
@@ -195,7 +233,7 @@ void Space::RebuildBodyIndex()
 	m_bodyIndex.clear();
 	m_bodyIndex.push_back(0);
 
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i) {
 		m_bodyIndex.push_back(*i);
 		// also index ships inside clouds
 		// XXX we should not have to know about this. move indexing grunt work
@@ -206,12 +244,18 @@ void Space::RebuildBodyIndex()
 		}
 	}
 
+	m_bodyIndexLookup.clear();
+	for (Uint32 i = 0; i < m_bodyIndex.size(); i++)
+		m_bodyIndexLookup.insert(std::make_pair(m_bodyIndex[i], i));
+
 	m_bodyIndexValid = true;
 }
 
 void Space::RebuildSystemBodyIndex()
 {
 	m_sbodyIndex.clear();
+	m_sbodyIndexLookup.clear();
+	m_sbodyIndexLookup[0] = 0;
 	m_sbodyIndex.push_back(0);
 
 	if (m_starSystem)
@@ -259,11 +303,11 @@ vector3d Space::GetHyperspaceExitPoint(const SystemPath &source) const
 
 	const SystemPath &dest = m_starSystem->GetPath();
 
-	Sector source_sec(source.sectorX, source.sectorY, source.sectorZ);
-	Sector dest_sec(dest.sectorX, dest.sectorY, dest.sectorZ);
+	RefCountedPtr<Sector> source_sec = Sector::GetCached(source);
+	RefCountedPtr<Sector> dest_sec = Sector::GetCached(dest);
 
-	Sector::System source_sys = source_sec.m_systems[source.systemIndex];
-	Sector::System dest_sys = dest_sec.m_systems[dest.systemIndex];
+	const Sector::System &source_sys = source_sec->m_systems[source.systemIndex];
+	const Sector::System &dest_sys = dest_sec->m_systems[dest.systemIndex];
 
 	const vector3d sourcePos = vector3d(source_sys.p) + vector3d(source.sectorX, source.sectorY, source.sectorZ);
 	const vector3d destPos = vector3d(dest_sys.p) + vector3d(dest.sectorX, dest.sectorY, dest.sectorZ);
@@ -285,21 +329,55 @@ vector3d Space::GetHyperspaceExitPoint(const SystemPath &source) const
 	return pos + primary->GetPositionRelTo(GetRootFrame());
 }
 
-Body *Space::FindNearestTo(const Body *b, Object::Type t) const
+// what proximity queries see of the caller's filter
+class LiveBodyFilter : public SpatialIndex::Filter {
+public:
+	LiveBodyFilter(const SpatialIndex::Filter &filter, const Body *exclude) : m_filter(filter), m_exclude(exclude) {}
+	virtual bool Accept(const Body *b) const {
+		return b != m_exclude && !b->IsDead() && m_filter.Accept(b);
+	}
+private:
+	const SpatialIndex::Filter &m_filter;
+	const Body *m_exclude;
+};
+
+void Space::FindNearBodies(const Body *b, size_t maxCount, double maxDist, const SpatialIndex::Filter &filter, bool includeSelf, std::vector<SpatialIndex::Result> &results) const
 {
-	Body *nearest = 0;
-	double dist = FLT_MAX;
-	for (std::list<Body*>::const_iterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
-		if ((*i)->IsDead()) continue;
-		if ((*i)->IsType(t)) {
-			double d = (*i)->GetPositionRelTo(b).Length();
-			if (d < dist) {
-				dist = d;
-				nearest = *i;
-			}
+	if (!m_spatialIndex.IsValid())
+		m_spatialIndex.Build(m_bodies, m_rootFrame.Get());
+
+	const LiveBodyFilter liveFilter(filter, includeSelf ? 0 : b);
+	const vector3d pos = b->GetPositionRelTo(m_rootFrame.Get());
+	m_spatialIndex.Find(pos, maxCount, maxDist, liveFilter, results);
+
+	// bodies added since the index was built
+	if (m_spatialIndex.GetNumBodies() < m_bodies.size()) {
+		const double maxDistSqr = maxDist*maxDist;
+		for (size_t i = m_spatialIndex.GetNumBodies(); i < m_bodies.size(); i++) {
+			Body *other = m_bodies[i];
+			const double distSqr = (other->GetPositionRelTo(m_rootFrame.Get()) - pos).LengthSqr();
+			if (distSqr <= maxDistSqr && liveFilter.Accept(other))
+				results.push_back(SpatialIndex::Result(other, distSqr));
 		}
+		std::sort(results.begin(), results.end());
+		if (maxCount && results.size() > maxCount)
+			results.resize(maxCount, results.back());
 	}
-	return nearest;
+}
+
+Body *Space::FindNearestTo(const Body *b, Object::Type t) const
+{
+	std::vector<SpatialIndex::Result> results;
+	FindNearBodies(b, 1, FLT_MAX, SpatialIndex::TypeFilter(t), true, results);
+	return results.empty() ? 0 : results[0].body;
+}
+
+void Space::FindBodiesNear(const Body *b, size_t maxCount, double maxDist, const SpatialIndex::Filter &filter, std::vector<Body*> &bodies) const
+{
+	std::vector<SpatialIndex::Result> results;
+	FindNearBodies(b, maxCount, maxDist, filter, false, results);
+	for (std::vector<SpatialIndex::Result>::const_iterator i = results.begin(); i != results.end(); ++i)
+		bodies.push_back(i->body);
 }
 
 Body *Space::FindBodyForPath(const SystemPath *path) const
@@ -309,7 +387,7 @@ Body *Space::FindBodyForPath(const SystemPath *path) const
 
 	if (!body) return 0;
 
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i) {
 		if ((*i)->GetSystemBody() == body) return *i;
 	}
 	return 0;
@@ -708,28 +786,207 @@ void Space::CollideFrame(Frame *f)
 		CollideFrame(*it);
 }
 
+// The collider reports contacts through a plain function pointer, so each
+// worker thread gets its own function that appends to whatever buffer that
+// thread is currently filling.
+static std::vector<CollisionContact> *s_threadContacts[MAX_COLLISION_THREADS];
+
+template <int N>
+static void RecordContact(CollisionContact *c)
+{
+	s_threadContacts[N]->push_back(*c);
+}
+
+static void (* const s_recordContact[MAX_COLLISION_THREADS])(CollisionContact*) = {
+	&RecordContact<0>, &RecordContact<1>, &RecordContact<2>, &RecordContact<3>,
+	&RecordContact<4>, &RecordContact<5>, &RecordContact<6>, &RecordContact<7>
+};
+
+class CollideFrameJob : public Job {
+public:
+	CollideFrameJob(CollisionSpace *space) : m_space(space) {}
+
+	virtual void Run(int threadNum) {
+		s_threadContacts[threadNum] = &m_contacts;
+		m_space->CollidePrepared(s_recordContact[threadNum]);
+	}
+
+	CollisionSpace *GetCollisionSpace() const { return m_space; }
+	const std::vector<CollisionContact> &GetContacts() const { return m_contacts; }
+
+private:
+	CollisionSpace *m_space;
+	std::vector<CollisionContact> m_contacts;
+};
+
+// same order as CollideFrame visits them
+static void AddCollideFrameJobs(Frame *f, std::vector<CollideFrameJob> &jobs)
+{
+	jobs.push_back(CollideFrameJob(f->GetCollisionSpace()));
+	for (Frame::ChildIterator it = f->BeginChildren(); it != f->EndChildren(); ++it)
+		AddCollideFrameJobs(*it, jobs);
+}
+
+// Handling an earlier contact can stop a body colliding (eg a ship touching
+// a docking pad). Colliding serially it would not have been tested against
+// anything after that, so its remaining contacts are dropped.
+static bool IsStillColliding(void *userData)
+{
+	Object *o = static_cast<Object*>(userData);
+	return !o || !o->IsType(Object::MODELBODY) || static_cast<ModelBody*>(o)->IsColliding();
+}
+
+void Space::CollideFrames()
+{
+	if (!s_collisionJobs) {
+		CollideFrame(m_rootFrame.Get());
+		return;
+	}
+
+	std::vector<CollideFrameJob> jobs;
+	AddCollideFrameJobs(m_rootFrame.Get(), jobs);
+
+	// tree updates are cheap next to the narrowphase, and doing them here
+	// keeps the collider's statistics single-threaded
+	for (std::vector<CollideFrameJob>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+		i->GetCollisionSpace()->RebuildObjectTrees();
+
+	for (std::vector<CollideFrameJob>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+		s_collisionJobs->Queue(&(*i));
+	s_collisionJobs->Finish();
+
+	// collision response happens back on the main thread, in the same
+	// order as if the frames had been collided one after the other
+	for (std::vector<CollideFrameJob>::iterator i = jobs.begin(); i != jobs.end(); ++i) {
+		const std::vector<CollisionContact> &contacts = i->GetContacts();
+		for (std::vector<CollisionContact>::const_iterator j = contacts.begin(); j != contacts.end(); ++j) {
+			if (!IsStillColliding(j->userData1) || !IsStillColliding(j->userData2)) continue;
+			CollisionContact c = *j;
+			hitCallback(&c);
+		}
+	}
+}
+
+static Space::TimeStepStats s_timeStepStats;
+
+// with time accelerated, ships that would only be falling anyway, far
+// enough from the player that nobody is watching closely, skip the
+// integrator and are moved along their orbits instead (see
+// Ship::IsCoasting). they come off again as they get near the player, when
+// their AI wants to act or when anything else happens to them
+void Space::UpdateShipRails()
+{
+	Player *player = m_game->GetPlayer();
+	if (!m_starSystem || !player || !player->GetFrame()) return;
+
+	// at normal speed the player may be watching anything, and the steps
+	// are short enough to simulate everyone
+	const bool useRails = s_railsDistance > 0.0 && m_game->GetTimeAccel() > Game::TIMEACCEL_1X;
+
+	const double now = m_game->GetTime();
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i) {
+		if (!(*i)->IsType(Object::SHIP) || *i == player) continue;
+		Ship *ship = static_cast<Ship*>(*i);
+		s_timeStepStats.shipSteps++;
+
+		if (!useRails) {
+			ship->LeaveRails();
+			continue;
+		}
+
+		// a bit of slack, so ships at the edge don't keep going on and off
+		const double dist = ship->GetPositionRelTo(player).Length();
+		if (ship->IsOnRails()) {
+			if (dist < 0.9 * s_railsDistance || now >= ship->GetRailsEnd() || !ship->IsCoasting())
+				ship->LeaveRails();
+		} else if (dist > s_railsDistance && ship->IsCoasting())
+			ship->GoOnRails(now + ship->GetCoastTime());
+
+		if (ship->IsOnRails()) s_timeStepStats.railsShipSteps++;
+	}
+}
+
+const Space::TimeStepStats &Space::GetTimeStepStats()
+{
+	return s_timeStepStats;
+}
+
+void Space::ClearTimeStepStats()
+{
+	memset(&s_timeStepStats, 0, sizeof(s_timeStepStats));
+}
+
+double Space::GetRailsDistance()
+{
+	return s_railsDistance;
+}
+
+void Space::SetRailsDistance(double dist)
+{
+	s_railsDistance = std::max(dist, 0.0);
+}
+
 void Space::TimeStep(float step)
 {
 	m_frameIndexValid = m_bodyIndexValid = m_sbodyIndexValid = false;
+	m_spatialIndex.Invalidate();
+
+	Uint64 phaseStart = OS::HFTimer(), phaseEnd;
 
 	// XXX does not need to be done this often
-	CollideFrame(m_rootFrame.Get());
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	CollideFrames();
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		CollideWithTerrain(*i);
 
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.collision += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
 	// update frames of reference
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		(*i)->UpdateFrame();
 
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.updateFrame += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
 	// AI acts here, then move all bodies and frames
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	UpdateShipRails();
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		(*i)->StaticUpdate(step);
 
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.staticUpdate += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
 	m_rootFrame->UpdateOrbitRails(m_game->GetTime(), m_game->GetTimeStep());
 
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.orbitRails += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
+	for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
 		(*i)->TimeStepUpdate(step);
 
+	// everything has moved
+	m_spatialIndex.Invalidate();
+
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.timeStepUpdate += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
+	if (DynamicBody::GetForceMode() != DynamicBody::FORCES_PER_BODY) {
+		m_pendingForceBodies.clear();
+		for (BodyIterator i = BodiesBegin(); i != BodiesEnd(); ++i)
+			if ((*i)->IsType(Object::DYNAMICBODY) && static_cast<DynamicBody*>(*i)->IsExternalForcePending())
+				m_pendingForceBodies.push_back(static_cast<DynamicBody*>(*i));
+		DynamicBody::CalcExternalForces(m_pendingForceBodies);
+
+		phaseEnd = OS::HFTimer();
+		s_timeStepStats.externalForces += phaseEnd - phaseStart;
+		phaseStart = phaseEnd;
+	}
+
 	// XXX don't emit events in hyperspace. this is mostly to maintain the
 	// status quo. in particular without this onEnterSystem will fire in the
 	// frame immediately before the player leaves hyperspace and the system is
@@ -740,29 +997,56 @@ void Space::TimeStep(float step)
 		Pi::luaTimer->Tick();
 	}
 
+	phaseEnd = OS::HFTimer();
+	s_timeStepStats.luaEvents += phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
 	UpdateBodies();
+
+	s_timeStepStats.updateBodies += OS::HFTimer() - phaseStart;
+	s_timeStepStats.steps++;
 }
 
+// matches bodies in a batch, for sweeping them out of the body list
+struct InBodyBatch {
+	InBodyBatch(const BodyBatch &batch) : m_batch(batch) {}
+	bool operator()(const Body *b) const { return m_batch.Contains(b); }
+	const BodyBatch &m_batch;
+};
+
 void Space::UpdateBodies()
 {
+	if (m_removeBodies.empty() && m_killBodies.empty()) return;
+
 #ifndef NDEBUG
 	m_processingFinalizationQueue = true;
 #endif
 
-	for (BodyIterator b = m_removeBodies.begin(); b != m_removeBodies.end(); ++b) {
+	BodyBatch removed;
+	for (std::vector<Body*>::iterator b = m_removeBodies.begin(); b != m_removeBodies.end(); ++b) {
 		(*b)->SetFrame(0);
-		for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-			(*i)->NotifyRemoved(*b);
-		m_bodies.remove(*b);
+		removed.Add(*b);
 	}
+	for (std::vector<Body*>::iterator b = m_killBodies.begin(); b != m_killBodies.end(); ++b)
+		removed.Add(*b);
+	removed.Sort();
+
+	m_spatialIndex.Invalidate();
+
+	// one pass over the bodies to take them all out
+	m_bodies.erase(std::remove_if(m_bodies.begin(), m_bodies.end(), InBodyBatch(removed)), m_bodies.end());
+
+	// then tell everyone who's left about them in one go. bodies that were
+	// only removed live on elsewhere (eg in hyperspace) so they need to know
+	// too
+	for (std::vector<Body*>::iterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+		(*i)->NotifyRemoved(removed);
+	for (std::vector<Body*>::iterator b = m_removeBodies.begin(); b != m_removeBodies.end(); ++b)
+		(*b)->NotifyRemoved(removed);
 	m_removeBodies.clear();
 
-	for (BodyIterator b = m_killBodies.begin(); b != m_killBodies.end(); ++b) {
-		for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-			(*i)->NotifyRemoved(*b);
-		m_bodies.remove(*b);
+	for (std::vector<Body*>::iterator b = m_killBodies.begin(); b != m_killBodies.end(); ++b)
 		delete *b;
-	}
 	m_killBodies.clear();
 
 #ifndef NDEBUG
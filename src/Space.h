@@ -4,17 +4,21 @@
 #ifndef _SPACE_H
 #define _SPACE_H
 
-#include <list>
+#include <vector>
+#include <map>
+#include <iterator>
 #include "Object.h"
 #include "vector3.h"
 #include "Serializer.h"
 #include "RefCounted.h"
 #include "galaxy/StarSystem.h"
 #include "Background.h"
+#include "SpatialIndex.h"
 
 class Body;
 class Frame;
 class Ship;
+class DynamicBody;
 class HyperspaceCloud;
 class Game;
 
@@ -31,6 +35,10 @@ public:
 
 	virtual ~Space();
 
+	// start and stop the worker threads used for collision detection
+	static void Init();
+	static void Uninit();
+
 	void Serialize(Serializer::Writer &wr);
 
 	// frame/body/sbody indexing for save/load. valid after
@@ -53,14 +61,58 @@ public:
 
 	void TimeStep(float step);
 
+	// time spent in each phase of TimeStep(), summed over all spaces since
+	// the last ClearTimeStepStats(). all times are OS::HFTimer() ticks
+	struct TimeStepStats {
+		Uint64 collision;      // frame and terrain collisions
+		Uint64 updateFrame;    // bodies changing frame
+		Uint64 staticUpdate;   // AI and forces
+		Uint64 orbitRails;     // frames moving along their orbits
+		Uint64 timeStepUpdate; // integration
+		Uint64 externalForces; // batched gravity, drag and frame rotation
+		Uint64 luaEvents;      // queued events and timers
+		Uint64 updateBodies;   // removing dead bodies
+		int steps;
+		int shipSteps;         // ships stepped, on rails or not
+		int railsShipSteps;    // ships stepped along their orbits
+
+	};
+	static const TimeStepStats &GetTimeStepStats();
+	static void ClearTimeStepStats();
+
+	// ships further than this from the player may be put on rails with time
+	// accelerated, 0 for never. from ShipRailsDistance in the config
+	static double GetRailsDistance();
+	static void SetRailsDistance(double dist);
+
 	vector3d GetHyperspaceExitPoint(const SystemPath &source) const;
 
 	Body *FindNearestTo(const Body *b, Object::Type t) const;
+	// bodies other than b that pass the filter, nearest first. at most
+	// maxCount of them (0 for no limit), no further than maxDist
+	void FindBodiesNear(const Body *b, size_t maxCount, double maxDist, const SpatialIndex::Filter &filter, std::vector<Body*> &bodies) const;
 	Body *FindBodyForPath(const SystemPath *path) const;
 
-	typedef std::list<Body*>::const_iterator BodyIterator;
-	const BodyIterator BodiesBegin() const { return m_bodies.begin(); }
-	const BodyIterator BodiesEnd() const { return m_bodies.end(); }
+	// walks the bodies by position rather than by pointer, so it stays valid
+	// when bodies are added while iterating (eg a ship firing in its
+	// TimeStepUpdate); they'll be visited too. bodies are only ever taken
+	// out in UpdateBodies(), at the end of a step
+	class BodyIterator : public std::iterator<std::forward_iterator_tag, Body*> {
+	public:
+		BodyIterator() : m_bodies(0), m_pos(0) {}
+		Body *operator*() const { return (*m_bodies)[m_pos]; }
+		BodyIterator &operator++() { ++m_pos; return *this; }
+		BodyIterator operator++(int) { BodyIterator i(*this); ++m_pos; return i; }
+		bool operator==(const BodyIterator &other) const { return m_pos == other.m_pos; }
+		bool operator!=(const BodyIterator &other) const { return m_pos != other.m_pos; }
+	private:
+		friend class Space;
+		BodyIterator(const std::vector<Body*> *bodies, size_t pos) : m_bodies(bodies), m_pos(pos) {}
+		const std::vector<Body*> *m_bodies;
+		size_t m_pos;
+	};
+	const BodyIterator BodiesBegin() const { return BodyIterator(&m_bodies, 0); }
+	const BodyIterator BodiesEnd() const { return BodyIterator(&m_bodies, m_bodies.size()); }
 
 	Background::Container& GetBackground() { return m_background; }
 
@@ -71,7 +123,12 @@ private:
 
 	void UpdateBodies();
 
+	void FindNearBodies(const Body *b, size_t maxCount, double maxDist, const SpatialIndex::Filter &filter, bool includeSelf, std::vector<SpatialIndex::Result> &results) const;
+
 	void CollideFrame(Frame *f);
+	void CollideFrames();
+	// puts distant coasting ships on rails and takes them off again
+	void UpdateShipRails();
 
 	ScopedPtr<Frame> m_rootFrame;
 
@@ -80,11 +137,15 @@ private:
 	Game *m_game;
 
 	// all the bodies we know about
-	std::list<Body*> m_bodies;
+	std::vector<Body*> m_bodies;
 
 	// bodies that were removed/killed this timestep and need pruning at the end
-	std::list<Body*> m_removeBodies;
-	std::list<Body*> m_killBodies;
+	std::vector<Body*> m_removeBodies;
+	std::vector<Body*> m_killBodies;
+
+	// bodies waiting on their external force this timestep, kept to save
+	// allocating the list every step
+	std::vector<DynamicBody*> m_pendingForceBodies;
 
 	void RebuildFrameIndex();
 	void RebuildBodyIndex();
@@ -98,6 +159,17 @@ private:
 	std::vector<Body*>  m_bodyIndex;
 	std::vector<SystemBody*> m_sbodyIndex;
 
+	// reverse lookups for the above, so saving isn't quadratic in the
+	// number of cross-references
+	std::map<const Frame*,Uint32> m_frameIndexLookup;
+	std::map<const Body*,Uint32>  m_bodyIndexLookup;
+	std::map<const SystemBody*,Uint32> m_sbodyIndexLookup;
+
+	// body positions relative to the root frame, for proximity queries.
+	// built when first needed after bodies move or are removed. bodies
+	// added since are the ones past its end in m_bodies
+	mutable SpatialIndex m_spatialIndex;
+
 	//background (elements that are infinitely far away,
 	//e.g. starfield and milky way)
 	Background::Container m_background;
@@ -384,10 +384,10 @@ void SpaceStation::UpdateShipyard()
 	onShipsForSaleChanged.emit();
 }
 
-void SpaceStation::NotifyRemoved(const Body* const removedBody)
+void SpaceStation::NotifyRemoved(const BodyBatch &removed)
 {
 	for (int i=0; i<MAX_DOCKING_PORTS; i++) {
-		if (m_shipDocking[i].ship == removedBody) {
+		if (removed.Contains(m_shipDocking[i].ship)) {
 			m_shipDocking[i].ship = 0;
 		}
 	}
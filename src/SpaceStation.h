@@ -106,7 +106,7 @@ public:
 	void ReplaceShipOnSale(int idx, const ShipFlavour *with);
 	const std::vector<ShipFlavour> &GetShipsOnSale() const { return m_shipsOnSale; }
 	virtual void PostLoadFixup(Space *space);
-	virtual void NotifyRemoved(const Body* const removedBody);
+	virtual void NotifyRemoved(const BodyBatch &removed);
 
 	// should call Ship::Undock and Ship::SetDockedWith instead
 	// Returns true on success, false if permission denied
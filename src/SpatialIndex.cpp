@@ -0,0 +1,120 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SpatialIndex.h"
+#include "Body.h"
+#include <algorithm>
+
+bool SpatialIndex::TypeFilter::Accept(const Body *b) const
+{
+	return b->IsType(m_type);
+}
+
+struct EntryAxisLess {
+	EntryAxisLess(int axis) : m_axis(axis) {}
+	template <typename T> bool operator()(const T &a, const T &b) const { return a.pos[m_axis] < b.pos[m_axis]; }
+	int m_axis;
+};
+
+void SpatialIndex::Build(const std::vector<Body*> &bodies, const Frame *relTo)
+{
+	m_entries.resize(bodies.size());
+	m_axes.resize(bodies.size());
+	for (size_t i = 0; i < bodies.size(); i++) {
+		m_entries[i].body = bodies[i];
+		m_entries[i].pos = bodies[i]->GetPositionRelTo(relTo);
+	}
+
+	// each node is the median of its range along the range's widest axis
+	std::vector<std::pair<int,int> > ranges;
+	ranges.push_back(std::make_pair(0, int(m_entries.size())));
+	while (!ranges.empty()) {
+		const int lo = ranges.back().first, hi = ranges.back().second;
+		ranges.pop_back();
+		if (hi - lo < 1) continue;
+
+		vector3d min(m_entries[lo].pos), max(m_entries[lo].pos);
+		for (int i = lo+1; i < hi; i++) {
+			const vector3d &p = m_entries[i].pos;
+			min.x = std::min(min.x, p.x); max.x = std::max(max.x, p.x);
+			min.y = std::min(min.y, p.y); max.y = std::max(max.y, p.y);
+			min.z = std::min(min.z, p.z); max.z = std::max(max.z, p.z);
+		}
+		const vector3d extent = max - min;
+		int axis = 0;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		const int mid = (lo + hi) / 2;
+		std::nth_element(m_entries.begin() + lo, m_entries.begin() + mid, m_entries.begin() + hi, EntryAxisLess(axis));
+		m_axes[mid] = axis;
+
+		ranges.push_back(std::make_pair(lo, mid));
+		ranges.push_back(std::make_pair(mid+1, hi));
+	}
+
+	m_valid = true;
+}
+
+struct SpatialIndex::Query {
+	Query(const vector3d &pos_, size_t maxCount_, double maxDist, const Filter &filter_, std::vector<Result> &results_) :
+		pos(pos_), maxCount(maxCount_), maxDistSqr(maxDist*maxDist), filter(filter_), results(results_) {}
+
+	// anything further away than this can't make it into the results
+	double Bound() const {
+		if (maxCount && results.size() == maxCount) return results.front().distSqr;
+		return maxDistSqr;
+	}
+
+	void Consider(Body *b, const vector3d &p) {
+		const double distSqr = (p - pos).LengthSqr();
+		if (distSqr > Bound()) return;
+		if (!filter.Accept(b)) return;
+		// results is a max-heap on distance while searching
+		if (maxCount && results.size() == maxCount) {
+			std::pop_heap(results.begin(), results.end());
+			results.pop_back();
+		}
+		results.push_back(Result(b, distSqr));
+		std::push_heap(results.begin(), results.end());
+	}
+
+	const vector3d pos;
+	const size_t maxCount;
+	const double maxDistSqr;
+	const Filter &filter;
+	std::vector<Result> &results;
+};
+
+void SpatialIndex::Search(int lo, int hi, Query &q) const
+{
+	while (lo < hi) {
+		const int mid = (lo + hi) / 2;
+		const Entry &e = m_entries[mid];
+		q.Consider(e.body, e.pos);
+
+		const int axis = m_axes[mid];
+		const double d = q.pos[axis] - e.pos[axis];
+
+		// near side first, so the far side is more likely to be culled.
+		// the far side is the loop's tail
+		int nearLo = lo, nearHi = mid, farLo = mid+1, farHi = hi;
+		if (d >= 0.0) {
+			std::swap(nearLo, farLo);
+			std::swap(nearHi, farHi);
+		}
+		Search(nearLo, nearHi, q);
+		if (d*d > q.Bound()) return;
+		lo = farLo;
+		hi = farHi;
+	}
+}
+
+void SpatialIndex::Find(const vector3d &pos, size_t maxCount, double maxDist, const Filter &filter, std::vector<Result> &out) const
+{
+	assert(m_valid);
+	assert(out.empty());
+	Query q(pos, maxCount, maxDist, filter, out);
+	Search(0, m_entries.size(), q);
+	std::sort_heap(out.begin(), out.end());
+}
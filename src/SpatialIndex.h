@@ -0,0 +1,69 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SPATIALINDEX_H
+#define _SPATIALINDEX_H
+
+#include "libs.h"
+#include "Object.h"
+
+class Body;
+class Frame;
+
+/*
+ * kd-tree of body positions, all relative to one frame, for nearest body and
+ * radius queries. The positions are a snapshot taken by Build(); it doesn't
+ * follow bodies as they move, so the owner has to rebuild it when they have.
+ */
+class SpatialIndex {
+public:
+	// decides which bodies a query can return
+	class Filter {
+	public:
+		virtual ~Filter() {}
+		virtual bool Accept(const Body *b) const = 0;
+	};
+
+	class TypeFilter : public Filter {
+	public:
+		TypeFilter(Object::Type type) : m_type(type) {}
+		virtual bool Accept(const Body *b) const;
+	private:
+		Object::Type m_type;
+	};
+
+	struct Result {
+		Result(Body *b, double d) : body(b), distSqr(d) {}
+		bool operator<(const Result &other) const { return distSqr < other.distSqr; }
+		Body *body;
+		double distSqr;
+	};
+
+	SpatialIndex() : m_valid(false) {}
+
+	void Build(const std::vector<Body*> &bodies, const Frame *relTo);
+	void Invalidate() { m_valid = false; }
+	bool IsValid() const { return m_valid; }
+	// number of bodies in the index; the first that many in the list it was built from
+	size_t GetNumBodies() const { return m_entries.size(); }
+
+	// Up to maxCount bodies (0 for no limit) no further than maxDist from pos,
+	// nearest first. Results are appended to out, which should be empty
+	void Find(const vector3d &pos, size_t maxCount, double maxDist, const Filter &filter, std::vector<Result> &out) const;
+
+private:
+	struct Entry {
+		Body *body;
+		vector3d pos;
+	};
+
+	struct Query;
+	void Search(int lo, int hi, Query &q) const;
+
+	std::vector<Entry> m_entries;
+	// split axis of the node at each position
+	std::vector<Uint8> m_axes;
+	bool m_valid;
+};
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+// Times the collision space object trees on a synthetic scene: clusters of
+// static buildings around a few sites, with a crowd of small ships moving
+// around them. Each split mode runs the same scene, so contact and hit
+// counts should match.
+
+#include "libs.h"
+#include "OS.h"
+#include "mtrand.h"
+#include "collider/collider.h"
+#include <cstdio>
+
+static const int NUM_SITES = 16;
+static const int NUM_BUILDINGS = 4000;
+static const int NUM_SHIPS = 2000;
+static const int NUM_STEPS = 200;
+static const int NUM_RAYS = 100000;
+static const double WORLD_SIZE = 50000.0;
+static const double SITE_SIZE = 5000.0;
+
+static int s_numContacts;
+
+static void ContactCallback(CollisionContact *c)
+{
+	s_numContacts++;
+}
+
+static GeomTree *MakeBox(float size)
+{
+	static int indices[] = {
+		0,1,2, 2,1,3, 4,6,5, 5,6,7,
+		0,4,1, 1,4,5, 2,3,6, 6,3,7,
+		0,2,4, 4,2,6, 1,5,3, 3,5,7
+	};
+	// GeomTree doesn't copy these, so they're left for the process to clean up
+	float *verts = new float[8*3];
+	for (int i = 0; i < 8; i++) {
+		verts[i*3+0] = (i & 1) ? size : -size;
+		verts[i*3+1] = (i & 2) ? size : -size;
+		verts[i*3+2] = (i & 4) ? size : -size;
+	}
+	unsigned int *flags = new unsigned int[12];
+	for (int i = 0; i < 12; i++) flags[i] = 0;
+	return new GeomTree(8, 12, verts, indices, flags);
+}
+
+static double Millisecs(Uint64 ticks)
+{
+	return 1000.0 * double(ticks) / double(OS::HFTimerFreq());
+}
+
+static vector3d RandomOffset(MTRand &rand, double size)
+{
+	return vector3d(rand.Double(-size, size), rand.Double(-size, size), rand.Double(-size, size));
+}
+
+static void RunScene(const char *name, GeomTree *buildingTree, GeomTree *shipTree)
+{
+	MTRand rand(1234);
+
+	std::vector<vector3d> sites;
+	for (int i = 0; i < NUM_SITES; i++)
+		sites.push_back(RandomOffset(rand, WORLD_SIZE));
+
+	CollisionSpace space;
+
+	std::vector<Geom*> buildings;
+	for (int i = 0; i < NUM_BUILDINGS; i++) {
+		Geom *g = new Geom(buildingTree);
+		g->MoveTo(matrix4x4d::Identity(), sites[i % NUM_SITES] + RandomOffset(rand, SITE_SIZE));
+		space.AddStaticGeom(g);
+		buildings.push_back(g);
+	}
+	space.RebuildObjectTrees();
+
+	// rays go before the ships are added, since dynamic geoms are traced
+	// one by one rather than through a tree
+	int numHits = 0;
+	const Uint64 rayStart = OS::HFTimer();
+	for (int i = 0; i < NUM_RAYS; i++) {
+		const vector3d from = sites[i % NUM_SITES] + RandomOffset(rand, 2.0*SITE_SIZE);
+		const vector3d dir = RandomOffset(rand, 1.0).Normalized();
+		CollisionContact c;
+		space.TraceRay(from, dir, 4.0*SITE_SIZE, &c);
+		if (c.triIdx != -1) numHits++;
+	}
+	const Uint64 rayTicks = OS::HFTimer() - rayStart;
+
+	std::vector<Geom*> ships;
+	std::vector<vector3d> pos, vel;
+	for (int i = 0; i < NUM_SHIPS; i++) {
+		Geom *g = new Geom(shipTree);
+		pos.push_back(sites[i % NUM_SITES] + RandomOffset(rand, SITE_SIZE));
+		vel.push_back(RandomOffset(rand, 20.0));
+		g->MoveTo(matrix4x4d::Identity(), pos.back());
+		space.AddGeom(g);
+		ships.push_back(g);
+	}
+
+	CollisionSpace::ClearTreeStats();
+	s_numContacts = 0;
+
+	Uint64 collideTicks = 0;
+	for (int step = 0; step < NUM_STEPS; step++) {
+		for (int i = 0; i < NUM_SHIPS; i++) {
+			pos[i] += vel[i];
+			ships[i]->MoveTo(matrix4x4d::Identity(), pos[i]);
+		}
+		const Uint64 start = OS::HFTimer();
+		space.Collide(&ContactCallback);
+		collideTicks += OS::HFTimer() - start;
+	}
+	const CollisionSpace::TreeStats &stats = CollisionSpace::GetTreeStats();
+
+	printf("%-8s rays:    %8.3f us/ray, %d hits\n",
+		name, 1000.0 * Millisecs(rayTicks) / NUM_RAYS, numHits);
+	printf("%-8s collide: %8.3f ms/step (tree update %.3f ms/step, %d rebuilds, %d re-splits), %d contacts\n",
+		name, Millisecs(collideTicks) / NUM_STEPS, Millisecs(stats.updateTime) / NUM_STEPS,
+		stats.rebuilds, stats.resplits, s_numContacts);
+
+	for (std::vector<Geom*>::iterator i = ships.begin(); i != ships.end(); ++i) {
+		space.RemoveGeom(*i);
+		delete *i;
+	}
+	for (std::vector<Geom*>::iterator i = buildings.begin(); i != buildings.end(); ++i) {
+		space.RemoveStaticGeom(*i);
+		delete *i;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	GeomTree *buildingTree = MakeBox(50.0f);
+	GeomTree *shipTree = MakeBox(20.0f);
+
+	printf("%d static geoms, %d dynamic geoms, %d steps, %d rays\n", NUM_BUILDINGS, NUM_SHIPS, NUM_STEPS, NUM_RAYS);
+
+	CollisionSpace::SetTreeSplitMode(CollisionSpace::SPLIT_MIDPOINT);
+	RunScene("midpoint", buildingTree, shipTree);
+
+	CollisionSpace::SetTreeSplitMode(CollisionSpace::SPLIT_SAH);
+	RunScene("sah", buildingTree, shipTree);
+
+	delete shipTree;
+	delete buildingTree;
+
+	return 0;
+}
@@ -5,44 +5,159 @@
 #include "Geom.h"
 #include "GeomTree.h"
 #include "../libs.h"
+#include "../OS.h"
+#include <algorithm>
 
-/* volnode!!!!!!!!!!! */
-struct BvhNode {
-	Aabb aabb;
+static CollisionSpace::TreeStats s_treeStats;
+static CollisionSpace::TreeSplitMode s_treeSplitMode = CollisionSpace::SPLIT_SAH;
+
+// float bounds must never be smaller than the double ones they came from
+static inline float RoundDown(double d)
+{
+	float f = float(d);
+	if (double(f) > d) f = float(d - fabs(d)*FLT_EPSILON);
+	return f;
+}
+
+static inline float RoundUp(double d)
+{
+	float f = float(d);
+	if (double(f) < d) f = float(d + fabs(d)*FLT_EPSILON);
+	return f;
+}
 
-	/* if geomStart == 0 then not leaf,
-	 * kids[] valid */
+/*
+ * Node of an object tree. Nodes are stored depth first in one flat array;
+ * an internal node's left child is always the next node. A subtree of n
+ * geoms owns exactly 2n-1 slots whatever its shape, so it can be split
+ * again in place, and its geoms are one contiguous range of m_geoms.
+ * Bounds are floats, rounded outwards, so a node fits in 32 bytes.
+ */
+struct BvhNode {
+	float min[3];
+	// internal: index of right child. leaf: index of first geom
+	int index;
+	float max[3];
+	// geoms in a leaf. 0 for internal nodes, -1 for unused slots
 	int numGeoms;
-	Geom **geomStart;
 
-	BvhNode *kids[2];
+	bool IsLeaf() const { return numGeoms > 0; }
 
-	BvhNode() {
-		kids[0] = 0;
-		geomStart = 0;
+	void SetAabb(const Aabb &aabb) {
+		min[0] = RoundDown(aabb.min.x); min[1] = RoundDown(aabb.min.y); min[2] = RoundDown(aabb.min.z);
+		max[0] = RoundUp(aabb.max.x); max[1] = RoundUp(aabb.max.y); max[2] = RoundUp(aabb.max.z);
 	}
 
-	bool CollideRay(const vector3d &start, const vector3d &invDir, isect_t *isect)
+	void SetUnion(const BvhNode &a, const BvhNode &b) {
+		for (int i=0; i<3; i++) {
+			min[i] = std::min(a.min[i], b.min[i]);
+			max[i] = std::max(a.max[i], b.max[i]);
+		}
+	}
+
+	double GetSurfaceArea() const {
+		const double dx = max[0]-min[0], dy = max[1]-min[1], dz = max[2]-min[2];
+		return 2.0 * (dx*dy + dy*dz + dz*dx);
+	}
+
+	bool Intersects(const Aabb &o) const {
+		return (min[0] < o.max.x) && (max[0] > o.min.x) &&
+			(min[1] < o.max.y) && (max[1] > o.min.y) &&
+			(min[2] < o.max.z) && (max[2] > o.min.z);
+	}
+
+	bool CollideRay(const vector3d &start, const vector3d &invDir, isect_t *isect) const
 	{
 		double
-                l1      = (aabb.min.x - start.x) * invDir.x,
-                l2      = (aabb.max.x - start.x) * invDir.x,
+                l1      = (min[0] - start.x) * invDir.x,
+                l2      = (max[0] - start.x) * invDir.x,
                 lmin    = std::min(l1,l2),
                 lmax    = std::max(l1,l2);
 
-		l1      = (aabb.min.y - start.y) * invDir.y;
-		l2      = (aabb.max.y - start.y) * invDir.y;
+		l1      = (min[1] - start.y) * invDir.y;
+		l2      = (max[1] - start.y) * invDir.y;
 		lmin    = std::max(std::min(l1,l2), lmin);
 		lmax    = std::min(std::max(l1,l2), lmax);
 
-		l1      = (aabb.min.z - start.z) * invDir.z;
-		l2      = (aabb.max.z - start.z) * invDir.z;
+		l1      = (min[2] - start.z) * invDir.z;
+		l2      = (max[2] - start.z) * invDir.z;
 		lmin    = std::max(std::min(l1,l2), lmin);
 		lmax    = std::min(std::max(l1,l2), lmax);
 
 		return ((lmax >= 0.f) & (lmax >= lmin) & (lmin < isect->dist));
 	}
+};
+
+// Only needed when building and refitting, so kept apart from the nodes
+// to keep those small.
+struct BvhNodeBuildInfo {
+	int firstGeom;
+	int numGeoms;
+	// surface area when this subtree was last split. refitting grows the
+	// box as geoms move; once it passes a multiple of this the split no
+	// longer fits the geoms and the subtree is split again
+	double buildArea;
+};
+
+// a refitted subtree is split again once its box has grown by this much
+#define BVH_RESPLIT_AREA_FACTOR 2.0
+
+// surface area heuristic. a node is split if visiting two children and
+// testing their geoms is expected to beat testing all its geoms directly
+#define SAH_NUM_BINS 12
+#define SAH_TRAVERSAL_COST 1.0
+#define SAH_GEOM_COST 2.0
+// split nodes with more geoms than this even if SAH prefers a leaf
+#define BVH_MAX_LEAF_GEOMS 4
+
+// geom bounding sphere, cached while building
+struct BvhBuildGeom {
+	Geom *geom;
+	vector3d pos;
+	double radius;
+};
+
+static inline void AddSphereToAabb(Aabb &aabb, const vector3d &pos, double radius)
+{
+	aabb.Update(pos + vector3d(radius,radius,radius));
+	aabb.Update(pos - vector3d(radius,radius,radius));
+}
+
+static inline double AabbSurfaceArea(const Aabb &aabb)
+{
+	const vector3d d = aabb.max - aabb.min;
+	return 2.0 * (d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+static inline void ClearAabb(Aabb &aabb)
+{
+	aabb.min = vector3d(FLT_MAX, FLT_MAX, FLT_MAX);
+	aabb.max = vector3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+struct BvhBinIndex {
+	BvhBinIndex(int axis, double min, double extent) :
+		m_axis(axis), m_min(min), m_scale(extent > 0.0 ? SAH_NUM_BINS / extent : 0.0) {}
+	int operator()(const BvhBuildGeom &g) const {
+		const int bin = int((g.pos[m_axis] - m_min) * m_scale);
+		return Clamp(bin, 0, SAH_NUM_BINS-1);
+	}
+	int m_axis;
+	double m_min, m_scale;
+};
 
+struct BvhBinBelow {
+	BvhBinBelow(const BvhBinIndex &binIndex, int splitBin) : m_binIndex(binIndex), m_splitBin(splitBin) {}
+	bool operator()(const BvhBuildGeom &g) const { return m_binIndex(g) < m_splitBin; }
+	BvhBinIndex m_binIndex;
+	int m_splitBin;
+};
+
+struct BvhBelowPivot {
+	BvhBelowPivot(int axis, double pivot) : m_axis(axis), m_pivot(pivot) {}
+	bool operator()(const BvhBuildGeom &g) const { return g.pos[m_axis] < m_pivot; }
+	int m_axis;
+	double m_pivot;
 };
 
 /*
@@ -51,64 +166,77 @@ struct BvhNode {
  */
 class BvhTree {
 public:
-	Geom **m_geoms;
-	BvhNode *m_root;
-	BvhNode *m_nodesAlloc;
-	int m_nodesAllocPos;
-	int m_nodesAllocMax;
-
-	BvhNode *AllocNode() {
-		assert(m_nodesAllocPos < m_nodesAllocMax);
-		return &m_nodesAlloc[m_nodesAllocPos++];
-	}
-
 	BvhTree(const std::list<Geom*> &geoms);
 	~BvhTree() {
-		if (m_geoms) delete [] m_geoms;
-		if (m_nodesAlloc) delete [] m_nodesAlloc;
+		delete [] m_geoms;
+		delete [] m_nodesAlloc;
 	}
 	void CollideGeom(Geom *, const Aabb &, int minMailboxValue, void (*callback)(CollisionContact*));
+	void TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c);
+
+	// Recompute node boxes from the current geom positions, keeping the
+	// tree shape. Subtrees whose boxes have grown too loose are split
+	// again in place.
+	void Refit();
 
 private:
-	void BuildNode(BvhNode *node, const std::list<Geom*> &a_geoms, int &outGeomPos);
+	void BuildSubtree(int nodeIdx, int firstGeom, int numGeoms);
+	void BuildNode(int nodeIdx, int firstGeom, int numGeoms);
+	int FindSAHSplit(int firstGeom, int numGeoms, const Aabb &centroids, double area);
+	int FindMidpointSplit(int firstGeom, int numGeoms, const Aabb &aabb);
+	void ResplitDegradedNodes();
+
+	int m_numGeoms;
+	Geom **m_geoms;
+
+	int m_numNodes;
+	BvhNode *m_nodes;
+	char *m_nodesAlloc;
+	std::vector<BvhNodeBuildInfo> m_buildInfo;
+
+	std::vector<BvhBuildGeom> m_buildGeoms;
+	std::vector<int> m_stack;
 };
 
 BvhTree::BvhTree(const std::list<Geom*> &geoms)
 {
+	m_numGeoms = geoms.size();
 	m_geoms = 0;
+	m_numNodes = 0;
+	m_nodes = 0;
 	m_nodesAlloc = 0;
-	int numGeoms = geoms.size();
-	if (numGeoms == 0) {
-		m_root = 0;
-		return;
-	}
-	m_geoms = new Geom*[numGeoms];
-	int geomPos = 0;
-	m_nodesAllocPos = 0;
-	m_nodesAllocMax = numGeoms*2;
-	m_nodesAlloc = new BvhNode[m_nodesAllocMax];
-	m_root = AllocNode();
-	BuildNode(m_root, geoms, geomPos);
-	assert(geomPos == numGeoms);
+	if (m_numGeoms == 0) return;
+
+	m_geoms = new Geom*[m_numGeoms];
+	std::copy(geoms.begin(), geoms.end(), m_geoms);
+
+	m_numNodes = 2*m_numGeoms - 1;
+	// a node per half cache line
+	m_nodesAlloc = new char[m_numNodes*sizeof(BvhNode) + 31];
+	m_nodes = reinterpret_cast<BvhNode*>((size_t(m_nodesAlloc) + 31) & ~size_t(31));
+	m_buildInfo.resize(m_numNodes);
+	m_buildGeoms.resize(m_numGeoms);
+
+	BuildSubtree(0, 0, m_numGeoms);
 }
 
 void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, void (*callback)(CollisionContact*))
 {
-	if (!m_root) return;
+	if (!m_nodes) return;
 
 	// our big aabb
 	vector3d pos = g->GetPosition();
 	double radius = g->GetGeomTree()->GetRadius();
 
-	int stackPos = -1;
-	BvhNode *stack[16];
-	BvhNode *node = m_root;
+	m_stack.clear();
+	int nodeIdx = 0;
 
 	for (;;) {
-		if (geomAabb.Intersects(node->aabb)) {
-			if (node->geomStart) {
-				for (int i=0; i<node->numGeoms; i++) {
-					Geom *g2 = node->geomStart[i];
+		const BvhNode &node = m_nodes[nodeIdx];
+		if (node.Intersects(geomAabb)) {
+			if (node.IsLeaf()) {
+				for (int i=0; i<node.numGeoms; i++) {
+					Geom *g2 = m_geoms[node.index + i];
 					if (!g2->IsEnabled()) continue;
 					if (g2->GetMailboxIndex() < minMailboxValue) continue;
 					if (g2 == g) continue;
@@ -119,37 +247,224 @@ void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, vo
 						g->Collide(g2, callback);
 					}
 				}
+			} else {
+				m_stack.push_back(node.index);
+				nodeIdx++;
+				continue;
 			}
-			else if (node->kids[0]) {
-				stack[++stackPos] = node->kids[0];
-				node = node->kids[1];
+		}
+
+		if (m_stack.empty()) break;
+		nodeIdx = m_stack.back();
+		m_stack.pop_back();
+	}
+}
+
+void BvhTree::TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c)
+{
+	if (!m_nodes) return;
+
+	vector3d invDir(1.0/dir.x, 1.0/dir.y, 1.0/dir.z);
+
+	m_stack.clear();
+	int nodeIdx = 0;
+
+	for (;;) {
+		const BvhNode &node = m_nodes[nodeIdx];
+
+		// do we hit it?
+		isect_t nodeIsect;
+		nodeIsect.dist = float(c->dist);
+		nodeIsect.triIdx = -1;
+		if (node.CollideRay(start, invDir, &nodeIsect)) {
+			if (node.IsLeaf()) {
+				// collide with all geoms
+				for (int i=0; i<node.numGeoms; i++) {
+					Geom *g = m_geoms[node.index + i];
+
+					const matrix4x4d &invTrans = g->GetInvTransform();
+					vector3d ms = invTrans * start;
+					vector3d md = invTrans.ApplyRotationOnly(dir);
+					vector3f modelStart = vector3f(ms.x, ms.y, ms.z);
+					vector3f modelDir = vector3f(md.x, md.y, md.z);
+
+					isect_t isect;
+					isect.dist = float(c->dist);
+					isect.triIdx = -1;
+					g->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
+					if (isect.triIdx != -1) {
+						c->pos = start + dir*double(isect.dist);
+
+						vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
+						c->normal = vector3d(n.x, n.y, n.z);
+						c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
+
+						c->depth = len - isect.dist;
+						c->triIdx = isect.triIdx;
+						c->userData1 = g->GetUserData();
+						c->userData2 = 0;
+						c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
+						c->dist = isect.dist;
+					}
+				}
+			} else {
+				m_stack.push_back(node.index);
+				nodeIdx++;
 				continue;
 			}
 		}
 
-		if (stackPos < 0) break;
-		node = stack[stackPos--];
+		if (m_stack.empty()) break;
+		nodeIdx = m_stack.back();
+		m_stack.pop_back();
 	}
 }
 
-void BvhTree::BuildNode(BvhNode *node, const std::list<Geom*> &a_geoms, int &outGeomPos)
+void BvhTree::BuildSubtree(int nodeIdx, int firstGeom, int numGeoms)
+{
+	// slots this subtree doesn't need stay marked unused
+	for (int i = nodeIdx; i < nodeIdx + 2*numGeoms - 1; i++)
+		m_nodes[i].numGeoms = -1;
+
+	for (int i = firstGeom; i < firstGeom + numGeoms; i++) {
+		BvhBuildGeom &bg = m_buildGeoms[i];
+		bg.geom = m_geoms[i];
+		bg.pos = m_geoms[i]->GetPosition();
+		bg.radius = m_geoms[i]->GetGeomTree()->GetRadius();
+	}
+
+	BuildNode(nodeIdx, firstGeom, numGeoms);
+
+	for (int i = firstGeom; i < firstGeom + numGeoms; i++)
+		m_geoms[i] = m_buildGeoms[i].geom;
+}
+
+void BvhTree::BuildNode(int nodeIdx, int firstGeom, int numGeoms)
 {
-	const int numGeoms = a_geoms.size();
 	// make aabb from spheres
 	// XXX suboptimal for static objects, as they have fixed rotation so
 	// we can use a precise rotated aabb rather than worst case XXX
-	Aabb aabb;
-	aabb.min = vector3d(FLT_MAX, FLT_MAX, FLT_MAX);
-	aabb.max = vector3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	Aabb aabb, centroids;
+	ClearAabb(aabb);
+	ClearAabb(centroids);
+	for (int i = firstGeom; i < firstGeom + numGeoms; i++) {
+		AddSphereToAabb(aabb, m_buildGeoms[i].pos, m_buildGeoms[i].radius);
+		centroids.Update(m_buildGeoms[i].pos);
+	}
+
+	BvhNode &node = m_nodes[nodeIdx];
+	node.SetAabb(aabb);
+
+	BvhNodeBuildInfo &info = m_buildInfo[nodeIdx];
+	info.firstGeom = firstGeom;
+	info.numGeoms = numGeoms;
+	info.buildArea = node.GetSurfaceArea();
+
+	int numLeft = 0;
+	if (numGeoms > 1) {
+		if (s_treeSplitMode == CollisionSpace::SPLIT_SAH)
+			numLeft = FindSAHSplit(firstGeom, numGeoms, centroids, AabbSurfaceArea(aabb));
+		else
+			numLeft = FindMidpointSplit(firstGeom, numGeoms, aabb);
+	}
+
+	if (numLeft == 0) {
+		node.index = firstGeom;
+		node.numGeoms = numGeoms;
+		return;
+	}
+
+	// left child is next, right child goes after the slots the left
+	// subtree owns
+	node.index = nodeIdx + 2*numLeft;
+	node.numGeoms = 0;
+
+	BuildNode(nodeIdx + 1, firstGeom, numLeft);
+	BuildNode(node.index, firstGeom + numLeft, numGeoms - numLeft);
+}
+
+// Binned SAH. Partitions the range and returns how many geoms went left, or
+// 0 if the node should be a leaf.
+int BvhTree::FindSAHSplit(int firstGeom, int numGeoms, const Aabb &centroids, double area)
+{
+	BvhBuildGeom *geoms = &m_buildGeoms[firstGeom];
+
+	double bestCost = SAH_GEOM_COST * numGeoms;
+	int bestAxis = -1, bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++) {
+		const double extent = centroids.max[axis] - centroids.min[axis];
+		if (extent <= 0.0) continue;
+		const BvhBinIndex binIndex(axis, centroids.min[axis], extent);
 
-	for (std::list<Geom*>::const_iterator i = a_geoms.begin();
-			i != a_geoms.end(); ++i) {
-		vector3d p = (*i)->GetPosition();
-		double rad = (*i)->GetGeomTree()->GetRadius();
-		aabb.Update(p + vector3d(rad,rad,rad));
-		aabb.Update(p - vector3d(rad,rad,rad));
+		Aabb binAabb[SAH_NUM_BINS];
+		int binCount[SAH_NUM_BINS];
+		for (int b = 0; b < SAH_NUM_BINS; b++) {
+			ClearAabb(binAabb[b]);
+			binCount[b] = 0;
+		}
+		for (int i = 0; i < numGeoms; i++) {
+			const int b = binIndex(geoms[i]);
+			AddSphereToAabb(binAabb[b], geoms[i].pos, geoms[i].radius);
+			binCount[b]++;
+		}
+
+		// cost of everything right of each split, sweeping from the right
+		double rightCost[SAH_NUM_BINS];
+		Aabb acc;
+		ClearAabb(acc);
+		int count = 0;
+		for (int b = SAH_NUM_BINS-1; b > 0; b--) {
+			if (binCount[b]) {
+				acc.Update(binAabb[b].min);
+				acc.Update(binAabb[b].max);
+				count += binCount[b];
+			}
+			rightCost[b] = count ? AabbSurfaceArea(acc) * count : 0.0;
+		}
+
+		ClearAabb(acc);
+		count = 0;
+		for (int b = 0; b < SAH_NUM_BINS-1; b++) {
+			if (binCount[b]) {
+				acc.Update(binAabb[b].min);
+				acc.Update(binAabb[b].max);
+				count += binCount[b];
+			}
+			// split between bin b and b+1
+			if (count == 0 || count == numGeoms) continue;
+			const double cost = SAH_TRAVERSAL_COST +
+				SAH_GEOM_COST * (AabbSurfaceArea(acc) * count + rightCost[b+1]) / area;
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b+1;
+			}
+		}
 	}
 
+	if (bestAxis < 0) {
+		// all centroids in one place, there's no useful split
+		if (numGeoms <= BVH_MAX_LEAF_GEOMS) return 0;
+		int axis = 0;
+		if (centroids.max.y - centroids.min.y > centroids.max[axis] - centroids.min[axis]) axis = 1;
+		if (centroids.max.z - centroids.min.z > centroids.max[axis] - centroids.min[axis]) axis = 2;
+		if (centroids.max[axis] - centroids.min[axis] <= 0.0) return 0;
+		bestAxis = axis;
+		bestBin = SAH_NUM_BINS/2;
+	}
+
+	const BvhBinIndex binIndex(bestAxis, centroids.min[bestAxis], centroids.max[bestAxis] - centroids.min[bestAxis]);
+	BvhBuildGeom *mid = std::partition(geoms, geoms + numGeoms, BvhBinBelow(binIndex, bestBin));
+	const int numLeft = int(mid - geoms);
+	return (numLeft == numGeoms) ? 0 : numLeft;
+}
+
+// The original splitter: halve the longest axis. Kept for comparison.
+int BvhTree::FindMidpointSplit(int firstGeom, int numGeoms, const Aabb &aabb)
+{
+	BvhBuildGeom *geoms = &m_buildGeoms[firstGeom];
+
 	// divide by longest axis
 	int axis;
 	const vector3d axislen = aabb.max - aabb.min;
@@ -158,37 +473,58 @@ void BvhTree::BuildNode(BvhNode *node, const std::list<Geom*> &a_geoms, int &out
 	else axis = 2;
 	const double pivot = 0.5*(aabb.max[axis] + aabb.min[axis]);
 
-	std::list<Geom*> side[2];
+	BvhBuildGeom *mid = std::partition(geoms, geoms + numGeoms, BvhBelowPivot(axis, pivot));
+	const int numLeft = int(mid - geoms);
+
+	// one side has all nodes. just make a fucking child
+	return (numLeft == numGeoms) ? 0 : numLeft;
+}
 
-	for (std::list<Geom*>::const_iterator i = a_geoms.begin();
-			i != a_geoms.end(); ++i) {
-		if ((*i)->GetPosition()[axis] < pivot) {
-			side[0].push_back(*i);
+void BvhTree::Refit()
+{
+	if (!m_nodes) return;
+
+	// children always come after their parent
+	for (int i = m_numNodes-1; i >= 0; i--) {
+		BvhNode &node = m_nodes[i];
+		if (node.numGeoms < 0) continue;
+		if (node.IsLeaf()) {
+			Aabb aabb;
+			ClearAabb(aabb);
+			for (int j = 0; j < node.numGeoms; j++) {
+				Geom *g = m_geoms[node.index + j];
+				AddSphereToAabb(aabb, g->GetPosition(), g->GetGeomTree()->GetRadius());
+			}
+			node.SetAabb(aabb);
 		} else {
-			side[1].push_back(*i);
+			node.SetUnion(m_nodes[i+1], m_nodes[node.index]);
 		}
 	}
 
-	node->numGeoms = numGeoms;
-	node->aabb = aabb;
+	ResplitDegradedNodes();
+}
 
-	// side 1 has all nodes. just make a fucking child
-	if ((side[0].size() == 0) || (side[1].size() == 0)) {
-		node->geomStart = &m_geoms[outGeomPos];
+void BvhTree::ResplitDegradedNodes()
+{
+	m_stack.clear();
+	int nodeIdx = 0;
 
-		// copy geoms to the stinking flat array
-		for (std::list<Geom*>::const_iterator i = a_geoms.begin();
-				i != a_geoms.end(); ++i) {
-			m_geoms[outGeomPos++] = *i;
+	for (;;) {
+		const BvhNode &node = m_nodes[nodeIdx];
+		const BvhNodeBuildInfo &info = m_buildInfo[nodeIdx];
+
+		if (info.numGeoms > 1 && node.GetSurfaceArea() > BVH_RESPLIT_AREA_FACTOR * info.buildArea) {
+			BuildSubtree(nodeIdx, info.firstGeom, info.numGeoms);
+			s_treeStats.resplits++;
+		} else if (!node.IsLeaf()) {
+			m_stack.push_back(node.index);
+			nodeIdx++;
+			continue;
 		}
-	} else {
-		// recurse!
-		node->geomStart = 0;
-		node->kids[0] = AllocNode();
-		node->kids[1] = AllocNode();
 
-		BuildNode(node->kids[0], side[0], outGeomPos);
-		BuildNode(node->kids[1], side[1], outGeomPos);
+		if (m_stack.empty()) break;
+		nodeIdx = m_stack.back();
+		m_stack.pop_back();
 	}
 }
 
@@ -200,6 +536,7 @@ CollisionSpace::CollisionSpace()
 {
 	sphere.radius = 0;
 	m_needStaticGeomRebuild = true;
+	m_needDynamicGeomRebuild = true;
 	m_staticObjectTree = 0;
 	m_dynamicObjectTree = 0;
 }
@@ -213,11 +550,13 @@ CollisionSpace::~CollisionSpace()
 void CollisionSpace::AddGeom(Geom *geom)
 {
 	m_geoms.push_back(geom);
+	m_needDynamicGeomRebuild = true;
 }
 
 void CollisionSpace::RemoveGeom(Geom *geom)
 {
 	m_geoms.remove(geom);
+	m_needDynamicGeomRebuild = true;
 }
 
 void CollisionSpace::AddStaticGeom(Geom *geom)
@@ -264,62 +603,9 @@ void CollisionSpace::CollideRaySphere(const vector3d &start, const vector3d &dir
 
 void CollisionSpace::TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c, Geom *ignore)
 {
-	vector3d invDir(1.0/dir.x, 1.0/dir.y, 1.0/dir.z);
 	c->dist = len;
 
-	BvhNode *vn_stack[16];
-	BvhNode *node = m_staticObjectTree->m_root;
-	int stackPos = -1;
-
-	for (;node;) {
-		// do we hit it?
-		{
-			isect_t isect;
-			isect.dist = float(c->dist);
-			isect.triIdx = -1;
-			if (!node->CollideRay(start, invDir, &isect)) goto pop_jizz;
-		}
-
-		if (node->geomStart) {
-			// it is a leaf node
-			// collide with all geoms
-			for (int i=0; i<node->numGeoms; i++) {
-				Geom *g = node->geomStart[i];
-
-				const matrix4x4d &invTrans = g->GetInvTransform();
-				vector3d ms = invTrans * start;
-				vector3d md = invTrans.ApplyRotationOnly(dir);
-				vector3f modelStart = vector3f(ms.x, ms.y, ms.z);
-				vector3f modelDir = vector3f(md.x, md.y, md.z);
-
-				isect_t isect;
-				isect.dist = float(c->dist);
-				isect.triIdx = -1;
-				g->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
-				if (isect.triIdx != -1) {
-					c->pos = start + dir*double(isect.dist);
-
-					vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
-					c->normal = vector3d(n.x, n.y, n.z);
-					c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
-
-					c->depth = len - isect.dist;
-					c->triIdx = isect.triIdx;
-					c->userData1 = g->GetUserData();
-					c->userData2 = 0;
-					c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
-					c->dist = isect.dist;
-				}
-			}
-		} else if (node->kids[0]) {
-			vn_stack[++stackPos] = node->kids[0];
-			node = node->kids[1];
-			continue;
-		}
-pop_jizz:
-		if (stackPos < 0) break;
-		node = vn_stack[stackPos--];
-	}
+	if (m_staticObjectTree) m_staticObjectTree->TraceRay(start, dir, len, c);
 
 	for (std::list<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i) {
 		if ((*i) == ignore) continue;
@@ -392,20 +678,55 @@ void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, void (*callback)
 
 void CollisionSpace::RebuildObjectTrees()
 {
+	const Uint64 startTime = OS::HFTimer();
+
 	if (m_needStaticGeomRebuild) {
 		if (m_staticObjectTree) delete m_staticObjectTree;
 		m_staticObjectTree = new BvhTree(m_staticGeoms);
 	}
-	if (m_dynamicObjectTree) delete m_dynamicObjectTree;
-	m_dynamicObjectTree = new BvhTree(m_geoms);
+
+	// dynamic geoms move every step but are rarely added or removed, so
+	// the same tree is refitted to their new positions until the set of
+	// geoms changes
+	if (m_needDynamicGeomRebuild || !m_dynamicObjectTree) {
+		if (m_dynamicObjectTree) delete m_dynamicObjectTree;
+		m_dynamicObjectTree = new BvhTree(m_geoms);
+		s_treeStats.rebuilds++;
+	} else {
+		m_dynamicObjectTree->Refit();
+	}
 
 	m_needStaticGeomRebuild = false;
+	m_needDynamicGeomRebuild = false;
+
+	s_treeStats.updateTime += OS::HFTimer() - startTime;
+}
+
+const CollisionSpace::TreeStats &CollisionSpace::GetTreeStats()
+{
+	return s_treeStats;
+}
+
+void CollisionSpace::SetTreeSplitMode(TreeSplitMode mode)
+{
+	s_treeSplitMode = mode;
+}
+
+void CollisionSpace::ClearTreeStats()
+{
+	s_treeStats.updateTime = 0;
+	s_treeStats.rebuilds = 0;
+	s_treeStats.resplits = 0;
 }
 
 void CollisionSpace::Collide(void (*callback)(CollisionContact*))
 {
 	RebuildObjectTrees();
+	CollidePrepared(callback);
+}
 
+void CollisionSpace::CollidePrepared(void (*callback)(CollisionContact*))
+{
 	int mailboxMin = 0;
 	for (std::list<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i) {
 		(*i)->SetMailboxIndex(mailboxMin++);
@@ -32,12 +32,32 @@ public:
 	void RemoveStaticGeom(Geom*);
 	void TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c, Geom *ignore = 0);
 	void Collide(void (*callback)(CollisionContact*));
+	// Collide() without updating the object trees first; call
+	// RebuildObjectTrees() beforehand. Only this space's geoms are modified,
+	// so separate spaces can be collided on separate threads.
+	void CollidePrepared(void (*callback)(CollisionContact*));
 	void SetSphere(const vector3d &pos, double radius, void *user_data) {
 		sphere.pos = pos; sphere.radius = radius; sphere.userData = user_data;
 	}
-	void FlagRebuildObjectTrees() { m_needStaticGeomRebuild = true; }
+	void FlagRebuildObjectTrees() { m_needStaticGeomRebuild = m_needDynamicGeomRebuild = true; }
 	void RebuildObjectTrees();
 
+	// cost of keeping the object trees up to date, summed over all
+	// collision spaces since the last ClearTreeStats()
+	struct TreeStats {
+		Uint64 updateTime; // OS::HFTimer() ticks
+		int rebuilds;      // dynamic trees built from scratch
+		int resplits;      // refitted subtrees that had to be split again
+	};
+	static const TreeStats &GetTreeStats();
+	static void ClearTreeStats();
+
+	// how object trees choose where to split. SAH gives better trees;
+	// midpoint is the old longest-axis split, kept for benchmarking.
+	// affects trees built after the call
+	enum TreeSplitMode { SPLIT_SAH, SPLIT_MIDPOINT };
+	static void SetTreeSplitMode(TreeSplitMode mode);
+
 	// Geoms with the same handle will not be collision tested against each other
 	// should be used for geoms that are part of the same body
 	// could also be used for autopiloted groups and LRCs near stations
@@ -49,6 +69,7 @@ private:
 	std::list<Geom*> m_geoms;
 	std::list<Geom*> m_staticGeoms;
 	bool m_needStaticGeomRebuild;
+	bool m_needDynamicGeomRebuild;
 	BvhTree *m_staticObjectTree;
 	BvhTree *m_dynamicObjectTree;
 	Sphere sphere;
@@ -10,6 +10,7 @@
 #include "LuaConstants.h"
 #include "Polit.h"
 #include "Factions.h"
+#include "Sector.h"
 #include "FileSystem.h"
 #include <map>
 
@@ -508,6 +509,9 @@ void CustomSystem::Init()
 
 	LUA_DEBUG_END(L, 0);
 	lua_close(L);
+
+	// anything generated before now is missing the custom systems
+	Sector::ShrinkCache();
 }
 
 void CustomSystem::Uninit()
@@ -4,6 +4,7 @@
 #include "libs.h"
 #include "Galaxy.h"
 #include "Sector.h"
+#include "SystemSummary.h"
 #include "Pi.h"
 #include "FileSystem.h"
 
@@ -18,6 +19,10 @@ static SDL_Surface *s_galaxybmp;
 
 void Init()
 {
+	Sector::Init();
+	StarSystem::Init();
+	SystemSummary::Init();
+
 	static const std::string filename("galaxy.bmp");
 
 	RefCountedPtr<FileSystem::FileData> filedata = FileSystem::gameDataFiles.ReadFile(filename);
@@ -37,6 +42,10 @@ void Init()
 void Uninit()
 {
 	if(s_galaxybmp) SDL_FreeSurface(s_galaxybmp);
+	SystemSummary::ShrinkCache();
+	StarSystem::Uninit();
+	SystemSummary::Uninit();
+	Sector::Uninit();
 }
 
 SDL_Surface *GetGalaxyBitmap()
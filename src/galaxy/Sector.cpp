@@ -8,6 +8,7 @@
 
 #include "Factions.h"
 #include "utils.h"
+#include <algorithm>
 
 #define SYS_NAME_FRAGS	32
 static const char *sys_names[SYS_NAME_FRAGS] =
@@ -17,6 +18,129 @@ static const char *sys_names[SYS_NAME_FRAGS] =
 
 const float Sector::SIZE = 8;
 
+// sectors that nobody is using are kept, up to this many, in case they're
+// wanted again
+static const size_t CACHE_SIZE = 1024;
+
+struct CachedSector {
+	CachedSector(Sector *s, Uint32 t) : sector(s), lastUse(t) {}
+	Sector *sector; // the cache owns one reference
+	Uint32 lastUse;
+};
+typedef std::map<SystemPath,CachedSector> SectorCacheMap;
+
+static SDL_mutex *s_cacheLock = 0;
+static SectorCacheMap s_cachedSectors;
+static Uint32 s_cacheClock;
+static size_t s_nextShrink;
+static Sector::CacheStats s_cacheStats;
+
+void Sector::Init()
+{
+	s_cacheLock = SDL_CreateMutex();
+	s_cacheClock = 0;
+	s_nextShrink = CACHE_SIZE;
+	ClearCacheStats();
+}
+
+void Sector::Uninit()
+{
+	for (SectorCacheMap::iterator i = s_cachedSectors.begin(); i != s_cachedSectors.end(); ++i)
+		i->second.sector->DecRefCount();
+	s_cachedSectors.clear();
+	SDL_DestroyMutex(s_cacheLock);
+	s_cacheLock = 0;
+}
+
+static bool CompareLastUse(const SectorCacheMap::iterator &a, const SectorCacheMap::iterator &b)
+{
+	return a->second.lastUse < b->second.lastUse;
+}
+
+// drop the least recently used unreferenced sectors until at most keep of
+// them are left. call with s_cacheLock held
+static void ShrinkCacheTo(size_t keep)
+{
+	std::vector<SectorCacheMap::iterator> unused;
+	for (SectorCacheMap::iterator i = s_cachedSectors.begin(); i != s_cachedSectors.end(); ++i)
+		if (i->second.sector->GetRefCount() == 1)
+			unused.push_back(i);
+
+	if (unused.size() > keep) {
+		const size_t numDrop = unused.size() - keep;
+		std::nth_element(unused.begin(), unused.begin() + numDrop, unused.end(), CompareLastUse);
+		for (size_t i = 0; i < numDrop; i++) {
+			unused[i]->second.sector->DecRefCount();
+			s_cachedSectors.erase(unused[i]);
+		}
+		s_cacheStats.evictions += numDrop;
+	}
+
+	// sectors that are in use don't count against the limit, so don't look
+	// again until a few more have been added
+	s_nextShrink = s_cachedSectors.size() + CACHE_SIZE / 4;
+}
+
+RefCountedPtr<Sector> Sector::GetCached(int x, int y, int z)
+{
+	const SystemPath path(x, y, z);
+
+	SDL_mutexP(s_cacheLock);
+	SectorCacheMap::iterator i = s_cachedSectors.find(path);
+	if (i != s_cachedSectors.end()) {
+		i->second.lastUse = ++s_cacheClock;
+		s_cacheStats.hits++;
+		RefCountedPtr<Sector> sec(i->second.sector);
+		SDL_mutexV(s_cacheLock);
+		return sec;
+	}
+	s_cacheStats.misses++;
+	SDL_mutexV(s_cacheLock);
+
+	// generate outside the lock so other threads can carry on using the
+	// cache meanwhile
+	Sector *newSec = new Sector(x, y, z);
+	newSec->AssignFactions();
+
+	SDL_mutexP(s_cacheLock);
+	std::pair<SectorCacheMap::iterator,bool> ret =
+		s_cachedSectors.insert(SectorCacheMap::value_type(path, CachedSector(newSec, ++s_cacheClock)));
+	if (ret.second)
+		newSec->IncRefCount();
+	else
+		// someone else generated it while we were
+		delete newSec;
+	RefCountedPtr<Sector> sec(ret.first->second.sector);
+	if (s_cachedSectors.size() > s_nextShrink)
+		ShrinkCacheTo(CACHE_SIZE);
+	SDL_mutexV(s_cacheLock);
+
+	return sec;
+}
+
+void Sector::ShrinkCache()
+{
+	SDL_mutexP(s_cacheLock);
+	ShrinkCacheTo(0);
+	SDL_mutexV(s_cacheLock);
+}
+
+Sector::CacheStats Sector::GetCacheStats()
+{
+	SDL_mutexP(s_cacheLock);
+	CacheStats stats = s_cacheStats;
+	stats.size = s_cachedSectors.size();
+	SDL_mutexV(s_cacheLock);
+	return stats;
+}
+
+void Sector::ClearCacheStats()
+{
+	SDL_mutexP(s_cacheLock);
+	memset(&s_cacheStats, 0, sizeof(s_cacheStats));
+	SDL_mutexV(s_cacheLock);
+}
+
 void Sector::GetCustomSystems()
 {
 	const std::vector<CustomSystem*> &systems = CustomSystem::GetCustomSystemsForSector(sx, sy, sz);
@@ -8,18 +8,40 @@
 #include "galaxy/SystemPath.h"
 #include "galaxy/StarSystem.h"
 #include "galaxy/CustomSystem.h"
+#include "RefCounted.h"
 #include <string>
 #include <vector>
 
 class Faction;
 
-class Sector {
+class Sector : public AtomicRefCounted {
 public:
 	// lightyears
 	static const float SIZE;
+	// generates the sector without factions. use GetCached() instead, unless
+	// the factions aren't set up yet
 	Sector(int x, int y, int z);
 	static float DistanceBetween(const Sector *a, int sysIdxA, const Sector *b, int sysIdxB);
 	static void Init();
+	static void Uninit();
+
+	// the shared copy of a sector, generated with factions assigned the
+	// first time it's asked for. may be called from any thread
+	static RefCountedPtr<Sector> GetCached(int x, int y, int z);
+	static RefCountedPtr<Sector> GetCached(const SystemPath &path) { return GetCached(path.sectorX, path.sectorY, path.sectorZ); }
+	// drop every cached sector nobody else is holding on to. sectors are
+	// also dropped, oldest first, when too many pile up
+	static void ShrinkCache();
+
+	struct CacheStats {
+		int hits;
+		int misses;
+		int evictions;
+		int size;
+	};
+	static CacheStats GetCacheStats();
+	// reset the counters (not the size)
+	static void ClearCacheStats();
 
 	// Sector is within a bounding rectangle - used for SectorView m_sectorCache pruning.
 	bool WithinBox(const int Xmin, const int Xmax, const int Ymin, const int Ymax, const int Zmin, const int Zmax) const;
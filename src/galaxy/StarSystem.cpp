@@ -12,6 +12,9 @@
 #include "utils.h"
 #include "Lang.h"
 #include "StringF.h"
+#include "JobQueue.h"
+#include "OS.h"
+#include <algorithm>
 
 #define CELSIUS	273.15
 //#define DEBUG_DUMP
@@ -454,62 +457,6 @@ static const struct StarTypeInfo {
 	}*/
 };
 
-SystemBody::BodySuperType SystemBody::GetSuperType() const
-{
-	switch (type) {
-		case TYPE_BROWN_DWARF:
-		case TYPE_WHITE_DWARF:
-		case TYPE_STAR_M:
-		case TYPE_STAR_K:
-		case TYPE_STAR_G:
-		case TYPE_STAR_F:
-		case TYPE_STAR_A:
-		case TYPE_STAR_B:
-		case TYPE_STAR_O:
-		case TYPE_STAR_M_GIANT:
-		case TYPE_STAR_K_GIANT:
-		case TYPE_STAR_G_GIANT:
-		case TYPE_STAR_F_GIANT:
-		case TYPE_STAR_A_GIANT:
-		case TYPE_STAR_B_GIANT:
-		case TYPE_STAR_O_GIANT:
-		case TYPE_STAR_M_SUPER_GIANT:
-		case TYPE_STAR_K_SUPER_GIANT:
-		case TYPE_STAR_G_SUPER_GIANT:
-		case TYPE_STAR_F_SUPER_GIANT:
-		case TYPE_STAR_A_SUPER_GIANT:
-		case TYPE_STAR_B_SUPER_GIANT:
-		case TYPE_STAR_O_SUPER_GIANT:
-		case TYPE_STAR_M_HYPER_GIANT:
-		case TYPE_STAR_K_HYPER_GIANT:
-		case TYPE_STAR_G_HYPER_GIANT:
-		case TYPE_STAR_F_HYPER_GIANT:
-		case TYPE_STAR_A_HYPER_GIANT:
-		case TYPE_STAR_B_HYPER_GIANT:
-		case TYPE_STAR_O_HYPER_GIANT:
-		case TYPE_STAR_M_WF:
-		case TYPE_STAR_B_WF:
-		case TYPE_STAR_O_WF:
-		case TYPE_STAR_S_BH:
-		case TYPE_STAR_IM_BH:
-		case TYPE_STAR_SM_BH:
-		     return SUPERTYPE_STAR;
-		case TYPE_PLANET_GAS_GIANT:
-		     return SUPERTYPE_GAS_GIANT;
-		case TYPE_PLANET_ASTEROID:
-		case TYPE_PLANET_TERRESTRIAL:
-		     return SUPERTYPE_ROCKY_PLANET;
-		case TYPE_STARPORT_ORBITAL:
-		case TYPE_STARPORT_SURFACE:
-		     return SUPERTYPE_STARPORT;
-		case TYPE_GRAVPOINT:
-             return SUPERTYPE_NONE;
-        default:
-             fprintf( stderr, "Warning: Invalid SuperBody Type found.\n");
-             return SUPERTYPE_NONE;
-	}
-}
-
 std::string SystemBody::GetAstroDescription() const
 {
 	switch (type) {
@@ -1143,15 +1090,6 @@ void StarSystem::MakeBinaryPair(SystemBody *a, SystemBody *b, fixed minDist, MTR
 	b->orbMax = orbMax;
 }
 
-SystemBody::SystemBody()
-{
-	heightMapFilename = 0;
-	heightMapFractal = 0;
-	rotationalPhaseAtStart = fixed(0);
-	orbitalPhaseAtStart = fixed(0);
-	isCustomBody = false;
-}
-
 bool SystemBody::HasAtmosphere() const
 {
 	return (m_volatileGas > fixed(1,100));
@@ -1373,12 +1311,13 @@ StarSystem::StarSystem(const SystemPath &path) : m_path(path)
 	memset(m_tradeLevel, 0, sizeof(m_tradeLevel));
 	rootBody = 0;
 
-	Sector s = Sector(m_path.sectorX, m_path.sectorY, m_path.sectorZ);
+	RefCountedPtr<Sector> sec = Sector::GetCached(m_path);
+	const Sector &s = *sec;
 	assert(m_path.systemIndex >= 0 && m_path.systemIndex < s.m_systems.size());
 
 	m_seed    = s.m_systems[m_path.systemIndex].seed;
 	m_name    = s.m_systems[m_path.systemIndex].name;
-	m_faction = Faction::GetNearestFaction(s, m_path.systemIndex);
+	m_faction = s.m_systems[m_path.systemIndex].faction;
 
 	unsigned long _init[6] = { m_path.systemIndex, Uint32(m_path.sectorX), Uint32(m_path.sectorY), Uint32(m_path.sectorZ), UNIVERSE_SEED, Uint32(m_seed) };
 	MTRand rand(_init, 6);
@@ -2023,9 +1962,8 @@ void SystemBody::PopulateStage1(StarSystem *system, fixed &outTotalPop)
 	unsigned long _init[6] = { system->m_path.systemIndex, Uint32(system->m_path.sectorX),
 			Uint32(system->m_path.sectorY), Uint32(system->m_path.sectorZ), UNIVERSE_SEED, Uint32(this->seed) };
 
-	MTRand rand, namerand;
+	MTRand rand;
 	rand.seed(_init, 6);
-	namerand.seed(_init, 6);
 
 	m_population = fixed(0);
 
@@ -2106,7 +2044,7 @@ void SystemBody::PopulateStage1(StarSystem *system, fixed &outTotalPop)
 	}
 
 	if (!system->m_hasCustomBodies && m_population > 0)
-		name = Pi::luaNameGen->BodyName(this, namerand);
+		system->AddUnnamedBodies(_init).push_back(this);
 
 	// Add a bunch of things people consume
 	for (int i=0; i<NUM_CONSUMABLES; i++) {
@@ -2140,12 +2078,13 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 	unsigned long _init[6] = { system->m_path.systemIndex, Uint32(system->m_path.sectorX),
 			Uint32(system->m_path.sectorY), Uint32(system->m_path.sectorZ), this->seed, UNIVERSE_SEED };
 
-	MTRand rand, namerand;
+	MTRand rand;
 	rand.seed(_init, 6);
-	namerand.seed(_init, 6);
 
 	if (m_population < fixed(1,1000)) return;
 
+	std::vector<SystemBody*> &unnamed = system->AddUnnamedBodies(_init);
+
 	fixed pop = m_population + rand.Fixed();
 
 	fixed orbMaxS = fixed(1,4)*this->CalcHillRadius();
@@ -2177,7 +2116,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 		sp->orbMin = sp->semiMajorAxis;
 		sp->orbMax = sp->semiMajorAxis;
 
-		sp->name = Pi::luaNameGen->BodyName(sp, namerand);
+		unnamed.push_back(sp);
 
 		pop -= rand.Fixed();
 		if (pop > 0) {
@@ -2186,7 +2125,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 			*sp2 = *sp;
 			sp2->path = path2;
 			sp2->orbit.rotMatrix = matrix3x3d::RotateZ(M_PI);
-			sp2->name = Pi::luaNameGen->BodyName(sp2, namerand);
+			unnamed.push_back(sp2);
 			children.insert(children.begin(), sp2);
 			system->m_spaceStations.push_back(sp2);
 		}
@@ -2205,7 +2144,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 		sp->parent = this;
 		sp->averageTemp = this->averageTemp;
 		sp->mass = 0;
-		sp->name = Pi::luaNameGen->BodyName(sp, namerand);
+		unnamed.push_back(sp);
 		memset(&sp->orbit, 0, sizeof(Orbit));
 		position_settlement_on_planet(sp);
 		children.insert(children.begin(), sp);
@@ -2218,13 +2157,6 @@ StarSystem::~StarSystem()
 	if (rootBody) delete rootBody;
 }
 
-SystemBody::~SystemBody()
-{
-	for (std::vector<SystemBody*>::iterator i = children.begin(); i != children.end(); ++i) {
-		delete (*i);
-	}
-}
-
 void StarSystem::Serialize(Serializer::Writer &wr, StarSystem *s)
 {
 	if (s) {
@@ -2251,38 +2183,378 @@ RefCountedPtr<StarSystem> StarSystem::Unserialize(Serializer::Reader &rd)
 	}
 }
 
-typedef std::map<SystemPath,StarSystem*> SystemCacheMap;
+std::vector<SystemBody*> &StarSystem::AddUnnamedBodies(const unsigned long seed[6])
+{
+	m_unnamedBodies.push_back(UnnamedBodies());
+	std::copy(seed, seed+6, m_unnamedBodies.back().seed);
+	return m_unnamedBodies.back().bodies;
+}
+
+void StarSystem::NameBodies()
+{
+	for (std::vector<UnnamedBodies>::iterator i = m_unnamedBodies.begin(); i != m_unnamedBodies.end(); ++i) {
+		MTRand namerand;
+		namerand.seed(i->seed, 6);
+		for (std::vector<SystemBody*>::iterator j = i->bodies.begin(); j != i->bodies.end(); ++j)
+			(*j)->name = Pi::luaNameGen->BodyName(*j, namerand);
+	}
+	m_unnamedBodies.clear();
+}
+
+// the cache holds one reference to each system. systems nobody else is
+// using are kept until they take up more than the budget
+struct CachedSystem {
+	CachedSystem(StarSystem *s, Uint32 t, size_t b) : system(s), lastUse(t), bytes(b) {}
+	StarSystem *system;
+	Uint32 lastUse;
+	size_t bytes;
+};
+typedef std::map<SystemPath,CachedSystem> SystemCacheMap;
+
 static SystemCacheMap s_cachedSystems;
+static Uint32 s_cacheClock;
+static size_t s_cacheBytes;
+static size_t s_cacheBudget;
+static size_t s_nextShrink;
+static StarSystem::CacheStats s_cacheStats;
+
+// rough size of a system, for the budget
+static size_t SystemMemoryUsage(const StarSystem *s)
+{
+	size_t bytes = sizeof(StarSystem) + (s->m_bodies.capacity() + s->m_spaceStations.capacity()) * sizeof(SystemBody*);
+	for (std::vector<SystemBody*>::const_iterator i = s->m_bodies.begin(); i != s->m_bodies.end(); ++i)
+		bytes += sizeof(SystemBody) + (*i)->name.capacity() + (*i)->children.capacity() * sizeof(SystemBody*);
+	return bytes;
+}
+
+static bool CompareLastUse(const SystemCacheMap::iterator &a, const SystemCacheMap::iterator &b)
+{
+	return a->second.lastUse < b->second.lastUse;
+}
+
+// drop the least recently used systems nobody else is holding on to until
+// the cache takes up no more than budget
+static void ShrinkCacheTo(size_t budget)
+{
+	std::vector<SystemCacheMap::iterator> unused;
+	for (SystemCacheMap::iterator i = s_cachedSystems.begin(); i != s_cachedSystems.end(); ++i) {
+		assert(i->second.system->GetRefCount() >= 1); // sanity check
+		// if the cache is the only owner, it can go
+		if (i->second.system->GetRefCount() == 1)
+			unused.push_back(i);
+	}
+
+	std::sort(unused.begin(), unused.end(), CompareLastUse);
+	for (std::vector<SystemCacheMap::iterator>::iterator i = unused.begin(); i != unused.end() && s_cacheBytes > budget; ++i) {
+		s_cacheBytes -= (*i)->second.bytes;
+		(*i)->second.system->DecRefCount();
+		s_cachedSystems.erase(*i);
+		s_cacheStats.evictions++;
+	}
+
+	// if the systems still in use are over the budget by themselves, don't
+	// look again until a few more have come in
+	s_nextShrink = std::max(s_cacheBudget, s_cacheBytes + s_cacheBudget / 4);
+}
+
+static void AddToCache(const SystemPath &path, StarSystem *s)
+{
+	const size_t bytes = SystemMemoryUsage(s);
+	s->IncRefCount(); // the cache owns one reference
+	s_cachedSystems.insert(SystemCacheMap::value_type(path, CachedSystem(s, ++s_cacheClock, bytes)));
+	s_cacheBytes += bytes;
+
+	if (s_cacheBytes > s_nextShrink)
+		ShrinkCacheTo(s_cacheBudget);
+}
+
+// a system being generated in the background. the job is owned by the main
+// thread, which deletes it once it's been collected
+class StarSystemPrefetchJob : public Job {
+public:
+	enum State {
+		QUEUED,
+		RUNNING,
+		DONE,
+		CANCELLED
+	};
+
+	StarSystemPrefetchJob(const SystemPath &path) : m_path(path), m_system(0), m_state(QUEUED) {}
+	virtual void Run(int threadNum);
+
+	const SystemPath &GetPath() const { return m_path; }
+	StarSystem *GetSystem() const { return m_system; }
+	// these need s_prefetchLock held
+	State GetState() const { return m_state; }
+	void Cancel() { assert(m_state == QUEUED); m_state = CANCELLED; }
+
+private:
+	SystemPath m_path;
+	StarSystem *m_system;
+	State m_state;
+};
+
+typedef std::map<SystemPath,StarSystemPrefetchJob*> PrefetchJobMap;
+
+static JobQueue *s_prefetchJobs = 0;
+static SDL_mutex *s_prefetchLock = 0;        // protects the rest of these and the job states
+static SDL_cond *s_prefetchDone = 0;         // signalled when a job finishes
+static PrefetchJobMap s_pendingJobs;         // queued or running, by path
+static std::vector<StarSystemPrefetchJob*> s_finishedJobs; // done or cancelled, waiting to be collected
+
+void StarSystemPrefetchJob::Run(int threadNum)
+{
+	SDL_mutexP(s_prefetchLock);
+	if (m_state == CANCELLED) {
+		s_finishedJobs.push_back(this);
+		SDL_mutexV(s_prefetchLock);
+		return;
+	}
+	m_state = RUNNING;
+	SDL_mutexV(s_prefetchLock);
+
+	// everything the constructor needs is either read-only once the game is
+	// up or safe to share (the sector cache), except the body names, which
+	// wait for the main thread
+	m_system = new StarSystem(m_path);
+
+	SDL_mutexP(s_prefetchLock);
+	m_state = DONE;
+	s_finishedJobs.push_back(this);
+	SDL_CondBroadcast(s_prefetchDone);
+	SDL_mutexV(s_prefetchLock);
+}
+
+void StarSystem::UpdatePrefetch()
+{
+	if (!s_prefetchJobs) return;
+
+	std::vector<StarSystemPrefetchJob*> finished;
+	SDL_mutexP(s_prefetchLock);
+	finished.swap(s_finishedJobs);
+	for (std::vector<StarSystemPrefetchJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		// cancelled jobs were taken off the list when they were cancelled
+		if ((*i)->GetState() == StarSystemPrefetchJob::DONE)
+			s_pendingJobs.erase((*i)->GetPath());
+	}
+	SDL_mutexV(s_prefetchLock);
+
+	for (std::vector<StarSystemPrefetchJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		StarSystem *s = (*i)->GetSystem();
+		if (s) {
+			assert(s_cachedSystems.find((*i)->GetPath()) == s_cachedSystems.end());
+			s->NameBodies();
+			AddToCache((*i)->GetPath(), s);
+			s_cacheStats.prefetched++;
+		}
+		delete *i;
+	}
+}
+
+void StarSystem::Init()
+{
+	s_cacheBudget = size_t(std::max(Pi::config->Int("SystemCacheSize"), 0)) * 1024 * 1024;
+	s_nextShrink = s_cacheBudget;
+	ClearCacheStats();
+
+	int numThreads = Pi::config->Int("SystemThreads");
+	if (numThreads <= 0 || s_cacheBudget == 0)
+		return;
+
+	s_prefetchLock = SDL_CreateMutex();
+	s_prefetchDone = SDL_CreateCond();
+	s_prefetchJobs = new JobQueue(std::min(numThreads, OS::GetNumCPUs()));
+}
+
+void StarSystem::Uninit()
+{
+	if (s_prefetchJobs) {
+		CancelPrefetch();
+		s_prefetchJobs->Finish();
+		delete s_prefetchJobs;
+		s_prefetchJobs = 0;
+
+		// not worth naming them now
+		for (std::vector<StarSystemPrefetchJob*>::iterator i = s_finishedJobs.begin(); i != s_finishedJobs.end(); ++i) {
+			delete (*i)->GetSystem();
+			delete *i;
+		}
+		s_finishedJobs.clear();
+		s_pendingJobs.clear();
+
+		SDL_DestroyCond(s_prefetchDone);
+		SDL_DestroyMutex(s_prefetchLock);
+		s_prefetchDone = 0;
+		s_prefetchLock = 0;
+	}
+
+	for (SystemCacheMap::iterator i = s_cachedSystems.begin(); i != s_cachedSystems.end(); ++i)
+		i->second.system->DecRefCount();
+	s_cachedSystems.clear();
+	s_cacheBytes = 0;
+}
 
 RefCountedPtr<StarSystem> StarSystem::GetCached(const SystemPath &path)
 {
-	SystemPath sysPath(path.SystemOnly());
-
-	StarSystem *s = 0;
-	std::pair<SystemCacheMap::iterator, bool>
-		ret = s_cachedSystems.insert(SystemCacheMap::value_type(sysPath, static_cast<StarSystem*>(0)));
-	if (ret.second) {
-		s = new StarSystem(sysPath);
-		ret.first->second = s;
-		s->IncRefCount(); // the cache owns one reference
-	} else {
-		s = ret.first->second;
+	const SystemPath sysPath(path.SystemOnly());
+
+	UpdatePrefetch();
+
+	SystemCacheMap::iterator i = s_cachedSystems.find(sysPath);
+	if (i == s_cachedSystems.end() && s_prefetchJobs) {
+		// it might be on its way. if it's already being generated, wait for
+		// it. if it hasn't been started yet it's quicker to do it here
+		bool waited = false;
+		SDL_mutexP(s_prefetchLock);
+		PrefetchJobMap::iterator job = s_pendingJobs.find(sysPath);
+		if (job != s_pendingJobs.end()) {
+			if (job->second->GetState() == StarSystemPrefetchJob::QUEUED) {
+				job->second->Cancel();
+				s_pendingJobs.erase(job);
+			} else {
+				while (job->second->GetState() == StarSystemPrefetchJob::RUNNING)
+					SDL_CondWait(s_prefetchDone, s_prefetchLock);
+				waited = true;
+			}
+		}
+		SDL_mutexV(s_prefetchLock);
+
+		if (waited) {
+			UpdatePrefetch();
+			i = s_cachedSystems.find(sysPath);
+		}
+	}
+
+	if (i != s_cachedSystems.end()) {
+		i->second.lastUse = ++s_cacheClock;
+		s_cacheStats.hits++;
+		return RefCountedPtr<StarSystem>(i->second.system);
 	}
+
+	s_cacheStats.misses++;
+	StarSystem *s = new StarSystem(sysPath);
+	s->NameBodies();
+	AddToCache(sysPath, s);
 	return RefCountedPtr<StarSystem>(s);
 }
 
+RefCountedPtr<StarSystem> StarSystem::FindCached(const SystemPath &path)
+{
+	const SystemPath sysPath(path.SystemOnly());
+
+	UpdatePrefetch();
+
+	SystemCacheMap::iterator i = s_cachedSystems.find(sysPath);
+	if (i == s_cachedSystems.end())
+		return RefCountedPtr<StarSystem>();
+
+	i->second.lastUse = ++s_cacheClock;
+	s_cacheStats.hits++;
+	return RefCountedPtr<StarSystem>(i->second.system);
+}
+
+RefCountedPtr<StarSystem> StarSystem::GenerateUncached(const SystemPath &path)
+{
+	return RefCountedPtr<StarSystem>(new StarSystem(path.SystemOnly()));
+}
+
+JobQueue *StarSystem::GetPrefetchQueue()
+{
+	return s_prefetchJobs;
+}
+
+struct PrefetchCandidate {
+	PrefetchCandidate(const SystemPath &p, float d) : path(p), dist(d) {}
+	SystemPath path;
+	float dist;
+	bool operator<(const PrefetchCandidate &b) const { return dist < b.dist; }
+};
+
+void StarSystem::PrefetchNear(const SystemPath &centre, float range, int maxSystems)
+{
+	if (!s_prefetchJobs) return;
+
+	UpdatePrefetch();
+
+	RefCountedPtr<Sector> here = Sector::GetCached(centre);
+	if (!centre.IsSystemPath() || centre.systemIndex >= here->m_systems.size())
+		return;
+	const int diff = int(ceilf(range / Sector::SIZE));
+
+	std::vector<PrefetchCandidate> candidates;
+	for (int x = centre.sectorX-diff; x <= centre.sectorX+diff; x++) {
+		for (int y = centre.sectorY-diff; y <= centre.sectorY+diff; y++) {
+			for (int z = centre.sectorZ-diff; z <= centre.sectorZ+diff; z++) {
+				RefCountedPtr<Sector> sec = Sector::GetCached(x, y, z);
+				for (unsigned int idx = 0; idx < sec->m_systems.size(); idx++) {
+					const float dist = Sector::DistanceBetween(here.Get(), centre.systemIndex, sec.Get(), idx);
+					if (dist <= range)
+						candidates.push_back(PrefetchCandidate(SystemPath(x, y, z, idx), dist));
+				}
+			}
+		}
+	}
+
+	if (candidates.size() > size_t(maxSystems)) {
+		std::nth_element(candidates.begin(), candidates.begin() + maxSystems, candidates.end());
+		candidates.erase(candidates.begin() + maxSystems, candidates.end());
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	// the workers take their newest job first, so queue the furthest first
+	std::vector<StarSystemPrefetchJob*> jobs;
+	SDL_mutexP(s_prefetchLock);
+	for (std::vector<PrefetchCandidate>::reverse_iterator i = candidates.rbegin(); i != candidates.rend(); ++i) {
+		SystemCacheMap::iterator cached = s_cachedSystems.find(i->path);
+		if (cached != s_cachedSystems.end()) {
+			// still wanted, so keep it
+			cached->second.lastUse = ++s_cacheClock;
+			continue;
+		}
+		if (s_pendingJobs.find(i->path) != s_pendingJobs.end())
+			continue;
+		StarSystemPrefetchJob *job = new StarSystemPrefetchJob(i->path);
+		s_pendingJobs.insert(PrefetchJobMap::value_type(i->path, job));
+		jobs.push_back(job);
+	}
+	SDL_mutexV(s_prefetchLock);
+
+	for (std::vector<StarSystemPrefetchJob*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+		s_prefetchJobs->Queue(*i);
+}
+
 void StarSystem::ShrinkCache()
 {
-	std::map<SystemPath,StarSystem*>::iterator i = s_cachedSystems.begin();
-	while (i != s_cachedSystems.end()) {
-		StarSystem *s = (*i).second;
-		assert(s->GetRefCount() >= 1); // sanity check
-		// if the cache is the only owner, then delete it
-		if (s->GetRefCount() == 1) {
-			delete s;
-			s_cachedSystems.erase(i++);
+	UpdatePrefetch();
+	ShrinkCacheTo(0);
+}
+
+void StarSystem::CancelPrefetch()
+{
+	if (!s_prefetchJobs) return;
+
+	SDL_mutexP(s_prefetchLock);
+	PrefetchJobMap::iterator i = s_pendingJobs.begin();
+	while (i != s_pendingJobs.end()) {
+		if (i->second->GetState() == StarSystemPrefetchJob::QUEUED) {
+			i->second->Cancel();
+			s_pendingJobs.erase(i++);
 		}
 		else
 			i++;
 	}
+	SDL_mutexV(s_prefetchLock);
+}
+
+StarSystem::CacheStats StarSystem::GetCacheStats()
+{
+	CacheStats stats = s_cacheStats;
+	stats.size = s_cachedSystems.size();
+	stats.totalBytes = s_cacheBytes;
+	return stats;
+}
+
+void StarSystem::ClearCacheStats()
+{
+	memset(&s_cacheStats, 0, sizeof(s_cacheStats));
 }
@@ -17,6 +17,7 @@
 class CustomSystemBody;
 class CustomSystem;
 class SystemBody;
+class JobQueue;
 
 // doubles - all masses in Kg, all lengths in meters
 // fixed - any mad scheme
@@ -225,10 +226,49 @@ private:
 class StarSystem : public DeleteEmitter, public RefCounted {
 public:
 	friend class SystemBody;
+	friend class StarSystemPrefetchJob;
 
+	static void Init();
+	static void Uninit();
+
+	// the cached copy of the system, generated now if it isn't already
+	// cached or being generated in the background. main thread only
 	static RefCountedPtr<StarSystem> GetCached(const SystemPath &path);
+	// the cached copy if there is one (picking up any finished in the
+	// background), or null. never generates the system
+	static RefCountedPtr<StarSystem> FindCached(const SystemPath &path);
+	// a copy of the system generated just to look at. it isn't cached and
+	// its bodies aren't named, so this can be called from any thread
+	static RefCountedPtr<StarSystem> GenerateUncached(const SystemPath &path);
+	// drop every cached system nobody else is holding on to. systems are
+	// also dropped, oldest first, when the cache goes over its memory budget
 	static void ShrinkCache();
 
+	// generate the systems within range of centre in the background, nearest
+	// first, so that GetCached() finds them ready. at most maxSystems are
+	// queued
+	static void PrefetchNear(const SystemPath &centre, float range, int maxSystems);
+	// forget any systems queued for the background that haven't been started
+	static void CancelPrefetch();
+	// move systems finished in the background into the cache. call it
+	// regularly from the main thread
+	static void UpdatePrefetch();
+	// the job pool systems are generated on in the background, or null if
+	// that's turned off. main thread only
+	static JobQueue *GetPrefetchQueue();
+
+	struct CacheStats {
+		int hits;
+		int misses;
+		int prefetched;
+		int evictions;
+		int size;
+		size_t totalBytes;
+	};
+	static CacheStats GetCacheStats();
+	// reset the counters (not the size)
+	static void ClearCacheStats();
+
 	const std::string &GetName() const { return m_name; }
 	SystemPath GetPathOf(const SystemBody *sbody) const;
 	SystemBody *GetBodyByPath(const SystemPath &path) const;
@@ -288,6 +328,17 @@ private:
 	void GenerateFromCustom(const CustomSystem *, MTRand &rand);
 	void Populate(bool addSpaceStations);
 
+	// body names come from Lua, so they can only be picked on the main
+	// thread. generation lists the bodies that want a name along with the
+	// seed for their name generator, and NameBodies() names them in order
+	struct UnnamedBodies {
+		unsigned long seed[6];
+		std::vector<SystemBody*> bodies;
+	};
+	std::vector<SystemBody*> &AddUnnamedBodies(const unsigned long seed[6]);
+	void NameBodies();
+	std::vector<UnnamedBodies> m_unnamedBodies;
+
 	SystemPath m_path;
 	int m_numStars;
 	std::string m_name;
@@ -0,0 +1,312 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SystemSummary.h"
+#include "Sector.h"
+#include "JobQueue.h"
+#include <algorithm>
+
+// summaries that nobody is using are kept, up to this many, in case they're
+// wanted again. they're small, and the point is to outlive the systems
+static const size_t CACHE_SIZE = 4096;
+
+struct CachedSummary {
+	CachedSummary(SystemSummary *s, Uint32 t) : summary(s), lastUse(t) {}
+	SystemSummary *summary; // the cache owns one reference
+	Uint32 lastUse;
+};
+typedef std::map<SystemPath,CachedSummary> SummaryCacheMap;
+
+static SummaryCacheMap s_cachedSummaries;
+static Uint32 s_cacheClock;
+static size_t s_nextShrink = CACHE_SIZE;
+
+static bool CompareLastUse(const SummaryCacheMap::iterator &a, const SummaryCacheMap::iterator &b)
+{
+	return a->second.lastUse < b->second.lastUse;
+}
+
+// drop the least recently used unreferenced summaries until at most keep of
+// them are left
+static void ShrinkCacheTo(size_t keep)
+{
+	std::vector<SummaryCacheMap::iterator> unused;
+	for (SummaryCacheMap::iterator i = s_cachedSummaries.begin(); i != s_cachedSummaries.end(); ++i)
+		if (i->second.summary->GetRefCount() == 1)
+			unused.push_back(i);
+
+	if (unused.size() > keep) {
+		const size_t numDrop = unused.size() - keep;
+		std::nth_element(unused.begin(), unused.begin() + numDrop, unused.end(), CompareLastUse);
+		for (size_t i = 0; i < numDrop; i++) {
+			unused[i]->second.summary->DecRefCount();
+			s_cachedSummaries.erase(unused[i]);
+		}
+	}
+
+	s_nextShrink = s_cachedSummaries.size() + CACHE_SIZE / 4;
+}
+
+// the bodies of a summary being worked out in the background, on the same
+// pool the systems are generated on. the main thread owns the job, and
+// deletes it once it's been collected
+class SystemSummaryFillJob : public Job {
+public:
+	enum State {
+		QUEUED,
+		RUNNING,
+		DONE,
+		CANCELLED
+	};
+
+	SystemSummaryFillJob(const SystemPath &path) : m_path(path), m_state(QUEUED) {}
+	virtual void Run(int threadNum);
+
+	const SystemPath &GetPath() const { return m_path; }
+	const SystemSummary::BodyInfo &GetBodyInfo() const { return m_bodies; }
+	// these need s_fillLock held
+	State GetState() const { return m_state; }
+	void Cancel() { assert(m_state == QUEUED); m_state = CANCELLED; }
+
+private:
+	SystemPath m_path;
+	SystemSummary::BodyInfo m_bodies;
+	State m_state;
+};
+
+typedef std::map<SystemPath,SystemSummaryFillJob*> FillJobMap;
+
+static SDL_mutex *s_fillLock = 0;        // protects the rest of these and the job states
+static SDL_cond *s_fillDone = 0;         // signalled when a job finishes
+static FillJobMap s_pendingFills;        // queued or running, by path
+static std::vector<SystemSummaryFillJob*> s_finishedFills; // done or cancelled, waiting to be collected
+
+void SystemSummaryFillJob::Run(int threadNum)
+{
+	SDL_mutexP(s_fillLock);
+	if (m_state == CANCELLED) {
+		s_finishedFills.push_back(this);
+		SDL_mutexV(s_fillLock);
+		return;
+	}
+	m_state = RUNNING;
+	SDL_mutexV(s_fillLock);
+
+	SystemSummary::GetBodyInfo(StarSystem::GenerateUncached(m_path).Get(), m_bodies);
+
+	SDL_mutexP(s_fillLock);
+	m_state = DONE;
+	s_finishedFills.push_back(this);
+	SDL_CondBroadcast(s_fillDone);
+	SDL_mutexV(s_fillLock);
+}
+
+void SystemSummary::Init()
+{
+	// there's only any point if the systems can be generated in the background
+	if (!StarSystem::GetPrefetchQueue())
+		return;
+
+	s_fillLock = SDL_CreateMutex();
+	s_fillDone = SDL_CreateCond();
+}
+
+void SystemSummary::Uninit()
+{
+	if (!s_fillLock) return;
+
+	// the job pool has been finished by now, so every job has handed itself
+	// over, summaries or no
+	for (std::vector<SystemSummaryFillJob*>::iterator i = s_finishedFills.begin(); i != s_finishedFills.end(); ++i)
+		delete *i;
+	s_finishedFills.clear();
+	s_pendingFills.clear();
+
+	SDL_DestroyCond(s_fillDone);
+	SDL_DestroyMutex(s_fillLock);
+	s_fillDone = 0;
+	s_fillLock = 0;
+}
+
+// hand the bodies worked out in the background to their summaries, if
+// they're still about
+void SystemSummary::CollectFills()
+{
+	if (!s_fillLock) return;
+
+	std::vector<SystemSummaryFillJob*> finished;
+	SDL_mutexP(s_fillLock);
+	finished.swap(s_finishedFills);
+	for (std::vector<SystemSummaryFillJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		// cancelled jobs were taken off the list when they were cancelled
+		if ((*i)->GetState() == SystemSummaryFillJob::DONE)
+			s_pendingFills.erase((*i)->GetPath());
+	}
+	SDL_mutexV(s_fillLock);
+
+	for (std::vector<SystemSummaryFillJob*>::iterator i = finished.begin(); i != finished.end(); ++i) {
+		if ((*i)->GetState() == SystemSummaryFillJob::DONE) {
+			SummaryCacheMap::iterator cached = s_cachedSummaries.find((*i)->GetPath());
+			if (cached != s_cachedSummaries.end() && !cached->second.summary->m_populated) {
+				cached->second.summary->m_bodies = (*i)->GetBodyInfo();
+				cached->second.summary->m_populated = true;
+			}
+		}
+		delete *i;
+	}
+}
+
+RefCountedPtr<SystemSummary> SystemSummary::GetCached(const SystemPath &path)
+{
+	const SystemPath sysPath(path.SystemOnly());
+
+	SummaryCacheMap::iterator i = s_cachedSummaries.find(sysPath);
+	if (i != s_cachedSummaries.end()) {
+		i->second.lastUse = ++s_cacheClock;
+		return RefCountedPtr<SystemSummary>(i->second.summary);
+	}
+
+	SystemSummary *s = new SystemSummary(sysPath);
+	s->IncRefCount();
+	s_cachedSummaries.insert(SummaryCacheMap::value_type(sysPath, CachedSummary(s, ++s_cacheClock)));
+	RefCountedPtr<SystemSummary> summary(s);
+
+	if (s_cachedSummaries.size() > s_nextShrink)
+		ShrinkCacheTo(CACHE_SIZE);
+
+	return summary;
+}
+
+void SystemSummary::GetNearby(const SystemPath &centre, double range, std::vector< RefCountedPtr<SystemSummary> > &out)
+{
+	RefCountedPtr<Sector> here = Sector::GetCached(centre);
+	const int diff = int(ceil(range/Sector::SIZE));
+
+	const size_t first = out.size();
+	for (int x = centre.sectorX-diff; x <= centre.sectorX+diff; x++) {
+		for (int y = centre.sectorY-diff; y <= centre.sectorY+diff; y++) {
+			for (int z = centre.sectorZ-diff; z <= centre.sectorZ+diff; z++) {
+				RefCountedPtr<Sector> sec = Sector::GetCached(x, y, z);
+				for (unsigned int idx = 0; idx < sec->m_systems.size(); idx++) {
+					if (x == centre.sectorX && y == centre.sectorY && z == centre.sectorZ && idx == centre.systemIndex)
+						continue;
+					if (Sector::DistanceBetween(here.Get(), centre.systemIndex, sec.Get(), idx) > range)
+						continue;
+					out.push_back(GetCached(SystemPath(x, y, z, idx)));
+				}
+			}
+		}
+	}
+
+	JobQueue *jobQueue = StarSystem::GetPrefetchQueue();
+	if (!s_fillLock || !jobQueue) return;
+
+	CollectFills();
+
+	// the workers take their newest job first, and whoever asked is likely
+	// to go through the list in order, so queue the last first
+	std::vector<SystemSummaryFillJob*> jobs;
+	SDL_mutexP(s_fillLock);
+	for (size_t i = out.size(); i > first; i--) {
+		const SystemSummary *s = out[i-1].Get();
+		if (s->m_populated || s_pendingFills.find(s->m_path) != s_pendingFills.end())
+			continue;
+		SystemSummaryFillJob *job = new SystemSummaryFillJob(s->m_path);
+		s_pendingFills.insert(FillJobMap::value_type(s->m_path, job));
+		jobs.push_back(job);
+	}
+	SDL_mutexV(s_fillLock);
+
+	for (std::vector<SystemSummaryFillJob*>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+		jobQueue->Queue(*i);
+}
+
+void SystemSummary::ShrinkCache()
+{
+	if (s_fillLock) {
+		SDL_mutexP(s_fillLock);
+		FillJobMap::iterator i = s_pendingFills.begin();
+		while (i != s_pendingFills.end()) {
+			if (i->second->GetState() == SystemSummaryFillJob::QUEUED) {
+				i->second->Cancel();
+				s_pendingFills.erase(i++);
+			}
+			else
+				i++;
+		}
+		SDL_mutexV(s_fillLock);
+		CollectFills();
+	}
+
+	ShrinkCacheTo(0);
+}
+
+SystemSummary::SystemSummary(const SystemPath &path) :
+	m_path(path),
+	m_populated(false)
+{
+	RefCountedPtr<Sector> sec = Sector::GetCached(path);
+	assert(path.systemIndex < sec->m_systems.size());
+	const Sector::System &sys = sec->m_systems[path.systemIndex];
+
+	m_name = sys.name;
+	m_numStars = sys.numStars;
+	for (int i = 0; i < m_numStars; i++)
+		m_starType[i] = sys.starType[i];
+	m_faction = sys.faction;
+}
+
+void SystemSummary::GetBodyInfo(const StarSystem *s, BodyInfo &info)
+{
+	info.totalPop = s->GetTotalPop();
+	info.polit = s->GetSysPolit();
+	info.econType = s->GetEconType();
+	info.unexplored = s->GetUnexplored();
+	memcpy(info.tradeLevel, s->GetTradeLevel(), sizeof(info.tradeLevel));
+
+	info.stationPaths.clear();
+	info.stationPaths.reserve(s->m_spaceStations.size());
+	for (std::vector<SystemBody*>::const_iterator i = s->m_spaceStations.begin(); i != s->m_spaceStations.end(); ++i)
+		info.stationPaths.push_back((*i)->path);
+}
+
+void SystemSummary::Populate()
+{
+	if (m_populated) return;
+
+	// if the whole system is about anyway, that's quickest
+	RefCountedPtr<StarSystem> cached = StarSystem::FindCached(m_path);
+	if (cached) {
+		GetBodyInfo(cached.Get(), m_bodies);
+		m_populated = true;
+		return;
+	}
+
+	if (s_fillLock) {
+		// it might be being worked out in the background. if it's already
+		// been started, wait for it. if not it's quicker to do it here
+		SDL_mutexP(s_fillLock);
+		FillJobMap::iterator job = s_pendingFills.find(m_path);
+		if (job != s_pendingFills.end()) {
+			if (job->second->GetState() == SystemSummaryFillJob::QUEUED) {
+				job->second->Cancel();
+				s_pendingFills.erase(job);
+			} else {
+				while (job->second->GetState() == SystemSummaryFillJob::RUNNING)
+					SDL_CondWait(s_fillDone, s_fillLock);
+			}
+		}
+		SDL_mutexV(s_fillLock);
+
+		CollectFills();
+		if (m_populated) return;
+	}
+
+	GetBodyInfo(StarSystem::GenerateUncached(m_path).Get(), m_bodies);
+	m_populated = true;
+}
+
+bool SystemSummary::IsCommodityLegal(Equip::Type t)
+{
+	return Polit::IsCommodityLegal(m_path, GetSysPolit(), m_faction, t);
+}
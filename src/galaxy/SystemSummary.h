@@ -0,0 +1,88 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SYSTEMSUMMARY_H
+#define _SYSTEMSUMMARY_H
+
+#include "libs.h"
+#include "RefCounted.h"
+#include "DeleteEmitter.h"
+#include "Polit.h"
+#include "galaxy/StarSystem.h"
+
+class Faction;
+
+// The parts of a StarSystem that matter when choosing between many systems:
+// its stars, who runs it, how many live there and what it trades. A summary
+// is a fraction of the size of the system and is kept after the system
+// itself has been thrown away, so looking over the same neighbourhood again
+// doesn't mean generating every system in it again. Main thread only.
+class SystemSummary : public DeleteEmitter, public RefCounted {
+public:
+	friend class SystemSummaryFillJob;
+
+	// after StarSystem::Init(), and after StarSystem::Uninit()
+	static void Init();
+	static void Uninit();
+
+	static RefCountedPtr<SystemSummary> GetCached(const SystemPath &path);
+	// summaries of every system within range light years of centre, not
+	// counting centre itself. the parts that need the bodies start being
+	// worked out for all of them in the background straight away, so going
+	// through them in order mostly finds those waiting
+	static void GetNearby(const SystemPath &centre, double range, std::vector< RefCountedPtr<SystemSummary> > &out);
+	// drop every summary nobody else is holding on to, and stop working out
+	// any that haven't been started. summaries are also dropped, oldest
+	// first, when too many pile up
+	static void ShrinkCache();
+
+	// these come from the sector, and never need the system
+	const SystemPath &GetPath() const { return m_path; }
+	const std::string &GetName() const { return m_name; }
+	int GetNumStars() const { return m_numStars; }
+	SystemBody::BodyType GetStarType(int n) const { assert(n >= 0 && n < m_numStars); return m_starType[n]; }
+	Faction *GetFaction() const { return m_faction; }
+
+	// these need the bodies, which stations there are depending on who
+	// lives where. they're worked out the first time any of them is asked
+	// for (or in the background, after GetNearby()), from the cached system
+	// if there is one and otherwise from an unnamed copy that's thrown away
+	// again, so a summary never fills the system cache. only the results
+	// are kept
+	fixed GetTotalPop() { Populate(); return m_bodies.totalPop; }
+	const SysPolit &GetSysPolit() { Populate(); return m_bodies.polit; }
+	int GetEconType() { Populate(); return m_bodies.econType; }
+	bool GetUnexplored() { Populate(); return m_bodies.unexplored; }
+	int GetCommodityBasePriceModPercent(int t) { Populate(); return m_bodies.tradeLevel[t]; }
+	const std::vector<SystemPath> &GetStationPaths() { Populate(); return m_bodies.stationPaths; }
+	bool IsCommodityLegal(Equip::Type t);
+
+	// the whole system, generated again if it's no longer cached
+	RefCountedPtr<StarSystem> GetStarSystem() const { return StarSystem::GetCached(m_path); }
+
+private:
+	struct BodyInfo {
+		fixed totalPop;
+		SysPolit polit;
+		int econType;
+		bool unexplored;
+		int tradeLevel[Equip::TYPE_MAX];
+		std::vector<SystemPath> stationPaths;
+	};
+	static void GetBodyInfo(const StarSystem *s, BodyInfo &info);
+	static void CollectFills();
+
+	SystemSummary(const SystemPath &path);
+	void Populate();
+
+	SystemPath m_path;
+	std::string m_name;
+	int m_numStars;
+	SystemBody::BodyType m_starType[4];
+	Faction *m_faction;
+
+	bool m_populated;
+	BodyInfo m_bodies;
+};
+
+#endif
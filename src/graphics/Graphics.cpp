@@ -6,6 +6,7 @@
 #include "Material.h"
 #include "RendererGL2.h"
 #include "RendererLegacy.h"
+#include "RendererNull.h"
 #include "OS.h"
 
 static GLuint boundArrayBufferObject = 0;
@@ -162,7 +163,13 @@ Renderer* Init(Settings vs)
 	shadersAvailable = glewIsSupported("GL_VERSION_2_0");
 	shadersEnabled = vs.shaders && shadersAvailable;
 
-	if (shadersEnabled)
+	// the null renderer's materials have no programs, so the code that
+	// draws with GL itself has to stay on the fixed function path too
+	if (vs.nullRenderer) {
+		shadersEnabled = false;
+		renderer = new RendererNull(vs);
+	}
+	else if (shadersEnabled)
 		renderer = new RendererGL2(vs);
 	else
 		renderer = new RendererLegacy(vs);
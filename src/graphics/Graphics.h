@@ -26,6 +26,7 @@ namespace Graphics {
 		int requestedSamples;
 		int height;
 		int width;
+		bool nullRenderer; // count what would be drawn instead of drawing it
 	};
 
 	//for querying available modes
@@ -0,0 +1,163 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RenderQueue.h"
+#include "Material.h"
+#include "StaticMesh.h"
+#include "Surface.h"
+#include <algorithm>
+
+namespace Graphics {
+
+static RenderQueue::Stats s_stats;
+
+// materials with the same descriptor get the same program, so this stands
+// in for the shader
+static Uint32 ShaderKey(const Material *m)
+{
+	if (!m) return 0;
+	const MaterialDescriptor &d = m->GetDescriptor();
+	return (Uint32(d.effect) << 16) | (Uint32(d.textures & 0xff) << 8) |
+		(d.lighting ? 0x01 : 0) | (d.vertexColors ? 0x02 : 0) | (d.alphaTest ? 0x04 : 0) |
+		(d.glowMap ? 0x08 : 0) | (d.specularMap ? 0x10 : 0) | (d.usePatterns ? 0x20 : 0) |
+		(d.atmosphere ? 0x40 : 0);
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+	Clear();
+}
+
+void RenderQueue::AddStaticMesh(StaticMesh *mesh, const matrix4x4f &trans, BlendMode mode)
+{
+	std::vector<Item> &items = (mode == BLEND_SOLID) ? m_solids : m_transparents;
+	const float depth = trans.GetTranslate().Length();
+
+	for (StaticMesh::SurfaceIterator surface = mesh->SurfacesBegin(); surface != mesh->SurfacesEnd(); ++surface) {
+		Item item;
+		item.material = (*surface)->GetMaterial().Get();
+		item.shader = ShaderKey(item.material);
+		item.texture = item.material ? item.material->texture0 : 0;
+		item.blendMode = mode;
+		item.depth = depth;
+		item.order = int(items.size());
+		item.deferred = 0;
+		item.draw.mesh = mesh;
+		item.draw.surface = (*surface).Get();
+		item.draw.transform = trans;
+		items.push_back(item);
+	}
+}
+
+void RenderQueue::AddDeferred(Deferred *d, float depth)
+{
+	Item item;
+	item.material = 0;
+	item.shader = 0;
+	item.texture = 0;
+	item.blendMode = BLEND_SOLID;
+	item.depth = depth;
+	item.order = int(m_transparents.size());
+	item.deferred = d;
+	item.draw.mesh = 0;
+	item.draw.surface = 0;
+	m_transparents.push_back(item);
+}
+
+bool RenderQueue::SolidLess(const Item &a, const Item &b)
+{
+	if (a.shader != b.shader) return a.shader < b.shader;
+	if (a.material != b.material) return a.material < b.material;
+	if (a.texture != b.texture) return a.texture < b.texture;
+	if (a.draw.mesh != b.draw.mesh) return a.draw.mesh < b.draw.mesh;
+	return a.order < b.order;
+}
+
+bool RenderQueue::TransparentLess(const Item &a, const Item &b)
+{
+	// furthest first. things at the same distance (the surfaces of one
+	// mesh) are still grouped by material
+	if (a.depth != b.depth) return a.depth > b.depth;
+	if (a.material != b.material) return a.material < b.material;
+	return a.order < b.order;
+}
+
+void RenderQueue::DrawRun(Renderer *r, const std::vector<Item> &items, size_t begin, size_t end)
+{
+	m_run.clear();
+	const Material *lastMaterial = 0;
+	const StaticMesh *lastMesh = 0;
+	for (size_t i = begin; i < end; i++) {
+		const Item &item = items[i];
+		if (i == begin || item.material != lastMaterial) s_stats.materialBinds++;
+		if (i == begin || item.draw.mesh != lastMesh) s_stats.meshBinds++;
+		lastMaterial = item.material;
+		lastMesh = item.draw.mesh;
+		m_run.push_back(item.draw);
+	}
+	r->DrawStaticMeshes(int(m_run.size()), &m_run[0]);
+}
+
+void RenderQueue::Flush(Renderer *r)
+{
+	if (IsEmpty()) return;
+
+	s_stats.flushes++;
+	s_stats.solids += m_solids.size();
+	s_stats.transparents += m_transparents.size();
+
+	Renderer::StateTicket ticket(r);
+
+	if (!m_solids.empty()) {
+		std::sort(m_solids.begin(), m_solids.end(), SolidLess);
+		r->SetBlendMode(BLEND_SOLID);
+		DrawRun(r, m_solids, 0, m_solids.size());
+	}
+
+	if (!m_transparents.empty()) {
+		std::sort(m_transparents.begin(), m_transparents.end(), TransparentLess);
+		size_t i = 0;
+		while (i < m_transparents.size()) {
+			const Item &item = m_transparents[i];
+			if (item.deferred) {
+				item.deferred->Render(r);
+				i++;
+				continue;
+			}
+			// surfaces in a row with the same blend mode go together
+			size_t end = i + 1;
+			while (end < m_transparents.size() && !m_transparents[end].deferred &&
+					m_transparents[end].blendMode == item.blendMode)
+				end++;
+			r->SetBlendMode(item.blendMode);
+			DrawRun(r, m_transparents, i, end);
+			i = end;
+		}
+	}
+
+	Clear();
+}
+
+void RenderQueue::Clear()
+{
+	for (std::vector<Item>::iterator i = m_transparents.begin(); i != m_transparents.end(); ++i)
+		delete (*i).deferred;
+	m_solids.clear();
+	m_transparents.clear();
+}
+
+RenderQueue::Stats RenderQueue::GetStats()
+{
+	return s_stats;
+}
+
+void RenderQueue::ClearStats()
+{
+	memset(&s_stats, 0, sizeof(s_stats));
+}
+
+}
@@ -0,0 +1,90 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _RENDERQUEUE_H
+#define _RENDERQUEUE_H
+/*
+ * Collects static mesh draws so they can be drawn sorted, instead of in
+ * the order they were asked for. Solids are drawn first, grouped by shader,
+ * material, texture and mesh so each is bound once per group. Transparent
+ * surfaces and deferred things (a model's transparent pass) come after,
+ * back to front.
+ *
+ * Set a queue on the renderer with Renderer::SetRenderQueue(), and the
+ * scene graph puts its draws in it. The renderer flushes the queue before
+ * any state change the queued draws depend on (lights, projection, depth
+ * state, leaving solid blending) and when the queue is taken off it.
+ *
+ * A flush binds and unbinds buffers and client arrays with GL directly, so
+ * code that draws with GL itself (LMR) must take the queue off the renderer
+ * for as long as it draws, and reset Graphics' buffer binding cache.
+ */
+#include "Renderer.h"
+
+namespace Graphics {
+
+class RenderQueue {
+public:
+	// something drawn in the transparent part of a flush. owned by the
+	// queue once added
+	class Deferred {
+	public:
+		virtual ~Deferred() { }
+		virtual void Render(Renderer *r) = 0;
+	};
+
+	RenderQueue();
+	~RenderQueue();
+
+	// every surface of the mesh, drawn with the given transform
+	void AddStaticMesh(StaticMesh *mesh, const matrix4x4f &trans, BlendMode mode);
+	// depth: distance from the camera
+	void AddDeferred(Deferred *d, float depth);
+
+	bool IsEmpty() const { return m_solids.empty() && m_transparents.empty(); }
+
+	// draw everything queued and empty the queue. the renderer's state is
+	// left as it was
+	void Flush(Renderer *r);
+	// empty the queue without drawing
+	void Clear();
+
+	struct Stats {
+		int flushes;
+		int solids;           // surfaces queued
+		int transparents;     // surfaces and deferred things queued
+		int materialBinds;    // without the queue, every surface applies its material
+		int meshBinds;
+	};
+	static Stats GetStats();
+	static void ClearStats();
+
+private:
+	RenderQueue(const RenderQueue&);
+	RenderQueue &operator=(const RenderQueue&);
+
+	struct Item {
+		Uint32 shader;        // from the material descriptor, see ShaderKey()
+		const Material *material;
+		const Texture *texture;
+		BlendMode blendMode;
+		float depth;
+		int order;            // to keep the sort stable
+		Deferred *deferred;   // or a mesh surface:
+		StaticMeshDraw draw;
+	};
+
+	static bool SolidLess(const Item &a, const Item &b);
+	static bool TransparentLess(const Item &a, const Item &b);
+
+	// draws a run of surfaces with the same blend mode
+	void DrawRun(Renderer *r, const std::vector<Item> &items, size_t begin, size_t end);
+
+	std::vector<Item> m_solids;
+	std::vector<Item> m_transparents;
+	std::vector<StaticMeshDraw> m_run;  // kept to save reallocating every flush
+};
+
+}
+
+#endif
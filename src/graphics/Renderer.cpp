@@ -2,12 +2,13 @@
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
 #include "Renderer.h"
+#include "RenderQueue.h"
 #include "Texture.h"
 
 namespace Graphics {
 
 Renderer::Renderer(int w, int h) :
-	m_width(w), m_height(h), m_ambient(Color::BLACK)
+	m_width(w), m_height(h), m_ambient(Color::BLACK), m_renderQueue(0)
 {
 
 }
@@ -38,6 +39,24 @@ void Renderer::RemoveCachedTexture(const std::string &type, const std::string &n
 	m_textures.erase(i);
 }
 
+void Renderer::SetRenderQueue(RenderQueue *queue)
+{
+	if (queue == m_renderQueue) return;
+	FlushRenderQueue();
+	m_renderQueue = queue;
+}
+
+void Renderer::FlushRenderQueue()
+{
+	if (!m_renderQueue || m_renderQueue->IsEmpty()) return;
+	// taken off while it draws, so the state changes it makes don't
+	// flush it again and the scene graph draws straight away
+	RenderQueue *queue = m_renderQueue;
+	m_renderQueue = 0;
+	queue->Flush(this);
+	m_renderQueue = queue;
+}
+
 void Renderer::RemoveAllCachedTextures()
 {
 	for (TextureCacheMap::iterator i = m_textures.begin(); i != m_textures.end(); ++i)
@@ -32,6 +32,7 @@ class Light;
 class Material;
 class MaterialDescriptor;
 class RendererLegacy;
+class RenderQueue;
 class StaticMesh;
 class Surface;
 class Texture;
@@ -61,6 +62,13 @@ enum BlendMode {
 	BLEND_ALPHA_PREMULT
 };
 
+// one surface of a static mesh and where to draw it
+struct StaticMeshDraw {
+	StaticMesh *mesh;
+	Surface *surface;
+	matrix4x4f transform;
+};
+
 // Renderer base, functions return false if
 // failed/unsupported
 class Renderer
@@ -77,6 +85,8 @@ public:
 	virtual bool EndFrame() = 0;
 	//traditionally gui happens between endframe and swapbuffers
 	virtual bool SwapBuffers() = 0;
+	//start the GPU on everything drawn so far, without waiting for it
+	virtual bool FlushCommands() { return false; }
 
 	//clear color and depth buffer
 	virtual bool ClearScreen() { return false; }
@@ -123,6 +133,14 @@ public:
 	virtual bool DrawPointSprites(int count, const vector3f *positions, Material *material, float size) { return false; }
 	//complex unchanging geometry that is worthwhile to store in VBOs etc.
 	virtual bool DrawStaticMesh(StaticMesh *thing) { return false; }
+	//surfaces of static meshes in the order given, binding each mesh's buffers
+	//and applying each material only when they change from the draw before
+	virtual bool DrawStaticMeshes(int count, const StaticMeshDraw *draws) { return false; }
+
+	//while a queue is set, the scene graph collects its draws in it instead
+	//of drawing them. taking the queue off (or setting another) flushes it
+	void SetRenderQueue(RenderQueue *queue);
+	RenderQueue *GetRenderQueue() const { return m_renderQueue; }
 
 	//creates a unique material based on the descriptor. It will not be deleted automatically.
 	virtual Material *CreateMaterial(const MaterialDescriptor &descriptor) = 0;
@@ -157,7 +175,12 @@ protected:
 	virtual void PushState() = 0;
 	virtual void PopState() = 0;
 
+	//draw what's queued. call before changing state the queued draws depend on
+	void FlushRenderQueue();
+
 private:
+	RenderQueue *m_renderQueue;
+
 	typedef std::pair<std::string,std::string> TextureCacheKey;
 	typedef std::map<TextureCacheKey,RefCountedPtr<Texture>*> TextureCacheMap;
 	TextureCacheMap m_textures;
@@ -55,6 +55,7 @@ bool RendererGL2::BeginFrame()
 
 bool RendererGL2::SetPerspectiveProjection(float fov, float aspect, float near, float far)
 {
+	FlushRenderQueue();
 	double ymax = near * tan(fov * M_PI / 360.0);
 	double ymin = -ymax;
 	double xmin = ymin * aspect;
@@ -73,6 +74,7 @@ bool RendererGL2::SetPerspectiveProjection(float fov, float aspect, float near,
 
 bool RendererGL2::SetAmbientColor(const Color &c)
 {
+	FlushRenderQueue();
 	m_ambient = c;
 	return true;
 }
@@ -92,6 +92,13 @@ bool RendererLegacy::BeginFrame()
 
 bool RendererLegacy::EndFrame()
 {
+	FlushRenderQueue();
+	return true;
+}
+
+bool RendererLegacy::FlushCommands()
+{
+	glFlush();
 	return true;
 }
 
@@ -120,6 +127,7 @@ static std::string glerr_to_string(GLenum err)
 
 bool RendererLegacy::SwapBuffers()
 {
+	FlushRenderQueue();
 #ifndef NDEBUG
 	// Check if an error occurred during the frame. This is not very useful for
 	// determining *where* the error happened. For that purpose, try GDebugger or
@@ -143,6 +151,7 @@ bool RendererLegacy::SwapBuffers()
 
 bool RendererLegacy::ClearScreen()
 {
+	FlushRenderQueue();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	return true;
@@ -150,6 +159,7 @@ bool RendererLegacy::ClearScreen()
 
 bool RendererLegacy::ClearDepthBuffer()
 {
+	FlushRenderQueue();
 	glClear(GL_DEPTH_BUFFER_BIT);
 
 	return true;
@@ -163,6 +173,7 @@ bool RendererLegacy::SetClearColor(const Color &c)
 
 bool RendererLegacy::SetViewport(int x, int y, int width, int height)
 {
+	FlushRenderQueue();
 	glViewport(x, y, width, height);
 	return true;
 }
@@ -186,6 +197,7 @@ bool RendererLegacy::SetTransform(const matrix4x4f &m)
 
 bool RendererLegacy::SetPerspectiveProjection(float fov, float aspect, float near, float far)
 {
+	FlushRenderQueue();
 	double ymax = near * tan(fov * M_PI / 360.0);
 	double ymin = -ymax;
 	double xmin = ymin * aspect;
@@ -199,6 +211,7 @@ bool RendererLegacy::SetPerspectiveProjection(float fov, float aspect, float nea
 
 bool RendererLegacy::SetOrthographicProjection(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax)
 {
+	FlushRenderQueue();
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	glOrtho(xmin, xmax, ymin, ymax, zmin, zmax);
@@ -207,6 +220,10 @@ bool RendererLegacy::SetOrthographicProjection(float xmin, float xmax, float ymi
 
 bool RendererLegacy::SetBlendMode(BlendMode m)
 {
+	// queued solids go first, so whatever's blended now is drawn over them
+	if (m != BLEND_SOLID)
+		FlushRenderQueue();
+
 	switch (m) {
 	case BLEND_SOLID:
 		glDisable(GL_BLEND);
@@ -236,6 +253,7 @@ bool RendererLegacy::SetBlendMode(BlendMode m)
 
 bool RendererLegacy::SetDepthTest(bool enabled)
 {
+	FlushRenderQueue();
 	if (enabled)
 		glEnable(GL_DEPTH_TEST);
 	else
@@ -245,6 +263,7 @@ bool RendererLegacy::SetDepthTest(bool enabled)
 
 bool RendererLegacy::SetDepthWrite(bool enabled)
 {
+	FlushRenderQueue();
 	if (enabled)
 		glDepthMask(GL_TRUE);
 	else
@@ -254,6 +273,7 @@ bool RendererLegacy::SetDepthWrite(bool enabled)
 
 bool RendererLegacy::SetWireFrameMode(bool enabled)
 {
+	FlushRenderQueue();
 	glPolygonMode(GL_FRONT_AND_BACK, enabled ? GL_LINE : GL_FILL);
 	return true;
 }
@@ -262,6 +282,8 @@ bool RendererLegacy::SetLights(int numlights, const Light *lights)
 {
 	if (numlights < 1) return false;
 
+	FlushRenderQueue();
+
 	m_numLights = numlights;
 	m_numDirLights = 0;
 
@@ -294,6 +316,7 @@ bool RendererLegacy::SetLights(int numlights, const Light *lights)
 
 bool RendererLegacy::SetAmbientColor(const Color &c)
 {
+	FlushRenderQueue();
 	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, c);
 	m_ambient = c;
 	return true;
@@ -301,6 +324,7 @@ bool RendererLegacy::SetAmbientColor(const Color &c)
 
 bool RendererLegacy::SetScissor(bool enabled, const vector2f &pos, const vector2f &size)
 {
+	FlushRenderQueue();
 	if (enabled) {
 		glScissor(pos.x,pos.y,size.x,size.y);
 		glEnable(GL_SCISSOR_TEST);
@@ -528,6 +552,67 @@ bool RendererLegacy::DrawStaticMesh(StaticMesh *t)
 	return true;
 }
 
+bool RendererLegacy::DrawStaticMeshes(int count, const StaticMeshDraw *draws)
+{
+	if (count < 1 || !draws) return false;
+
+	// the same as DrawStaticMesh, but buffers are only bound when the mesh
+	// changes, materials only applied when the material changes and the
+	// transform only set when it changes
+	StaticMesh *mesh = 0;
+	MeshRenderInfo *meshInfo = 0;
+	Material *material = 0;
+	const matrix4x4f *transform = 0;
+
+	for (int i = 0; i < count; i++) {
+		const StaticMeshDraw &draw = draws[i];
+
+		if (draw.mesh != mesh) {
+			if (meshInfo) {
+				if (meshInfo->ibuf)
+					meshInfo->ibuf->Unbind();
+				meshInfo->vbuf->Unbind();
+			}
+			mesh = draw.mesh;
+			meshInfo = 0;
+			if (!mesh->cached && !BufferStaticMesh(mesh))
+				continue;
+			meshInfo = static_cast<MeshRenderInfo*>(mesh->GetRenderInfo());
+			meshInfo->vbuf->Bind();
+			if (meshInfo->ibuf)
+				meshInfo->ibuf->Bind();
+		}
+		if (!meshInfo) continue;
+
+		Material *m = const_cast<Material*>(draw.surface->GetMaterial().Get());
+		if (m != material) {
+			if (material) material->Unapply();
+			material = m;
+			material->Apply();
+		}
+
+		if (!transform || memcmp(&(*transform)[0], &draw.transform[0], sizeof(float) * 16) != 0) {
+			SetTransform(draw.transform);
+			transform = &draw.transform;
+		}
+
+		SurfaceRenderInfo *surfaceInfo = static_cast<SurfaceRenderInfo*>(draw.surface->GetRenderInfo());
+		if (meshInfo->ibuf)
+			meshInfo->vbuf->DrawIndexed(mesh->GetPrimtiveType(), surfaceInfo->glOffset, surfaceInfo->glAmount);
+		else
+			meshInfo->vbuf->Draw(mesh->GetPrimtiveType(), surfaceInfo->glOffset, surfaceInfo->glAmount);
+	}
+
+	if (material) material->Unapply();
+	if (meshInfo) {
+		if (meshInfo->ibuf)
+			meshInfo->ibuf->Unbind();
+		meshInfo->vbuf->Unbind();
+	}
+
+	return true;
+}
+
 void RendererLegacy::EnableClientStates(const VertexArray *v)
 {
 	if (!v) return;
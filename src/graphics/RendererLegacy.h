@@ -25,6 +25,7 @@ public:
 	virtual bool BeginFrame();
 	virtual bool EndFrame();
 	virtual bool SwapBuffers();
+	virtual bool FlushCommands();
 
 	virtual bool ClearScreen();
 	virtual bool ClearDepthBuffer();
@@ -56,6 +57,7 @@ public:
 	virtual bool DrawSurface(const Surface *surface);
 	virtual bool DrawPointSprites(int count, const vector3f *positions, Material *material, float size);
 	virtual bool DrawStaticMesh(StaticMesh *thing);
+	virtual bool DrawStaticMeshes(int count, const StaticMeshDraw *draws);
 
 	virtual Material *CreateMaterial(const MaterialDescriptor &descriptor);
 	virtual Texture *CreateTexture(const TextureDescriptor &descriptor);
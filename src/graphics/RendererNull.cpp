@@ -0,0 +1,396 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RendererNull.h"
+#include "Graphics.h"
+#include "Light.h"
+#include "Material.h"
+#include "StaticMesh.h"
+#include "Surface.h"
+#include "Texture.h"
+#include "TextureGL.h"
+#include "VertexArray.h"
+#include <cstdio>
+#include <ostream>
+
+namespace Graphics {
+
+// a material that keeps its descriptor and does nothing else
+class MaterialNull : public Material {
+public:
+	MaterialNull(const MaterialDescriptor &desc) { m_descriptor = desc; }
+};
+
+static int VertexArrayBytes(const VertexArray *v)
+{
+	return int(v->position.size() * sizeof(vector3f) +
+		v->normal.size() * sizeof(vector3f) +
+		v->diffuse.size() * sizeof(Color) +
+		v->uv0.size() * sizeof(vector2f));
+}
+
+static int SurfaceBytes(const Surface *s)
+{
+	const int vertexBytes = s->GetVertices() ? VertexArrayBytes(s->GetVertices()) : 0;
+	return vertexBytes + s->GetNumIndices() * int(sizeof(unsigned short));
+}
+
+RendererNull::RendererNull(const Graphics::Settings &vs)
+: Renderer(vs.width, vs.height)
+, m_lastMaterial(0)
+, m_frameCount(0)
+, m_recordCommands(false)
+{
+	m_state.blendMode = BLEND_SOLID;
+	m_state.depthTest = true;
+	m_state.depthWrite = true;
+	m_state.wireframe = false;
+	m_state.scissor = false;
+
+	memset(&m_frame, 0, sizeof(m_frame));
+	memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+}
+
+RendererNull::~RendererNull()
+{
+}
+
+bool RendererNull::GetNearFarRange(float &near, float &far) const
+{
+	// same as the legacy renderer, so scenes are split up the same way
+	near = 10.f;
+	far = 1000000.0f;
+	return true;
+}
+
+bool RendererNull::BeginFrame()
+{
+	ClearScreen();
+	return true;
+}
+
+bool RendererNull::EndFrame()
+{
+	FlushRenderQueue();
+	return true;
+}
+
+bool RendererNull::SwapBuffers()
+{
+	FlushRenderQueue();
+	m_lastFrame = m_frame;
+	memset(&m_frame, 0, sizeof(m_frame));
+	m_lastCommands.swap(m_commands);
+	m_commands.clear();
+	m_frameCount++;
+	// the first draw of a frame always counts as a material change
+	m_lastMaterial = 0;
+	return true;
+}
+
+bool RendererNull::FlushCommands()
+{
+	return true;
+}
+
+bool RendererNull::ClearScreen()
+{
+	FlushRenderQueue();
+	Record(CMD_CLEAR, 1);
+	return true;
+}
+
+bool RendererNull::ClearDepthBuffer()
+{
+	FlushRenderQueue();
+	Record(CMD_CLEAR, 0);
+	return true;
+}
+
+bool RendererNull::SetClearColor(const Color &c)
+{
+	return true;
+}
+
+bool RendererNull::SetViewport(int x, int y, int width, int height)
+{
+	FlushRenderQueue();
+	m_frame.stateChanges++;
+	Record(CMD_VIEWPORT, width);
+	return true;
+}
+
+bool RendererNull::SetTransform(const matrix4x4d &m)
+{
+	m_frame.transforms++;
+	Record(CMD_TRANSFORM, 0);
+	return true;
+}
+
+bool RendererNull::SetTransform(const matrix4x4f &m)
+{
+	m_frame.transforms++;
+	Record(CMD_TRANSFORM, 0);
+	return true;
+}
+
+bool RendererNull::SetPerspectiveProjection(float fov, float aspect, float near, float far)
+{
+	FlushRenderQueue();
+	m_frame.transforms++;
+	Record(CMD_PROJECTION, 0);
+	return true;
+}
+
+bool RendererNull::SetOrthographicProjection(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax)
+{
+	FlushRenderQueue();
+	m_frame.transforms++;
+	Record(CMD_PROJECTION, 1);
+	return true;
+}
+
+template <typename T>
+bool RendererNull::ChangeState(T &current, T value, CommandType type)
+{
+	if (current == value) {
+		m_frame.redundantStates++;
+		return false;
+	}
+	current = value;
+	if (type == CMD_BLEND)
+		m_frame.blendChanges++;
+	else
+		m_frame.stateChanges++;
+	Record(type, int(value));
+	return true;
+}
+
+bool RendererNull::SetBlendMode(BlendMode mode)
+{
+	if (mode != BLEND_SOLID)
+		FlushRenderQueue();
+	ChangeState(m_state.blendMode, mode, CMD_BLEND);
+	return true;
+}
+
+bool RendererNull::SetDepthTest(bool enabled)
+{
+	FlushRenderQueue();
+	ChangeState(m_state.depthTest, enabled, CMD_DEPTH_TEST);
+	return true;
+}
+
+bool RendererNull::SetDepthWrite(bool enabled)
+{
+	FlushRenderQueue();
+	ChangeState(m_state.depthWrite, enabled, CMD_DEPTH_WRITE);
+	return true;
+}
+
+bool RendererNull::SetWireFrameMode(bool enabled)
+{
+	FlushRenderQueue();
+	ChangeState(m_state.wireframe, enabled, CMD_WIREFRAME);
+	return true;
+}
+
+bool RendererNull::SetLights(int numlights, const Light *lights)
+{
+	if (numlights < 1) return false;
+
+	FlushRenderQueue();
+
+	m_frame.stateChanges++;
+	Record(CMD_LIGHTS, numlights);
+
+	// LMR still looks for them here
+	Graphics::State::SetLights(numlights, lights);
+
+	return true;
+}
+
+bool RendererNull::SetAmbientColor(const Color &c)
+{
+	FlushRenderQueue();
+	m_ambient = c;
+	m_frame.stateChanges++;
+	Record(CMD_AMBIENT, 0);
+	return true;
+}
+
+bool RendererNull::SetScissor(bool enabled, const vector2f &pos, const vector2f &size)
+{
+	FlushRenderQueue();
+	// a new rectangle is a change even if it stays on
+	if (enabled) {
+		m_state.scissor = true;
+		m_frame.stateChanges++;
+		Record(CMD_SCISSOR, 1);
+	} else
+		ChangeState(m_state.scissor, false, CMD_SCISSOR);
+	return true;
+}
+
+void RendererNull::Record(CommandType type, int value, const Material *material)
+{
+	if (!m_recordCommands) return;
+	const Command cmd = { type, value, material };
+	m_commands.push_back(cmd);
+}
+
+void RendererNull::CountDraw(CommandType type, int numVerts, int numIndices, int bytes, const Material *material)
+{
+	m_frame.drawCalls++;
+	m_frame.vertices += numVerts;
+	m_frame.indices += numIndices;
+	m_frame.bytesSubmitted += bytes;
+	if (material != m_lastMaterial) {
+		m_frame.materialChanges++;
+		m_lastMaterial = material;
+	}
+	Record(type, numVerts, material);
+}
+
+bool RendererNull::DrawLines(int count, const vector3f *v, const Color *c, LineType t)
+{
+	if (count < 2 || !v) return false;
+	CountDraw(CMD_DRAW_LINES, count, 0, count * int(sizeof(vector3f) + sizeof(Color)), vtxColorMaterial);
+	return true;
+}
+
+bool RendererNull::DrawLines(int count, const vector3f *v, const Color &c, LineType t)
+{
+	if (count < 2 || !v) return false;
+	CountDraw(CMD_DRAW_LINES, count, 0, count * int(sizeof(vector3f)), vtxColorMaterial);
+	return true;
+}
+
+bool RendererNull::DrawLines2D(int count, const vector2f *v, const Color &c, LineType t)
+{
+	if (count < 2 || !v) return false;
+	CountDraw(CMD_DRAW_LINES, count, 0, count * int(sizeof(vector2f)), vtxColorMaterial);
+	return true;
+}
+
+bool RendererNull::DrawPoints(int count, const vector3f *points, const Color *colors, float size)
+{
+	if (count < 1 || !points || !colors) return false;
+	CountDraw(CMD_DRAW_POINTS, count, 0, count * int(sizeof(vector3f) + sizeof(Color)), vtxColorMaterial);
+	return true;
+}
+
+bool RendererNull::DrawPoints2D(int count, const vector2f *points, const Color *colors, float size)
+{
+	if (count < 1 || !points || !colors) return false;
+	CountDraw(CMD_DRAW_POINTS, count, 0, count * int(sizeof(vector2f) + sizeof(Color)), vtxColorMaterial);
+	return true;
+}
+
+bool RendererNull::DrawTriangles(const VertexArray *v, Material *m, PrimitiveType t)
+{
+	if (!v || v->position.size() < 3) return false;
+	CountDraw(CMD_DRAW_TRIANGLES, v->GetNumVerts(), 0, VertexArrayBytes(v), m);
+	return true;
+}
+
+bool RendererNull::DrawSurface(const Surface *s)
+{
+	if (!s || !s->GetVertices() || s->GetNumIndices() < 3) return false;
+	CountDraw(CMD_DRAW_SURFACE, s->GetNumVerts(), s->GetNumIndices(), SurfaceBytes(s), s->GetMaterial().Get());
+	return true;
+}
+
+bool RendererNull::DrawPointSprites(int count, const vector3f *positions, Material *material, float size)
+{
+	if (count < 1 || !material || !material->texture0) return false;
+	// drawn as a quad each
+	CountDraw(CMD_DRAW_POINT_SPRITES, count * 4, 0, count * 4 * int(sizeof(vector3f) + sizeof(vector2f)), material);
+	return true;
+}
+
+bool RendererNull::DrawStaticMesh(StaticMesh *t)
+{
+	if (!t) return false;
+
+	// the data is sent once, the first time it's drawn
+	if (!t->cached) {
+		for (StaticMesh::SurfaceIterator surface = t->SurfacesBegin(); surface != t->SurfacesEnd(); ++surface)
+			m_frame.bytesSubmitted += SurfaceBytes((*surface).Get());
+		t->cached = true;
+	}
+
+	for (StaticMesh::SurfaceIterator surface = t->SurfacesBegin(); surface != t->SurfacesEnd(); ++surface)
+		CountDraw(CMD_DRAW_STATIC_MESH, (*surface)->GetNumVerts(), (*surface)->GetNumIndices(), 0, (*surface)->GetMaterial().Get());
+
+	return true;
+}
+
+bool RendererNull::DrawStaticMeshes(int count, const StaticMeshDraw *draws)
+{
+	if (count < 1 || !draws) return false;
+
+	const matrix4x4f *transform = 0;
+	for (int i = 0; i < count; i++) {
+		const StaticMeshDraw &draw = draws[i];
+		if (!draw.mesh->cached) {
+			for (StaticMesh::SurfaceIterator surface = draw.mesh->SurfacesBegin(); surface != draw.mesh->SurfacesEnd(); ++surface)
+				m_frame.bytesSubmitted += SurfaceBytes((*surface).Get());
+			draw.mesh->cached = true;
+		}
+		// like the legacy renderer, the transform is only set when it changes
+		if (!transform || memcmp(&(*transform)[0], &draw.transform[0], sizeof(float) * 16) != 0) {
+			SetTransform(draw.transform);
+			transform = &draw.transform;
+		}
+		CountDraw(CMD_DRAW_STATIC_MESH, draw.surface->GetNumVerts(), draw.surface->GetNumIndices(), 0, draw.surface->GetMaterial().Get());
+	}
+
+	return true;
+}
+
+Material *RendererNull::CreateMaterial(const MaterialDescriptor &desc)
+{
+	m_frame.materialsCreated++;
+	return new MaterialNull(desc);
+}
+
+Texture *RendererNull::CreateTexture(const TextureDescriptor &descriptor)
+{
+	m_frame.texturesCreated++;
+	// nothing is drawn with them, so there's no point compressing them
+	return new TextureGL(descriptor, false);
+}
+
+bool RendererNull::PrintDebugInfo(std::ostream &out)
+{
+	out << "Null renderer: nothing is drawn through the renderer" << std::endl;
+	return true;
+}
+
+void RendererNull::PrintStatsHeader(FILE *f)
+{
+	fprintf(f, "frame,cpu_ms,draws,vertices,indices,material_changes,blend_changes,state_changes,redundant_states,transforms,bytes,materials_created,textures_created\n");
+}
+
+void RendererNull::PrintStats(FILE *f, int frame, const FrameStats &stats, double cpuMsec)
+{
+	fprintf(f, "%d,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", frame, cpuMsec,
+		stats.drawCalls, stats.vertices, stats.indices, stats.materialChanges, stats.blendChanges,
+		stats.stateChanges, stats.redundantStates, stats.transforms, stats.bytesSubmitted,
+		stats.materialsCreated, stats.texturesCreated);
+}
+
+void RendererNull::PushState()
+{
+	m_stateStack.push_back(m_state);
+}
+
+void RendererNull::PopState()
+{
+	assert(!m_stateStack.empty());
+	m_state = m_stateStack.back();
+	m_stateStack.pop_back();
+}
+
+}
@@ -0,0 +1,159 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _RENDERER_NULL_H
+#define _RENDERER_NULL_H
+/*
+ * Renderer that draws nothing, but counts what it's asked to do, so the
+ * CPU cost of drawing a scene can be measured without the GPU's. A frame
+ * ends at SwapBuffers().
+ *
+ * Code that still draws with GL directly (LMR, terrain, the old gui) isn't
+ * seen here, and textures are real GL textures because that code binds
+ * them. So a GL context is still needed, but nothing has to be shown.
+ */
+#include "Renderer.h"
+#include <cstdio>
+
+namespace Graphics {
+
+struct Settings;
+
+class RendererNull : public Renderer
+{
+public:
+	struct FrameStats {
+		int drawCalls;         // static meshes count one per surface
+		int vertices;
+		int indices;
+		int materialChanges;   // draws with a different material to the last
+		int blendChanges;
+		int stateChanges;      // depth, wireframe, scissor, lights etc.
+		int redundantStates;   // state set to what it was already
+		int transforms;        // modelview and projection matrices set
+		int bytesSubmitted;    // vertex and index data, static meshes only the first time
+		int materialsCreated;
+		int texturesCreated;
+	};
+
+	enum CommandType {
+		CMD_CLEAR,
+		CMD_VIEWPORT,
+		CMD_TRANSFORM,
+		CMD_PROJECTION,
+		CMD_BLEND,
+		CMD_DEPTH_TEST,
+		CMD_DEPTH_WRITE,
+		CMD_WIREFRAME,
+		CMD_LIGHTS,
+		CMD_AMBIENT,
+		CMD_SCISSOR,
+		CMD_DRAW_LINES,
+		CMD_DRAW_POINTS,
+		CMD_DRAW_TRIANGLES,
+		CMD_DRAW_SURFACE,
+		CMD_DRAW_POINT_SPRITES,
+		CMD_DRAW_STATIC_MESH   // one per surface
+	};
+
+	struct Command {
+		CommandType type;
+		int value;                // the new state, or the vertex count of a draw
+		const Material *material; // for draws that have one
+	};
+
+	RendererNull(const Graphics::Settings &vs);
+	virtual ~RendererNull();
+
+	virtual const char* GetName() const { return "Null renderer"; }
+	virtual bool GetNearFarRange(float &near, float &far) const;
+
+	virtual bool BeginFrame();
+	virtual bool EndFrame();
+	virtual bool SwapBuffers();
+	virtual bool FlushCommands();
+
+	virtual bool ClearScreen();
+	virtual bool ClearDepthBuffer();
+	virtual bool SetClearColor(const Color &c);
+
+	virtual bool SetViewport(int x, int y, int width, int height);
+
+	virtual bool SetTransform(const matrix4x4d &m);
+	virtual bool SetTransform(const matrix4x4f &m);
+	virtual bool SetPerspectiveProjection(float fov, float aspect, float near, float far);
+	virtual bool SetOrthographicProjection(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax);
+
+	virtual bool SetBlendMode(BlendMode mode);
+	virtual bool SetDepthTest(bool enabled);
+	virtual bool SetDepthWrite(bool enabled);
+	virtual bool SetWireFrameMode(bool enabled);
+
+	virtual bool SetLights(int numlights, const Light *l);
+	virtual bool SetAmbientColor(const Color &c);
+
+	virtual bool SetScissor(bool enabled, const vector2f &pos = vector2f(0.0f), const vector2f &size = vector2f(0.0f));
+
+	virtual bool DrawLines(int vertCount, const vector3f *vertices, const Color *colors, LineType type=LINE_SINGLE);
+	virtual bool DrawLines(int vertCount, const vector3f *vertices, const Color &color, LineType type=LINE_SINGLE);
+	virtual bool DrawLines2D(int vertCount, const vector2f *vertices, const Color &color, LineType type=LINE_SINGLE);
+	virtual bool DrawPoints(int count, const vector3f *points, const Color *colors, float pointSize=1.f);
+	virtual bool DrawPoints2D(int count, const vector2f *points, const Color *colors, float pointSize=1.f);
+	virtual bool DrawTriangles(const VertexArray *vertices, Material *material, PrimitiveType type=TRIANGLES);
+	virtual bool DrawSurface(const Surface *surface);
+	virtual bool DrawPointSprites(int count, const vector3f *positions, Material *material, float size);
+	virtual bool DrawStaticMesh(StaticMesh *thing);
+	virtual bool DrawStaticMeshes(int count, const StaticMeshDraw *draws);
+
+	virtual Material *CreateMaterial(const MaterialDescriptor &descriptor);
+	virtual Texture *CreateTexture(const TextureDescriptor &descriptor);
+
+	virtual bool PrintDebugInfo(std::ostream &out);
+
+	// the last finished frame
+	const FrameStats &GetFrameStats() const { return m_lastFrame; }
+	int GetFrameCount() const { return m_frameCount; }
+
+	// a frame's stats as one line, for the benchmarks to print
+	static void PrintStatsHeader(FILE *f);
+	static void PrintStats(FILE *f, int frame, const FrameStats &stats, double cpuMsec);
+
+	// keep every command of a frame, to see what order things were drawn
+	// in. off to start with, since it costs time of its own
+	void SetRecordCommands(bool record) { m_recordCommands = record; }
+	const std::vector<Command> &GetFrameCommands() const { return m_lastCommands; }
+
+protected:
+	virtual void PushState();
+	virtual void PopState();
+
+private:
+	struct State {
+		BlendMode blendMode;
+		bool depthTest;
+		bool depthWrite;
+		bool wireframe;
+		bool scissor;
+	};
+
+	void Record(CommandType type, int value, const Material *material = 0);
+	// counts a state change, or a redundant one. returns true if it changed
+	template <typename T> bool ChangeState(T &current, T value, CommandType type);
+	void CountDraw(CommandType type, int numVerts, int numIndices, int bytes, const Material *material);
+
+	State m_state;
+	std::vector<State> m_stateStack;
+	const Material *m_lastMaterial;
+
+	FrameStats m_frame;
+	FrameStats m_lastFrame;
+	int m_frameCount;
+
+	bool m_recordCommands;
+	std::vector<Command> m_commands;
+	std::vector<Command> m_lastCommands;
+};
+
+}
+
+#endif
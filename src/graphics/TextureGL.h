@@ -26,6 +26,7 @@ public:
 private:
 	friend class RendererLegacy;
 	friend class RendererGL2;
+	friend class RendererNull;
 	TextureGL(const TextureDescriptor &descriptor, const bool useCompressed);
 
 	GLenum m_target;
@@ -4,11 +4,19 @@
 #include "libs.h"
 #include "Pi.h"
 #include "ModelViewer.h"
+#include "Game.h"
+#include "FileSystem.h"
 #include <cstdio>
 
 enum RunMode {
 	MODE_GAME,
 	MODE_MODELVIEWER,
+	MODE_BENCHMARK,
+	MODE_MODELBENCHMARK,
+	MODE_RENDERBENCHMARK,
+	MODE_TERRAINBENCHMARK,
+	MODE_SUMMARYTEST,
+	MODE_CONVERTSAVE,
 	MODE_VERSION,
 	MODE_USAGE,
 	MODE_USAGE_ERROR
@@ -17,6 +25,7 @@ enum RunMode {
 int main(int argc, char** argv)
 {
 	RunMode mode = MODE_GAME;
+	int status = 0;
 
 	if (argc > 1) {
 		const char switchchar = argv[1][0];
@@ -37,6 +46,36 @@ int main(int argc, char** argv)
 			goto start;
 		}
 
+		if (modeopt == "benchmark" || modeopt == "b") {
+			mode = MODE_BENCHMARK;
+			goto start;
+		}
+
+		if (modeopt == "modelbenchmark" || modeopt == "mb") {
+			mode = MODE_MODELBENCHMARK;
+			goto start;
+		}
+
+		if (modeopt == "renderbenchmark" || modeopt == "rb") {
+			mode = MODE_RENDERBENCHMARK;
+			goto start;
+		}
+
+		if (modeopt == "terrainbenchmark" || modeopt == "tb") {
+			mode = MODE_TERRAINBENCHMARK;
+			goto start;
+		}
+
+		if (modeopt == "summarytest" || modeopt == "st") {
+			mode = MODE_SUMMARYTEST;
+			goto start;
+		}
+
+		if (modeopt == "convertsave" || modeopt == "cs") {
+			mode = MODE_CONVERTSAVE;
+			goto start;
+		}
+
 		if (modeopt == "version" || modeopt == "v") {
 			mode = MODE_VERSION;
 			goto start;
@@ -62,7 +101,109 @@ start:
 			std::string modelName;
 			if (argc > 2)
 				modelName = argv[2];
-			ModelViewer::Run(modelName);
+			int benchmarkFrames = 0;
+			if (argc > 3) {
+				benchmarkFrames = atoi(argv[3]);
+				if (benchmarkFrames <= 0) {
+					fprintf(stderr, "pioneer: benchmark frame count must be positive\n");
+					break;
+				}
+			}
+			ModelViewer::Run(modelName, benchmarkFrames);
+			break;
+		}
+
+		case MODE_BENCHMARK: {
+			// a minute of game time unless told otherwise
+			int numTicks = 3600;
+			if (argc > 2)
+				numTicks = atoi(argv[2]);
+			if (numTicks <= 0) {
+				fprintf(stderr, "pioneer: benchmark tick count must be positive\n");
+				break;
+			}
+			std::string saveName;
+			if (argc > 3)
+				saveName = argv[3];
+			// a rate, as in 1x, 10x and so on
+			int rate = 1;
+			if (argc > 4)
+				rate = atoi(argv[4]);
+			Game::TimeAccel timeAccel;
+			if      (rate == 1)     timeAccel = Game::TIMEACCEL_1X;
+			else if (rate == 10)    timeAccel = Game::TIMEACCEL_10X;
+			else if (rate == 100)   timeAccel = Game::TIMEACCEL_100X;
+			else if (rate == 1000)  timeAccel = Game::TIMEACCEL_1000X;
+			else if (rate == 10000) timeAccel = Game::TIMEACCEL_10000X;
+			else {
+				fprintf(stderr, "pioneer: benchmark time acceleration must be 1, 10, 100, 1000 or 10000\n");
+				break;
+			}
+			// nothing is drawn, so nothing is sent to the GPU either
+			Pi::Init(true, true);
+			Pi::RunBenchmark(saveName, numTicks, timeAccel);
+			Pi::Quit();
+			break;
+		}
+
+		case MODE_MODELBENCHMARK:
+			// models are loaded for the null renderer, so the timings are
+			// only the loading
+			Pi::Init(true, true);
+			Pi::RunModelBenchmark();
+			Pi::Quit();
+			break;
+
+		case MODE_RENDERBENCHMARK: {
+			// ten seconds at 60 fps
+			int numFrames = 600;
+			if (argc > 2)
+				numFrames = atoi(argv[2]);
+			if (numFrames <= 0) {
+				fprintf(stderr, "pioneer: benchmark frame count must be positive\n");
+				break;
+			}
+			std::string saveName;
+			if (argc > 3)
+				saveName = argv[3];
+			Pi::Init(true, true);
+			Pi::RunRenderBenchmark(saveName, numFrames);
+			Pi::Quit();
+			break;
+		}
+
+		case MODE_TERRAINBENCHMARK:
+			Pi::Init(true, true);
+			Pi::RunTerrainCacheBenchmark();
+			Pi::Quit();
+			break;
+
+		case MODE_SUMMARYTEST:
+			Pi::Init(true, true);
+			Pi::Quit(Pi::RunSystemSummaryTest() ? 1 : 0);
+			break;
+
+		case MODE_CONVERTSAVE: {
+			if (argc < 3) {
+				fprintf(stderr, "pioneer: no save file given\n");
+				status = 1;
+				break;
+			}
+			const bool pack = !(argc > 3 && std::string(argv[3]) == "plain");
+			FileSystem::Init();
+			try {
+				Game::ConvertSaveGame(argv[2], pack);
+			} catch (CouldNotOpenFileException) {
+				fprintf(stderr, "pioneer: couldn't read save file %s\n", argv[2]);
+				status = 1;
+			} catch (CouldNotWriteToFileException) {
+				fprintf(stderr, "pioneer: couldn't write save file %s\n", argv[2]);
+				status = 1;
+			} catch (SavedGameCorruptException) {
+				fprintf(stderr, "pioneer: save file %s is damaged\n", argv[2]);
+				status = 1;
+			}
+			FileSystem::Uninit();
 			break;
 		}
 
@@ -82,12 +223,18 @@ start:
 				"usage: pioneer [mode] [options...]\n"
 				"available modes:\n"
 				"    -game        [-g]     game (default)\n"
-				"    -modelviewer [-mv]    model viewer\n"
+				"    -modelviewer [-mv]    model viewer: -mv [model] [frames to benchmark]\n"
+				"    -benchmark   [-b]     time physics: -b [ticks] [savefile] [time accel]\n"
+				"    -modelbenchmark [-mb] time loading every model\n"
+				"    -renderbenchmark [-rb] count what's drawn: -rb [frames] [savefile]\n"
+				"    -terrainbenchmark [-tb] time the terrain cache against generating\n"
+				"    -summarytest [-st]    check system summaries don't generate systems\n"
+				"    -convertsave [-cs]    pack a save: -cs savefile [plain to unpack]\n"
 				"    -version     [-v]     show version\n"
 				"    -help        [-h,-?]  this help\n"
 			);
 			break;
 	}
 
-	return 0;
+	return status;
 }
@@ -227,6 +227,24 @@ namespace FileSystem {
 		return make_directory_raw(fullpath);
 	}
 
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		return (unlink(fullpath.c_str()) == 0);
+	}
+
+	bool FileSourceFS::RenameFile(const std::string &oldPath, const std::string &newPath)
+	{
+		const std::string oldFullpath = JoinPathBelow(GetRoot(), oldPath);
+		const std::string newFullpath = JoinPathBelow(GetRoot(), newPath);
+		return (rename(oldFullpath.c_str(), newFullpath.c_str()) == 0);
+	}
+
+	bool FileSourceFS::SyncWriteStream(FILE *f)
+	{
+		return (fflush(f) == 0 && fsync(fileno(f)) == 0);
+	}
+
 	FILE* FileSourceFS::OpenReadStream(const std::string &path)
 	{
 		const std::string fullpath = JoinPathBelow(GetRoot(), path);
@@ -3,6 +3,7 @@
 
 #include "Loader.h"
 #include "CollisionGeometry.h"
+#include "CRC32.h"
 #include "FileSystem.h"
 #include "LOD.h"
 #include "Parser.h"
@@ -20,6 +21,7 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <assimp/material.h>
+#include <set>
 
 namespace {
 
@@ -118,12 +120,30 @@ namespace {
 
 namespace SceneGraph {
 
-Loader::Loader(Graphics::Renderer *r) :
+static const char CACHE_DIR[] = "model_cache/newmodels";
+
+// bump this when MeshData or what goes into it changes
+static const Uint32 CACHE_VERSION = 2;
+
+void PendingTexture::Upload(Graphics::Renderer *r)
+{
+	Graphics::Texture *t = builder.GetOrCreateTexture(r, "model");
+	switch (slot) {
+		case 0: material->texture0 = t; break;
+		case 1: material->texture1 = t; break;
+		case 2: material->texture2 = t; break;
+		default: assert(0); break;
+	}
+}
+
+Loader::Loader(Graphics::Renderer *r, bool rebuildCache, bool writeCache) :
 	m_renderer(r),
+	m_rebuildCache(rebuildCache),
+	m_writeCache(writeCache),
+	m_cacheChanged(false),
+	m_pendingTextures(0),
 	m_model(0)
 {
-	Graphics::Texture *sdfTex = Graphics::TextureBuilder("fonts/label3d.png", Graphics::LINEAR_CLAMP, true, true, true).GetOrCreateTexture(r, "model");
-	m_labelFont.Reset(new Text::DistanceFieldFont("fonts/sdf_definition.txt", sdfTex));
 }
 
 Loader::~Loader()
@@ -137,6 +157,12 @@ Model *Loader::LoadModel(const std::string &filename)
 }
 
 Model *Loader::LoadModel(const std::string &shortname, const std::string &basepath)
+{
+	PrepareModel(shortname, basepath);
+	return CreatePreparedModel();
+}
+
+void Loader::PrepareModel(const std::string &shortname, const std::string &basepath)
 {
 	FileSystem::FileSource &fileSource = FileSystem::gameDataFiles;
 	for (FileSystem::FileEnumerator files(fileSource, basepath, FileSystem::FileEnumerator::Recurse); !files.Finished(); files.Next())
@@ -150,7 +176,8 @@ Model *Loader::LoadModel(const std::string &shortname, const std::string &basepa
 			const std::string name = info.GetName();
 
 			if (shortname == name.substr(0, name.length()-6)) {
-				ModelDefinition modelDefinition;
+				ModelDefinition &modelDefinition = m_modelDef;
+				modelDefinition = ModelDefinition();
 				try {
 					//curPath is used to find textures, patterns,
 					//possibly other data files for this model.
@@ -167,7 +194,64 @@ Model *Loader::LoadModel(const std::string &shortname, const std::string &basepa
 					throw LoadingError(err.what());
 				}
 				modelDefinition.name = shortname;
-				return CreateModel(modelDefinition);
+
+				m_meshes.clear();
+				m_collisionMeshes.clear();
+				m_textures.clear();
+				m_cacheChanged = false;
+				const Uint32 checksum = CalcCacheChecksum(fpath, modelDefinition);
+				if (!m_rebuildCache)
+					ReadCache(shortname, checksum);
+
+				//import whatever the cache didn't have
+				for (std::vector<LodDefinition>::const_iterator lod = modelDefinition.lodDefs.begin();
+					lod != modelDefinition.lodDefs.end(); ++lod)
+				{
+					for (std::vector<std::string>::const_iterator it = (*lod).meshNames.begin();
+						it != (*lod).meshNames.end(); ++it)
+					{
+						if (m_meshes.find(*it) != m_meshes.end()) continue;
+						try {
+							MeshData data;
+							ImportMesh(*it, data);
+							m_meshes.insert(std::make_pair(*it, data));
+							m_cacheChanged = true;
+						} catch (LoadingError &err) {
+							//append filename - easiest to do here
+							fprintf(stderr, "%s:\n%s\n", (*it).c_str(), err.what());
+							throw (LoadingError(stringf("%0:\n%1", *it, err.what())));
+						}
+					}
+				}
+				for (std::vector<std::string>::const_iterator it = modelDefinition.collisionDefs.begin();
+					it != modelDefinition.collisionDefs.end(); ++it)
+				{
+					if (m_collisionMeshes.find(*it) != m_collisionMeshes.end()) continue;
+					try {
+						CollisionMeshData data;
+						ImportCollision(*it, data);
+						m_collisionMeshes.insert(std::make_pair(*it, data));
+						m_cacheChanged = true;
+					} catch (LoadingError &err) {
+						throw (LoadingError(stringf("%0:\n%1", *it, err.what())));
+					}
+				}
+				if (m_cacheChanged && m_writeCache)
+					WriteCache(shortname, checksum);
+
+				//decode the textures now, they're uploaded when the model is created
+				for (std::vector<MaterialDefinition>::const_iterator it = modelDefinition.matDefs.begin();
+					it != modelDefinition.matDefs.end(); ++it)
+				{
+					const std::string *texs[] = { &(*it).tex_diff, &(*it).tex_spec, &(*it).tex_glow };
+					for (unsigned int i = 0; i < COUNTOF(texs); i++) {
+						if (texs[i]->empty() || m_textures.find(*texs[i]) != m_textures.end()) continue;
+						Graphics::TextureBuilder &b = m_textures.insert(
+							std::make_pair(*texs[i], Graphics::TextureBuilder::Model(*texs[i]))).first->second;
+						b.GetDescriptor();
+					}
+				}
+				return;
 			}
 		}
 
@@ -175,11 +259,36 @@ Model *Loader::LoadModel(const std::string &shortname, const std::string &basepa
 	throw (LoadingError("File not found"));
 }
 
+Model *Loader::CreatePreparedModel(std::vector<PendingTexture> *pendingTextures)
+{
+	m_pendingTextures = pendingTextures;
+	Model *model = CreateModel(m_modelDef);
+	m_pendingTextures = 0;
+	//the decoded textures aren't needed once they've been uploaded
+	m_textures.clear();
+	return model;
+}
+
 Graphics::Texture *Loader::GetWhiteTexture() const
 {
 	return Graphics::TextureBuilder::Model("textures/white.png").GetOrCreateTexture(m_renderer, "model");
 }
 
+Graphics::Texture *Loader::GetTexture(const std::string &filename, const RefCountedPtr<Graphics::Material> &mat, int slot, const char *placeholder)
+{
+	Graphics::Texture *t = m_renderer->GetCachedTexture("model", filename);
+	if (t) return t;
+
+	std::map<std::string, Graphics::TextureBuilder>::iterator it = m_textures.find(filename);
+	if (it == m_textures.end())
+		return Graphics::TextureBuilder::Model(filename).GetOrCreateTexture(m_renderer, "model");
+	if (!m_pendingTextures)
+		return it->second.GetOrCreateTexture(m_renderer, "model");
+
+	m_pendingTextures->push_back(PendingTexture(mat, slot, it->second));
+	return Graphics::TextureBuilder::Model(placeholder).GetOrCreateTexture(m_renderer, "model");
+}
+
 Model *Loader::CreateModel(ModelDefinition &def)
 {
 	using Graphics::Material;
@@ -227,13 +336,13 @@ Model *Loader::CreateModel(ModelDefinition &def)
 			mat->diffuse.a = float((*it).opacity) / 100.f;
 
 		if (!diffTex.empty())
-			mat->texture0 = Graphics::TextureBuilder::Model(diffTex).GetOrCreateTexture(m_renderer, "model");
+			mat->texture0 = GetTexture(diffTex, mat, 0, "textures/white.png");
 		else
 			mat->texture0 = GetWhiteTexture();
 		if (!specTex.empty())
-			mat->texture1 = Graphics::TextureBuilder::Model(specTex).GetOrCreateTexture(m_renderer, "model");
+			mat->texture1 = GetTexture(specTex, mat, 1, "textures/black.png");
 		if (!glowTex.empty())
-			mat->texture2 = Graphics::TextureBuilder::Model(glowTex).GetOrCreateTexture(m_renderer, "model");
+			mat->texture2 = GetTexture(glowTex, mat, 2, "textures/black.png");
 		//texture3 is reserved for pattern
 		//texture4 is reserved for color gradient
 
@@ -357,6 +466,32 @@ void Loader::FindPatterns(PatternContainer &output)
 }
 
 RefCountedPtr<Node> Loader::LoadMesh(const std::string &filename, const AnimList &animDefs, TagList &modelTags)
+{
+	std::map<std::string, MeshData>::iterator it = m_meshes.find(filename);
+	if (it == m_meshes.end()) {
+		MeshData data;
+		ImportMesh(filename, data);
+		it = m_meshes.insert(std::make_pair(filename, data)).first;
+		m_cacheChanged = true;
+	}
+	const MeshData &data = it->second;
+
+	//turn all mesh surfaces into Surfaces
+	//Index matches assimp index.
+	std::vector<RefCountedPtr<Graphics::Surface> > surfaces;
+	ConvertSurfaces(surfaces, data, m_model);
+
+	// Recursive structure conversion. Matrix needs to be accumulated for
+	// special features that are absolute-positioned (thrusters)
+	RefCountedPtr<Node> meshRoot(new Group());
+
+	ConvertNodes(data, 0, static_cast<Group*>(meshRoot.Get()), surfaces, matrix4x4f::Identity());
+	ConvertAnimations(data, animDefs, static_cast<Group*>(meshRoot.Get()));
+
+	return meshRoot;
+}
+
+void Loader::ImportMesh(const std::string &filename, MeshData &out)
 {
 	Assimp::Importer importer;
 	importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
@@ -382,19 +517,96 @@ RefCountedPtr<Node> Loader::LoadMesh(const std::string &filename, const AnimList
 	if(scene->mNumMeshes == 0)
 		throw LoadingError("No geometry found");
 
-	//turn all scene aiMeshes into Surfaces
-	//Index matches assimp index.
-	std::vector<RefCountedPtr<Graphics::Surface> > surfaces;
-	ConvertAiMeshesToSurfaces(surfaces, scene, m_model);
+	//XXX sigh, workaround for obj loader
+	int matIdxOffs = 0;
+	if (scene->mNumMaterials > scene->mNumMeshes)
+		matIdxOffs = 1;
 
-	// Recursive structure conversion. Matrix needs to be accumulated for
-	// special features that are absolute-positioned (thrusters)
-	RefCountedPtr<Node> meshRoot(new Group());
+	for (unsigned int i=0; i<scene->mNumMeshes; i++) {
+		aiMesh *mesh = scene->mMeshes[i];
+		assert(mesh->HasNormals());
+
+		if (!mesh->HasTextureCoords(0))
+			throw LoadingError("Missing UV coordinates");
 
-	ConvertNodes(scene->mRootNode, static_cast<Group*>(meshRoot.Get()), surfaces, matrix4x4f::Identity());
-	ConvertAnimations(scene, animDefs, static_cast<Group*>(meshRoot.Get()));
+		out.surfaces.push_back(MeshSurface());
+		MeshSurface &surf = out.surfaces.back();
 
-	return meshRoot;
+		//Material names are not consistent throughout formats...
+		//keep the name if there is one, and the index in case it doesn't match
+		const aiMaterial *amat = scene->mMaterials[mesh->mMaterialIndex];
+		aiString s;
+		if(AI_SUCCESS == amat->Get(AI_MATKEY_NAME,s))
+			surf.materialName = std::string(s.data, s.length);
+		surf.materialIndex = mesh->mMaterialIndex - matIdxOffs;
+
+		//copy indices first
+		//note: index offsets are not adjusted, StaticMesh should do that for us
+		for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+			const aiFace *face = &mesh->mFaces[f];
+			for (unsigned int j = 0; j < face->mNumIndices; j++) {
+				surf.indices.push_back(face->mIndices[j]);
+			}
+		}
+
+		//then vertices, making gross assumptions of the format
+		for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
+			const aiVector3D &vtx = mesh->mVertices[v];
+			const aiVector3D &norm = mesh->mNormals[v];
+			const aiVector3D &uv0 = mesh->mTextureCoords[0][v];
+			surf.positions.push_back(vector3f(vtx.x, vtx.y, vtx.z));
+			surf.normals.push_back(vector3f(norm.x, norm.y, norm.z));
+			surf.uvs.push_back(vector2f(uv0.x, uv0.y));
+		}
+	}
+
+	ImportNode(scene->mRootNode, out);
+
+	//keys are kept as they are, the animation definitions split them up later
+	out.numAnimations = scene->mNumAnimations;
+	if (scene->mNumAnimations == 0) return;
+
+	const aiAnimation* aianim = scene->mAnimations[0];
+	out.ticksPerSecond = aianim->mTicksPerSecond;
+	for (unsigned int j=0; j<aianim->mNumChannels; j++) {
+		const aiNodeAnim *aichan = aianim->mChannels[j];
+		out.channels.push_back(MeshChannel());
+		MeshChannel &chan = out.channels.back();
+		chan.nodeName = aichan->mNodeName.C_Str();
+
+		for(unsigned int k=0; k<aichan->mNumPositionKeys; k++) {
+			const aiVectorKey &aikey = aichan->mPositionKeys[k];
+			const aiVector3D &aipos = aikey.mValue;
+			chan.positionKeys.push_back(PositionKey(aikey.mTime, vector3f(aipos.x, aipos.y, aipos.z)));
+		}
+		for(unsigned int k=0; k<aichan->mNumRotationKeys; k++) {
+			const aiQuatKey &aikey = aichan->mRotationKeys[k];
+			const aiQuaternion &airot = aikey.mValue;
+			chan.rotationKeys.push_back(RotationKey(aikey.mTime, Quaternionf(airot.w, airot.x, airot.y, airot.z)));
+		}
+		for(unsigned int k=0; k<aichan->mNumScalingKeys; k++) {
+			const aiVectorKey &aikey = aichan->mScalingKeys[k];
+			const aiVector3D &aipos = aikey.mValue;
+			chan.scaleKeys.push_back(ScaleKey(aikey.mTime, vector3f(aipos.x, aipos.y, aipos.z)));
+		}
+	}
+}
+
+//parents go in before their children, returns the node's index
+Uint32 Loader::ImportNode(const aiNode *node, MeshData &out)
+{
+	const Uint32 index = out.nodes.size();
+	out.nodes.push_back(MeshNode());
+	out.nodes[index].name = node->mName.C_Str();
+	out.nodes[index].transform = ConvertMatrix(node->mTransformation);
+	for (unsigned int i=0; i<node->mNumMeshes; i++)
+		out.nodes[index].meshes.push_back(node->mMeshes[i]);
+
+	for (unsigned int i=0; i<node->mNumChildren; i++) {
+		const Uint32 child = ImportNode(node->mChildren[i], out);
+		out.nodes[index].children.push_back(child);
+	}
+	return index;
 }
 
 static bool in_range(double keytime, double start, double end)
@@ -403,25 +615,22 @@ static bool in_range(double keytime, double start, double end)
 }
 
 //check animation channel has at least two P, R or S keys within time range
-bool Loader::CheckKeysInRange(const aiNodeAnim *chan, double start, double end)
+bool Loader::CheckKeysInRange(const MeshChannel &chan, double start, double end)
 {
 	int posKeysInRange = 0;
 	int rotKeysInRange = 0;
 	int sclKeysInRange = 0;
 
-	for (unsigned int k=0; k<chan->mNumPositionKeys; k++) {
-		const aiVectorKey &aikey = chan->mPositionKeys[k];
-		if (in_range(aikey.mTime, start, end)) posKeysInRange++;
+	for (unsigned int k=0; k<chan.positionKeys.size(); k++) {
+		if (in_range(chan.positionKeys[k].time, start, end)) posKeysInRange++;
 	}
 
-	for (unsigned int k=0; k<chan->mNumRotationKeys; k++) {
-		const aiQuatKey &aikey = chan->mRotationKeys[k];
-		if (in_range(aikey.mTime, start, end)) rotKeysInRange++;
+	for (unsigned int k=0; k<chan.rotationKeys.size(); k++) {
+		if (in_range(chan.rotationKeys[k].time, start, end)) rotKeysInRange++;
 	}
 
-	for (unsigned int k=0; k<chan->mNumScalingKeys; k++) {
-		const aiVectorKey &aikey = chan->mScalingKeys[k];
-		if (in_range(aikey.mTime, start, end)) sclKeysInRange++;
+	for (unsigned int k=0; k<chan.scaleKeys.size(); k++) {
+		if (in_range(chan.scaleKeys[k].time, start, end)) sclKeysInRange++;
 	}
 
 	return (posKeysInRange > 1 || rotKeysInRange > 1 || sclKeysInRange > 1);
@@ -442,35 +651,19 @@ RefCountedPtr<Graphics::Material> Loader::GetDecalMaterial(unsigned int index)
 	return decMat;
 }
 
-void Loader::ConvertAiMeshesToSurfaces(std::vector<RefCountedPtr<Graphics::Surface> > &surfaces, const aiScene *scene, Model *model)
+void Loader::ConvertSurfaces(std::vector<RefCountedPtr<Graphics::Surface> > &surfaces, const MeshData &data, Model *model)
 {
-	//XXX sigh, workaround for obj loader
-	int matIdxOffs = 0;
-	if (scene->mNumMaterials > scene->mNumMeshes)
-		matIdxOffs = 1;
-
-	//turn meshes into surfaces
-	for (unsigned int i=0; i<scene->mNumMeshes; i++) {
-		aiMesh *mesh = scene->mMeshes[i];
-		assert(mesh->HasNormals());
-
-		if (!mesh->HasTextureCoords(0))
-			throw LoadingError("Missing UV coordinates");
+	for (std::vector<MeshSurface>::const_iterator it = data.surfaces.begin(); it != data.surfaces.end(); ++it) {
+		const MeshSurface &mesh = *it;
 
-		//Material names are not consistent throughout formats...
 		//try to figure out a material
 		//try name first, if that fails use index
 		RefCountedPtr<Graphics::Material> mat;
-		const aiMaterial *amat = scene->mMaterials[mesh->mMaterialIndex];
-		aiString s;
-		if(AI_SUCCESS == amat->Get(AI_MATKEY_NAME,s)) {
-			//std::cout << "Looking for " << std::string(s.data,s.length) << std::endl;
-			const std::string aiMatName = std::string(s.data, s.length);
-			mat = model->GetMaterialByName(aiMatName);
-		}
+		if (!mesh.materialName.empty())
+			mat = model->GetMaterialByName(mesh.materialName);
 
 		if (!mat.Valid()) {
-			mat = model->GetMaterialByIndex(mesh->mMaterialIndex - matIdxOffs);
+			mat = model->GetMaterialByIndex(mesh.materialIndex);
 		}
 
 		assert(mat.Valid());
@@ -482,45 +675,28 @@ void Loader::ConvertAiMeshesToSurfaces(std::vector<RefCountedPtr<Graphics::Surfa
 				Graphics::ATTRIB_UV0);
 
 		RefCountedPtr<Graphics::Surface> surface(new Graphics::Surface(Graphics::TRIANGLES, vts, mat));
-		std::vector<unsigned short> &indices = surface->GetIndices();
-
-		//copy indices first
-		//note: index offsets are not adjusted, StaticMesh should do that for us
-		for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
-			const aiFace *face = &mesh->mFaces[f];
-			for (unsigned int j = 0; j < face->mNumIndices; j++) {
-				indices.push_back(face->mIndices[j]);
-			}
-		}
+		surface->GetIndices() = mesh.indices;
 
-		//then vertices, making gross assumptions of the format
-		for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
-			const aiVector3D &vtx = mesh->mVertices[v];
-			const aiVector3D &norm = mesh->mNormals[v];
-			const aiVector3D &uv0 = mesh->mTextureCoords[0][v];
-			vts->Add(vector3f(vtx.x, vtx.y, vtx.z),
-				vector3f(norm.x, norm.y, norm.z),
-				vector2f(uv0.x, uv0.y));
-		}
+		for (unsigned int v = 0; v < mesh.positions.size(); v++)
+			vts->Add(mesh.positions[v], mesh.normals[v], mesh.uvs[v]);
 
 		surfaces.push_back(surface);
 	}
 }
 
-void Loader::ConvertAnimations(const aiScene* scene, const AnimList &animDefs, Node *meshRoot)
+void Loader::ConvertAnimations(const MeshData &data, const AnimList &animDefs, Node *meshRoot)
 {
 	//Split convert assimp animations according to anim defs
 	//This is very limited, and all animdefs are processed for all
 	//meshes, potentially leading to duplicate and wrongly split animations
-	if (animDefs.empty() || scene->mNumAnimations == 0) return;
+	if (animDefs.empty() || data.numAnimations == 0) return;
 
-	if (scene->mNumAnimations > 1) throw LoadingError("More than one animation in file! Your exporter is too good");
+	if (data.numAnimations > 1) throw LoadingError("More than one animation in file! Your exporter is too good");
 
 	//Blender .X exporter exports only one animation (without a name!) so
 	//we read only one animation from the scene and split it according to animDefs
 	std::vector<Animation*> &animations = m_model->m_animations;
 
-	const aiAnimation* aianim = scene->mAnimations[0];
 	for (AnimList::const_iterator def = animDefs.begin();
 		def != animDefs.end();
 		++def)
@@ -530,7 +706,7 @@ void Loader::ConvertAnimations(const aiScene* scene, const AnimList &animDefs, N
 		//duration is calculated after adding all keys
 		double start = DBL_MAX;
 		double end = 0.0;
-		const double ticksPerSecond = aianim->mTicksPerSecond > 0.0 ? aianim->mTicksPerSecond : 24.0;
+		const double ticksPerSecond = data.ticksPerSecond > 0.0 ? data.ticksPerSecond : 24.0;
 
 		//Ranges are specified in frames (since that's nice) but Collada
 		//uses seconds. This is easiest to detect from ticksPerSecond,
@@ -546,49 +722,45 @@ void Loader::ConvertAnimations(const aiScene* scene, const AnimList &animDefs, N
 			def->name, 0.0,
 			def->loop ? Animation::LOOP : Animation::ONCE,
 			ticksPerSecond);
-		for (unsigned int j=0; j<aianim->mNumChannels; j++) {
-			const aiNodeAnim *aichan = aianim->mChannels[j];
+		for (unsigned int j=0; j<data.channels.size(); j++) {
+			const MeshChannel &meshchan = data.channels[j];
 			//do a preliminary check that at least two keys in one channel are within range
-			if (!CheckKeysInRange(aichan, defStart, defEnd))
+			if (!CheckKeysInRange(meshchan, defStart, defEnd))
 				continue;
 
-			const std::string channame(aichan->mNodeName.C_Str());
-			MatrixTransform *trans = dynamic_cast<MatrixTransform*>(meshRoot->FindNode(channame));
+			MatrixTransform *trans = dynamic_cast<MatrixTransform*>(meshRoot->FindNode(meshchan.nodeName));
 			assert(trans);
 			animation->m_channels.push_back(AnimationChannel(trans));
 			AnimationChannel &chan = animation->m_channels.back();
 
-			for(unsigned int k=0; k<aichan->mNumPositionKeys; k++) {
-				const aiVectorKey &aikey = aichan->mPositionKeys[k];
-				const aiVector3D &aipos = aikey.mValue;
-				if (in_range(aikey.mTime, defStart, defEnd)) {
-					chan.positionKeys.push_back(PositionKey(aikey.mTime - defStart, vector3f(aipos.x, aipos.y, aipos.z)));
-					start = std::min(start, aikey.mTime);
-					end = std::max(end, aikey.mTime);
+			for(unsigned int k=0; k<meshchan.positionKeys.size(); k++) {
+				const PositionKey &key = meshchan.positionKeys[k];
+				if (in_range(key.time, defStart, defEnd)) {
+					chan.positionKeys.push_back(PositionKey(key.time - defStart, key.position));
+					start = std::min(start, key.time);
+					end = std::max(end, key.time);
 				}
 			}
 
 			//scale interpolation will blow up without rotation keys,
 			//so skipping them when rotkeys < 2 is correct
-			if (aichan->mNumRotationKeys < 2) continue;
-
-			for(unsigned int k=0; k<aichan->mNumRotationKeys; k++) {
-				const aiQuatKey &aikey = aichan->mRotationKeys[k];
-				const aiQuaternion &airot = aikey.mValue;
-				if (in_range(aikey.mTime, defStart, defEnd)) {
-					chan.rotationKeys.push_back(RotationKey(aikey.mTime - defStart, Quaternionf(airot.w, airot.x, airot.y, airot.z)));
-					start = std::min(start, aikey.mTime);
-					end = std::max(end, aikey.mTime);
+			if (meshchan.rotationKeys.size() < 2) continue;
+
+			for(unsigned int k=0; k<meshchan.rotationKeys.size(); k++) {
+				const RotationKey &key = meshchan.rotationKeys[k];
+				if (in_range(key.time, defStart, defEnd)) {
+					chan.rotationKeys.push_back(RotationKey(key.time - defStart, key.rotation));
+					start = std::min(start, key.time);
+					end = std::max(end, key.time);
 				}
 			}
 
-			for(unsigned int k=0; k<aichan->mNumScalingKeys; k++) {
-				const aiVectorKey &aikey = aichan->mScalingKeys[k];
-				const aiVector3D &aipos = aikey.mValue;
-				if (in_range(aikey.mTime, defStart, defEnd)) {
-					chan.scaleKeys.push_back(ScaleKey(aikey.mTime - defStart, vector3f(aipos.x, aipos.y, aipos.z)));
-					start = std::min(start, aikey.mTime);
-					end = std::max(end, aikey.mTime);
+			for(unsigned int k=0; k<meshchan.scaleKeys.size(); k++) {
+				const ScaleKey &key = meshchan.scaleKeys[k];
+				if (in_range(key.time, defStart, defEnd)) {
+					chan.scaleKeys.push_back(ScaleKey(key.time - defStart, key.scale));
+					start = std::min(start, key.time);
+					end = std::max(end, key.time);
 				}
 			}
 		}
@@ -630,6 +802,11 @@ matrix4x4f Loader::ConvertMatrix(const aiMatrix4x4& trans) const
 
 void Loader::CreateLabel(Group *parent, const matrix4x4f &m)
 {
+	if (!m_labelFont.Valid()) {
+		Graphics::Texture *sdfTex = Graphics::TextureBuilder("fonts/label3d.png", Graphics::LINEAR_CLAMP, true, true, true).GetOrCreateTexture(m_renderer, "model");
+		m_labelFont.Reset(new Text::DistanceFieldFont("fonts/sdf_definition.txt", sdfTex));
+	}
+
 	MatrixTransform *trans = new MatrixTransform(m);
 	Label3D *label = new Label3D(m_labelFont, m_renderer);
 	label->SetText("Bananas");
@@ -675,15 +852,15 @@ void Loader::CreateThruster(Group* parent, const matrix4x4f &m, const std::strin
 	parent->AddChild(trans);
 }
 
-void Loader::ConvertNodes(aiNode *node, Group *_parent, std::vector<RefCountedPtr<Graphics::Surface> >& surfaces, const matrix4x4f &accum)
+void Loader::ConvertNodes(const MeshData &data, Uint32 nodeIndex, Group *_parent, std::vector<RefCountedPtr<Graphics::Surface> >& surfaces, const matrix4x4f &accum)
 {
 	Group *parent = _parent;
-	const std::string nodename(node->mName.C_Str());
-	const aiMatrix4x4& trans = node->mTransformation;
-	matrix4x4f m = ConvertMatrix(trans);
+	const MeshNode &node = data.nodes[nodeIndex];
+	const std::string &nodename = node.name;
+	const matrix4x4f &m = node.transform;
 
 	//lights, and possibly other special nodes should be leaf nodes (without meshes)
-	if (node->mNumChildren == 0 && node->mNumMeshes == 0) {
+	if (node.children.empty() && node.meshes.empty()) {
 		if (starts_with(nodename, "navlight_")) {
 			CreateLight(parent, m);
 		} else if (starts_with(nodename, "thruster_")) {
@@ -705,9 +882,9 @@ void Loader::ConvertNodes(aiNode *node, Group *_parent, std::vector<RefCountedPt
 	parent->SetName(nodename);
 
 	//nodes named collision_* are not added as renderable geometry
-	if (node->mNumMeshes == 1 && starts_with(nodename, "collision_")) {
+	if (node.meshes.size() == 1 && starts_with(nodename, "collision_")) {
 		const unsigned int collflag = GetGeomFlagForNodeName(nodename);
-		RefCountedPtr<Graphics::Surface> surf = surfaces.at(node->mMeshes[0]);
+		RefCountedPtr<Graphics::Surface> surf = surfaces.at(node.meshes[0]);
 		RefCountedPtr<CollisionGeometry> cgeom(new CollisionGeometry(surf.Get(), collflag));
 		cgeom->SetName(nodename + "_cgeom");
 		parent->AddChild(cgeom.Get());
@@ -715,7 +892,7 @@ void Loader::ConvertNodes(aiNode *node, Group *_parent, std::vector<RefCountedPt
 	}
 
 	//nodes with visible geometry (StaticGeometry and decals)
-	if (node->mNumMeshes > 0) {
+	if (!node.meshes.empty()) {
 		//is this node animated? add a transform
 		//does this node have children? Add a group
 		RefCountedPtr<StaticGeometry> geom(new StaticGeometry());
@@ -736,8 +913,8 @@ void Loader::ConvertNodes(aiNode *node, Group *_parent, std::vector<RefCountedPt
 				throw LoadingError("More than 4 different decals");
 		}
 
-		for(unsigned int i=0; i<node->mNumMeshes; i++) {
-			RefCountedPtr<Graphics::Surface> surf = surfaces.at(node->mMeshes[i]);
+		for(unsigned int i=0; i<node.meshes.size(); i++) {
+			RefCountedPtr<Graphics::Surface> surf = surfaces.at(node.meshes[i]);
 
 			//Mark the entire node as transparent (all importers split by material so far)
 			if (surf->GetMaterial()->diffuse.a < 0.999f) {
@@ -771,18 +948,31 @@ void Loader::ConvertNodes(aiNode *node, Group *_parent, std::vector<RefCountedPt
 		parent->AddChild(geom.Get());
 	}
 
-	for(unsigned int i=0; i<node->mNumChildren; i++) {
-		aiNode *child = node->mChildren[i];
-		ConvertNodes(child, parent, surfaces, accum * m);
+	for(unsigned int i=0; i<node.children.size(); i++) {
+		ConvertNodes(data, node.children[i], parent, surfaces, accum * m);
 	}
 }
 
 void Loader::LoadCollision(const std::string &filename)
 {
-	//Convert all found aiMeshes into a geomtree. Materials,
-	//Animations and node structure can be ignored
 	assert(m_model);
 
+	std::map<std::string, CollisionMeshData>::iterator it = m_collisionMeshes.find(filename);
+	if (it == m_collisionMeshes.end()) {
+		CollisionMeshData data;
+		ImportCollision(filename, data);
+		it = m_collisionMeshes.insert(std::make_pair(filename, data)).first;
+		m_cacheChanged = true;
+	}
+
+	//add pre-transformed geometry at the top level
+	m_model->GetRoot()->AddChild(new CollisionGeometry(it->second.vertices, it->second.indices, 0));
+}
+
+void Loader::ImportCollision(const std::string &filename, CollisionMeshData &out)
+{
+	//Convert all found aiMeshes into a geomtree. Materials,
+	//Animations and node structure can be ignored
 	Assimp::Importer importer;
 	importer.SetIOHandler(new AssimpFileSystem(FileSystem::gameDataFiles));
 
@@ -806,8 +996,8 @@ void Loader::LoadCollision(const std::string &filename)
 	if(scene->mNumMeshes == 0)
 		throw LoadingError("No geometry found");
 
-	std::vector<unsigned short> indices;
-	std::vector<vector3f> vertices;
+	std::vector<unsigned short> &indices = out.indices;
+	std::vector<vector3f> &vertices = out.vertices;
 	unsigned int indexOffset = 0;
 
 	for(unsigned int i=0; i<scene->mNumMeshes; i++) {
@@ -821,7 +1011,7 @@ void Loader::LoadCollision(const std::string &filename)
 				indices.push_back(indexOffset + face->mIndices[j]);
 			}
 		}
-		indexOffset += mesh->mNumFaces*3;
+		indexOffset += mesh->mNumVertices;
 
 		//vertices
 		for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
@@ -831,9 +1021,130 @@ void Loader::LoadCollision(const std::string &filename)
 	}
 
 	assert(!vertices.empty() && !vertices.empty());
+}
 
-	//add pre-transformed geometry at the top level
-	m_model->GetRoot()->AddChild(new CollisionGeometry(vertices, indices, 0));
+static void AddFileToChecksum(CRC32 &crc, const std::string &path)
+{
+	crc.AddData(path.c_str(), path.size());
+	RefCountedPtr<FileSystem::FileData> data = FileSystem::gameDataFiles.ReadFile(path);
+	if (data)
+		crc.AddData(data->GetData(), data->GetSize());
+}
+
+//everything the imported meshes come from: the .model, the mesh files, and
+//any .mtl files beside .obj meshes. textures aren't cached so they don't count
+Uint32 Loader::CalcCacheChecksum(const std::string &modelPath, const ModelDefinition &def)
+{
+	std::set<std::string> files;
+	for (std::vector<LodDefinition>::const_iterator lod = def.lodDefs.begin(); lod != def.lodDefs.end(); ++lod)
+		files.insert((*lod).meshNames.begin(), (*lod).meshNames.end());
+	files.insert(def.collisionDefs.begin(), def.collisionDefs.end());
+
+	std::set<std::string> mtlDirs;
+	for (std::set<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
+		if (ends_with(*it, ".obj")) {
+			const size_t slash = (*it).rfind('/');
+			mtlDirs.insert(slash == std::string::npos ? std::string() : (*it).substr(0, slash));
+		}
+	}
+	for (std::set<std::string>::const_iterator dir = mtlDirs.begin(); dir != mtlDirs.end(); ++dir) {
+		for (FileSystem::FileEnumerator mtls(FileSystem::gameDataFiles, *dir); !mtls.Finished(); mtls.Next()) {
+			const FileSystem::FileInfo &info = mtls.Current();
+			if (info.IsFile() && ends_with(info.GetPath(), ".mtl"))
+				files.insert(info.GetPath());
+		}
+	}
+
+	CRC32 crc;
+	AddFileToChecksum(crc, modelPath);
+	for (std::set<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+		AddFileToChecksum(crc, *it);
+	return crc.GetChecksum();
+}
+
+/* Layout, in Serializer format:
+ *   "SGMODEL", cache version, checksum
+ *   number of meshes, then for each its filename and a "mesh" section
+ *   number of collision meshes, then for each its filename and a
+ *   "collision" section
+ * The file is read in one go and the meshes read straight out of it. If
+ * anything doesn't match, nothing is used and the meshes are imported again */
+void Loader::ReadCache(const std::string &name, Uint32 checksum)
+{
+	const std::string path = FileSystem::JoinPathBelow(CACHE_DIR, name) + ".bin";
+	RefCountedPtr<FileSystem::FileData> file = FileSystem::userFiles.ReadFile(path);
+	if (!file) return;
+
+	std::map<std::string, MeshData> meshes;
+	std::map<std::string, CollisionMeshData> collisionMeshes;
+	try {
+		Serializer::Reader rd(file);
+		if (rd.String() != "SGMODEL") return;
+		if (rd.Int32() != CACHE_VERSION) return;
+		if (rd.Int32() != checksum) return;
+
+		for (Uint32 n = rd.Int32(); n > 0; n--) {
+			const std::string filename = rd.String();
+			Serializer::Reader section = rd.RdSection("mesh");
+			MeshData &data = meshes[filename];
+			data.Load(section);
+			if (!section.AtEnd()) return;
+		}
+		for (Uint32 n = rd.Int32(); n > 0; n--) {
+			const std::string filename = rd.String();
+			Serializer::Reader section = rd.RdSection("collision");
+			CollisionMeshData &data = collisionMeshes[filename];
+			data.Load(section);
+			if (!section.AtEnd()) return;
+		}
+		if (!rd.AtEnd()) return;
+	} catch (SavedGameCorruptException) {
+		fprintf(stderr, "model cache for %s is damaged, rebuilding it\n", name.c_str());
+		return;
+	}
+
+	m_meshes.swap(meshes);
+	m_collisionMeshes.swap(collisionMeshes);
+}
+
+void Loader::WriteCache(const std::string &name, Uint32 checksum)
+{
+	FileSystem::userFiles.MakeDirectory("model_cache");
+	FileSystem::userFiles.MakeDirectory(CACHE_DIR);
+
+	const std::string path = FileSystem::JoinPathBelow(CACHE_DIR, name) + ".bin";
+	FILE *f = FileSystem::userFiles.OpenWriteStream(path);
+	if (!f) {
+		fprintf(stderr, "couldn't write model cache %s\n", path.c_str());
+		return;
+	}
+
+	try {
+		Serializer::Writer wr(f);
+		wr.String("SGMODEL");
+		wr.Int32(CACHE_VERSION);
+		wr.Int32(checksum);
+
+		wr.Int32(m_meshes.size());
+		for (std::map<std::string, MeshData>::const_iterator it = m_meshes.begin(); it != m_meshes.end(); ++it) {
+			wr.String(it->first);
+			wr.BeginSection("mesh");
+			it->second.Save(wr);
+			wr.EndSection();
+		}
+		wr.Int32(m_collisionMeshes.size());
+		for (std::map<std::string, CollisionMeshData>::const_iterator it = m_collisionMeshes.begin(); it != m_collisionMeshes.end(); ++it) {
+			wr.String(it->first);
+			wr.BeginSection("collision");
+			it->second.Save(wr);
+			wr.EndSection();
+		}
+		wr.Flush();
+	} catch (CouldNotWriteToFileException) {
+		// a partly written cache fails to read and is rebuilt next time
+		fprintf(stderr, "couldn't write model cache %s\n", path.c_str());
+	}
+	fclose(f);
 }
 
 unsigned int Loader::GetGeomFlagForNodeName(const std::string &nodename)
@@ -8,19 +8,20 @@
  *  .model files are simple text files
  *  they are read into definition structures using a crummy parser, and
  *  then a scenegraph can be created with meshes loaded by assimp.
+ *  What assimp gives back is kept in the user's model_cache/newmodels/,
+ *  and used instead until the .model or one of its meshes changes.
  */
 #include "libs.h"
 #include "Model.h"
 #include "LoaderDefinitions.h"
+#include "MeshData.h"
 #include "graphics/Material.h"
 #include "graphics/Surface.h"
+#include "graphics/TextureBuilder.h"
 #include "text/DistanceFieldFont.h"
 #include <assimp/types.h>
 
 struct aiNode;
-struct aiMesh;
-struct aiScene;
-struct aiNodeAnim;
 
 namespace Graphics { class Renderer; }
 
@@ -28,36 +29,82 @@ namespace SceneGraph {
 
 class StaticGeometry;
 
+//a texture a model was given a placeholder for. Upload() creates the real
+//one and puts it in the material
+struct PendingTexture {
+	PendingTexture(const RefCountedPtr<Graphics::Material> &mat, int slot_, const Graphics::TextureBuilder &b) :
+		material(mat), slot(slot_), builder(b) { }
+	void Upload(Graphics::Renderer *r);
+
+	RefCountedPtr<Graphics::Material> material;
+	int slot; //texture0..2
+	Graphics::TextureBuilder builder;
+};
+
 class Loader {
 public:
-	Loader(Graphics::Renderer *r);
+	// rebuildCache: import every mesh again, even if the cache is up to date
+	// writeCache: save what was imported to the cache
+	Loader(Graphics::Renderer *r, bool rebuildCache = false, bool writeCache = true);
 	~Loader();
 	//find & attempt to load a model, based on filename (without path or .model suffix)
 	Model *LoadModel(const std::string &name);
 	Model *LoadModel(const std::string &name, const std::string &basepath);
 
+	//LoadModel in two halves. PrepareModel does everything that doesn't
+	//need the renderer (parsing, importing meshes or reading them from the
+	//cache, decoding textures) so it can run on another thread.
+	//CreatePreparedModel then builds the model on the main thread. given a
+	//list, textures the renderer doesn't have yet get a placeholder and are
+	//added to the list to be uploaded later
+	void PrepareModel(const std::string &name, const std::string &basepath = "models");
+	Model *CreatePreparedModel(std::vector<PendingTexture> *pendingTextures = 0);
+
 private:
 	Graphics::Renderer *m_renderer;
 	std::string m_curPath;
+	bool m_rebuildCache;
+	bool m_writeCache;
+
+	//filled in by PrepareModel
+	ModelDefinition m_modelDef;
+	//imported meshes by filename, from the cache or from assimp
+	std::map<std::string, MeshData> m_meshes;
+	std::map<std::string, CollisionMeshData> m_collisionMeshes;
+	bool m_cacheChanged;
+	//decoded material textures by filename
+	std::map<std::string, Graphics::TextureBuilder> m_textures;
+
+	std::vector<PendingTexture> *m_pendingTextures;
 
 	Model *m_model;
 	RefCountedPtr<Text::DistanceFieldFont> m_labelFont;
 
-	bool CheckKeysInRange(const aiNodeAnim *, double start, double end);
+	bool CheckKeysInRange(const MeshChannel &, double start, double end);
 	Graphics::Texture *GetWhiteTexture() const;
+	Graphics::Texture *GetTexture(const std::string &filename, const RefCountedPtr<Graphics::Material> &mat, int slot, const char *placeholder);
 	matrix4x4f ConvertMatrix(const aiMatrix4x4&) const;
 	Model *CreateModel(ModelDefinition &def);
 	RefCountedPtr<Graphics::Material> GetDecalMaterial(unsigned int index);
 	RefCountedPtr<Node> LoadMesh(const std::string &filename, const AnimList &animDefs, TagList &modelTags); //load one mesh file so it can be added to the model scenegraph. Materials should be created before this!
-	void ConvertAiMeshesToSurfaces(std::vector<RefCountedPtr<Graphics::Surface> >&, const aiScene*, Model*); //model is only for material lookup
-	void ConvertAnimations(const aiScene *, const AnimList &, Node *meshRoot);
-	void ConvertNodes(aiNode *node, Group *parent, std::vector<RefCountedPtr<Graphics::Surface> >& meshes, const matrix4x4f&);
+	void ConvertSurfaces(std::vector<RefCountedPtr<Graphics::Surface> >&, const MeshData&, Model*); //model is only for material lookup
+	void ConvertAnimations(const MeshData &, const AnimList &, Node *meshRoot);
+	void ConvertNodes(const MeshData &, Uint32 nodeIndex, Group *parent, std::vector<RefCountedPtr<Graphics::Surface> >& meshes, const matrix4x4f&);
 	void CreateLabel(Group *parent, const matrix4x4f&);
 	void CreateLight(Group *parent, const matrix4x4f&);
 	void CreateThruster(Group *parent, const matrix4x4f& nodeTrans, const std::string &name, const matrix4x4f &accum);
 	void FindPatterns(PatternContainer &output); //find pattern texture files from the model directory
 	void LoadCollision(const std::string &filename);
 
+	//assimp import, only when the mesh isn't in the cache
+	void ImportMesh(const std::string &filename, MeshData &out);
+	Uint32 ImportNode(const aiNode *node, MeshData &out);
+	void ImportCollision(const std::string &filename, CollisionMeshData &out);
+
+	Uint32 CalcCacheChecksum(const std::string &modelPath, const ModelDefinition &def);
+	void ReadCache(const std::string &name, Uint32 checksum);
+	void WriteCache(const std::string &name, Uint32 checksum);
+
 	unsigned int GetGeomFlagForNodeName(const std::string&);
 };
 
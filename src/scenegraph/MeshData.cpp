@@ -0,0 +1,192 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "MeshData.h"
+
+namespace SceneGraph {
+
+// counts are read back one element at a time rather than used to size the
+// vectors up front, so a damaged count runs off the end of the data and
+// throws instead of asking for a silly amount of memory
+
+static void WriteVector3f(Serializer::Writer &wr, const vector3f &v)
+{
+	wr.Float(v.x);
+	wr.Float(v.y);
+	wr.Float(v.z);
+}
+
+static vector3f ReadVector3f(Serializer::Reader &rd)
+{
+	vector3f v;
+	v.x = rd.Float();
+	v.y = rd.Float();
+	v.z = rd.Float();
+	return v;
+}
+
+static void WriteVector3fs(Serializer::Writer &wr, const std::vector<vector3f> &vs)
+{
+	wr.Int32(vs.size());
+	for (std::vector<vector3f>::const_iterator it = vs.begin(); it != vs.end(); ++it)
+		WriteVector3f(wr, *it);
+}
+
+static void ReadVector3fs(Serializer::Reader &rd, std::vector<vector3f> &vs)
+{
+	for (Uint32 n = rd.Int32(); n > 0; n--)
+		vs.push_back(ReadVector3f(rd));
+}
+
+static void WriteIndices(Serializer::Writer &wr, const std::vector<unsigned short> &indices)
+{
+	wr.Int32(indices.size());
+	for (std::vector<unsigned short>::const_iterator it = indices.begin(); it != indices.end(); ++it)
+		wr.Int16(*it);
+}
+
+static void ReadIndices(Serializer::Reader &rd, std::vector<unsigned short> &indices)
+{
+	for (Uint32 n = rd.Int32(); n > 0; n--)
+		indices.push_back(rd.Int16());
+}
+
+static void WriteInts(Serializer::Writer &wr, const std::vector<Uint32> &xs)
+{
+	wr.Int32(xs.size());
+	for (std::vector<Uint32>::const_iterator it = xs.begin(); it != xs.end(); ++it)
+		wr.Int32(*it);
+}
+
+static void ReadInts(Serializer::Reader &rd, std::vector<Uint32> &xs)
+{
+	for (Uint32 n = rd.Int32(); n > 0; n--)
+		xs.push_back(rd.Int32());
+}
+
+void MeshData::Save(Serializer::Writer &wr) const
+{
+	wr.Int32(surfaces.size());
+	for (std::vector<MeshSurface>::const_iterator it = surfaces.begin(); it != surfaces.end(); ++it) {
+		wr.String(it->materialName);
+		wr.Int32(it->materialIndex);
+		WriteVector3fs(wr, it->positions);
+		WriteVector3fs(wr, it->normals);
+		wr.Int32(it->uvs.size());
+		for (std::vector<vector2f>::const_iterator uv = it->uvs.begin(); uv != it->uvs.end(); ++uv) {
+			wr.Float(uv->x);
+			wr.Float(uv->y);
+		}
+		WriteIndices(wr, it->indices);
+	}
+
+	wr.Int32(nodes.size());
+	for (std::vector<MeshNode>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+		wr.String(it->name);
+		for (int i = 0; i < 16; i++)
+			wr.Float(it->transform[i]);
+		WriteInts(wr, it->meshes);
+		WriteInts(wr, it->children);
+	}
+
+	wr.Int32(numAnimations);
+	wr.Double(ticksPerSecond);
+	wr.Int32(channels.size());
+	for (std::vector<MeshChannel>::const_iterator it = channels.begin(); it != channels.end(); ++it) {
+		wr.String(it->nodeName);
+		wr.Int32(it->positionKeys.size());
+		for (std::vector<PositionKey>::const_iterator key = it->positionKeys.begin(); key != it->positionKeys.end(); ++key) {
+			wr.Double(key->time);
+			WriteVector3f(wr, key->position);
+		}
+		wr.Int32(it->rotationKeys.size());
+		for (std::vector<RotationKey>::const_iterator key = it->rotationKeys.begin(); key != it->rotationKeys.end(); ++key) {
+			wr.Double(key->time);
+			wr.WrQuaternionf(key->rotation);
+		}
+		wr.Int32(it->scaleKeys.size());
+		for (std::vector<ScaleKey>::const_iterator key = it->scaleKeys.begin(); key != it->scaleKeys.end(); ++key) {
+			wr.Double(key->time);
+			WriteVector3f(wr, key->scale);
+		}
+	}
+}
+
+void MeshData::Load(Serializer::Reader &rd)
+{
+	for (Uint32 n = rd.Int32(); n > 0; n--) {
+		surfaces.push_back(MeshSurface());
+		MeshSurface &surf = surfaces.back();
+		surf.materialName = rd.String();
+		surf.materialIndex = rd.Int32();
+		ReadVector3fs(rd, surf.positions);
+		ReadVector3fs(rd, surf.normals);
+		for (Uint32 i = rd.Int32(); i > 0; i--) {
+			const float x = rd.Float();
+			const float y = rd.Float();
+			surf.uvs.push_back(vector2f(x, y));
+		}
+		ReadIndices(rd, surf.indices);
+		if (surf.normals.size() != surf.positions.size() || surf.uvs.size() != surf.positions.size())
+			throw SavedGameCorruptException();
+		for (std::vector<unsigned short>::const_iterator i = surf.indices.begin(); i != surf.indices.end(); ++i)
+			if (*i >= surf.positions.size()) throw SavedGameCorruptException();
+	}
+
+	for (Uint32 n = rd.Int32(); n > 0; n--) {
+		nodes.push_back(MeshNode());
+		MeshNode &node = nodes.back();
+		node.name = rd.String();
+		for (int i = 0; i < 16; i++)
+			node.transform[i] = rd.Float();
+		ReadInts(rd, node.meshes);
+		ReadInts(rd, node.children);
+	}
+
+	// the loader follows these without checking. nodes are stored parents
+	// first, so children always come later and there can't be a loop
+	for (Uint32 n = 0; n < nodes.size(); n++) {
+		const MeshNode &node = nodes[n];
+		for (std::vector<Uint32>::const_iterator i = node.meshes.begin(); i != node.meshes.end(); ++i)
+			if (*i >= surfaces.size()) throw SavedGameCorruptException();
+		for (std::vector<Uint32>::const_iterator i = node.children.begin(); i != node.children.end(); ++i)
+			if (*i <= n || *i >= nodes.size()) throw SavedGameCorruptException();
+	}
+	if (nodes.empty()) throw SavedGameCorruptException();
+
+	numAnimations = rd.Int32();
+	ticksPerSecond = rd.Double();
+	for (Uint32 n = rd.Int32(); n > 0; n--) {
+		channels.push_back(MeshChannel());
+		MeshChannel &chan = channels.back();
+		chan.nodeName = rd.String();
+		for (Uint32 i = rd.Int32(); i > 0; i--) {
+			const double time = rd.Double();
+			chan.positionKeys.push_back(PositionKey(time, ReadVector3f(rd)));
+		}
+		for (Uint32 i = rd.Int32(); i > 0; i--) {
+			const double time = rd.Double();
+			chan.rotationKeys.push_back(RotationKey(time, rd.RdQuaternionf()));
+		}
+		for (Uint32 i = rd.Int32(); i > 0; i--) {
+			const double time = rd.Double();
+			chan.scaleKeys.push_back(ScaleKey(time, ReadVector3f(rd)));
+		}
+	}
+}
+
+void CollisionMeshData::Save(Serializer::Writer &wr) const
+{
+	WriteVector3fs(wr, vertices);
+	WriteIndices(wr, indices);
+}
+
+void CollisionMeshData::Load(Serializer::Reader &rd)
+{
+	ReadVector3fs(rd, vertices);
+	ReadIndices(rd, indices);
+	for (std::vector<unsigned short>::const_iterator i = indices.begin(); i != indices.end(); ++i)
+		if (*i >= vertices.size()) throw SavedGameCorruptException();
+}
+
+}
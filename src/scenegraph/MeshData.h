@@ -0,0 +1,68 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SCENEGRAPH_MESHDATA_H
+#define _SCENEGRAPH_MESHDATA_H
+/*
+ * A mesh file as imported by assimp, cut down to what the loader builds
+ * the scenegraph from. Importing is by far the slowest part of loading a
+ * model, so the loader keeps these in a cache file per model and reads
+ * them back while the source files haven't changed.
+ */
+#include "libs.h"
+#include "AnimationKey.h"
+#include "Serializer.h"
+
+namespace SceneGraph {
+
+struct MeshSurface {
+	std::string materialName; // empty if the file doesn't name it
+	Uint32 materialIndex;
+	std::vector<vector3f> positions;
+	std::vector<vector3f> normals;
+	std::vector<vector2f> uvs;
+	std::vector<unsigned short> indices;
+};
+
+struct MeshNode {
+	std::string name;
+	matrix4x4f transform;
+	std::vector<Uint32> meshes;   // into MeshData::surfaces
+	std::vector<Uint32> children; // into MeshData::nodes
+};
+
+// all the keys of one node, split into animations by the loader
+struct MeshChannel {
+	std::string nodeName;
+	std::vector<PositionKey> positionKeys;
+	std::vector<RotationKey> rotationKeys;
+	std::vector<ScaleKey> scaleKeys;
+};
+
+struct MeshData {
+	MeshData(): numAnimations(0), ticksPerSecond(0.0) {}
+
+	std::vector<MeshSurface> surfaces;
+	std::vector<MeshNode> nodes; // the first is the root
+	Uint32 numAnimations;        // only the first is kept
+	double ticksPerSecond;
+	std::vector<MeshChannel> channels;
+
+	void Save(Serializer::Writer &wr) const;
+	// throws SavedGameCorruptException if the data is damaged
+	void Load(Serializer::Reader &rd);
+};
+
+// a collision mesh, with its transforms already applied
+struct CollisionMeshData {
+	std::vector<vector3f> vertices;
+	std::vector<unsigned short> indices;
+
+	void Save(Serializer::Writer &wr) const;
+	// throws SavedGameCorruptException if the data is damaged
+	void Load(Serializer::Reader &rd);
+};
+
+}
+
+#endif
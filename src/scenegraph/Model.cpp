@@ -4,6 +4,7 @@
 #include "Model.h"
 #include "CollisionVisitor.h"
 #include "graphics/Renderer.h"
+#include "graphics/RenderQueue.h"
 
 namespace SceneGraph {
 
@@ -16,6 +17,24 @@ public:
 	std::string label;
 };
 
+// the transparent pass of a model, drawn once the render queue's solids are
+class TransparentPass : public Graphics::RenderQueue::Deferred {
+public:
+	TransparentPass(Group *root, const matrix4x4f &trans, const RenderData &params) :
+		m_root(root), m_trans(trans), m_params(params) {
+		m_params.nodemask = NODE_TRANSPARENT;
+	}
+	virtual void Render(Graphics::Renderer *r) {
+		r->SetTransform(m_trans);
+		m_root->Render(r, m_trans, &m_params);
+	}
+
+private:
+	RefCountedPtr<Group> m_root;
+	matrix4x4f m_trans;
+	RenderData m_params;
+};
+
 Model::Model(const std::string &name)
 : ModelBase()
 , m_lastTime(0.0)
@@ -46,7 +65,13 @@ void Model::Render(Graphics::Renderer *renderer, const matrix4x4f &trans, LmrObj
 		params->nodemask = NODE_SOLID;
 		m_root->Render(renderer, trans, params);
 		params->nodemask = NODE_TRANSPARENT;
-		m_root->Render(renderer, trans, params);
+		// queued, the solids are drawn later so the transparent pass has
+		// to be too
+		Graphics::RenderQueue *queue = renderer->GetRenderQueue();
+		if (queue)
+			queue->AddDeferred(new TransparentPass(m_root.Get(), trans, *params), trans.GetTranslate().Length());
+		else
+			m_root->Render(renderer, trans, params);
 	}
 }
 
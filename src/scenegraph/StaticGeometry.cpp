@@ -5,6 +5,7 @@
 #include "NodeVisitor.h"
 #include "graphics/Graphics.h"
 #include "graphics/Renderer.h"
+#include "graphics/RenderQueue.h"
 #include "graphics/Surface.h"
 #include "graphics/Material.h"
 
@@ -27,6 +28,13 @@ void StaticGeometry::Accept(NodeVisitor &nv)
 
 void StaticGeometry::Render(Graphics::Renderer *r, const matrix4x4f &trans, RenderData *rd)
 {
+	Graphics::RenderQueue *queue = r->GetRenderQueue();
+	if (queue) {
+		for (MeshContainer::iterator it = m_meshes.begin(); it != m_meshes.end(); ++it)
+			queue->AddStaticMesh(it->Get(), trans, m_blendMode);
+		return;
+	}
+
 	r->SetTransform(trans);
 	if (m_blendMode != Graphics::BLEND_SOLID)
 		r->SetBlendMode(m_blendMode);
@@ -43,6 +43,14 @@ public:
 	virtual double GetHeight(const vector3d &p) = 0;
 	virtual vector3d GetColor(const vector3d &p, double height, const vector3d &norm) = 0;
 
+	// batch versions of the above, for count points at once, with one
+	// virtual call for the lot. each fractal's file has the loop with the
+	// per point work inline and anything that only depends on the body
+	// worked out before it. the single point versions are the batch ones
+	// with a count of 1, so the results are exactly the same
+	virtual void GetHeights(const vector3d *p, double *heights, int count) = 0;
+	virtual void GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, int count) = 0;
+
 	virtual const char *GetHeightFractalName() const = 0;
 	virtual const char *GetColorFractalName() const = 0;
 
@@ -120,6 +128,7 @@ template <typename HeightFractal>
 class TerrainHeightFractal : virtual public Terrain {
 public:
 	virtual double GetHeight(const vector3d &p);
+	virtual void GetHeights(const vector3d *p, double *heights, int count);
 	virtual const char *GetHeightFractalName() const;
 protected:
 	TerrainHeightFractal(const SystemBody *body);
@@ -131,6 +140,7 @@ template <typename ColorFractal>
 class TerrainColorFractal : virtual public Terrain {
 public:
 	virtual vector3d GetColor(const vector3d &p, double height, const vector3d &norm);
+	virtual void GetColors(const vector3d *p, const double *heights, const vector3d *norms, vector3d *colors, int count);
 	virtual const char *GetColorFractalName() const;
 protected:
 	TerrainColorFractal(const SystemBody *body);
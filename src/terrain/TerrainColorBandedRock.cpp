@@ -15,11 +15,23 @@ TerrainColorFractal<TerrainColorBandedRock>::TerrainColorFractal(const SystemBod
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorBandedRock>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorBandedRock>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	const double flatness = pow(p.Dot(norm), 6.0);
-	double n = fabs(noise(vector3d(height*10000.0,0.0,0.0)));
-	vector3d col = interpolate_color(n, m_rockColor[0], m_rockColor[1]);
-	return interpolate_color(flatness, col, m_rockColor[2]);
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		const double height = heights[i];
+		const vector3d &norm = norms[i];
+		const double flatness = pow(p.Dot(norm), 6.0);
+		double n = fabs(noise(vector3d(height*10000.0,0.0,0.0)));
+		vector3d col = interpolate_color(n, m_rockColor[0], m_rockColor[1]);
+		colors[i] = interpolate_color(flatness, col, m_rockColor[2]);
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorBandedRock>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorBandedRock>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
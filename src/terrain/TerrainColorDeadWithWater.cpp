@@ -16,10 +16,22 @@ TerrainColorFractal<TerrainColorDeadWithWater>::TerrainColorFractal(const System
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorDeadWithWater>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorDeadWithWater>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = m_invMaxHeight*height;
-	if (n <= 0) return vector3d(0.0,0.0,0.5);
-	else return interpolate_color(n, vector3d(.2,.2,.2), vector3d(.6,.6,.6));
+	const double invMaxHeight = m_invMaxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const double height = heights[i];
+		double n = invMaxHeight*height;
+		if (n <= 0) { colors[i] = vector3d(0.0,0.0,0.5); continue; }
+		else colors[i] = interpolate_color(n, vector3d(.2,.2,.2), vector3d(.6,.6,.6));
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorDeadWithWater>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorDeadWithWater>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
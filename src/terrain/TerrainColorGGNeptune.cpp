@@ -25,16 +25,26 @@ TerrainColorFractal<TerrainColorGGNeptune>::TerrainColorFractal(const SystemBody
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorGGNeptune>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorGGNeptune>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = 0.8*octavenoise(GetFracDef(2), 0.6, vector3d(3.142*p.y*p.y));
-	n += 0.25*ridged_octavenoise(GetFracDef(3), 0.55, vector3d(3.142*p.y*p.y));
-	n += 0.2*octavenoise(GetFracDef(3), 0.5, vector3d(3.142*p.y*p.y));
-	//spot
-	n += 0.8*billow_octavenoise(GetFracDef(1), 0.8, vector3d(noise(p*3.142)*p))*
-		 megavolcano_function(GetFracDef(0), p);
-	n /= 2.0;
-	n *= n*n;
-	return interpolate_color(n, vector3d(.04, .05, .15), vector3d(.80,.94,.96));
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = 0.8*octavenoise(GetFracDef(2), 0.6, vector3d(3.142*p.y*p.y));
+		n += 0.25*ridged_octavenoise(GetFracDef(3), 0.55, vector3d(3.142*p.y*p.y));
+		n += 0.2*octavenoise(GetFracDef(3), 0.5, vector3d(3.142*p.y*p.y));
+		//spot
+		n += 0.8*billow_octavenoise(GetFracDef(1), 0.8, vector3d(noise(p*3.142)*p))*
+			 megavolcano_function(GetFracDef(0), p);
+		n /= 2.0;
+		n *= n*n;
+		colors[i] = interpolate_color(n, vector3d(.04, .05, .15), vector3d(.80,.94,.96));
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorGGNeptune>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorGGNeptune>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
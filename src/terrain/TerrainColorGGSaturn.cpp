@@ -24,17 +24,27 @@ TerrainColorFractal<TerrainColorGGSaturn>::TerrainColorFractal(const SystemBody
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorGGSaturn>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorGGSaturn>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = 0.4*ridged_octavenoise(GetFracDef(0), 0.7, vector3d(3.142*p.y*p.y));
-	n += 0.4*octavenoise(GetFracDef(1), 0.6, vector3d(3.142*p.y*p.y));
-	n += 0.3*octavenoise(GetFracDef(2), 0.5, vector3d(3.142*p.y*p.y));
-	n += 0.8*octavenoise(GetFracDef(0), 0.7, vector3d(p*p.y*p.y));
-	n += 0.5*ridged_octavenoise(GetFracDef(1), 0.7, vector3d(p*p.y*p.y));
-	n /= 2.0;
-	n *= n*n;
-	n += billow_octavenoise(GetFracDef(0), 0.8, vector3d(noise(p*3.142)*p))*
-		 megavolcano_function(GetFracDef(3), p);
-	return interpolate_color(n, vector3d(.69, .53, .43), vector3d(.99, .76, .62));
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = 0.4*ridged_octavenoise(GetFracDef(0), 0.7, vector3d(3.142*p.y*p.y));
+		n += 0.4*octavenoise(GetFracDef(1), 0.6, vector3d(3.142*p.y*p.y));
+		n += 0.3*octavenoise(GetFracDef(2), 0.5, vector3d(3.142*p.y*p.y));
+		n += 0.8*octavenoise(GetFracDef(0), 0.7, vector3d(p*p.y*p.y));
+		n += 0.5*ridged_octavenoise(GetFracDef(1), 0.7, vector3d(p*p.y*p.y));
+		n /= 2.0;
+		n *= n*n;
+		n += billow_octavenoise(GetFracDef(0), 0.8, vector3d(noise(p*3.142)*p))*
+			 megavolcano_function(GetFracDef(3), p);
+		colors[i] = interpolate_color(n, vector3d(.69, .53, .43), vector3d(.99, .76, .62));
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorGGSaturn>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorGGSaturn>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
@@ -24,42 +24,57 @@ TerrainColorFractal<TerrainColorGGSaturn2>::TerrainColorFractal(const SystemBody
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorGGSaturn2>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorGGSaturn2>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = 0.2*billow_octavenoise(GetFracDef(0), 0.8, p*p.y*p.y);
-	n += 0.5*ridged_octavenoise(GetFracDef(1), 0.7, p*p.y*p.y);
-	n += 0.25*octavenoise(GetFracDef(2), 0.7, p*p.y*p.y);
-	//spot
-	n *= n*n*0.5;
-	n += billow_octavenoise(GetFracDef(0), 0.8, noise(p*3.142)*p)*
-		 megavolcano_function(GetFracDef(3), p);
-	vector3d col;
-	//col = interpolate_color(octavenoise(GetFracDef(2), 0.7, noise(p*3.142)*p), vector3d(.05, .0, .0), vector3d(.4,.0,.35));
-	if (n > 1.0) {
-		n -= 1.0;// n *= 5.0;
-		col = interpolate_color(n, vector3d(.25, .3, .4), vector3d(.0, .2, .0) );
-	} else if (n >0.8) {
-		n -= 0.8; n *= 5.0;
-		col = interpolate_color(n, vector3d(.0, .0, .15), vector3d(.25, .3, .4) );
-		return col;
-	} else if (n>0.6) {
-		n -= 0.6; n*= 5.0;
-		col = interpolate_color(n, vector3d(.0, .0, .1), vector3d(.0, .0, .15) );
-		return col;
-	} else if (n>0.4) {
-		n -= 0.4; n*= 5.0;
-		col = interpolate_color(n, vector3d(.05, .0, .05), vector3d(.0, .0, .1) );
-		return col;
-	} else if (n>0.2) {
-		n -= 0.2; n*= 5.0;
-		col = interpolate_color(n, vector3d(.0, .0, .1), vector3d(.05, .0, .05) );
-		return col;
-	} else {
-		n *= 5.0;
-		col = interpolate_color(n, vector3d(.0, .0, .0), vector3d(.0, .0, .1) );
-		return col;
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = 0.2*billow_octavenoise(GetFracDef(0), 0.8, p*p.y*p.y);
+		n += 0.5*ridged_octavenoise(GetFracDef(1), 0.7, p*p.y*p.y);
+		n += 0.25*octavenoise(GetFracDef(2), 0.7, p*p.y*p.y);
+		//spot
+		n *= n*n*0.5;
+		n += billow_octavenoise(GetFracDef(0), 0.8, noise(p*3.142)*p)*
+			 megavolcano_function(GetFracDef(3), p);
+		vector3d col;
+		//col = interpolate_color(octavenoise(GetFracDef(2), 0.7, noise(p*3.142)*p), vector3d(.05, .0, .0), vector3d(.4,.0,.35));
+		if (n > 1.0) {
+			n -= 1.0;// n *= 5.0;
+			col = interpolate_color(n, vector3d(.25, .3, .4), vector3d(.0, .2, .0) );
+		} else if (n >0.8) {
+			n -= 0.8; n *= 5.0;
+			col = interpolate_color(n, vector3d(.0, .0, .15), vector3d(.25, .3, .4) );
+			colors[i] = col;
+			continue;
+		} else if (n>0.6) {
+			n -= 0.6; n*= 5.0;
+			col = interpolate_color(n, vector3d(.0, .0, .1), vector3d(.0, .0, .15) );
+			colors[i] = col;
+			continue;
+		} else if (n>0.4) {
+			n -= 0.4; n*= 5.0;
+			col = interpolate_color(n, vector3d(.05, .0, .05), vector3d(.0, .0, .1) );
+			colors[i] = col;
+			continue;
+		} else if (n>0.2) {
+			n -= 0.2; n*= 5.0;
+			col = interpolate_color(n, vector3d(.0, .0, .1), vector3d(.05, .0, .05) );
+			colors[i] = col;
+			continue;
+		} else {
+			n *= 5.0;
+			col = interpolate_color(n, vector3d(.0, .0, .0), vector3d(.0, .0, .1) );
+			colors[i] = col;
+			continue;
+		}
+		// never happens, just silencing a warning
+		colors[i] = col;
 	}
-	// never happens, just silencing a warning
-	return col;
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorGGSaturn2>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorGGSaturn2>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
@@ -19,13 +19,23 @@ TerrainColorFractal<TerrainColorGGUranus>::TerrainColorFractal(const SystemBody
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorGGUranus>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorGGUranus>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = 0.5*ridged_octavenoise(GetFracDef(0), 0.7, vector3d(3.142*p.y*p.y));
-	n += 0.5*octavenoise(GetFracDef(1), 0.6, vector3d(3.142*p.y*p.y));
-	n += 0.2*octavenoise(GetFracDef(2), 0.5, vector3d(3.142*p.y*p.y));
-	n /= 2.0;
-	n *= n*n;
-	return interpolate_color(n, vector3d(.4, .5, .55), vector3d(.85,.95,.96));
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = 0.5*ridged_octavenoise(GetFracDef(0), 0.7, vector3d(3.142*p.y*p.y));
+		n += 0.5*octavenoise(GetFracDef(1), 0.6, vector3d(3.142*p.y*p.y));
+		n += 0.2*octavenoise(GetFracDef(2), 0.5, vector3d(3.142*p.y*p.y));
+		n /= 2.0;
+		n *= n*n;
+		colors[i] = interpolate_color(n, vector3d(.4, .5, .55), vector3d(.85,.95,.96));
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorGGUranus>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorGGUranus>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
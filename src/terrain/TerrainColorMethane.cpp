@@ -15,10 +15,22 @@ TerrainColorFractal<TerrainColorMethane>::TerrainColorFractal(const SystemBody *
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorMethane>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorMethane>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = m_invMaxHeight*height;
-	if (n <= 0) return vector3d(.3,.0,.0);
-	else return interpolate_color(n, vector3d(.3,.2,.0), vector3d(.6,.3,.0));
+	const double invMaxHeight = m_invMaxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const double height = heights[i];
+		double n = invMaxHeight*height;
+		if (n <= 0) { colors[i] = vector3d(.3,.0,.0); continue; }
+		else colors[i] = interpolate_color(n, vector3d(.3,.2,.0), vector3d(.6,.3,.0));
+	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorMethane>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorMethane>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
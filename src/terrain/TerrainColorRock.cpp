@@ -15,121 +15,146 @@ TerrainColorFractal<TerrainColorRock>::TerrainColorFractal(const SystemBody *bod
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorRock>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorRock>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n = m_invMaxHeight*height/2;
-	if (n <= 0) return m_darkrockColor[0];
-	const double flatness = pow(p.Dot(norm), 20.0);
-	const vector3d color_cliffs = m_rockColor[0];
-	double equatorial_desert = (2.0-m_icyness)*(-1.0+2.0*octavenoise(4, 0.05, 2.0, (n*2.0)*p)) *
-		1.0*(2.0-m_icyness)*(1.0-p.y*p.y);
-	//double equatorial_region = octavenoise(GetFracDef(0), 0.54, p) * p.y * p.x;
-	//double equatorial_region_2 = ridged_octavenoise(GetFracDef(1), 0.58, p) * p.x * p.x;
-	// Below is to do with variable colours for different heights, it gives a nice effect.
-	// n is height.
-	vector3d col, tex1, tex2;
-	col = interpolate_color(equatorial_desert, m_rockColor[2], m_darkrockColor[4]);
-	//col = interpolate_color(equatorial_region, col, m_darkrockColor[4]);
-	//col = interpolate_color(equatorial_region_2, m_rockColor[1], col);
-	if (n > 0.9) {
-		n -= 0.9; n *= 10.0;
-		col = interpolate_color(n, m_rockColor[5], col );
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.8) {
-		n -= 0.8; n *= 10.0;
-		col = interpolate_color(n, col, m_rockColor[5]);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.7) {
-		n -= 0.7; n *= 10.0;
-		col = interpolate_color(n, m_rockColor[4], col);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.6) {
-		n -= 0.6; n *= 10.0;
-		col = interpolate_color(n, m_rockColor[1], m_rockColor[4]);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.5) {
-		n -= 0.5; n *= 10.0;
-		col = interpolate_color(n, col, m_rockColor[1]);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.4) {
-		n -= 0.4; n *= 10.0;
-		col = interpolate_color(n, m_darkrockColor[3], col);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	if (n > 0.3) {
-		n -= 0.3; n *= 10.0;
-		col = interpolate_color(n, col, m_darkrockColor[3]);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, m_darkrockColor[6]);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.2) {
-		n -= 0.2; n *= 10.0;
-		col = interpolate_color(n, m_rockColor[1], col);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else if (n > 0.1) {
-		n -= 0.1; n *= 10.0;
-		col = interpolate_color(n, col, m_rockColor[1]);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
-	}
-	else {
-		n *= 10.0;
-		col = interpolate_color(n, m_darkrockColor[0], col);
-		if (textures) {
-			tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
-			tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
-			col = interpolate_color(flatness, tex1, tex2);
-		} else col = interpolate_color(flatness, color_cliffs, col);
-	return col;
+	const bool textured = textures;
+	const double invMaxHeight = m_invMaxHeight;
+	const double desertScale = 2.0-m_icyness;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		const double height = heights[i];
+		const vector3d &norm = norms[i];
+		double n = invMaxHeight*height/2;
+		if (n <= 0) { colors[i] = m_darkrockColor[0]; continue; }
+		const double flatness = pow(p.Dot(norm), 20.0);
+		const vector3d color_cliffs = m_rockColor[0];
+		double equatorial_desert = desertScale*(-1.0+2.0*octavenoise(4, 0.05, 2.0, (n*2.0)*p)) *
+			1.0*desertScale*(1.0-p.y*p.y);
+		//double equatorial_region = octavenoise(GetFracDef(0), 0.54, p) * p.y * p.x;
+		//double equatorial_region_2 = ridged_octavenoise(GetFracDef(1), 0.58, p) * p.x * p.x;
+		// Below is to do with variable colours for different heights, it gives a nice effect.
+		// n is height.
+		vector3d col, tex1, tex2;
+		col = interpolate_color(equatorial_desert, m_rockColor[2], m_darkrockColor[4]);
+		//col = interpolate_color(equatorial_region, col, m_darkrockColor[4]);
+		//col = interpolate_color(equatorial_region_2, m_rockColor[1], col);
+		if (n > 0.9) {
+			n -= 0.9; n *= 10.0;
+			col = interpolate_color(n, m_rockColor[5], col );
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.8) {
+			n -= 0.8; n *= 10.0;
+			col = interpolate_color(n, col, m_rockColor[5]);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.7) {
+			n -= 0.7; n *= 10.0;
+			col = interpolate_color(n, m_rockColor[4], col);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.6) {
+			n -= 0.6; n *= 10.0;
+			col = interpolate_color(n, m_rockColor[1], m_rockColor[4]);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.5) {
+			n -= 0.5; n *= 10.0;
+			col = interpolate_color(n, col, m_rockColor[1]);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.4) {
+			n -= 0.4; n *= 10.0;
+			col = interpolate_color(n, m_darkrockColor[3], col);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		if (n > 0.3) {
+			n -= 0.3; n *= 10.0;
+			col = interpolate_color(n, col, m_darkrockColor[3]);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, m_darkrockColor[6]);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.2) {
+			n -= 0.2; n *= 10.0;
+			col = interpolate_color(n, m_rockColor[1], col);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else if (n > 0.1) {
+			n -= 0.1; n *= 10.0;
+			col = interpolate_color(n, col, m_rockColor[1]);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock2, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, m_rockColor[3]);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		continue;
+		}
+		else {
+			n *= 10.0;
+			col = interpolate_color(n, m_darkrockColor[0], col);
+			if (textured) {
+				tex1 = interpolate_color(terrain_colournoise_rock, col, color_cliffs);
+				tex2 = interpolate_color(terrain_colournoise_mud, col, color_cliffs);
+				col = interpolate_color(flatness, tex1, tex2);
+			} else col = interpolate_color(flatness, color_cliffs, col);
+		colors[i] = col;
+		}
 	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorRock>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorRock>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
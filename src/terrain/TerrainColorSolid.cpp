@@ -11,8 +11,18 @@ TerrainColorFractal<TerrainColorSolid>::TerrainColorFractal(const SystemBody *bo
 {
 }
 
+template <>
+void TerrainColorFractal<TerrainColorSolid>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
+{
+	for (int i = 0; i < count; i++) {
+		colors[i] = vector3d(1.0);
+	}
+}
+
 template <>
 vector3d TerrainColorFractal<TerrainColorSolid>::GetColor(const vector3d &p, double height, const vector3d &norm)
 {
-	return vector3d(1.0);
+	vector3d color;
+	TerrainColorFractal<TerrainColorSolid>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
 }
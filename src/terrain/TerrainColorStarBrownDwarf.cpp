@@ -18,23 +18,35 @@ TerrainColorFractal<TerrainColorStarBrownDwarf>::TerrainColorFractal(const Syste
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorStarBrownDwarf>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorStarBrownDwarf>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n;
-	vector3d col;
-	n = voronoiscam_octavenoise(GetFracDef(0), 0.6, p) * 0.5;
-	if (n > 0.666) {
-		n -= 0.666; n *= 3.0;
-		col = interpolate_color(n, vector3d(.25, .2, .2), vector3d(.1, .0, .0) );
-		return col;
-	} else if (n > 0.333) {
-		n -= 0.333; n *= 3.0;
-		col = interpolate_color(n, vector3d(.2, .25, .1), vector3d(.25, .2, .2) );
-		return col;
-	} else {
-		n *= 3.0;
-		col = interpolate_color(n, vector3d(1.5, 1.0, 1.0), vector3d(.2, .25, .1) );
-		return col;
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n;
+		vector3d col;
+		n = voronoiscam_octavenoise(GetFracDef(0), 0.6, p) * 0.5;
+		if (n > 0.666) {
+			n -= 0.666; n *= 3.0;
+			col = interpolate_color(n, vector3d(.25, .2, .2), vector3d(.1, .0, .0) );
+			colors[i] = col;
+			continue;
+		} else if (n > 0.333) {
+			n -= 0.333; n *= 3.0;
+			col = interpolate_color(n, vector3d(.2, .25, .1), vector3d(.25, .2, .2) );
+			colors[i] = col;
+			continue;
+		} else {
+			n *= 3.0;
+			col = interpolate_color(n, vector3d(1.5, 1.0, 1.0), vector3d(.2, .25, .1) );
+			colors[i] = col;
+		}
 	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorStarBrownDwarf>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorStarBrownDwarf>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
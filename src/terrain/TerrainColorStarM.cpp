@@ -22,32 +22,44 @@ TerrainColorFractal<TerrainColorStarM>::TerrainColorFractal(const SystemBody *bo
 using namespace TerrainFeature;
 
 template <>
-vector3d TerrainColorFractal<TerrainColorStarM>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorStarM>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n;
-	vector3d col;
-	n = ridged_octavenoise(GetFracDef(0), 0.6, p) * 0.5;
-	n += ridged_octavenoise(GetFracDef(1), 0.7, p) * 0.5;
-	n += ridged_octavenoise(GetFracDef(0), 0.8, p) * ridged_octavenoise(GetFracDef(1), 0.8, p);
-	n *= n * n;
-	n += ridged_octavenoise(GetFracDef(2), 0.6, p) * 0.5;
-	n += ridged_octavenoise(GetFracDef(3), 0.6, p) * 0.5;
-	n += 15.0*billow_octavenoise(GetFracDef(0), 0.8, noise(p*3.142)*p)*
-	 megavolcano_function(GetFracDef(1), p);
-	n *= 0.15;
-	n = 1.0-n;
-	if (n > 0.666) {
-		n -= 0.666; n *= 3.0;
-		col = interpolate_color(n, vector3d(.65, .5, .25), vector3d(1.0, 1.0, 1.0) );
-		return col;
-	} else if (n > 0.333) {
-		n -= 0.333; n *= 3.0;
-		col = interpolate_color(n, vector3d(.3, .1, .0), vector3d(.65, .5, .25) );
-		return col;
-	} else {
-		n *= 3.0;
-		col = interpolate_color(n, vector3d(.03, .0, .0), vector3d(.3, .1, .0) );
-		return col;
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n;
+		vector3d col;
+		n = ridged_octavenoise(GetFracDef(0), 0.6, p) * 0.5;
+		n += ridged_octavenoise(GetFracDef(1), 0.7, p) * 0.5;
+		n += ridged_octavenoise(GetFracDef(0), 0.8, p) * ridged_octavenoise(GetFracDef(1), 0.8, p);
+		n *= n * n;
+		n += ridged_octavenoise(GetFracDef(2), 0.6, p) * 0.5;
+		n += ridged_octavenoise(GetFracDef(3), 0.6, p) * 0.5;
+		n += 15.0*billow_octavenoise(GetFracDef(0), 0.8, noise(p*3.142)*p)*
+		 megavolcano_function(GetFracDef(1), p);
+		n *= 0.15;
+		n = 1.0-n;
+		if (n > 0.666) {
+			n -= 0.666; n *= 3.0;
+			col = interpolate_color(n, vector3d(.65, .5, .25), vector3d(1.0, 1.0, 1.0) );
+			colors[i] = col;
+			continue;
+		} else if (n > 0.333) {
+			n -= 0.333; n *= 3.0;
+			col = interpolate_color(n, vector3d(.3, .1, .0), vector3d(.65, .5, .25) );
+			colors[i] = col;
+			continue;
+		} else {
+			n *= 3.0;
+			col = interpolate_color(n, vector3d(.03, .0, .0), vector3d(.3, .1, .0) );
+			colors[i] = col;
+		}
 	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorStarM>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorStarM>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
@@ -21,26 +21,38 @@ TerrainColorFractal<TerrainColorStarWhiteDwarf>::TerrainColorFractal(const Syste
 }
 
 template <>
-vector3d TerrainColorFractal<TerrainColorStarWhiteDwarf>::GetColor(const vector3d &p, double height, const vector3d &norm)
+void TerrainColorFractal<TerrainColorStarWhiteDwarf>::GetColors(const vector3d *points, const double *heights, const vector3d *norms, vector3d *colors, int count)
 {
-	double n;
-	vector3d col;
-	n = ridged_octavenoise(GetFracDef(0), 0.8, p*p.x);
-	n += ridged_octavenoise(GetFracDef(1), 0.8, p);
-	n += voronoiscam_octavenoise(GetFracDef(0), 0.8 * octavenoise(GetFracDef(1), 0.6, p), p);
-	n *= n*n;
-	if (n > 0.666) {
-		n -= 0.666; n *= 3.0;
-		col = interpolate_color(n, vector3d(.8, .8, 1.0), vector3d(1.0, 1.0, 1.0));
-		return col;
-	} else if (n > 0.333) {
-		n -= 0.333; n *= 3.0;
-		col = interpolate_color(n, vector3d(.6, .8, .8), vector3d(.8, .8, 1.0));
-		return col;
-	} else {
-		n *= 3.0;
-		col = interpolate_color(n, vector3d(.0, .0, .9), vector3d(.6, .8, .8));
-		return col;
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n;
+		vector3d col;
+		n = ridged_octavenoise(GetFracDef(0), 0.8, p*p.x);
+		n += ridged_octavenoise(GetFracDef(1), 0.8, p);
+		n += voronoiscam_octavenoise(GetFracDef(0), 0.8 * octavenoise(GetFracDef(1), 0.6, p), p);
+		n *= n*n;
+		if (n > 0.666) {
+			n -= 0.666; n *= 3.0;
+			col = interpolate_color(n, vector3d(.8, .8, 1.0), vector3d(1.0, 1.0, 1.0));
+			colors[i] = col;
+			continue;
+		} else if (n > 0.333) {
+			n -= 0.333; n *= 3.0;
+			col = interpolate_color(n, vector3d(.6, .8, .8), vector3d(.8, .8, 1.0));
+			colors[i] = col;
+			continue;
+		} else {
+			n *= 3.0;
+			col = interpolate_color(n, vector3d(.0, .0, .9), vector3d(.6, .8, .8));
+			colors[i] = col;
+		}
 	}
 }
 
+template <>
+vector3d TerrainColorFractal<TerrainColorStarWhiteDwarf>::GetColor(const vector3d &p, double height, const vector3d &norm)
+{
+	vector3d color;
+	TerrainColorFractal<TerrainColorStarWhiteDwarf>::GetColors(&p, &height, &norm, &color, 1);
+	return color;
+}
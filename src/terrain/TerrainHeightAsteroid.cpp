@@ -18,19 +18,32 @@ TerrainHeightFractal<TerrainHeightAsteroid>::TerrainHeightFractal(const SystemBo
 {
 }
 
+template <>
+void TerrainHeightFractal<TerrainHeightAsteroid>::GetHeights(const vector3d *points, double *heights, int count)
+{
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		//p.x = 3*(p.y-p.x);
+		//p.y = (-p.x*p.z) + (26.5*p.x) - p.y;
+		//p.z = (p.x*p.y) - p.z;
+		//float heightmap = octavenoise(64, 0.4, 1.6, 12.0*(3*(p.y-p.x), (-p.x*p.z) + (26.5*p.x) - p.y, (p.x*p.y) - p.z) );
+		//Lorenz attractor:
+		//float heightmap = octavenoise(8, 0.5, 2.0, (3*(p.y-p.x), (-p.x*p.z) + (26.5*p.x) - p.y, (p.x*p.y) - p.z) );
+		//float heightmap = octavenoise(8, 0.2*octavenoise(1, 0.3, 3.7, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 15.0*octavenoise(1, 0.5, 4.0, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), (p.x*2.0-p.y, p.y*2.0-p.x, p.z)) -
+			//0.75*billow_octavenoise(8*octavenoise(1, 0.275, 3.2, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 0.4*octavenoise(1, 0.4, 3.0, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 4.0*octavenoise(1, 0.35, 3.7, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), (p.x*2.0-p.y, p.y*2.0-p.x, p.z));
+
+		double n = octavenoise(8, 0.4, 2.4, p);
+
+		heights[i] = (n > 0.0? maxHeight*n : 0.0);
+	}
+}
+
 template <>
 double TerrainHeightFractal<TerrainHeightAsteroid>::GetHeight(const vector3d &p)
 {
-	//p.x = 3*(p.y-p.x);
-	//p.y = (-p.x*p.z) + (26.5*p.x) - p.y;
-	//p.z = (p.x*p.y) - p.z;
-	//float heightmap = octavenoise(64, 0.4, 1.6, 12.0*(3*(p.y-p.x), (-p.x*p.z) + (26.5*p.x) - p.y, (p.x*p.y) - p.z) );
-	//Lorenz attractor:
-	//float heightmap = octavenoise(8, 0.5, 2.0, (3*(p.y-p.x), (-p.x*p.z) + (26.5*p.x) - p.y, (p.x*p.y) - p.z) );
-	//float heightmap = octavenoise(8, 0.2*octavenoise(1, 0.3, 3.7, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 15.0*octavenoise(1, 0.5, 4.0, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), (p.x*2.0-p.y, p.y*2.0-p.x, p.z)) -
-		//0.75*billow_octavenoise(8*octavenoise(1, 0.275, 3.2, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 0.4*octavenoise(1, 0.4, 3.0, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), 4.0*octavenoise(1, 0.35, 3.7, (p.x*2.0-p.y, p.y*2.0-p.x, p.z)), (p.x*2.0-p.y, p.y*2.0-p.x, p.z));
-
-	double n = octavenoise(8, 0.4, 2.4, p);
-
-	return (n > 0.0? m_maxHeight*n : 0.0);
+	double height;
+	TerrainHeightFractal<TerrainHeightAsteroid>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -19,9 +19,22 @@ TerrainHeightFractal<TerrainHeightAsteroid3>::TerrainHeightFractal(const SystemB
 }
 
 template <>
-double TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeight(const vector3d &p)
+void TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeights(const vector3d *points, double *heights, int count)
 {
-	double n = octavenoise(8, 0.5, 4.0, p) * ridged_octavenoise(8, 0.5, 4.0, p);
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = octavenoise(8, 0.5, 4.0, p) * ridged_octavenoise(8, 0.5, 4.0, p);
+
+		heights[i] = (n > 0.0? maxHeight*n : 0.0);
+	}
+}
 
-	return (n > 0.0? m_maxHeight*n : 0.0);
+template <>
+double TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeight(const vector3d &p)
+{
+	double height;
+	TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeights(&p, &height, 1);
+	return height;
 }
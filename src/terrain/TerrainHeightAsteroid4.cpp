@@ -19,10 +19,23 @@ TerrainHeightFractal<TerrainHeightAsteroid4>::TerrainHeightFractal(const SystemB
 }
 
 template <>
-double TerrainHeightFractal<TerrainHeightAsteroid4>::GetHeight(const vector3d &p)
+void TerrainHeightFractal<TerrainHeightAsteroid4>::GetHeights(const vector3d *points, double *heights, int count)
 {
-	double n = octavenoise(6, 0.2*octavenoise(2, 0.3, 3.7, p), 2.8*ridged_octavenoise(3, 0.5, 3.0, p), p) *
-		0.75*ridged_octavenoise(16*octavenoise(3, 0.275, 2.9, p), 0.3*octavenoise(2, 0.4, 3.0, p), 2.8*ridged_octavenoise(8, 0.35, 2.7, p), p);
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = octavenoise(6, 0.2*octavenoise(2, 0.3, 3.7, p), 2.8*ridged_octavenoise(3, 0.5, 3.0, p), p) *
+			0.75*ridged_octavenoise(16*octavenoise(3, 0.275, 2.9, p), 0.3*octavenoise(2, 0.4, 3.0, p), 2.8*ridged_octavenoise(8, 0.35, 2.7, p), p);
+
+		heights[i] = (n > 0.0? maxHeight*n : 0.0);
+	}
+}
 
-	return (n > 0.0? m_maxHeight*n : 0.0);
+template <>
+double TerrainHeightFractal<TerrainHeightAsteroid4>::GetHeight(const vector3d &p)
+{
+	double height;
+	TerrainHeightFractal<TerrainHeightAsteroid4>::GetHeights(&p, &height, 1);
+	return height;
 }
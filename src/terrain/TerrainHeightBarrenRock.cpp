@@ -22,13 +22,26 @@ TerrainHeightFractal<TerrainHeightBarrenRock>::TerrainHeightFractal(const System
 }
 
 template <>
-double TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeight(const vector3d &p)
+void TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeights(const vector3d *points, double *heights, int count)
 {
-	/*return std::max(0.0, m_maxHeight * (octavenoise(GetFracDef(0), 0.5, p) +
-			GetFracDef(1).amplitude * crater_function(GetFracDef(1), p)));*/
-			//fuck the fracdefs, direct control is better:
-	double n = ridged_octavenoise(16, 0.5*octavenoise(8, 0.4, 2.5, p),Clamp(5.0*octavenoise(8, 0.257, 4.0, p), 1.0, 5.0), p);
-	n = m_maxHeight*2.0*n*n;
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		/*return std::max(0.0, maxHeight * (octavenoise(GetFracDef(0), 0.5, p) +
+				GetFracDef(1).amplitude * crater_function(GetFracDef(1), p)));*/
+				//fuck the fracdefs, direct control is better:
+		double n = ridged_octavenoise(16, 0.5*octavenoise(8, 0.4, 2.5, p),Clamp(5.0*octavenoise(8, 0.257, 4.0, p), 1.0, 5.0), p);
+		n = maxHeight*2.0*n*n;
+
+		heights[i] = (n > 0.0? n : 0.0);
+	}
+}
 
-	return (n > 0.0? n : 0.0);
+template <>
+double TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeight(const vector3d &p)
+{
+	double height;
+	TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -20,10 +20,22 @@ TerrainHeightFractal<TerrainHeightBarrenRock2>::TerrainHeightFractal(const Syste
 }
 
 template <>
-double TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeight(const vector3d &p)
+void TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeights(const vector3d *points, double *heights, int count)
 {
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double n = billow_octavenoise(16, 0.3*octavenoise(8, 0.4, 2.5, p),Clamp(5.0*ridged_octavenoise(8, 0.377, 4.0, p), 1.0, 5.0), p);
 
-	double n = billow_octavenoise(16, 0.3*octavenoise(8, 0.4, 2.5, p),Clamp(5.0*ridged_octavenoise(8, 0.377, 4.0, p), 1.0, 5.0), p);
+		heights[i] = (n > 0.0? maxHeight*n : 0.0);
+	}
+}
 
-	return (n > 0.0? m_maxHeight*n : 0.0);
+template <>
+double TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeight(const vector3d &p)
+{
+	double height;
+	TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -19,10 +19,22 @@ TerrainHeightFractal<TerrainHeightBarrenRock3>::TerrainHeightFractal(const Syste
 }
 
 template <>
-double TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeight(const vector3d &p)
+void TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeights(const vector3d *points, double *heights, int count)
 {
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		float n = 0.07*voronoiscam_octavenoise(12, Clamp(fabs(0.165 - (0.38*river_octavenoise(12, 0.4, 2.5, p))), 0.15, 0.5),Clamp(8.0*billow_octavenoise(12, 0.37, 4.0, p), 0.5, 9.0), p);
 
-	float n = 0.07*voronoiscam_octavenoise(12, Clamp(fabs(0.165 - (0.38*river_octavenoise(12, 0.4, 2.5, p))), 0.15, 0.5),Clamp(8.0*billow_octavenoise(12, 0.37, 4.0, p), 0.5, 9.0), p);
+		heights[i] = (n > 0.0? maxHeight*n : 0.0);
+	}
+}
 
-	return (n > 0.0? m_maxHeight*n : 0.0);
+template <>
+double TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeight(const vector3d &p)
+{
+	double height;
+	TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -11,8 +11,18 @@ TerrainHeightFractal<TerrainHeightFlat>::TerrainHeightFractal(const SystemBody *
 {
 }
 
+template <>
+void TerrainHeightFractal<TerrainHeightFlat>::GetHeights(const vector3d *points, double *heights, int count)
+{
+	for (int i = 0; i < count; i++) {
+		heights[i] = 0.0;
+	}
+}
+
 template <>
 double TerrainHeightFractal<TerrainHeightFlat>::GetHeight(const vector3d &p)
 {
-	return 0.0;
+	double height;
+	TerrainHeightFractal<TerrainHeightFlat>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -26,24 +26,38 @@ TerrainHeightFractal<TerrainHeightHillsCraters2>::TerrainHeightFractal(const Sys
 	SetFracDef(8, m_maxHeightInMeters*0.04, 9e5, 100.0*m_fracmult);
 }
 
+template <>
+void TerrainHeightFractal<TerrainHeightHillsCraters2>::GetHeights(const vector3d *points, double *heights, int count)
+{
+	const double sealevel = m_sealevel;
+	const double maxHeight = m_maxHeight;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double continents = octavenoise(GetFracDef(0), 0.5, p) - sealevel;
+		if (continents < 0) { heights[i] = 0; continue; }
+		// == TERRAIN_HILLS_NORMAL except river_octavenoise
+		double n = 0.3 * continents;
+		double distrib = river_octavenoise(GetFracDef(2), 0.5, p);
+		double m = GetFracDef(1).amplitude * river_octavenoise(GetFracDef(1), 0.5*distrib, p);
+		// cliffs at shore
+		if (continents < 0.001) n += m * continents * 1000.0f;
+		else n += m;
+		n += crater_function(GetFracDef(3), p);
+		n += crater_function(GetFracDef(4), p);
+		n += crater_function(GetFracDef(5), p);
+		n += crater_function(GetFracDef(6), p);
+		n += crater_function(GetFracDef(7), p);
+		n += crater_function(GetFracDef(8), p);
+		n *= maxHeight;
+		heights[i] = (n > 0.0 ? n : 0.0);
+	}
+}
+
 template <>
 double TerrainHeightFractal<TerrainHeightHillsCraters2>::GetHeight(const vector3d &p)
 {
-	double continents = octavenoise(GetFracDef(0), 0.5, p) - m_sealevel;
-	if (continents < 0) return 0;
-	// == TERRAIN_HILLS_NORMAL except river_octavenoise
-	double n = 0.3 * continents;
-	double distrib = river_octavenoise(GetFracDef(2), 0.5, p);
-	double m = GetFracDef(1).amplitude * river_octavenoise(GetFracDef(1), 0.5*distrib, p);
-	// cliffs at shore
-	if (continents < 0.001) n += m * continents * 1000.0f;
-	else n += m;
-	n += crater_function(GetFracDef(3), p);
-	n += crater_function(GetFracDef(4), p);
-	n += crater_function(GetFracDef(5), p);
-	n += crater_function(GetFracDef(6), p);
-	n += crater_function(GetFracDef(7), p);
-	n += crater_function(GetFracDef(8), p);
-	n *= m_maxHeight;
-	return (n > 0.0 ? n : 0.0);
+	double height;
+	TerrainHeightFractal<TerrainHeightHillsCraters2>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -28,27 +28,43 @@ TerrainHeightFractal<TerrainHeightHillsNormal>::TerrainHeightFractal(const Syste
 	SetFracDef(6-m_fracnum, m_maxHeightInMeters*0.000000005, 1000, 20*m_fracmult);
 }
 
+template <>
+void TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeights(const vector3d *points, double *heights, int count)
+{
+	const int fracnum = m_fracnum;
+	const double maxHeight = m_maxHeight;
+	const double landScale = 1.0-m_sealevel;
+	const double seaDrop = m_sealevel*0.1;
+
+	for (int i = 0; i < count; i++) {
+		const vector3d &p = points[i];
+		double continents = octavenoise(GetFracDef(3-fracnum), 0.65, p) * landScale - seaDrop;
+		if (continents < 0) { heights[i] = 0; continue; }
+		double n = continents;
+		double distrib = octavenoise(GetFracDef(4-fracnum), 0.5, p);
+		distrib *= distrib;
+		double m = 0.5*GetFracDef(3-fracnum).amplitude * octavenoise(GetFracDef(4-fracnum), 0.55*distrib, p)
+		           * GetFracDef(5-fracnum).amplitude;
+		m += 0.25*billow_octavenoise(GetFracDef(5-fracnum), 0.55*distrib, p);
+		//hill footings
+		m -= octavenoise(GetFracDef(2-fracnum), 0.6*(1.0-distrib), p)
+	         * Clamp(0.05-m, 0.0, 0.05) * Clamp(0.05-m, 0.0, 0.05);
+		//hill footings
+		m += voronoiscam_octavenoise(GetFracDef(6-fracnum), 0.765*distrib, p)
+	         * Clamp(0.025-m, 0.0, 0.025) * Clamp(0.025-m, 0.0, 0.025);
+		// cliffs at shore
+		if (continents < 0.01) n += m * continents * 100.0f;
+		else n += m;
+
+		if (n > 0.0) { heights[i] = n*maxHeight; continue; }
+	    heights[i] = 0.0;
+	}
+}
+
 template <>
 double TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeight(const vector3d &p)
 {
-	double continents = octavenoise(GetFracDef(3-m_fracnum), 0.65, p) * (1.0-m_sealevel) - (m_sealevel*0.1);
-	if (continents < 0) return 0;
-	double n = continents;
-	double distrib = octavenoise(GetFracDef(4-m_fracnum), 0.5, p);
-	distrib *= distrib;
-	double m = 0.5*GetFracDef(3-m_fracnum).amplitude * octavenoise(GetFracDef(4-m_fracnum), 0.55*distrib, p)
-	           * GetFracDef(5-m_fracnum).amplitude;
-	m += 0.25*billow_octavenoise(GetFracDef(5-m_fracnum), 0.55*distrib, p);
-	//hill footings
-	m -= octavenoise(GetFracDef(2-m_fracnum), 0.6*(1.0-distrib), p)
-         * Clamp(0.05-m, 0.0, 0.05) * Clamp(0.05-m, 0.0, 0.05);
-	//hill footings
-	m += voronoiscam_octavenoise(GetFracDef(6-m_fracnum), 0.765*distrib, p)
-         * Clamp(0.025-m, 0.0, 0.025) * Clamp(0.025-m, 0.0, 0.025);
-	// cliffs at shore
-	if (continents < 0.01) n += m * continents * 100.0f;
-	else n += m;
-
-	if (n > 0.0) return n*m_maxHeight;
-    return 0.0;
+	double height;
+	TerrainHeightFractal<TerrainHeightHillsNormal>::GetHeights(&p, &height, 1);
+	return height;
 }
@@ -0,0 +1,64 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "Kepler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const double EARTH_MU = 3.986004418e14;
+
+static bool close_to(const vector3d &a, const vector3d &b, double tolerance)
+{
+	return (a - b).Length() <= tolerance * std::max(b.Length(), 1.0);
+}
+
+static double energy(double mu, const vector3d &pos, const vector3d &vel)
+{
+	return 0.5 * vel.LengthSqr() - (mu > 0.0 ? mu / pos.Length() : 0.0);
+}
+
+// propagates forward then back again, which should land where it started,
+// and checks the orbit's energy is the same at the far end
+static void round_trip(const char *what, double mu, const vector3d &pos, const vector3d &vel, double dt)
+{
+	vector3d midPos, midVel, endPos, endVel;
+	const bool forward = Kepler::Propagate(mu, pos, vel, dt, midPos, midVel);
+	const bool back = forward && Kepler::Propagate(mu, midPos, midVel, -dt, endPos, endVel);
+	printf("%s:\n", what);
+	CHECK(forward && back);
+	if (!forward || !back) return;
+	CHECK(close_to(endPos, pos, 1e-6));
+	CHECK(close_to(endVel, vel, 1e-6));
+	const double e0 = energy(mu, pos, vel), e1 = energy(mu, midPos, midVel);
+	CHECK(fabs(e1 - e0) <= 1e-6 * std::max(fabs(e0), 1.0));
+}
+
+int test_kepler()
+{
+	const int failuresBefore = test_failures();
+
+	const vector3d pos(7.0e6, 0.0, 0.0);
+	const double vCircular = sqrt(EARTH_MU / pos.x);
+
+	round_trip("circular", EARTH_MU, pos, vector3d(0.0, vCircular, 0.0), 1000.0);
+	round_trip("elliptic", EARTH_MU, pos, vector3d(0.0, 1.2 * vCircular, 0.1 * vCircular), 20000.0);
+	round_trip("hyperbolic", EARTH_MU, pos, vector3d(1000.0, 2.0 * vCircular, 0.0), 50000.0);
+	round_trip("no mass", 0.0, pos, vector3d(10.0, 20.0, -30.0), 100.0);
+
+	// once round a circular orbit comes back to the start
+	{
+		const vector3d vel(0.0, vCircular, 0.0);
+		const double period = 2.0 * M_PI * pos.x / vCircular;
+		vector3d endPos, endVel;
+		printf("full circle:\n");
+		CHECK(Kepler::Propagate(EARTH_MU, pos, vel, period, endPos, endVel));
+		CHECK(close_to(endPos, pos, 1e-6));
+		CHECK(close_to(endVel, vel, 1e-6));
+	}
+
+	const int failures = test_failures() - failuresBefore;
+	printf("kepler: %d failures\n", failures);
+	return failures;
+}
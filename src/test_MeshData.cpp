@@ -0,0 +1,171 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "scenegraph/MeshData.h"
+#include <cstdio>
+
+using namespace SceneGraph;
+
+// floats are stored as they are, so they come back exactly
+static bool same_vec(const vector3f &a, const vector3f &b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool same_vecs(const std::vector<vector3f> &a, const std::vector<vector3f> &b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++)
+		if (!same_vec(a[i], b[i])) return false;
+	return true;
+}
+
+static bool same_surface(const MeshSurface &a, const MeshSurface &b)
+{
+	if (a.uvs.size() != b.uvs.size()) return false;
+	for (size_t i = 0; i < a.uvs.size(); i++)
+		if (a.uvs[i].x != b.uvs[i].x || a.uvs[i].y != b.uvs[i].y) return false;
+	return a.materialName == b.materialName && a.materialIndex == b.materialIndex &&
+		same_vecs(a.positions, b.positions) && same_vecs(a.normals, b.normals) && a.indices == b.indices;
+}
+
+static bool same_node(const MeshNode &a, const MeshNode &b)
+{
+	for (int i = 0; i < 16; i++)
+		if (a.transform[i] != b.transform[i]) return false;
+	return a.name == b.name && a.meshes == b.meshes && a.children == b.children;
+}
+
+static MeshData make_mesh()
+{
+	MeshData data;
+
+	data.surfaces.push_back(MeshSurface());
+	MeshSurface &surf = data.surfaces.back();
+	surf.materialName = "hull";
+	surf.materialIndex = 3;
+	for (int i = 0; i < 4; i++) {
+		surf.positions.push_back(vector3f(float(i), float(i & 1), -float(i)));
+		surf.normals.push_back(vector3f(0.f, 0.f, 1.f));
+		surf.uvs.push_back(vector2f(0.25f * i, 0.5f));
+	}
+	const unsigned short indices[] = { 0, 1, 2, 2, 1, 3 };
+	surf.indices.assign(indices, indices + 6);
+
+	data.nodes.push_back(MeshNode());
+	data.nodes.back().name = "root";
+	data.nodes.back().transform = matrix4x4f::Identity();
+	data.nodes.back().children.push_back(1);
+	data.nodes.push_back(MeshNode());
+	data.nodes.back().name = "thruster_0";
+	data.nodes.back().transform = matrix4x4f::Translation(1.f, 2.f, 3.f);
+	data.nodes.back().meshes.push_back(0);
+
+	data.numAnimations = 1;
+	data.ticksPerSecond = 24.0;
+	data.channels.push_back(MeshChannel());
+	MeshChannel &chan = data.channels.back();
+	chan.nodeName = "thruster_0";
+	chan.positionKeys.push_back(PositionKey(0.0, vector3f(1.f, 2.f, 3.f)));
+	chan.positionKeys.push_back(PositionKey(12.0, vector3f(1.f, 2.f, 4.f)));
+	chan.rotationKeys.push_back(RotationKey(6.0, Quaternionf(0.5f, 0.5f, 0.5f, 0.5f)));
+	chan.scaleKeys.push_back(ScaleKey(3.0, vector3f(2.f)));
+
+	return data;
+}
+
+// the model cache keeps meshes as MeshData, so what's saved has to come
+// back the same, and damage has to be caught before the loader trusts it
+int test_meshdata()
+{
+	const int failuresBefore = test_failures();
+
+	const MeshData mesh = make_mesh();
+	Serializer::Writer wr;
+	mesh.Save(wr);
+	const std::string saved = wr.GetData();
+	{
+		MeshData loaded;
+		Serializer::Reader rd(saved);
+		loaded.Load(rd);
+		CHECK(rd.AtEnd());
+		CHECK(loaded.surfaces.size() == 1 && same_surface(loaded.surfaces[0], mesh.surfaces[0]));
+		CHECK(loaded.nodes.size() == 2 && same_node(loaded.nodes[0], mesh.nodes[0]) && same_node(loaded.nodes[1], mesh.nodes[1]));
+		CHECK(loaded.numAnimations == 1 && loaded.ticksPerSecond == 24.0);
+		CHECK(loaded.channels.size() == 1);
+		if (loaded.channels.size() == 1) {
+			const MeshChannel &chan = loaded.channels[0];
+			CHECK(chan.nodeName == "thruster_0");
+			CHECK(chan.positionKeys.size() == 2 && chan.positionKeys[1].time == 12.0 &&
+				same_vec(chan.positionKeys[1].position, vector3f(1.f, 2.f, 4.f)));
+			CHECK(chan.rotationKeys.size() == 1 && chan.rotationKeys[0].rotation.w == 0.5f &&
+				chan.rotationKeys[0].rotation.z == 0.5f);
+			CHECK(chan.scaleKeys.size() == 1 && same_vec(chan.scaleKeys[0].scale, vector3f(2.f)));
+		}
+	}
+
+	// an index past the end of the vertices
+	{
+		MeshData bad = make_mesh();
+		bad.surfaces[0].indices.push_back(4);
+		Serializer::Writer badWr;
+		bad.Save(badWr);
+		const std::string badData = badWr.GetData();
+		Serializer::Reader rd(badData);
+		MeshData loaded;
+		bool thrown = false;
+		try {
+			loaded.Load(rd);
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	// cut short
+	{
+		Serializer::Reader rd(saved.substr(0, saved.size() - 8));
+		MeshData loaded;
+		bool thrown = false;
+		try {
+			loaded.Load(rd);
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	// collision meshes: the same, and the indices are checked too
+	{
+		CollisionMeshData coll;
+		coll.vertices = mesh.surfaces[0].positions;
+		coll.indices = mesh.surfaces[0].indices;
+		Serializer::Writer collWr;
+		coll.Save(collWr);
+		const std::string collData = collWr.GetData();
+		Serializer::Reader rd(collData);
+		CollisionMeshData loaded;
+		loaded.Load(rd);
+		CHECK(rd.AtEnd());
+		CHECK(same_vecs(loaded.vertices, coll.vertices) && loaded.indices == coll.indices);
+
+		coll.indices.push_back(100);
+		Serializer::Writer badWr;
+		coll.Save(badWr);
+		const std::string badData = badWr.GetData();
+		Serializer::Reader badRd(badData);
+		CollisionMeshData badLoaded;
+		bool thrown = false;
+		try {
+			badLoaded.Load(badRd);
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	const int failures = test_failures() - failuresBefore;
+	printf("mesh data: %d failures\n", failures);
+	return failures;
+}
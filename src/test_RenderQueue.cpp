@@ -0,0 +1,119 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "graphics/Graphics.h"
+#include "graphics/Material.h"
+#include "graphics/RendererNull.h"
+#include "graphics/RenderQueue.h"
+#include "graphics/StaticMesh.h"
+#include "graphics/Surface.h"
+#include "graphics/VertexArray.h"
+#include <cstdio>
+
+using namespace Graphics;
+
+static std::vector<int> s_deferredOrder;
+
+class TestDeferred : public RenderQueue::Deferred {
+public:
+	TestDeferred(int id) : m_id(id) {}
+	virtual void Render(Renderer *r) { s_deferredOrder.push_back(m_id); }
+private:
+	int m_id;
+};
+
+static matrix4x4f at(float z)
+{
+	return matrix4x4f::Translation(0.f, 0.f, z);
+}
+
+// draws the same meshes through the queue and without it, and compares
+// what the null renderer was asked to do
+int test_render_queue()
+{
+	const int failuresBefore = test_failures();
+
+	Settings settings = {};
+	settings.width = 800;
+	settings.height = 600;
+	settings.nullRenderer = true;
+	RendererNull r(settings);
+
+	MaterialDescriptor desc;
+	RefCountedPtr<Material> hull(r.CreateMaterial(desc));
+	RefCountedPtr<Material> glass(r.CreateMaterial(desc));
+
+	// two models sharing their materials, as the same model's instances do
+	StaticMesh a(TRIANGLES), b(TRIANGLES);
+	a.AddSurface(RefCountedPtr<Surface>(test_make_surface(hull.Get())));
+	a.AddSurface(RefCountedPtr<Surface>(test_make_surface(glass.Get())));
+	b.AddSurface(RefCountedPtr<Surface>(test_make_surface(hull.Get())));
+	b.AddSurface(RefCountedPtr<Surface>(test_make_surface(glass.Get())));
+
+	// in the order given, every surface changes the material
+	r.BeginFrame();
+	for (int i = 0; i < 4; i++) {
+		r.SetTransform(at(-10.f * i));
+		r.DrawStaticMesh(i % 2 ? &b : &a);
+	}
+	r.EndFrame();
+	r.SwapBuffers();
+	CHECK(r.GetFrameStats().drawCalls == 8);
+	CHECK(r.GetFrameStats().materialChanges == 8);
+
+	// queued, each material is used once
+	RenderQueue queue;
+	RenderQueue::ClearStats();
+	r.BeginFrame();
+	r.SetRenderQueue(&queue);
+	for (int i = 0; i < 4; i++)
+		queue.AddStaticMesh(i % 2 ? &b : &a, at(-10.f * i), BLEND_SOLID);
+	CHECK(r.GetRenderQueue() == &queue);
+	CHECK(!queue.IsEmpty());
+	r.SetRenderQueue(0);
+	CHECK(queue.IsEmpty());
+	r.EndFrame();
+	r.SwapBuffers();
+	CHECK(r.GetFrameStats().drawCalls == 8);
+	CHECK(r.GetFrameStats().materialChanges == 2);
+	CHECK(r.GetFrameStats().transforms == 8);
+	{
+		const RenderQueue::Stats stats = RenderQueue::GetStats();
+		CHECK(stats.flushes == 1);
+		CHECK(stats.solids == 8);
+		CHECK(stats.materialBinds == 2);
+		CHECK(stats.meshBinds == 4); // instances of a mesh are drawn together
+	}
+
+	// solids are drawn before anything blended, and deferred things
+	// are drawn furthest first
+	s_deferredOrder.clear();
+	r.SetRecordCommands(true);
+	r.BeginFrame();
+	r.SetRenderQueue(&queue);
+	queue.AddStaticMesh(&a, at(-10.f), BLEND_SOLID);
+	queue.AddDeferred(new TestDeferred(1), 10.f);
+	queue.AddDeferred(new TestDeferred(2), 30.f);
+	queue.AddDeferred(new TestDeferred(3), 20.f);
+	r.SetBlendMode(BLEND_ALPHA);
+	CHECK(queue.IsEmpty());
+	r.SetRenderQueue(0);
+	r.EndFrame();
+	r.SwapBuffers();
+	CHECK(s_deferredOrder.size() == 3);
+	CHECK(s_deferredOrder.size() == 3 && s_deferredOrder[0] == 2 && s_deferredOrder[1] == 3 && s_deferredOrder[2] == 1);
+	{
+		const std::vector<RendererNull::Command> &cmds = r.GetFrameCommands();
+		bool drawnBeforeBlend = false;
+		for (size_t i = 0; i < cmds.size(); i++) {
+			if (cmds[i].type == RendererNull::CMD_DRAW_STATIC_MESH) drawnBeforeBlend = true;
+			if (cmds[i].type == RendererNull::CMD_BLEND && cmds[i].value == BLEND_ALPHA) break;
+		}
+		CHECK(drawnBeforeBlend);
+	}
+
+	const int failures = test_failures() - failuresBefore;
+	printf("render queue: %d failures\n", failures);
+	return failures;
+}
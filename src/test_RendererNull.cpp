@@ -0,0 +1,95 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "graphics/Graphics.h"
+#include "graphics/Material.h"
+#include "graphics/RendererNull.h"
+#include "graphics/StaticMesh.h"
+#include "graphics/Surface.h"
+#include "graphics/VertexArray.h"
+#include <cstdio>
+
+using namespace Graphics;
+
+// the null renderer needs no GL context as long as nothing makes textures
+int test_renderer_null()
+{
+	const int failuresBefore = test_failures();
+
+	Settings settings = {};
+	settings.width = 800;
+	settings.height = 600;
+	settings.nullRenderer = true;
+	RendererNull r(settings);
+	r.SetRecordCommands(true);
+
+	MaterialDescriptor desc;
+	Material *a = r.CreateMaterial(desc);
+	Material *b = r.CreateMaterial(desc);
+
+	StaticMesh mesh(TRIANGLES);
+	mesh.AddSurface(RefCountedPtr<Surface>(test_make_surface(a)));
+	mesh.AddSurface(RefCountedPtr<Surface>(test_make_surface(b)));
+	const int surfaceBytes = 3 * int(2 * sizeof(vector3f) + sizeof(vector2f)) + 3 * int(sizeof(unsigned short));
+
+	VertexArray tris(ATTRIB_POSITION, 3);
+	tris.Add(vector3f(0.f));
+	tris.Add(vector3f(1.f, 0.f, 0.f));
+	tris.Add(vector3f(0.f, 1.f, 0.f));
+
+	// first frame: the mesh is sent, and the blend mode is set twice
+	r.BeginFrame();
+	r.SetTransform(matrix4x4f::Identity());
+	r.DrawStaticMesh(&mesh);
+	r.SetBlendMode(BLEND_ALPHA);
+	r.SetBlendMode(BLEND_ALPHA);
+	r.DrawTriangles(&tris, b);
+	r.DrawTriangles(&tris, b);
+	r.EndFrame();
+	r.SwapBuffers();
+	{
+		const RendererNull::FrameStats &stats = r.GetFrameStats();
+		CHECK(r.GetFrameCount() == 1);
+		CHECK(stats.drawCalls == 4);
+		CHECK(stats.vertices == 12);
+		CHECK(stats.indices == 6);
+		CHECK(stats.materialChanges == 2);
+		CHECK(stats.blendChanges == 1);
+		CHECK(stats.redundantStates == 1);
+		CHECK(stats.transforms == 1);
+		CHECK(stats.bytesSubmitted == 2 * surfaceBytes + 2 * 3 * int(sizeof(vector3f)));
+		CHECK(stats.materialsCreated == 2);
+
+		const std::vector<RendererNull::Command> &cmds = r.GetFrameCommands();
+		CHECK(cmds.size() == 7);
+		CHECK(cmds[0].type == RendererNull::CMD_CLEAR);
+		CHECK(cmds[2].type == RendererNull::CMD_DRAW_STATIC_MESH && cmds[2].material == a);
+		CHECK(cmds[4].type == RendererNull::CMD_BLEND && cmds[4].value == BLEND_ALPHA);
+		CHECK(cmds[6].type == RendererNull::CMD_DRAW_TRIANGLES && cmds[6].material == b);
+	}
+
+	// second frame: the mesh is already buffered, and state pushed and
+	// popped comes back
+	r.BeginFrame();
+	{
+		Renderer::StateTicket ticket(&r);
+		r.SetBlendMode(BLEND_SOLID);
+	}
+	r.SetBlendMode(BLEND_ALPHA);
+	r.DrawStaticMesh(&mesh);
+	r.EndFrame();
+	r.SwapBuffers();
+	{
+		const RendererNull::FrameStats &stats = r.GetFrameStats();
+		CHECK(stats.drawCalls == 2);
+		CHECK(stats.bytesSubmitted == 0);
+		CHECK(stats.blendChanges == 1);
+		CHECK(stats.redundantStates == 1);
+		CHECK(stats.materialsCreated == 0);
+	}
+
+	const int failures = test_failures() - failuresBefore;
+	printf("renderer null: %d failures\n", failures);
+	return failures;
+}
@@ -0,0 +1,200 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "Serializer.h"
+#include "SaveContainer.h"
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+
+// nested sections around enough data that the file writer has to go back
+// into the file to fill in the outer lengths
+static void write_test_data(Serializer::Writer &wr)
+{
+	wr.Int32(0xdeadbeef);
+	wr.BeginSection("outer");
+	wr.String("hello");
+	for (int i = 0; i < 100000; i++)
+		wr.Double(i * 0.5);
+	wr.BeginSection("inner");
+	wr.Int64(0x0123456789abcdefULL);
+	wr.Int16(0xbeef);
+	wr.EndSection();
+	wr.Bool(true);
+	wr.EndSection();
+	wr.BeginSection("empty");
+	wr.EndSection();
+	wr.Byte(42);
+}
+
+static void read_test_data(Serializer::Reader &rd)
+{
+	CHECK(rd.Int32() == 0xdeadbeef);
+	Serializer::Reader outer = rd.RdSection("outer");
+	CHECK(outer.String() == "hello");
+	bool doublesOk = true;
+	for (int i = 0; i < 100000; i++)
+		if (outer.Double() != i * 0.5) doublesOk = false;
+	CHECK(doublesOk);
+	Serializer::Reader inner = outer.RdSection("inner");
+	CHECK(inner.Int64() == 0x0123456789abcdefULL);
+	CHECK(inner.Int16() == 0xbeef);
+	CHECK(inner.AtEnd());
+	CHECK(outer.Bool());
+	CHECK(outer.AtEnd());
+	Serializer::Reader empty = rd.RdSection("empty");
+	CHECK(empty.AtEnd());
+	CHECK(rd.Byte() == 42);
+	CHECK(rd.AtEnd());
+}
+
+int test_serializer()
+{
+	const int failuresBefore = test_failures();
+
+	// sections are stored the same way as a label string then a data string
+	{
+		Serializer::Writer section;
+		section.Int32(7);
+		Serializer::Writer expected;
+		expected.String("label");
+		expected.String(section.GetData());
+
+		Serializer::Writer wr;
+		wr.BeginSection("label");
+		wr.Int32(7);
+		wr.EndSection();
+		CHECK(wr.GetData() == expected.GetData());
+	}
+
+	std::string memData;
+	{
+		Serializer::Writer wr;
+		write_test_data(wr);
+		memData = wr.GetData();
+		Serializer::Reader rd(memData);
+		read_test_data(rd);
+	}
+
+	{
+		FILE *f = tmpfile();
+		Serializer::Writer wr(f);
+		write_test_data(wr);
+		wr.Flush();
+
+		std::string fileData(size_t(ftell(f)), '\0');
+		rewind(f);
+		CHECK(fread(&fileData[0], fileData.size(), 1, f) == 1);
+		fclose(f);
+		CHECK(fileData == memData);
+	}
+
+	{
+		Serializer::Reader rd(memData.substr(0, memData.size() / 2));
+		bool thrown = false;
+		try {
+			read_test_data(rd);
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	// a section other than the one asked for is an error
+	{
+		Serializer::Writer wr;
+		wr.BeginSection("first");
+		wr.Int32(1);
+		wr.EndSection();
+		const std::string data = wr.GetData();
+
+		Serializer::Reader rd(data);
+		bool thrown = false;
+		try {
+			rd.RdSection("second");
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	// packing as the file is written gives back the same bytes, including
+	// the lengths of sections whose start was packed before they finished
+	{
+		FILE *f = tmpfile();
+		Serializer::Writer wr(f, true);
+		write_test_data(wr);
+		wr.Flush();
+
+		std::string fileData(size_t(ftell(f)), '\0');
+		rewind(f);
+		CHECK(fread(&fileData[0], fileData.size(), 1, f) == 1);
+		fclose(f);
+		CHECK(SaveContainer::IsContainer(fileData.data(), fileData.size()));
+		CHECK(fileData.size() < memData.size());
+
+		size_t size;
+		int numBlocks;
+		char *data = SaveContainer::Unpack(fileData.data(), fileData.size(), 2, size, numBlocks);
+		CHECK(numBlocks > 1);
+		CHECK(std::string(data, size) == memData);
+		free(data);
+
+		// the patches are checked too
+		fileData[fileData.size() - 6] ^= 0x55;
+		bool thrown = false;
+		try {
+			free(SaveContainer::Unpack(fileData.data(), fileData.size(), 2, size, numBlocks));
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	// packing gives back the same bytes, whatever the number of threads,
+	// and a damaged block is caught
+	{
+		Serializer::Writer wr;
+		wr.Byte('P'); wr.Byte(0); wr.Int32(1); // like a save's signature
+		wr.BeginSection("small");
+		write_test_data(wr);
+		wr.EndSection();
+		wr.BeginSection("big");
+		for (int i = 0; i < 400000; i++)
+			wr.Int32(i);
+		wr.EndSection();
+		wr.Byte('E'); wr.Byte(0);
+		const std::string plain = wr.GetData();
+
+		std::string packed;
+		SaveContainer::Pack(plain.data(), plain.size(), packed);
+		CHECK(SaveContainer::IsContainer(packed.data(), packed.size()));
+		CHECK(!SaveContainer::IsContainer(plain.data(), plain.size()));
+		CHECK(packed.size() < plain.size());
+
+		for (int numThreads = 1; numThreads <= 4; numThreads += 3) {
+			size_t size;
+			int numBlocks;
+			char *data = SaveContainer::Unpack(packed.data(), packed.size(), numThreads, size, numBlocks);
+			CHECK(numBlocks > 4);
+			CHECK(std::string(data, size) == plain);
+			free(data);
+		}
+
+		packed[packed.size() / 2] ^= 0x55;
+		bool thrown = false;
+		try {
+			size_t size;
+			int numBlocks;
+			free(SaveContainer::Unpack(packed.data(), packed.size(), 2, size, numBlocks));
+		} catch (SavedGameCorruptException) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	const int failures = test_failures() - failuresBefore;
+	printf("serializer: %d failures\n", failures);
+	return failures;
+}
@@ -0,0 +1,96 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "tests.h"
+#include "terrain/Terrain.h"
+#include "Pi.h"
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+// the terrain reads its detail settings from here, and Pi isn't in the tests
+DetailLevel Pi::detail;
+
+static fixed random_fraction(MTRand &rand)
+{
+	return fixed(rand.Int32(1001), 1000);
+}
+
+// a body made up enough that the terrain picks its fractals from it the way
+// it does for generated systems
+static void make_body(SystemBody &body, SystemBody::BodyType type, MTRand &rand)
+{
+	body.type = type;
+	body.seed = rand.Int32();
+	body.radius = fixed(rand.Int32(1, 2000), 1000);
+	body.mass = fixed(rand.Int32(1, 2000), 1000);
+	body.averageTemp = rand.Int32(50, 400);
+	body.m_metallicity = random_fraction(rand);
+	body.m_volatileGas = random_fraction(rand);
+	body.m_volatileLiquid = random_fraction(rand);
+	body.m_volatileIces = random_fraction(rand);
+	body.m_volcanicity = random_fraction(rand);
+	body.m_life = random_fraction(rand);
+}
+
+// every fractal has its own batch loop for GetHeights and GetColors, and the
+// single point versions have to give exactly the same results, as patches
+// are built with the batch ones and other things ask for single points
+int test_terrain()
+{
+	const int failuresBefore = test_failures();
+
+	const SystemBody::BodyType types[] = {
+		SystemBody::TYPE_BROWN_DWARF, SystemBody::TYPE_WHITE_DWARF,
+		SystemBody::TYPE_STAR_M, SystemBody::TYPE_STAR_K, SystemBody::TYPE_STAR_G,
+		SystemBody::TYPE_STAR_F, SystemBody::TYPE_STAR_A, SystemBody::TYPE_STAR_B,
+		SystemBody::TYPE_STAR_O, SystemBody::TYPE_STAR_M_WF, SystemBody::TYPE_STAR_S_BH,
+		SystemBody::TYPE_PLANET_GAS_GIANT, SystemBody::TYPE_PLANET_ASTEROID,
+		SystemBody::TYPE_PLANET_TERRESTRIAL
+	};
+	const int NUM_POINTS = 100;
+	vector3d points[NUM_POINTS], norms[NUM_POINTS], colors[NUM_POINTS], batchColors[NUM_POINTS];
+	double heights[NUM_POINTS], batchHeights[NUM_POINTS];
+
+	std::set<std::string> fractals;
+	int mismatches = 0;
+	for (int textures = 0; textures < 2; textures++) {
+		Pi::detail.textures = textures;
+		Pi::detail.fracmult = 1;
+		for (unsigned t = 0; t < COUNTOF(types); t++) {
+			// terrestrial planets have the most fractals to choose from
+			const int numBodies = types[t] == SystemBody::TYPE_PLANET_TERRESTRIAL ? 150 : 8;
+			for (int n = 0; n < numBodies; n++) {
+				MTRand rand(n * 64 + types[t]);
+				SystemBody body;
+				make_body(body, types[t], rand);
+				Terrain *terrain = Terrain::InstanceTerrain(&body);
+				fractals.insert(std::string(terrain->GetHeightFractalName()) + "/" + terrain->GetColorFractalName());
+
+				for (int i = 0; i < NUM_POINTS; i++) {
+					points[i] = vector3d(rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0)).Normalized();
+					const vector3d tilt(rand.Double(-0.3, 0.3), rand.Double(-0.3, 0.3), rand.Double(-0.3, 0.3));
+					norms[i] = (points[i] + tilt).Normalized();
+					heights[i] = terrain->GetHeight(points[i]);
+					colors[i] = terrain->GetColor(points[i], heights[i], norms[i]);
+				}
+				terrain->GetHeights(points, batchHeights, NUM_POINTS);
+				terrain->GetColors(points, batchHeights, norms, batchColors, NUM_POINTS);
+
+				// bit for bit, so no tolerance
+				if (memcmp(heights, batchHeights, sizeof(heights)) || memcmp(colors, batchColors, sizeof(colors))) {
+					printf("batch differs for %s/%s\n", terrain->GetHeightFractalName(), terrain->GetColorFractalName());
+					mismatches++;
+				}
+				delete terrain;
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+	// make sure the bodies above really reach most of the fractals
+	CHECK(fractals.size() >= 40);
+
+	const int failures = test_failures() - failuresBefore;
+	printf("terrain: %d failures\n", failures);
+	return failures;
+}
@@ -1,14 +1,65 @@
 // Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
 // Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
 
+#include "tests.h"
+#include "graphics/Material.h"
+#include "graphics/Surface.h"
+#include "graphics/VertexArray.h"
+#include <cstdio>
+
+static int s_failures = 0;
+
+void test_check(int line, bool ok, const char *what)
+{
+	if (ok)
+		printf("[line %5d] OK (%s)\n", line, what);
+	else {
+		printf("[line %5d] FAIL (%s)\n", line, what);
+		s_failures++;
+	}
+}
+
+int test_failures()
+{
+	return s_failures;
+}
+
+Graphics::Surface *test_make_surface(Graphics::Material *m)
+{
+	using namespace Graphics;
+	VertexArray *va = new VertexArray(ATTRIB_POSITION | ATTRIB_NORMAL | ATTRIB_UV0, 3);
+	va->Add(vector3f(0.f), vector3f(0.f, 0.f, 1.f), vector2f(0.f));
+	va->Add(vector3f(1.f, 0.f, 0.f), vector3f(0.f, 0.f, 1.f), vector2f(0.f));
+	va->Add(vector3f(0.f, 1.f, 0.f), vector3f(0.f, 0.f, 1.f), vector2f(0.f));
+	Surface *s = new Surface(TRIANGLES, va, RefCountedPtr<Material>(m));
+	s->GetIndices().push_back(0);
+	s->GetIndices().push_back(1);
+	s->GetIndices().push_back(2);
+	return s;
+}
+
 void test_frames();
 void test_stringf();
 void test_filesystem();
+// these return how many of their checks failed
+int test_serializer();
+int test_renderer_null();
+int test_render_queue();
+int test_kepler();
+int test_meshdata();
+int test_terrain();
 
 int main(int argc, char *argv[])
 {
 	test_frames();
 	test_stringf();
 	test_filesystem();
-	return 0;
+	int failures = 0;
+	failures += test_serializer();
+	failures += test_renderer_null();
+	failures += test_render_queue();
+	failures += test_kepler();
+	failures += test_meshdata();
+	failures += test_terrain();
+	return failures ? 1 : 0;
 }
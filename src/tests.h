@@ -0,0 +1,25 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _TESTS_H
+#define _TESTS_H
+
+// shared by the test_*.cpp files. defined in tests.cpp
+
+namespace Graphics {
+	class Material;
+	class Surface;
+}
+
+// prints the check and counts it if it failed
+void test_check(int line, bool ok, const char *what);
+#define CHECK(cond) test_check(__LINE__, (cond), #cond)
+
+// failed checks so far, in all tests. a test returns the difference
+// between this at its start and end
+int test_failures();
+
+// a single triangle with positions, normals and uvs
+Graphics::Surface *test_make_surface(Graphics::Material *m);
+
+#endif
@@ -56,6 +56,7 @@ int main(int argc, char **argv)
 	videoSettings.requestedSamples = 0;
 	videoSettings.vsync = false;
 	videoSettings.useTextureCompression = false;
+	videoSettings.nullRenderer = false;
 	Graphics::Renderer *r = Graphics::Init(videoSettings);
 
 	r->SetOrthographicProjection(0, WIDTH, HEIGHT, 0, -1, 1);
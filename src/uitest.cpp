@@ -135,6 +135,7 @@ int main(int argc, char **argv)
 	videoSettings.requestedSamples = 0;
 	videoSettings.vsync = false;
 	videoSettings.useTextureCompression = false;
+	videoSettings.nullRenderer = false;
 	Graphics::Renderer *r = Graphics::Init(videoSettings);
 
 	Lua::Init();
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <algorithm>
 #include <cerrno>
+#include <io.h>
 
 // I hate macros. I just hate them. Hate hate hate.
 #undef FT_FILE
@@ -223,6 +224,25 @@ namespace FileSystem {
 		return make_directory_raw(wfullpath);
 	}
 
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
+		return (DeleteFileW(wfullpath.c_str()) != 0);
+	}
+
+	bool FileSourceFS::RenameFile(const std::string &oldPath, const std::string &newPath)
+	{
+		const std::wstring woldpath = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), oldPath));
+		const std::wstring wnewpath = transcode_utf8_to_utf16(JoinPathBelow(GetRoot(), newPath));
+		return (MoveFileExW(woldpath.c_str(), wnewpath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+	}
+
+	bool FileSourceFS::SyncWriteStream(FILE *f)
+	{
+		return (fflush(f) == 0 && _commit(_fileno(f)) == 0);
+	}
+
 	static FILE* open_file_raw(const std::string &fullpath, const wchar_t *mode)
 	{
 		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
@@ -117,4 +117,11 @@ Uint64 HFTimer()
 	return i.QuadPart;
 }
 
+int GetNumCPUs()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? int(info.dwNumberOfProcessors) : 1;
+}
+
 } // namespace OS